@@ -0,0 +1,86 @@
+#!/usr/bin/env bash
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7149" # git grep '\<7149\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+function get_propose_batched() {
+    CEPH_ARGS='' ceph --admin-daemon $(get_asok_path mon.a) \
+        perf dump paxos | jq '.paxos.propose_batched'
+}
+
+# update three services at once; each arms its proposal timer, and the
+# first one to fire proposes for all of them.
+function update_services() {
+    local dir=$1
+
+    ceph osd set noout > $dir/osd.out 2>&1 &
+    local osd_pid=$!
+    ceph config-key set propose-batch-test value > $dir/kv.out 2>&1 &
+    local kv_pid=$!
+    ceph config set mon.a debug_paxos 10 > $dir/config.out 2>&1 &
+    local config_pid=$!
+    wait $osd_pid || return 1
+    wait $kv_pid || return 1
+    wait $config_pid || return 1
+}
+
+function TEST_propose_batch() {
+    local dir=$1
+
+    # every armed proposal timer is due within paxos_min_wait
+    run_mon $dir a \
+        --paxos-propose-batch=true \
+        --paxos-propose-interval=5 \
+        --paxos-min-wait=5 || return 1
+    test "$(get_propose_batched)" = 0 || return 1
+
+    update_services $dir || return 1
+    ceph osd dump | grep -q noout || return 1
+    ceph config-key get propose-batch-test | grep -q value || return 1
+    test "$(get_propose_batched)" -gt 0 || return 1
+}
+
+function TEST_propose_no_batch() {
+    local dir=$1
+
+    # off by default
+    run_mon $dir a \
+        --paxos-propose-interval=5 \
+        --paxos-min-wait=5 || return 1
+
+    update_services $dir || return 1
+    ceph osd dump | grep -q noout || return 1
+    test "$(get_propose_batched)" = 0 || return 1
+}
+
+main mon-propose-batch "$@"
+
+# Local Variables:
+# compile-command: "cd ../.. ; make -j4 && test/mon/mon-propose-batch.sh"
+# End:
@@ -9,6 +9,15 @@
 #include "include/types.h"
 #include "include/buffer.h"
 
+/// what a CDC found in some data, which it can reuse when the same data is
+/// chunked again, e.g. at another target size
+struct cdc_boundary_index_t {
+  uint64_t length = 0;  ///< of the data
+  uint64_t mask = 0;    ///< the fingerprints below match at least these bits
+  /// (offset, fingerprint) of the candidate cut points, in order
+  std::vector<std::pair<uint64_t, uint64_t>> matches;
+};
+
 class CDC {
 public:
   virtual ~CDC() = default;
@@ -18,6 +27,15 @@ public:
     const bufferlist& inputdata,
     std::vector<std::pair<uint64_t, uint64_t>> *chunks) const = 0;
 
+  /// as above, reusing @p index if it was built for @p inputdata by a
+  /// compatible CDC, rebuilding it otherwise
+  virtual void calc_chunks(
+    const bufferlist& inputdata,
+    std::vector<std::pair<uint64_t, uint64_t>> *chunks,
+    cdc_boundary_index_t *index) const {
+    calc_chunks(inputdata, chunks);
+  }
+
   /// set target chunk size as a power of 2, and number of bits for hard min/max
   virtual void set_target_bits(int bits, int windowbits = 2) = 0;
 
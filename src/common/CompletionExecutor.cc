@@ -0,0 +1,258 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "CompletionExecutor.h"
+
+#include "common/Clock.h"
+#include "common/debug.h"
+#include "common/perf_counters.h"
+
+#define dout_subsys ceph_subsys_finisher
+#undef dout_prefix
+#define dout_prefix *_dout << "completion_executor(" << this << ") "
+
+namespace {
+/// the executor and shard of the calling thread, if it is a worker
+thread_local CompletionExecutor *current_executor = nullptr;
+thread_local unsigned current_shard = 0;
+}
+
+CompletionExecutor::Strand::Strand(CompletionExecutor *ex,
+				   const std::string& name,
+				   int affinity)
+  : ex(ex),
+    affinity(affinity),
+    lock(ceph::make_mutex("CompletionExecutor::Strand::" + name))
+{
+}
+
+void CompletionExecutor::Strand::queue(Context *c, int r)
+{
+  std::lock_guard l(lock);
+  q.emplace_back(c, r);
+  _queued(1);
+}
+
+void CompletionExecutor::Strand::_queued(size_t n)
+{
+  ceph_assert(ceph_mutex_is_locked(lock));
+  if (logger) {
+    logger->inc(l_queue_len, n);
+  }
+  if (!scheduled) {
+    scheduled = true;
+    ex->_queue(Task{nullptr, 0, this}, affinity);
+  }
+}
+
+void CompletionExecutor::Strand::wait_for_empty()
+{
+  std::unique_lock l(lock);
+  empty_cond.wait(l, [this] { return !scheduled; });
+}
+
+void CompletionExecutor::Strand::run()
+{
+  std::unique_lock l(lock);
+  // as the Finisher did, swap the queue out so that the Contexts completed
+  // can queue more without contending with us
+  in_progress.swap(q);
+  l.unlock();
+
+  utime_t start;
+  uint64_t count = in_progress.size();
+  if (logger) {
+    start = ceph_clock_now();
+  }
+  for (auto& p : in_progress) {
+    p.first->complete(p.second);
+  }
+  in_progress.clear();
+  if (logger) {
+    logger->dec(l_queue_len, count);
+    logger->tinc(l_complete_lat, ceph_clock_now() - start);
+  }
+
+  l.lock();
+  if (!q.empty()) {
+    // go to the back of this worker's queue, in reach of the idle ones
+    ex->_queue(Task{nullptr, 0, this}, AFFINITY_ANY);
+  } else {
+    scheduled = false;
+    empty_cond.notify_all();
+  }
+}
+
+CompletionExecutor::CompletionExecutor(CephContext *cct,
+				       std::string thread_name,
+				       unsigned num_shards)
+  : cct(cct),
+    thread_name(std::move(thread_name)),
+    empty_lock(ceph::make_mutex("CompletionExecutor::empty_lock"))
+{
+  ceph_assert(num_shards > 0);
+  for (unsigned i = 0; i < num_shards; ++i) {
+    shards.emplace_back(std::make_unique<Shard>(
+      "CompletionExecutor::" + this->thread_name + "-" + std::to_string(i)));
+  }
+}
+
+CompletionExecutor::~CompletionExecutor()
+{
+  ceph_assert(workers.empty());
+}
+
+void CompletionExecutor::start()
+{
+  ldout(cct, 10) << __func__ << " " << shards.size() << " shards" << dendl;
+  ceph_assert(workers.empty());
+  for (unsigned i = 0; i < shards.size(); ++i) {
+    {
+      std::lock_guard l(shards[i]->lock);
+      shards[i]->stopping = false;
+    }
+    workers.emplace_back(std::make_unique<Worker>(this, i));
+    // tell the workers apart if there are several of them
+    std::string name = thread_name;
+    if (shards.size() > 1) {
+      name += std::to_string(i);
+    }
+    workers.back()->create(name.c_str());
+  }
+}
+
+void CompletionExecutor::stop()
+{
+  ldout(cct, 10) << __func__ << dendl;
+  if (workers.empty()) {
+    // never started, keep what is queued for start()
+    return;
+  }
+  // let the workers complete what is queued, including whatever that
+  // queues in turn on the other shards
+  wait_for_empty();
+  for (auto& s : shards) {
+    std::lock_guard l(s->lock);
+    s->stopping = true;
+    s->cond.notify_all();
+  }
+  for (auto& w : workers) {
+    w->join();
+  }
+  workers.clear();
+  ldout(cct, 10) << __func__ << " finish" << dendl;
+}
+
+void CompletionExecutor::wait_for_empty()
+{
+  std::unique_lock l(empty_lock);
+  ++empty_waiters;
+  empty_cond.wait(l, [this] { return pending == 0; });
+  --empty_waiters;
+}
+
+unsigned CompletionExecutor::pick_shard(int affinity)
+{
+  if (affinity >= 0) {
+    return affinity % shards.size();
+  }
+  if (current_executor == this) {
+    return current_shard;
+  }
+  return next_shard++ % shards.size();
+}
+
+void CompletionExecutor::_queue(Task&& t, int affinity)
+{
+  ++pending;
+  unsigned id = pick_shard(affinity);
+  auto& s = *shards[id];
+  {
+    std::lock_guard l(s.lock);
+    s.q.push_back(std::move(t));
+    if (s.idle) {
+      s.cond.notify_one();
+      return;
+    }
+  }
+  if (num_idle == 0) {
+    return;
+  }
+  // the worker of this shard is busy, hand the task to an idle one
+  for (unsigned k = 1; k < shards.size(); ++k) {
+    auto& o = *shards[(id + k) % shards.size()];
+    std::lock_guard l(o.lock);
+    if (o.idle) {
+      o.cond.notify_one();
+      return;
+    }
+  }
+}
+
+bool CompletionExecutor::steal(unsigned id, Task *t)
+{
+  for (unsigned k = 1; k < shards.size(); ++k) {
+    auto& o = *shards[(id + k) % shards.size()];
+    std::lock_guard l(o.lock);
+    // an idle worker is being woken up for its own queue
+    if (!o.idle && !o.q.empty()) {
+      *t = o.q.front();
+      o.q.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void CompletionExecutor::run(const Task& t)
+{
+  if (t.strand) {
+    t.strand->run();
+  } else {
+    t.c->complete(t.r);
+  }
+  if (--pending == 0 && empty_waiters > 0) {
+    std::lock_guard l(empty_lock);
+    empty_cond.notify_all();
+  }
+}
+
+void CompletionExecutor::worker_entry(unsigned id)
+{
+  ldout(cct, 10) << __func__ << " " << id << " start" << dendl;
+  current_executor = this;
+  current_shard = id;
+  auto& s = *shards[id];
+  std::unique_lock l(s.lock);
+  while (true) {
+    // drain the shard before stopping, a strand requeues itself here
+    if (!s.q.empty()) {
+      Task t = s.q.front();
+      s.q.pop_front();
+      l.unlock();
+      run(t);
+      l.lock();
+      continue;
+    }
+    if (s.stopping) {
+      break;
+    }
+    l.unlock();
+    Task t;
+    bool stolen = steal(id, &t);
+    if (stolen) {
+      run(t);
+    }
+    l.lock();
+    if (stolen || !s.q.empty() || s.stopping) {
+      continue;
+    }
+    s.idle = true;
+    ++num_idle;
+    s.cond.wait(l);
+    --num_idle;
+    s.idle = false;
+  }
+  current_executor = nullptr;
+  ldout(cct, 10) << __func__ << " " << id << " stop" << dendl;
+}
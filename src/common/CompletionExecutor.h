@@ -0,0 +1,173 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_COMPLETIONEXECUTOR_H
+#define CEPH_COMPLETIONEXECUTOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include/Context.h"
+#include "include/common_fwd.h"
+#include "common/Thread.h"
+#include "common/ceph_mutex.h"
+
+/**
+ * CompletionExecutor
+ *
+ * Completes Contexts on a set of worker threads, one per shard.  A Context
+ * is queued on the shard picked by its affinity hint; without a hint, a
+ * Context queued by one of the workers stays on that worker, so that a
+ * completion chain runs where it started, with its data still in cache.
+ * Workers with nothing to do steal from the other shards.
+ *
+ * Contexts queued directly may complete in any order.  Those which must
+ * complete in the order they were queued go through a Strand.
+ */
+class CompletionExecutor {
+public:
+  static constexpr int AFFINITY_ANY = -1;
+
+  /**
+   * Strand
+   *
+   * A FIFO of Contexts, completed in batches by one worker at a time: the
+   * strand is queued on its executor as a whole, and may be stolen as a
+   * whole.
+   */
+  class Strand {
+  public:
+    Strand(CompletionExecutor *ex, const std::string& name,
+	   int affinity = AFFINITY_ANY);
+    Strand(const Strand&) = delete;
+    Strand& operator=(const Strand&) = delete;
+
+    void queue(Context *c, int r = 0);
+    template<typename Container>
+    void queue(Container& ls) {
+      if (ls.empty()) {
+	return;
+      }
+      {
+	std::lock_guard l(lock);
+	for (auto c : ls) {
+	  q.emplace_back(c, 0);
+	}
+	_queued(ls.size());
+      }
+      ls.clear();
+    }
+
+    /// blocks until everything queued so far is completed; must not be
+    /// called from one of the strand's Contexts
+    void wait_for_empty();
+
+    /// account the queue length and the latency of the batches in
+    /// @p logger, under the given counter ids
+    void set_logger(PerfCounters *l, int queue_len, int complete_lat) {
+      logger = l;
+      l_queue_len = queue_len;
+      l_complete_lat = complete_lat;
+    }
+
+  private:
+    friend class CompletionExecutor;
+
+    CompletionExecutor *ex;
+    const int affinity;
+    ceph::mutex lock;
+    ceph::condition_variable empty_cond;
+    std::vector<std::pair<Context*,int>> q;
+    std::vector<std::pair<Context*,int>> in_progress;
+    bool scheduled = false;  ///< queued on the executor, or running
+    PerfCounters *logger = nullptr;
+    int l_queue_len = 0;
+    int l_complete_lat = 0;
+
+    void _queued(size_t n);
+    void run();
+  };
+
+  /// the workers are named @p thread_name, followed by their shard index
+  /// if there are several
+  CompletionExecutor(CephContext *cct, std::string thread_name,
+		     unsigned num_shards);
+  ~CompletionExecutor();
+  CompletionExecutor(const CompletionExecutor&) = delete;
+  CompletionExecutor& operator=(const CompletionExecutor&) = delete;
+
+  /// start the workers
+  void start();
+  /** @brief Stop the workers.
+   *
+   * Waits until the outstanding Contexts are completed, and each worker
+   * drains its shard before exiting.  The sources queueing Contexts should
+   * be shut down first; whatever is queued after the workers exit is
+   * completed if the executor is started again.  Must not be called from
+   * one of the workers. */
+  void stop();
+
+  unsigned get_num_shards() const {
+    return shards.size();
+  }
+
+  /// complete @p c with @p r on the shard picked by @p affinity, modulo
+  /// the number of shards
+  void queue(Context *c, int r = 0, int affinity = AFFINITY_ANY) {
+    _queue(Task{c, r, nullptr}, affinity);
+  }
+
+  /// blocks until everything queued so far is completed
+  void wait_for_empty();
+
+private:
+  struct Task {
+    Context *c;
+    int r;
+    Strand *strand;  ///< run the strand instead, if set
+  };
+
+  struct Worker : public Thread {
+    CompletionExecutor *ex;
+    unsigned id;
+    Worker(CompletionExecutor *ex, unsigned id) : ex(ex), id(id) {}
+    void *entry() override {
+      ex->worker_entry(id);
+      return nullptr;
+    }
+  };
+
+  struct alignas(64) Shard {
+    ceph::mutex lock;
+    ceph::condition_variable cond;
+    std::deque<Task> q;
+    bool idle = false;
+    bool stopping = false;
+    explicit Shard(const std::string& name)
+      : lock(ceph::make_mutex(name)) {}
+  };
+
+  CephContext *cct;
+  const std::string thread_name;
+  std::vector<std::unique_ptr<Shard>> shards;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<unsigned> next_shard = {0};
+  std::atomic<unsigned> num_idle = {0};
+
+  std::atomic<uint64_t> pending = {0};
+  std::atomic<unsigned> empty_waiters = {0};
+  ceph::mutex empty_lock;
+  ceph::condition_variable empty_cond;
+
+  void _queue(Task&& t, int affinity);
+  unsigned pick_shard(int affinity);
+  bool steal(unsigned id, Task *t);
+  void run(const Task& t);
+  void worker_entry(unsigned id);
+};
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <random>
 
+#include "common/likely.h"
+
 #include "FastCDC.h"
 
 
@@ -71,51 +73,160 @@ void FastCDC::_setup(int target, int size_window_bits)
   }
 }
 
-static inline bool _scan(
-  // these are our cursor/postion...
-  bufferlist::buffers_t::const_iterator *p,
-  const char **pp, const char **pe,
-  size_t& pos,
-  size_t max,   // how much to read
-  uint64_t& fp, // fingerprint
-  uint64_t mask, const uint64_t *table)
+// The fingerprint is shifted left by one bit per byte, so once a window
+// of bytes is hashed, it no longer depends on where hashing started: at a
+// given offset, it is the same whether chunking started the window there
+// or hashed the whole buffer so far.  So the fingerprints are computed
+// once over the whole data, in four independent lanes to keep the
+// pipeline busy (the hash is a chain of dependent shifts), and the offsets where they match large_mask are kept.
+// The masks are nested (large_mask is a subset of target_mask, itself a
+// subset of small_mask, and a larger target only adds bits), so these
+// offsets are all the candidate cut points, for this target size and the
+// larger ones.  Chunking then walks the candidates instead of the data.
+
+// Below this, a buffer is hashed in one lane: each extra lane first hashes
+// the window before its start.
+#define MIN_LANE_BYTES  4096
+
+static inline uint64_t _index_one(
+  const uint64_t *table,
+  uint64_t mask,
+  size_t window,
+  const unsigned char *p, size_t len,
+  uint64_t off,  // of p in the data
+  uint64_t fp,   // of the bytes before p
+  std::vector<std::pair<uint64_t, uint64_t>> *matches)
+{
+  for (size_t i = 0; i < len; ++i) {
+    fp = (fp << 1) ^ table[p[i]];
+    if (unlikely((fp & mask) == mask) && off + i + 1 >= window) {
+      matches->emplace_back(off + i + 1, fp);
+    }
+  }
+  return fp;
+}
+
+// hash four lanes, n bytes apart, from q until one of them matches @p mask
+// (@return where) or until e; the lanes are spelled out and the loop calls
+// nothing, for the compiler to keep them all in registers
+static const unsigned char *_hash_four(
+  const uint64_t *table,
+  uint64_t mask,
+  const unsigned char *q, const unsigned char *e, size_t n,
+  uint64_t *f)
+{
+  uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3];
+  for (; q < e; ++q) {
+    f0 = (f0 << 1) ^ table[q[0]];
+    f1 = (f1 << 1) ^ table[q[n]];
+    f2 = (f2 << 1) ^ table[q[2 * n]];
+    f3 = (f3 << 1) ^ table[q[3 * n]];
+    if (unlikely(!(~f0 & mask) | !(~f1 & mask) |
+		 !(~f2 & mask) | !(~f3 & mask))) {
+      break;
+    }
+  }
+  f[0] = f0;
+  f[1] = f1;
+  f[2] = f2;
+  f[3] = f3;
+  return q;
+}
+
+static uint64_t _index_four(
+  const uint64_t *table,
+  uint64_t mask,
+  size_t window,
+  const unsigned char *p, size_t len,
+  uint64_t off,
+  uint64_t fp,
+  std::vector<std::pair<uint64_t, uint64_t>> *matches)
 {
-  while (pos < max) {
-    if (*pp == *pe) {
-      ++(*p);
-      *pp = (*p)->c_str();
-      *pe = *pp + (*p)->length();
+  // four quarters, hashed side by side
+  size_t n = len / 4;
+  uint64_t f[4] = {fp, 0, 0, 0};
+  for (const unsigned char *w = p + n - window; w < p + n; ++w) {
+    for (unsigned l = 1; l < 4; ++l) {
+      f[l] = (f[l] << 1) ^ table[w[(l - 1) * n]];
     }
-    const char *te = std::min(*pe, *pp + max - pos);
-    for (; *pp < te; ++(*pp), ++pos) {
-      if ((fp & mask) == mask) {
-	return false;
+  }
+  std::vector<std::pair<uint64_t, uint64_t>> found[3];
+  const unsigned char *e = p + n;
+  for (auto q = _hash_four(table, mask, p, e, n, f);
+       q < e;
+       q = _hash_four(table, mask, q + 1, e, n, f)) {
+    uint64_t pos = off + (q - p) + 1;
+    if (!(~f[0] & mask) && pos >= window) {
+      matches->emplace_back(pos, f[0]);
+    }
+    for (unsigned l = 1; l < 4; ++l) {
+      if (!(~f[l] & mask)) {
+	found[l - 1].emplace_back(pos + l * n, f[l]);
       }
-      fp = (fp << 1) ^ table[*(unsigned char*)*pp];
     }
-    if (pos >= max) {
-      return true;
+  }
+  for (auto& v : found) {
+    matches->insert(matches->end(), v.begin(), v.end());
+  }
+  // the last lane takes the remainder
+  return _index_one(table, mask, window, p + 4 * n, len - 4 * n,
+		    off + 4 * n, f[3], matches);
+}
+
+void FastCDC::build_index(
+  const bufferlist& bl,
+  cdc_boundary_index_t *index,
+  unsigned lanes) const
+{
+  index->length = bl.length();
+  index->mask = large_mask;
+  index->matches.clear();
+
+  uint64_t off = 0;
+  uint64_t fp = 0;
+  for (auto& b : bl.buffers()) {
+    auto p = (const unsigned char*)b.c_str();
+    size_t len = b.length();
+    if (lanes == 4 && len >= 4 * MIN_LANE_BYTES) {
+      fp = _index_four(table, large_mask, window, p, len, off, fp,
+		       &index->matches);
+    } else {
+      ceph_assert(lanes == 1 || lanes == 4);
+      fp = _index_one(table, large_mask, window, p, len, off, fp,
+		      &index->matches);
     }
+    off += len;
   }
-  return true;
 }
 
 void FastCDC::calc_chunks(
   const bufferlist& bl,
   std::vector<std::pair<uint64_t, uint64_t>> *chunks) const
+{
+  cdc_boundary_index_t index;
+  calc_chunks(bl, chunks, &index);
+}
+
+void FastCDC::calc_chunks(
+  const bufferlist& bl,
+  std::vector<std::pair<uint64_t, uint64_t>> *chunks,
+  cdc_boundary_index_t *index) const
 {
   if (bl.length() == 0) {
     return;
   }
-  auto p = bl.buffers().begin();
-  const char *pp = p->c_str();
-  const char *pe = pp + p->length();
+  // an index built for a smaller target (fewer bits in its mask) has all
+  // of our candidates, and more
+  if (index->length != bl.length() ||
+      (index->mask & large_mask) != index->mask) {
+    build_index(bl, index);
+  }
 
+  auto m = index->matches.cbegin();
   size_t pos = 0;
   size_t len = bl.length();
   while (pos < len) {
     size_t cstart = pos;
-    uint64_t fp = 0;
 
     // are we left with a min-sized (or smaller) chunk?
     if (len - pos <= (1ul << min_bits)) {
@@ -123,53 +234,29 @@ void FastCDC::calc_chunks(
       break;
     }
 
-    // skip forward to the min chunk size cut point (minus the window, so
-    // we can initialize the rolling fingerprint).
-    size_t skip = (1 << min_bits) - window;
-    pos += skip;
-    while (skip) {
-      size_t s = std::min<size_t>(pe - pp, skip);
-      skip -= s;
-      pp += s;
-      if (pp == pe) {
-	++p;
-	pp = p->c_str();
-	pe = pp + p->length();
-      }
-    }
+    // the first "small" region, the middle range (close to our target),
+    // and past the target, as the paper's maskS, maskA and maskL
+    size_t small_end = std::min(
+      len, cstart + (1ul << (target_bits - TARGET_WINDOW_BITS)));
+    size_t target_end = TARGET_WINDOW_BITS == 0 ? small_end :
+      std::min(len, cstart + (1ul << (target_bits + TARGET_WINDOW_BITS)));
+    size_t end = std::min(len, cstart + (1ul << max_bits));
 
-    // first fill the window
-    size_t max = pos + window;
-    while (pos < max) {
-      if (pp == pe) {
-	++p;
-	pp = p->c_str();
-	pe = pp + p->length();
-      }
-      const char *te = std::min(pe, pp + (max - pos));
-      for (; pp < te; ++pp, ++pos) {
-	fp = (fp << 1) ^ table[*(unsigned char*)pp];
-      }
+    // skip forward to the min chunk size cut point
+    while (m != index->matches.cend() &&
+	   m->first < cstart + (1ul << min_bits)) {
+      ++m;
     }
-    ceph_assert(pos < len);
-
     // find an end marker
-    if (
-      // for the first "small" region
-      _scan(&p, &pp, &pe, pos,
-	    std::min(len, cstart + (1 << (target_bits - TARGET_WINDOW_BITS))),
-	    fp, small_mask, table) &&
-      // for the middle range (close to our target)
-      (TARGET_WINDOW_BITS == 0 ||
-       _scan(&p, &pp, &pe, pos,
-	     std::min(len, cstart + (1 << (target_bits + TARGET_WINDOW_BITS))),
-	     fp, target_mask, table)) &&
-      // we're past target, use large_mask!
-      _scan(&p, &pp, &pe, pos,
-	    std::min(len,
-		     cstart + (1 << max_bits)),
-	    fp, large_mask, table))
-      ;
+    pos = end;
+    for (; m != index->matches.cend() && m->first < end; ++m) {
+      uint64_t mask = m->first < small_end ? small_mask :
+	(m->first < target_end ? target_mask : large_mask);
+      if ((m->second & mask) == mask) {
+	pos = m->first;
+	break;
+      }
+    }
 
     chunks->push_back(std::pair<uint64_t,uint64_t>(cstart, pos - cstart));
   }
@@ -40,6 +40,9 @@ private:
   void _setup(int target, int window_bits);
 
 public:
+  /// lanes build_index() hashes side by side, by default
+  static constexpr unsigned DEFAULT_LANES = 4;
+
   FastCDC(int target = 18, int window_bits = 0) {
     _setup(target, window_bits);
   };
@@ -51,4 +54,16 @@ public:
   void calc_chunks(
     const bufferlist& bl,
     std::vector<std::pair<uint64_t, uint64_t>> *chunks) const override;
+  void calc_chunks(
+    const bufferlist& bl,
+    std::vector<std::pair<uint64_t, uint64_t>> *chunks,
+    cdc_boundary_index_t *index) const override;
+
+  /// find the offsets in @p bl at which the rolling fingerprint matches
+  /// large_mask: the candidate cut points.  Each buffer is cut in @p lanes
+  /// (1 or 4) parts, whose fingerprints are computed side by side.
+  void build_index(
+    const bufferlist& bl,
+    cdc_boundary_index_t *index,
+    unsigned lanes = DEFAULT_LANES) const;
 };
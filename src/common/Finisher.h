@@ -17,7 +17,7 @@
 
 #include "include/Context.h"
 #include "include/common_fwd.h"
-#include "common/Thread.h"
+#include "common/CompletionExecutor.h"
 #include "common/ceph_mutex.h"
 #include "common/perf_counters.h"
 #include "common/Cond.h"
@@ -33,101 +33,53 @@ enum {
 
 /** @brief Asynchronous cleanup class.
  * Finisher asynchronously completes Contexts, which are simple classes
- * representing callbacks, in a dedicated worker thread. Enqueuing
+ * representing callbacks, in the order they were queued. Enqueuing
  * contexts to complete is thread-safe.
+ *
+ * A Finisher is a CompletionExecutor::Strand: by default on a private,
+ * single threaded executor, that is a dedicated worker thread; otherwise
+ * on a shared executor, whose workers complete the contexts of several
+ * Finishers, one batch of a Finisher at a time.
  */
 class Finisher {
   CephContext *cct;
-  ceph::mutex finisher_lock; ///< Protects access to queues and finisher_running.
-  ceph::condition_variable finisher_cond; ///< Signaled when there is something to process.
-  ceph::condition_variable finisher_empty_cond; ///< Signaled when the finisher has nothing more to process.
-  bool         finisher_stop; ///< Set when the finisher should stop.
-  bool         finisher_running; ///< True when the finisher is currently executing contexts.
-  bool	       finisher_empty_wait; ///< True mean someone wait finisher empty.
-
-  /// Queue for contexts for which complete(0) will be called.
-  std::vector<std::pair<Context*,int>> finisher_queue;
-  std::vector<std::pair<Context*,int>> in_progress_queue;
-
-  std::string thread_name;
+  /// the executor of an unshared Finisher
+  std::unique_ptr<CompletionExecutor> own_executor;
+  CompletionExecutor::Strand strand;
 
   /// Performance counter for the finisher's queue length.
   /// Only active for named finishers.
   PerfCounters *logger;
 
-  void *finisher_thread_entry();
-
-  struct FinisherThread : public Thread {
-    Finisher *fin;
-    explicit FinisherThread(Finisher *f) : fin(f) {}
-    void* entry() override { return fin->finisher_thread_entry(); }
-  } finisher_thread;
+  void create_logger(const std::string& name);
 
  public:
   /// Add a context to complete, optionally specifying a parameter for the complete function.
   void queue(Context *c, int r = 0) {
-    std::unique_lock ul(finisher_lock);
-    bool was_empty = finisher_queue.empty();
-    finisher_queue.push_back(std::make_pair(c, r));
-    if (was_empty) {
-      finisher_cond.notify_one();
-    }
-    if (logger)
-      logger->inc(l_finisher_queue_len);
+    strand.queue(c, r);
   }
 
   void queue(std::list<Context*>& ls) {
-    {
-      std::unique_lock ul(finisher_lock);
-      if (finisher_queue.empty()) {
-	finisher_cond.notify_all();
-      }
-      for (auto i : ls) {
-	finisher_queue.push_back(std::make_pair(i, 0));
-      }
-      if (logger)
-	logger->inc(l_finisher_queue_len, ls.size());
-    }
-    ls.clear();
+    strand.queue(ls);
   }
   void queue(std::deque<Context*>& ls) {
-    {
-      std::unique_lock ul(finisher_lock);
-      if (finisher_queue.empty()) {
-	finisher_cond.notify_all();
-      }
-      for (auto i : ls) {
-	finisher_queue.push_back(std::make_pair(i, 0));
-      }
-      if (logger)
-	logger->inc(l_finisher_queue_len, ls.size());
-    }
-    ls.clear();
+    strand.queue(ls);
   }
   void queue(std::vector<Context*>& ls) {
-    {
-      std::unique_lock ul(finisher_lock);
-      if (finisher_queue.empty()) {
-	finisher_cond.notify_all();
-      }
-      for (auto i : ls) {
-	finisher_queue.push_back(std::make_pair(i, 0));
-      }
-      if (logger)
-	logger->inc(l_finisher_queue_len, ls.size());
-    }
-    ls.clear();
+    strand.queue(ls);
   }
 
-  /// Start the worker thread.
+  /// Start the worker thread; a no-op on a shared executor, which is
+  /// started by its owner.
   void start();
 
   /** @brief Stop the worker thread.
    *
-   * Does not wait until all outstanding contexts are completed.
-   * To ensure that everything finishes, you should first shut down
-   * all sources that can add contexts to this finisher and call
-   * wait_for_empty() before calling stop(). */
+   * Completes the outstanding contexts before the worker exits.  You
+   * should first shut down all sources that can add contexts to this
+   * finisher, or the ones they add afterwards are left queued until the
+   * finisher is started again.  On a shared executor, which keeps
+   * running, this waits until the finisher is empty. */
   void stop();
 
   /** @brief Blocks until the finisher has nothing left to process.
@@ -138,25 +90,28 @@ class Finisher {
   /// Construct an anonymous Finisher.
   /// Anonymous finishers do not log their queue length.
   explicit Finisher(CephContext *cct_) :
-    cct(cct_), finisher_lock(ceph::make_mutex("Finisher::finisher_lock")),
-    finisher_stop(false), finisher_running(false), finisher_empty_wait(false),
-    thread_name("fn_anonymous"), logger(0),
-    finisher_thread(this) {}
+    cct(cct_),
+    own_executor(std::make_unique<CompletionExecutor>(cct, "fn_anonymous", 1)),
+    strand(own_executor.get(), "anonymous"),
+    logger(0) {}
 
   /// Construct a named Finisher that logs its queue length.
   Finisher(CephContext *cct_, std::string name, std::string tn) :
-    cct(cct_), finisher_lock(ceph::make_mutex("Finisher::" + name)),
-    finisher_stop(false), finisher_running(false), finisher_empty_wait(false),
-    thread_name(tn), logger(0),
-    finisher_thread(this) {
-    PerfCountersBuilder b(cct, std::string("finisher-") + name,
-			  l_finisher_first, l_finisher_last);
-    b.add_u64(l_finisher_queue_len, "queue_len");
-    b.add_time_avg(l_finisher_complete_lat, "complete_latency");
-    logger = b.create_perf_counters();
-    cct->get_perfcounters_collection()->add(logger);
-    logger->set(l_finisher_queue_len, 0);
-    logger->set(l_finisher_complete_lat, 0);
+    cct(cct_),
+    own_executor(std::make_unique<CompletionExecutor>(cct, tn, 1)),
+    strand(own_executor.get(), name),
+    logger(0) {
+    create_logger(name);
+  }
+
+  /// Construct a named Finisher on the shared executor @p ex, preferably
+  /// completing its contexts on the shard @p affinity.
+  Finisher(CephContext *cct_, std::string name, CompletionExecutor *ex,
+	   int affinity = CompletionExecutor::AFFINITY_ANY) :
+    cct(cct_),
+    strand(ex, name, affinity),
+    logger(0) {
+    create_logger(name);
   }
 
   ~Finisher() {
@@ -17,6 +17,7 @@ public:
   void set_target_bits(int target, int window_bits) override {
     chunk_size = 1ul << target;
   }
+  using CDC::calc_chunks;
   void calc_chunks(
     const bufferlist& bl,
     std::vector<std::pair<uint64_t, uint64_t>> *chunks) const override;
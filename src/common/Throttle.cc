@@ -538,6 +538,109 @@ uint64_t BackoffThrottle::get_max()
   return max;
 }
 
+enum {
+  l_adaptive_throttle_first = l_backoff_throttle_last + 1,
+  l_adaptive_throttle_budget,
+  l_adaptive_throttle_ceiling,
+  l_adaptive_throttle_target,
+  l_adaptive_throttle_min_lat,
+  l_adaptive_throttle_increase,
+  l_adaptive_throttle_decrease,
+  l_adaptive_throttle_last,
+};
+
+AdaptiveThrottle::AdaptiveThrottle(CephContext *cct, const std::string& n,
+				   Throttle *t)
+  : cct(cct), name(n), throttle(t),
+    next_adjust(ceph::coarse_mono_time::min())
+{
+  ceph_assert(throttle);
+  if (cct->_conf->throttler_perf_counter) {
+    PerfCountersBuilder b(cct, string("throttle-adaptive-") + name,
+			  l_adaptive_throttle_first, l_adaptive_throttle_last);
+    b.add_u64(l_adaptive_throttle_budget, "budget", "Max currently allowed");
+    b.add_u64(l_adaptive_throttle_ceiling, "ceiling", "Configured max");
+    b.add_time(l_adaptive_throttle_target, "target", "Target latency");
+    b.add_time(l_adaptive_throttle_min_lat, "min_lat",
+	       "Minimum latency of the last interval");
+    b.add_u64_counter(l_adaptive_throttle_increase, "increase",
+		      "Additive increases of the budget");
+    b.add_u64_counter(l_adaptive_throttle_decrease, "decrease",
+		      "Multiplicative decreases of the budget");
+
+    logger = { b.create_perf_counters(), cct };
+    cct->get_perfcounters_collection()->add(logger.get());
+  }
+}
+
+AdaptiveThrottle::~AdaptiveThrottle() = default;
+
+void AdaptiveThrottle::configure(int64_t c, ceph::timespan t)
+{
+  ceph_assert(c >= 0);
+  std::lock_guard l(lock);
+  double min_ratio = cct->_conf.get_val<double>("throttle_adaptive_min_ratio");
+  interval = ceph::make_timespan(
+    cct->_conf.get_val<double>("throttle_adaptive_interval"));
+  ceiling = c;
+  floor = std::max<int64_t>(1, ceiling * min_ratio);
+  target = t;
+  // a zero ceiling is no throttling at all, there is nothing to adapt
+  bool adapt = ceiling > 0 && target > ceph::timespan::zero();
+  if (!adapt || budget == 0) {
+    budget = ceiling;
+  }
+  budget = std::clamp(budget, std::min(floor, ceiling), ceiling);
+  ldout(cct, 10) << __func__ << " ceiling " << ceiling << " floor " << floor
+		 << " target " << target << " budget " << budget << dendl;
+  min_lat_ns = UINT64_MAX;
+  next_adjust = ceph::coarse_mono_clock::now() + interval;
+  enabled = adapt;
+  throttle->reset_max(budget);
+  if (logger) {
+    logger->set(l_adaptive_throttle_budget, budget);
+    logger->set(l_adaptive_throttle_ceiling, ceiling);
+    logger->tset(l_adaptive_throttle_target, utime_t(target));
+  }
+}
+
+void AdaptiveThrottle::_adjust(ceph::coarse_mono_time now)
+{
+  std::unique_lock l(lock, std::try_to_lock);
+  if (!l.owns_lock() || !enabled || now < next_adjust.load()) {
+    // someone else is on it
+    return;
+  }
+  next_adjust = now + interval;
+  uint64_t ns = min_lat_ns.exchange(UINT64_MAX);
+  if (ns == UINT64_MAX) {
+    return;
+  }
+  auto min_lat = ceph::timespan(ns);
+  int64_t prev = budget;
+  if (min_lat > target) {
+    budget = std::max<int64_t>(floor, budget * DECREASE_FACTOR);
+    if (logger && budget != prev) {
+      logger->inc(l_adaptive_throttle_decrease);
+    }
+  } else {
+    budget = std::min(ceiling,
+		      budget + std::max<int64_t>(1, ceiling / INCREASE_DIVISOR));
+    if (logger && budget != prev) {
+      logger->inc(l_adaptive_throttle_increase);
+    }
+  }
+  if (budget != prev) {
+    ldout(cct, 10) << __func__ << " min_lat " << min_lat << " target " << target
+		   << " budget " << prev << " -> " << budget << dendl;
+    throttle->reset_max(budget);
+  }
+  if (logger) {
+    logger->set(l_adaptive_throttle_budget, budget);
+    logger->tset(l_adaptive_throttle_min_lat, utime_t(min_lat));
+  }
+}
+
 SimpleThrottle::SimpleThrottle(uint64_t max, bool ignore_enoent)
   : m_max(max), m_ignore_enoent(ignore_enoent) {}
 
@@ -11,6 +11,7 @@
 #include <map>
 
 #include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
 #include "include/Context.h"
 #include "common/ThrottleInterface.h"
 #include "common/Timer.h"
@@ -123,6 +124,79 @@ public:
   }
 };
 
+/**
+ * @class AdaptiveThrottle
+ * Adapts the max of a Throttle to the latency of the requests it admits.
+ *
+ * Given a ceiling (the configured max) and a target latency, the max is
+ * adjusted once per interval, as CoDel does for a queue: if even the
+ * fastest request of the interval took longer than the target, requests
+ * are queueing up behind the device rather than in the throttle, so the
+ * max is cut multiplicatively; otherwise it grows additively back to the
+ * ceiling (AIMD).  The max never drops below ceiling * min_ratio.
+ *
+ * A zero target pins the max to the ceiling, which is the plain Throttle.
+ */
+class AdaptiveThrottle {
+  CephContext *cct;
+  const std::string name;
+  Throttle *throttle;
+  PerfCountersRef logger;
+
+  /// serializes the adjustments
+  ceph::mutex lock = ceph::make_mutex("AdaptiveThrottle::lock");
+  int64_t ceiling = 0;
+  int64_t floor = 0;
+  int64_t budget = 0;
+  ceph::timespan target = ceph::timespan::zero();
+  ceph::timespan interval = ceph::timespan::zero();
+
+  std::atomic<bool> enabled = { false };
+  std::atomic<uint64_t> min_lat_ns = { UINT64_MAX };  ///< of this interval
+  std::atomic<ceph::coarse_mono_time> next_adjust;
+
+  void _adjust(ceph::coarse_mono_time now);
+
+public:
+  static constexpr int64_t INCREASE_DIVISOR = 32;   ///< step: ceiling / 32
+  static constexpr double DECREASE_FACTOR = 0.75;
+
+  AdaptiveThrottle(CephContext *cct, const std::string& n, Throttle *t);
+  ~AdaptiveThrottle();
+
+  /**
+   * set the bounds and the target; the interval and the min ratio are read
+   * from throttle_adaptive_interval and throttle_adaptive_min_ratio
+   * @param c the ceiling, the max of the throttle if it is not adapted
+   * @param t the target latency, or zero not to adapt the max
+   */
+  void configure(int64_t c, ceph::timespan t);
+
+  /**
+   * account the latency of a request, from its admission by the throttle
+   * to its completion
+   */
+  void sample(ceph::timespan lat) {
+    if (!enabled.load(std::memory_order_relaxed)) {
+      return;
+    }
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(lat).count();
+    uint64_t cur = min_lat_ns.load(std::memory_order_relaxed);
+    while (ns < cur &&
+	   !min_lat_ns.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {
+    }
+    auto now = ceph::coarse_mono_clock::now();
+    if (now >= next_adjust.load(std::memory_order_relaxed)) {
+      _adjust(now);
+    }
+  }
+
+  int64_t get_budget() {
+    std::lock_guard l(lock);
+    return budget;
+  }
+};
+
 /**
  * BackoffThrottle
  *
@@ -12,12 +12,16 @@
 
 #include "TrackedOp.h"
 
+#include <algorithm>
+#include <cstring>
+
 #define dout_context cct
 #define dout_subsys ceph_subsys_optracker
 #undef dout_prefix
 #define dout_prefix _prefix(_dout)
 
 using std::list;
+using std::vector;
 using std::make_pair;
 using std::ostream;
 using std::pair;
@@ -71,13 +75,148 @@ void* OpHistoryServiceThread::entry() {
 
 void OpHistory::on_shutdown()
 {
-  opsvc.break_thread();
-  opsvc.join();
+  if (!lockless) {
+    opsvc.break_thread();
+    opsvc.join();
+  }
   std::lock_guard history_lock(ops_history_lock);
   arrived.clear();
   duration.clear();
   slow_op.clear();
   shutdown = true;
+  drain_rings();
+}
+
+void OpHistory::Ring::init(size_t s)
+{
+  size = s;
+  slots.reset(new std::atomic<TrackedOp*>[size]);
+  for (size_t i = 0; i < size; i++) {
+    slots[i] = nullptr;
+  }
+}
+
+void OpHistory::Ring::push(TrackedOpRef&& op)
+{
+  if (!size)
+    return;
+  auto i = head.fetch_add(1, std::memory_order_relaxed) % size;
+  if (auto old = slots[i].exchange(op.detach()); old) {
+    intrusive_ptr_release(old);
+  }
+}
+
+void OpHistory::Ring::collect(vector<TrackedOpRef>* ops)
+{
+  for (size_t i = 0; i < size; i++) {
+    TrackedOp* op = slots[i].exchange(nullptr);
+    if (!op)
+      continue;
+    ops->emplace_back(op);
+    // put it back, unless a newer op took the slot meanwhile
+    TrackedOp* expected = nullptr;
+    if (!slots[i].compare_exchange_strong(expected, op)) {
+      intrusive_ptr_release(op);
+    }
+  }
+}
+
+void OpHistory::Ring::drain()
+{
+  for (size_t i = 0; i < size; i++) {
+    if (auto op = slots[i].exchange(nullptr); op) {
+      intrusive_ptr_release(op);
+    }
+  }
+}
+
+OpHistory::Rings::Rings(uint32_t num_shards, size_t size, size_t slow_size)
+  : recent(new Ring[num_shards]),
+    slow(new Ring[num_shards])
+{
+  for (uint32_t i = 0; i < num_shards; i++) {
+    recent[i].init(size);
+    slow[i].init(slow_size);
+  }
+}
+
+void OpHistory::reset_rings()
+{
+  std::lock_guard history_lock(ops_history_lock);
+  if (shutdown)
+    return;
+  auto r = new Rings(num_shards,
+		     (history_size + num_shards - 1) / num_shards,
+		     (history_slow_op_size + num_shards - 1) / num_shards);
+  all_rings.emplace_back(r);
+  // inserts may still go to the old rings until they are freed
+  if (auto old = rings.exchange(r); old) {
+    for (uint32_t i = 0; i < num_shards; i++) {
+      old->recent[i].drain();
+      old->slow[i].drain();
+    }
+  }
+  free_retired_rings();
+}
+
+void OpHistory::free_retired_rings()
+{
+  ceph_assert(ceph_mutex_is_locked(ops_history_lock));
+  if (all_rings.size() <= 1)
+    return;
+  // an insert which loaded a retired Rings did so before it was replaced,
+  // and is counted until it is done with it
+  for (uint32_t i = 0; i < num_shards; i++) {
+    if (inserting[i].n.load() != 0)
+      return;
+  }
+  auto current = all_rings.end() - 1;
+  for (auto r = all_rings.begin(); r != current; ++r) {
+    for (uint32_t i = 0; i < num_shards; i++) {
+      (*r)->recent[i].drain();
+      (*r)->slow[i].drain();
+    }
+  }
+  all_rings.erase(all_rings.begin(), current);
+}
+
+void OpHistory::drain_rings()
+{
+  for (auto& r : all_rings) {
+    for (uint32_t i = 0; i < num_shards; i++) {
+      r->recent[i].drain();
+      r->slow[i].drain();
+    }
+  }
+}
+
+void OpHistory::_insert_lockless(TrackedOpRef&& op)
+{
+  uint32_t shard = op->seq % num_shards;
+  auto& in = inserting[shard].n;
+  // seq_cst, pairs with the exchange in reset_rings() and the loads in
+  // free_retired_rings()
+  in.fetch_add(1);
+  if (Rings* r = rings.load(); r) {
+    if (op->get_duration() >= history_slow_op_threshold.load())
+      r->slow[shard].push(TrackedOpRef(op));
+    r->recent[shard].push(std::move(op));
+  }
+  in.fetch_sub(1, std::memory_order_release);
+}
+
+vector<TrackedOpRef> OpHistory::collect(bool slow)
+{
+  vector<TrackedOpRef> ops;
+  // keeps the rings from being freed under us
+  std::lock_guard history_lock(ops_history_lock);
+  free_retired_rings();
+  if (Rings* r = rings.load(std::memory_order_acquire); r) {
+    for (uint32_t i = 0; i < num_shards; i++) {
+      (slow ? r->slow[i] : r->recent[i]).collect(&ops);
+    }
+  }
+  return ops;
 }
 
 void OpHistory::_insert_delayed(const utime_t& now, TrackedOpRef op)
@@ -120,6 +259,43 @@ void OpHistory::cleanup(utime_t now)
 
 void OpHistory::dump_ops(utime_t now, Formatter *f, set<string> filters, bool by_duration)
 {
+  if (lockless) {
+    // keep what cleanup() would: the longest of the recent enough ops
+    auto ops = collect(false);
+    ops.erase(std::remove_if(ops.begin(), ops.end(), [&](auto& op) {
+	  return now - op->get_initiated() > (double)history_duration.load();
+	}), ops.end());
+    vector<pair<double, TrackedOpRef>> by_dur;
+    for (auto& op : ops) {
+      by_dur.emplace_back(op->get_duration(), std::move(op));
+    }
+    std::sort(by_dur.begin(), by_dur.end(), [](auto& a, auto& b) {
+	return a.first > b.first;
+      });
+    if (by_dur.size() > history_size.load()) {
+      by_dur.resize(history_size.load());
+    }
+    if (!by_duration) {
+      std::sort(by_dur.begin(), by_dur.end(), [](auto& a, auto& b) {
+	  return a.second->get_initiated() < b.second->get_initiated();
+	});
+    }
+    f->open_object_section("op_history");
+    f->dump_int("size", history_size.load());
+    f->dump_int("duration", history_duration.load());
+    f->open_array_section("ops");
+    for (auto& [d, op] : by_dur) {
+      if (!op->filter_out(filters))
+	continue;
+      f->open_object_section("op");
+      op->dump(now, f);
+      f->close_section();
+    }
+    f->close_section();
+    f->close_section();
+    return;
+  }
+
   std::lock_guard history_lock(ops_history_lock);
   cleanup(now);
   f->open_object_section("op_history");
@@ -156,6 +332,8 @@ struct ShardedTrackingData {
 
 OpTracker::OpTracker(CephContext *cct_, bool tracking, uint32_t num_shards):
   seq(0),
+  lockless(cct_->_conf.get_val<bool>("op_tracker_lockless")),
+  history(lockless, num_shards),
   num_optracker_shards(num_shards),
   complaint_time(0), log_threshold(0),
   tracking_enabled(tracking),
@@ -189,6 +367,31 @@ bool OpTracker::dump_historic_ops(Formatter *f, bool by_duration, set<string> fi
 
 void OpHistory::dump_slow_ops(utime_t now, Formatter *f, set<string> filters)
 {
+  if (lockless) {
+    // keep what cleanup() would: the latest ones
+    auto ops = collect(true);
+    std::sort(ops.begin(), ops.end(), [](auto& a, auto& b) {
+	return a->get_initiated() < b->get_initiated();
+      });
+    if (ops.size() > history_slow_op_size.load()) {
+      ops.erase(ops.begin(), ops.end() - history_slow_op_size.load());
+    }
+    f->open_object_section("OpHistory slow ops");
+    f->dump_int("num to keep", history_slow_op_size.load());
+    f->dump_int("threshold to keep", history_slow_op_threshold.load());
+    f->open_array_section("Ops");
+    for (auto& op : ops) {
+      if (!op->filter_out(filters))
+	continue;
+      f->open_object_section("Op");
+      op->dump(now, f);
+      f->close_section();
+    }
+    f->close_section();
+    f->close_section();
+    return;
+  }
+
   std::lock_guard history_lock(ops_history_lock);
   cleanup(now);
   f->open_object_section("OpHistory slow ops");
@@ -292,6 +495,10 @@ void OpTracker::unregister_inflight_op(TrackedOp* const i)
 
 void OpTracker::record_history_op(TrackedOpRef&& i)
 {
+  if (lockless) {
+    history.insert(utime_t(), std::move(i));
+    return;
+  }
   std::shared_lock l{lock};
   history.insert(ceph_clock_now(), std::move(i));
 }
@@ -452,15 +659,193 @@ void OpTracker::get_age_ms_histogram(pow2_hist_t *h)
 }
 
 
+namespace {
+struct EventNames {
+  static constexpr unsigned MAX = 1024;
+  ceph::mutex lock = ceph::make_mutex("TrackedOp::EventNames::lock");
+  std::array<std::atomic<const char*>, MAX> names;
+  unsigned num = 0;  ///< protected by lock
+
+  EventNames() {
+    for (auto& n : names) {
+      n = nullptr;
+    }
+    // TrackedOp::EVENT_*
+    for (auto name : {"", "initiated", "throttled", "header_read",
+		      "all_read", "dispatched", "done"}) {
+      names[num++] = name;
+    }
+  }
+};
+
+EventNames& event_names()
+{
+  static EventNames names;
+  return names;
+}
+}
+
+TrackedOp::event_id_t TrackedOp::register_event(const char *name)
+{
+  auto& en = event_names();
+  std::lock_guard l(en.lock);
+  for (unsigned i = 1; i < en.num; i++) {
+    if (strcmp(en.names[i], name) == 0) {
+      return i;
+    }
+  }
+  ceph_assert(en.num < EventNames::MAX);
+  en.names[en.num] = name;
+  return en.num++;
+}
+
+const char *TrackedOp::get_event_name(event_id_t id)
+{
+  const char *name = event_names().names[id];
+  return name ? name : "";
+}
+
 #undef dout_context
 #define dout_context tracker->cct
 
-void TrackedOp::mark_event(std::string_view event, utime_t stamp)
+void TrackedOp::_record_event(event_id_t event, utime_t stamp)
+{
+  if (auto i = num_fast_events.fetch_add(1, std::memory_order_relaxed);
+      i < fast_events.size()) {
+    fast_events[i].stamp = stamp;
+    fast_events[i].id.store(event, std::memory_order_release);
+  } else {
+    _record_slow_event(i, stamp, get_event_name(event));
+  }
+}
+
+void TrackedOp::_record_slow_event(uint32_t slot, utime_t stamp,
+				   std::string_view event)
+{
+  std::lock_guard l(lock);
+  events.emplace_back(stamp, event);
+  event_slots.push_back(slot);
+  num_slow_events.store(events.size(), std::memory_order_release);
+}
+
+void TrackedOp::mark_event(event_id_t event, utime_t stamp)
 {
   if (!state)
     return;
 
+  if (!tracker->is_lockless()) {
+    mark_event(get_event_name(event), stamp);
+    return;
+  }
+  _record_event(event, stamp);
+  dout(6) << " seq: " << seq
+	  << ", time: " << stamp
+	  << ", event: " << get_event_name(event)
+	  << ", op: " << get_desc()
+	  << dendl;
+  _event_marked();
+}
+
+vector<TrackedOp::Event> TrackedOp::get_events() const
+{
+  // the events ordered by the slot they claimed when marked
+  vector<pair<uint32_t, Event>> marked;
+  size_t n = std::min<size_t>(num_fast_events.load(), fast_events.size());
+  for (size_t i = 0; i < n; i++) {
+    if (auto id = fast_events[i].id.load(std::memory_order_acquire);
+	id != EVENT_NONE) {
+      marked.emplace_back(i, Event(fast_events[i].stamp, get_event_name(id)));
+    }
+  }
   {
+    std::lock_guard l(lock);
+    if (event_slots.empty()) {
+      // not in the lockless mode, or no event went to the list yet
+      if (marked.empty()) {
+	return events;
+      }
+    } else {
+      for (size_t i = 0; i < events.size(); i++) {
+	marked.emplace_back(event_slots[i], events[i]);
+      }
+    }
+  }
+  std::sort(marked.begin(), marked.end(), [](auto& a, auto& b) {
+      return a.first < b.first;
+    });
+  vector<Event> ret;
+  ret.reserve(marked.size());
+  for (auto& [slot, event] : marked) {
+    ret.push_back(std::move(event));
+  }
+  return ret;
+}
+
+bool TrackedOp::_get_last_event(utime_t *stamp, std::string_view *name) const
+{
+  if (!tracker->is_lockless()) {
+    std::lock_guard l(lock);
+    if (events.empty()) {
+      return false;
+    }
+    *stamp = events.rbegin()->stamp;
+    *name = events.rbegin()->str;
+    return true;
+  }
+  bool found = false;
+  size_t last = 0;
+  size_t n = std::min<size_t>(num_fast_events.load(), fast_events.size());
+  for (size_t i = n; i > 0; i--) {
+    if (auto id = fast_events[i - 1].id.load(std::memory_order_acquire);
+	id != EVENT_NONE) {
+      *stamp = fast_events[i - 1].stamp;
+      *name = get_event_name(id);
+      last = i - 1;
+      found = true;
+      break;
+    }
+  }
+  if (num_slow_events.load(std::memory_order_acquire) == 0) {
+    return found;
+  }
+  std::lock_guard l(lock);
+  // the slots only grow, so the latest of the list is at its end
+  if (!found || event_slots.back() > last) {
+    *stamp = events.rbegin()->stamp;
+    *name = events.rbegin()->str;
+    found = true;
+  }
+  return found;
+}
+
+double TrackedOp::get_duration() const
+{
+  utime_t stamp;
+  std::string_view name;
+  if (_get_last_event(&stamp, &name) && name == "done")
+    return stamp - get_initiated();
+  else
+    return ceph_clock_now() - get_initiated();
+}
+
+std::string_view TrackedOp::state_string() const
+{
+  utime_t stamp;
+  std::string_view name;
+  if (_get_last_event(&stamp, &name))
+    return name;
+  return std::string_view();
+}
+
+void TrackedOp::mark_event(std::string_view event, utime_t stamp)
+{
+  if (!state)
+    return;
+
+  if (tracker->is_lockless()) {
+    _record_slow_event(num_fast_events.fetch_add(1, std::memory_order_relaxed),
+		       stamp, event);
+  } else {
     std::lock_guard l(lock);
     events.emplace_back(stamp, event);
   }
@@ -14,6 +14,7 @@
 #ifndef TRACKEDREQUEST_H_
 #define TRACKEDREQUEST_H_
 
+#include <array>
 #include <atomic>
 #include "common/ceph_mutex.h"
 #include "common/histogram.h"
@@ -53,6 +54,45 @@ public:
 
 
 class OpHistory {
+  /*
+   * in the lockless mode the completed ops go to rings, one per OpTracker
+   * shard, instead of the sets below.  each slot owns a reference to its
+   * op; whoever exchanges it out of the slot owns that reference.
+   */
+  struct Ring {
+    std::unique_ptr<std::atomic<TrackedOp*>[]> slots;
+    size_t size = 0;
+    std::atomic<uint64_t> head = {0};
+
+    void init(size_t s);
+    void push(TrackedOpRef&& op);
+    /// take a reference to each of the ops in the ring
+    void collect(std::vector<TrackedOpRef>* ops);
+    void drain();
+  };
+  struct Rings {
+    std::unique_ptr<Ring[]> recent;
+    std::unique_ptr<Ring[]> slow;
+    Rings(uint32_t num_shards, size_t size, size_t slow_size);
+  };
+  /// the inserts in flight, per shard; a retired Rings may be freed once
+  /// none are, as later inserts can only see the current one
+  struct alignas(64) Inserting {
+    std::atomic<uint32_t> n = {0};
+  };
+  const bool lockless;
+  const uint32_t num_shards;
+  std::atomic<Rings*> rings = {nullptr};
+  std::unique_ptr<Inserting[]> inserting;
+  /// the retired rings, which inserts may still be racing with, followed
+  /// by the current ones; protected by ops_history_lock
+  std::vector<std::unique_ptr<Rings>> all_rings;
+  void reset_rings();
+  void free_retired_rings();
+  void drain_rings();
+  void _insert_lockless(TrackedOpRef&& op);
+  std::vector<TrackedOpRef> collect(bool slow);
+
   std::set<std::pair<utime_t, TrackedOpRef> > arrived;
   std::set<std::pair<double, TrackedOpRef> > duration;
   std::set<std::pair<utime_t, TrackedOpRef> > slow_op;
@@ -67,10 +107,18 @@ class OpHistory {
   friend class OpHistoryServiceThread;
 
 public:
-  OpHistory() : opsvc(this) {
-    opsvc.create("OpHistorySvc");
+  OpHistory(bool lockless, uint32_t num_shards)
+    : lockless(lockless),
+      num_shards(num_shards),
+      opsvc(this) {
+    if (lockless) {
+      inserting.reset(new Inserting[num_shards]);
+    } else {
+      opsvc.create("OpHistorySvc");
+    }
   }
   ~OpHistory() {
+    drain_rings();
     ceph_assert(arrived.empty());
     ceph_assert(duration.empty());
     ceph_assert(slow_op.empty());
@@ -80,6 +128,10 @@ public:
     if (shutdown)
       return;
 
+    if (lockless) {
+      _insert_lockless(std::move(op));
+      return;
+    }
     opsvc.insert_op(now, op);
   }
 
@@ -88,12 +140,18 @@ public:
   void dump_slow_ops(utime_t now, ceph::Formatter *f, std::set<std::string> filters = {""});
   void on_shutdown();
   void set_size_and_duration(size_t new_size, uint32_t new_duration) {
-    history_size = new_size;
+    bool resize = history_size.exchange(new_size) != new_size;
     history_duration = new_duration;
+    if (lockless && resize) {
+      reset_rings();
+    }
   }
   void set_slow_op_size_and_threshold(size_t new_size, uint32_t new_threshold) {
-    history_slow_op_size = new_size;
+    bool resize = history_slow_op_size.exchange(new_size) != new_size;
     history_slow_op_threshold = new_threshold;
+    if (lockless && resize) {
+      reset_rings();
+    }
   }
 };
 
@@ -102,6 +160,8 @@ class OpTracker {
   friend class OpHistory;
   std::atomic<int64_t> seq = { 0 };
   std::vector<ShardedTrackingData*> sharded_in_flight_list;
+  /// record events in preallocated arrays, and history in lockless rings
+  const bool lockless;
   OpHistory history;
   uint32_t num_optracker_shards;
   float complaint_time;
@@ -126,6 +186,9 @@ public:
   bool is_tracking() const {
     return tracking_enabled;
   }
+  bool is_lockless() const {
+    return lockless;
+  }
   void set_tracking(bool enable) {
     tracking_enabled = enable;
   }
@@ -187,10 +250,14 @@ public:
     typename T::Ref retval(new T(params, this));
     retval->tracking_start();
     if (is_tracking()) {
-      retval->mark_event("throttled", params->get_throttle_stamp());
-      retval->mark_event("header_read", params->get_recv_stamp());
-      retval->mark_event("all_read", params->get_recv_complete_stamp());
-      retval->mark_event("dispatched", params->get_dispatch_stamp());
+      retval->mark_event(T::EVENT_THROTTLED,
+			 params->get_throttle_stamp());
+      retval->mark_event(T::EVENT_HEADER_READ,
+			 params->get_recv_stamp());
+      retval->mark_event(T::EVENT_ALL_READ,
+			 params->get_recv_complete_stamp());
+      retval->mark_event(T::EVENT_DISPATCHED,
+			 params->get_dispatch_stamp());
     }
 
     return retval;
@@ -220,6 +287,22 @@ public:
     }
   };
 
+  /// names an event w/o building a string for it, see register_event()
+  typedef uint16_t event_id_t;
+  enum : event_id_t {
+    EVENT_NONE = 0,
+    EVENT_INITIATED,
+    EVENT_THROTTLED,
+    EVENT_HEADER_READ,
+    EVENT_ALL_READ,
+    EVENT_DISPATCHED,
+    EVENT_DONE,
+  };
+  /// @return the id of the event called @p name, which must stay valid
+  /// for good, e.g. a literal
+  static event_id_t register_event(const char *name);
+  static const char *get_event_name(event_id_t id);
+
 protected:
   OpTracker *tracker;          ///< the tracker we are associated with
   std::atomic_int nref = {0};  ///< ref count
@@ -248,6 +331,23 @@ protected:
 
   std::vector<Event> events;    ///< std::list of events and their times
   mutable ceph::mutex lock = ceph::make_mutex("TrackedOp::lock"); ///< to protect the events list
+
+  /// the events marked by id in the lockless mode; the ones which do not
+  /// fit go to events
+  struct FastEvent {
+    std::atomic<event_id_t> id = {EVENT_NONE};  ///< set once stamp is
+    utime_t stamp;
+  };
+  std::array<FastEvent, OPTRACKER_PREALLOC_EVENTS> fast_events;
+  /// the number of event slots claimed so far in the lockless mode; the
+  /// events marked by name claim one as well, so the slots give the order
+  /// of all the events
+  std::atomic<uint32_t> num_fast_events = {0};
+  /// the slot claimed by each of events in the lockless mode, protected
+  /// by lock
+  std::vector<uint32_t> event_slots;
+  /// events.size() in the lockless mode, readable without lock
+  std::atomic<uint32_t> num_slow_events = {0};
   uint64_t seq = 0;        ///< a unique value std::set by the OpTracker
 
   uint32_t warn_interval_multiplier = 1; //< limits output of a given op warning
@@ -267,7 +367,9 @@ protected:
     tracker(_tracker),
     initiated_at(initiated)
   {
-    events.reserve(OPTRACKER_PREALLOC_EVENTS);
+    if (!tracker->is_lockless()) {
+      events.reserve(OPTRACKER_PREALLOC_EVENTS);
+    }
   }
 
   /// output any type-specific data you want to get when dump() is called
@@ -303,7 +405,7 @@ public:
 	break;
 
       case STATE_LIVE:
-	mark_event("done");
+	mark_event(EVENT_DONE);
 	tracker->unregister_inflight_op(this);
 	_unregistered();
 	if (!tracker->is_tracking()) {
@@ -351,34 +453,42 @@ public:
     return initiated_at;
   }
 
-  double get_duration() const {
-    std::lock_guard l(lock);
-    if (!events.empty() && events.rbegin()->compare("done") == 0)
-      return events.rbegin()->stamp - get_initiated();
-    else
-      return ceph_clock_now() - get_initiated();
-  }
+  double get_duration() const;
 
   void mark_event(std::string_view event, utime_t stamp=ceph_clock_now());
+  void mark_event(event_id_t event, utime_t stamp=ceph_clock_now());
 
   void mark_nowarn() {
     warn_interval_multiplier = 0;
   }
 
-  virtual std::string_view state_string() const {
-    std::lock_guard l(lock);
-    return events.empty() ? std::string_view() : std::string_view(events.rbegin()->str);
-  }
+  virtual std::string_view state_string() const;
 
   void dump(utime_t now, ceph::Formatter *f) const;
 
   void tracking_start() {
     if (tracker->register_inflight_op(this)) {
-      events.emplace_back(initiated_at, "initiated");
+      if (tracker->is_lockless()) {
+	_record_event(EVENT_INITIATED, initiated_at);
+      } else {
+	events.emplace_back(initiated_at, "initiated");
+      }
       state = STATE_LIVE;
     }
   }
 
+protected:
+  /// a copy of the events so far, in the order they were marked
+  std::vector<Event> get_events() const;
+
+private:
+  void _record_event(event_id_t event, utime_t stamp);
+  void _record_slow_event(uint32_t slot, utime_t stamp, std::string_view event);
+  /// @return false if no event was marked yet
+  bool _get_last_event(utime_t *stamp, std::string_view *name) const;
+
+public:
+
   // ref counting via intrusive_ptr, with special behavior on final
   // put for historical op tracking
   friend void intrusive_ptr_add_ref(TrackedOp *o) {
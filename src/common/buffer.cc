@@ -77,6 +77,117 @@ static ceph::spinlock debug_lock;
     return buffer_missed_crc;
   }
 
+  static std::atomic<bool> buffer_thread_cache =
+    !get_env_bool("CEPH_BUFFER_NO_THREAD_CACHE");
+
+  void buffer::use_thread_cache(bool b) {
+    buffer_thread_cache = b;
+  }
+
+namespace {
+  /*
+   * per-thread free lists of the small blocks bufferlists churn through
+   * while encoding: ptr_nodes, and raw_combined buffers of up to 4k.  all
+   * of the blocks are malloc()ed, so the thread dropping the last
+   * reference to a buffer may keep it, or free() it, no matter which
+   * thread allocated it.
+   */
+  class thread_cache_t {
+  public:
+    /// class 0 holds ptr_nodes, class i > 0 blocks of (MIN_RAW << (i - 1))
+    static constexpr int NUM_CLASSES = 6;
+    static constexpr size_t MIN_RAW = 256;
+    static constexpr size_t MAX_RAW = MIN_RAW << (NUM_CLASSES - 2);
+    static constexpr size_t MAX_RAW_BYTES = 16384;  ///< per class
+    static constexpr unsigned MAX_NODES = 128;
+
+    /// @return the class of the raw blocks of @p size, -1 if none
+    static int raw_class(size_t size) {
+      if (size > MAX_RAW) {
+	return -1;
+      }
+      int c = 1;
+      for (size_t s = MIN_RAW; s < size; s <<= 1) {
+	++c;
+      }
+      return c;
+    }
+    static size_t class_size(int c) {
+      return MIN_RAW << (c - 1);
+    }
+
+    void* get(int c) {
+      auto& fl = lists[c];
+      if (!fl.head) {
+	return nullptr;
+      }
+      auto b = fl.head;
+      fl.head = b->next;
+      --fl.count;
+      return b;
+    }
+    bool put(int c, void* p) {
+      auto& fl = lists[c];
+      if (fl.count >= (c ? MAX_RAW_BYTES / class_size(c) : MAX_NODES)) {
+	return false;
+      }
+      auto b = static_cast<block_t*>(p);
+      b->next = fl.head;
+      fl.head = b;
+      ++fl.count;
+      return true;
+    }
+
+    ~thread_cache_t();
+
+  private:
+    struct block_t {
+      block_t* next;
+    };
+    struct free_list_t {
+      block_t* head = nullptr;
+      unsigned count = 0;
+    };
+    std::array<free_list_t, NUM_CLASSES> lists;
+  };
+
+  thread_local thread_cache_t thread_cache;
+  // a buffer may outlive the cache of the thread releasing it
+  thread_local bool thread_cache_gone = false;
+
+  thread_cache_t::~thread_cache_t() {
+    thread_cache_gone = true;
+    for (auto& fl : lists) {
+      while (fl.head) {
+	auto b = fl.head;
+	fl.head = b->next;
+	::free(b);
+      }
+    }
+  }
+
+  void* thread_cache_get(int c, size_t size) {
+    void* p = nullptr;
+    if (buffer_thread_cache && !thread_cache_gone) {
+      p = thread_cache.get(c);
+    }
+    if (!p) {
+      p = ::malloc(size);
+      if (!p) {
+	throw bad_alloc();
+      }
+    }
+    return p;
+  }
+
+  void thread_cache_put(int c, void* p) {
+    if (!buffer_thread_cache || thread_cache_gone ||
+	!thread_cache.put(c, p)) {
+      ::free(p);
+    }
+  }
+} // anonymous namespace
+
   /*
    * raw_combined is always placed within a single allocation along
    * with the data buffer.  the data goes at the beginning, and
@@ -84,11 +195,14 @@ static ceph::spinlock debug_lock;
    */
   class buffer::raw_combined : public buffer::raw {
     size_t alignment;
+    /// of the thread cache we came from, -1 if none
+    int cache_class;
   public:
     raw_combined(char *dataptr, unsigned l, unsigned align,
-		 int mempool)
+		 int mempool, int cache_class = -1)
       : raw(dataptr, l, mempool),
-	alignment(align) {
+	alignment(align),
+	cache_class(cache_class) {
     }
     raw* clone_empty() override {
       return create(len, alignment).release();
@@ -105,6 +219,15 @@ static ceph::spinlock debug_lock;
 				  alignof(buffer::raw_combined));
       size_t datalen = round_up_to(len, alignof(buffer::raw_combined));
 
+      // malloc() is good for any fundamental alignment
+      if (int c = thread_cache_t::raw_class(rawlen + datalen);
+	  c > 0 && align <= alignof(std::max_align_t)) {
+	char *ptr = static_cast<char*>(
+	  thread_cache_get(c, thread_cache_t::class_size(c)));
+	return ceph::unique_leakable_ptr<buffer::raw>(
+	  new (ptr + datalen) raw_combined(ptr, len, align, mempool, c));
+      }
+
 #ifdef DARWIN
       char *ptr = (char *) valloc(rawlen + datalen);
 #else
@@ -124,7 +247,11 @@ static ceph::spinlock debug_lock;
 
     static void operator delete(void *ptr) {
       raw_combined *raw = (raw_combined *)ptr;
-      aligned_free((void *)raw->data);
+      if (raw->cache_class > 0) {
+	thread_cache_put(raw->cache_class, (void *)raw->data);
+      } else {
+	aligned_free((void *)raw->data);
+      }
     }
   };
 
@@ -2218,6 +2345,27 @@ buffer::ptr_node::create_hypercombined(ceph::unique_leakable_ptr<buffer::raw> r)
     new ptr_node(std::move(r)));
 }
 
+void* buffer::ptr_node::operator new(size_t size)
+{
+  if (size == sizeof(ptr_node)) {
+    return thread_cache_get(0, size);
+  }
+  void* p = ::malloc(size);
+  if (!p) {
+    throw bad_alloc();
+  }
+  return p;
+}
+
+void buffer::ptr_node::operator delete(void* p, size_t size)
+{
+  if (size == sizeof(ptr_node)) {
+    thread_cache_put(0, p);
+  } else {
+    ::free(p);
+  }
+}
+
 buffer::ptr_node* buffer::ptr_node::cloner::operator()(
   const buffer::ptr_node& clone_this)
 {
@@ -288,6 +288,7 @@ public:
       "log_graylog_host",
       "log_graylog_port",
       "log_coarse_timestamps",
+      "log_binary",
       "fsid",
       "host",
       NULL
@@ -311,8 +312,12 @@ public:
     }
 
     // file
+    if (changed.count("log_binary")) {
+      log->set_binary(conf.get_val<bool>("log_binary"));
+    }
     if (changed.count("log_file") ||
-	changed.count("log_to_file")) {
+	changed.count("log_to_file") ||
+	changed.count("log_binary")) {
       if (conf->log_to_file) {
 	log->set_log_file(conf->log_file);
       } else {
@@ -8,6 +8,7 @@
 #include "arch/ppc.h"
 #include "common/sctp_crc32.h"
 #include "common/crc32c_intel_fast.h"
+#include "common/crc32c_intel_interleave.h"
 #include "common/crc32c_aarch64.h"
 #include "common/crc32c_ppc.h"
 
@@ -26,6 +27,9 @@ ceph_crc32c_func_t ceph_choose_crc32(void)
   if (ceph_arch_intel_sse42 && ceph_crc32c_intel_fast_exists()) {
     return ceph_crc32c_intel_fast;
   }
+  if (ceph_arch_intel_sse42 && ceph_crc32c_intel_interleave_exists()) {
+    return ceph_crc32c_intel_interleave;
+  }
 #elif defined(__arm__) || defined(__aarch64__)
 # if defined(HAVE_ARMV8_CRC)
   if (ceph_arch_aarch64_crc32){
@@ -0,0 +1,147 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "common/crc32c_intel_interleave.h"
+
+#ifdef __x86_64__
+
+#include <nmmintrin.h>
+
+/*
+ * crc32c with the SSE 4.2 crc32 instruction, for the builds without the
+ * isa-l assembly.
+ *
+ * The instruction has a latency of 3 cycles but a throughput of 1 per
+ * cycle, so a buffer is cut in chunks of three streams, whose crcs are
+ * computed side by side and then combined: the crc of a stream is shifted
+ * over the length of the next one, which is the crc of that many zeroes,
+ * and xor-ed with the crc of the next one.  The streams are of a fixed
+ * length, so that shifting is a lookup in a table built once.
+ */
+
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+
+#define LONG_STREAM	8192
+#define SHORT_STREAM	256
+
+/* shift[k][b]: a crc register holding b in its byte k, shifted over a stream */
+static uint32_t long_shift[4][256];
+static uint32_t short_shift[4][256];
+static pthread_once_t shift_once = PTHREAD_ONCE_INIT;
+
+static inline uint64_t load64(unsigned char const *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static CRC32C_TARGET void build_shift(uint32_t table[4][256], unsigned len)
+{
+	uint32_t basis[32];
+	int bit, k, b;
+	unsigned i;
+
+	/* a crc register followed by zeroes is linear in the register */
+	for (bit = 0; bit < 32; bit++) {
+		uint64_t c = 1u << bit;
+		for (i = 0; i < len; i += 8)
+			c = _mm_crc32_u64(c, 0);
+		basis[bit] = (uint32_t)c;
+	}
+	for (k = 0; k < 4; k++) {
+		for (b = 0; b < 256; b++) {
+			uint32_t v = 0;
+			for (bit = 0; bit < 8; bit++) {
+				if (b & (1 << bit))
+					v ^= basis[8 * k + bit];
+			}
+			table[k][b] = v;
+		}
+	}
+}
+
+static void build_shift_tables(void)
+{
+	build_shift(long_shift, LONG_STREAM);
+	build_shift(short_shift, SHORT_STREAM);
+}
+
+static inline uint32_t shift(uint32_t table[4][256], uint32_t crc)
+{
+	return table[0][crc & 0xff] ^
+		table[1][(crc >> 8) & 0xff] ^
+		table[2][(crc >> 16) & 0xff] ^
+		table[3][crc >> 24];
+}
+
+static CRC32C_TARGET unsigned char const *crc32c_3way(
+	uint32_t *crc, unsigned char const *p, unsigned *len,
+	unsigned stream, uint32_t table[4][256])
+{
+	while (*len >= 3 * stream) {
+		uint64_t c0 = *crc, c1 = 0, c2 = 0;
+		unsigned char const *end = p + stream;
+		while (p < end) {
+			c0 = _mm_crc32_u64(c0, load64(p));
+			c1 = _mm_crc32_u64(c1, load64(p + stream));
+			c2 = _mm_crc32_u64(c2, load64(p + 2 * stream));
+			p += 8;
+		}
+		*crc = shift(table, shift(table, (uint32_t)c0) ^ (uint32_t)c1) ^
+			(uint32_t)c2;
+		p += 2 * stream;
+		*len -= 3 * stream;
+	}
+	return p;
+}
+
+static CRC32C_TARGET uint32_t crc32c_1way(uint32_t crc, unsigned char const *p, unsigned len)
+{
+	uint64_t c = crc;
+
+	for (; len >= 8; len -= 8, p += 8)
+		c = _mm_crc32_u64(c, load64(p));
+	crc = (uint32_t)c;
+	while (len--)
+		crc = _mm_crc32_u8(crc, *p++);
+	return crc;
+}
+
+static CRC32C_TARGET uint32_t crc32c_zeros_1way(uint32_t crc, unsigned len)
+{
+	uint64_t c = crc;
+
+	for (; len >= 8; len -= 8)
+		c = _mm_crc32_u64(c, 0);
+	crc = (uint32_t)c;
+	while (len--)
+		crc = _mm_crc32_u8(crc, 0);
+	return crc;
+}
+
+CRC32C_TARGET uint32_t ceph_crc32c_intel_interleave(uint32_t crc, unsigned char const *buffer, unsigned len)
+{
+	if (!buffer)
+		return crc32c_zeros_1way(crc, len);
+	if (len >= 3 * SHORT_STREAM) {
+		pthread_once(&shift_once, build_shift_tables);
+		buffer = crc32c_3way(&crc, buffer, &len, LONG_STREAM, long_shift);
+		buffer = crc32c_3way(&crc, buffer, &len, SHORT_STREAM, short_shift);
+	}
+	return crc32c_1way(crc, buffer, len);
+}
+
+int ceph_crc32c_intel_interleave_exists(void)
+{
+	return 1;
+}
+
+#else
+
+int ceph_crc32c_intel_interleave_exists(void)
+{
+	return 0;
+}
+
+#endif
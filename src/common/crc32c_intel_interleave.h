@@ -0,0 +1,30 @@
+#ifndef CEPH_COMMON_CRC32C_INTEL_INTERLEAVE_H
+#define CEPH_COMMON_CRC32C_INTEL_INTERLEAVE_H
+
+#include "include/int_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* is the interleaved version compiled in */
+extern int ceph_crc32c_intel_interleave_exists(void);
+
+#ifdef __x86_64__
+
+extern uint32_t ceph_crc32c_intel_interleave(uint32_t crc, unsigned char const *buffer, unsigned len);
+
+#else
+
+static inline uint32_t ceph_crc32c_intel_interleave(uint32_t crc, unsigned char const *buffer, unsigned len)
+{
+	return 0;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
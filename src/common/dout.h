@@ -24,6 +24,7 @@
 #include <seastar/util/log.hh>
 #include "crimson/common/log.h"
 #include "crimson/common/config_proxy.h"
+#include "log/BinaryLog.h"
 #else
 #include "global/global_context.h"
 #include "common/ceph_context.h"
@@ -132,6 +133,9 @@ struct is_dynamic<dynamic_marker_t<T>> : public std::true_type {};
                   "{}", _out.str().c_str());    \
     }                                           \
   } while (0)
+#define dout_args_impl(cct, sub, v, fmt, ...)				\
+  dout_impl(cct, sub, v)						\
+    *_dout << ceph::logging::render_args(fmt, ##__VA_ARGS__) << dendl_impl
 #elif defined(WITH_SEASTAR) && defined(WITH_ALIEN)
 #define dout_impl(cct, sub, v)						\
   do {									\
@@ -142,6 +146,9 @@ struct is_dynamic<dynamic_marker_t<T>> : public std::true_type {};
 #define dendl_impl std::flush;                                          \
   }                                                                     \
   } while (0)
+#define dout_args_impl(cct, sub, v, fmt, ...)				\
+  dout_impl(cct, sub, v)						\
+    *_dout << ceph::logging::render_args(fmt, ##__VA_ARGS__) << dendl_impl
 #else
 #define dout_impl(cct, sub, v)						\
   do {									\
@@ -169,12 +176,39 @@ struct is_dynamic<dynamic_marker_t<T>> : public std::true_type {};
     _dout_cct->_log->submit_entry(std::move(_dout_e));                  \
   }                                                                     \
   } while (0)
+
+// the format and the arguments go to the log as they are, see
+// Log::submit_args()
+#define dout_args_impl(cct, sub, v, fmt, ...)				\
+  do {									\
+  const bool should_gather = [&](const auto cctX) {			\
+    if constexpr (ceph::dout::is_dynamic<decltype(sub)>::value ||	\
+		  ceph::dout::is_dynamic<decltype(v)>::value) {		\
+      return cctX->_conf->subsys.should_gather(sub, v);			\
+    } else {								\
+      return (cctX->_conf->subsys.template should_gather<sub, v>());	\
+    }									\
+  }(cct);								\
+									\
+  if (should_gather) {							\
+    static const uint16_t _dout_fmt_id =				\
+      ceph::logging::register_binary_format(fmt);			\
+    (cct)->_log->submit_args(v, sub, _dout_fmt_id, ##__VA_ARGS__);	\
+  }									\
+  } while (0)
 #endif	// WITH_SEASTAR
 
 #define lsubdout(cct, sub, v)  dout_impl(cct, ceph_subsys_##sub, v) dout_prefix
 #define ldout(cct, v)  dout_impl(cct, dout_subsys, v) dout_prefix
 #define lderr(cct) dout_impl(cct, ceph_subsys_, -1) dout_prefix
 
+// a line given as a format, with a "{}" for each of the arguments which
+// follow it, and no dout_prefix
+#define lsubdout_args(cct, sub, v, fmt, ...)				\
+  dout_args_impl(cct, ceph_subsys_##sub, v, fmt, ##__VA_ARGS__)
+#define ldout_args(cct, v, fmt, ...)					\
+  dout_args_impl(cct, dout_subsys, v, fmt, ##__VA_ARGS__)
+
 #define ldpp_dout(dpp, v) 						\
   if (decltype(auto) pdpp = (dpp); pdpp) /* workaround -Wnonnull-compare for 'this' */ \
     dout_impl(pdpp->get_cct(), ceph::dout::need_dynamic(pdpp->get_subsys()), v) \
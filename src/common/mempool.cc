@@ -61,6 +61,58 @@ void mempool::set_debug_mode(bool d)
   debug_mode = d;
 }
 
+// --------------------------------------------------------------
+// arena_t
+
+mempool::arena_t::arena_t(pool_index_t ix, char *buf, size_t buf_size,
+			  size_t chunk_size)
+  : shard(get_pool(ix).pick_a_shard()),
+    chunk_size(chunk_size),
+    pos(buf),
+    end(buf + buf_size),
+    total(buf_size)
+{
+  shard->items++;
+  shard->bytes += total;
+}
+
+mempool::arena_t::~arena_t()
+{
+  while (chunks) {
+    chunk_t *next = chunks->next;
+    ::operator delete(chunks);
+    chunks = next;
+  }
+  shard->items--;
+  shard->bytes -= total;
+}
+
+void *mempool::arena_t::allocate_slow(size_t size, size_t align)
+{
+  // the chunk header keeps the data max_align_t aligned, larger alignments
+  // are paid for with some room
+  constexpr size_t header = std::max(sizeof(chunk_t),
+				     alignof(std::max_align_t));
+  size_t need = header + size +
+    (align > alignof(std::max_align_t) ? align : 0);
+  size_t len = std::max(chunk_size, need);
+  auto c = static_cast<chunk_t*>(::operator new(len));
+  c->next = chunks;
+  chunks = c;
+  shard->bytes += len;
+  total += len;
+  char *data = reinterpret_cast<char*>(c) + header;
+  if (len > chunk_size) {
+    // an oversized one; keep on with what is left of the current chunk
+    auto p = reinterpret_cast<char*>(
+      (reinterpret_cast<uintptr_t>(data) + align - 1) & ~(uintptr_t)(align - 1));
+    return p;
+  }
+  pos = data;
+  end = reinterpret_cast<char*>(c) + len;
+  return allocate(size, align);
+}
+
 // --------------------------------------------------------------
 // pool_t
 
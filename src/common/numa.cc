@@ -6,6 +6,12 @@
 #include <cstring>
 #include <errno.h>
 #include <iostream>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 #include "include/stringify.h"
 #include "common/safe_io.h"
@@ -188,6 +194,119 @@ int set_cpu_affinity_all_threads(size_t cpu_set_size, cpu_set_t *cpu_set)
   return 0;
 }
 
+int get_numa_nodes(std::set<int> *nodes)
+{
+  std::set<std::string> ls;
+  int r = easy_readdir("/sys/devices/system/node", &ls);
+  if (r < 0) {
+    return r;
+  }
+  nodes->clear();
+  for (auto& i : ls) {
+    int node;
+    if (sscanf(i.c_str(), "node%d", &node) == 1) {
+      nodes->insert(node);
+    }
+  }
+  return nodes->empty() ? -ENOENT : 0;
+}
+
+/// the numa node of each cpu, read from sysfs once; -1 for the cpus which
+/// are not listed
+static const std::vector<int>& get_cpu_numa_nodes()
+{
+  static const std::vector<int> cpu_nodes = [] {
+    std::vector<int> v;
+    std::set<int> nodes;
+    if (get_numa_nodes(&nodes) < 0) {
+      return v;
+    }
+    for (int node : nodes) {
+      size_t cpu_set_size;
+      cpu_set_t cpu_set;
+      if (get_numa_node_cpu_set(node, &cpu_set_size, &cpu_set) < 0) {
+	continue;
+      }
+      for (int cpu : cpu_set_to_set(cpu_set_size, &cpu_set)) {
+	if (cpu >= (int)v.size()) {
+	  v.resize(cpu + 1, -1);
+	}
+	v[cpu] = node;
+      }
+    }
+    return v;
+  }();
+  return cpu_nodes;
+}
+
+int get_cpu_numa_node(int cpu)
+{
+  auto& cpu_nodes = get_cpu_numa_nodes();
+  if (cpu < 0 || cpu >= (int)cpu_nodes.size() || cpu_nodes[cpu] < 0) {
+    return -ENOENT;
+  }
+  return cpu_nodes[cpu];
+}
+
+static thread_local int thread_numa_node = -1;
+
+int set_thread_numa_affinity(int node)
+{
+  size_t cpu_set_size;
+  cpu_set_t cpu_set;
+  int r = get_numa_node_cpu_set(node, &cpu_set_size, &cpu_set);
+  if (r < 0) {
+    return r;
+  }
+  r = pthread_setaffinity_np(pthread_self(), cpu_set_size, &cpu_set);
+  if (r) {
+    return -r;
+  }
+  thread_numa_node = node;
+  return 0;
+}
+
+int set_thread_cpu_affinity(size_t cpu_set_size, const cpu_set_t *cpu_set)
+{
+  int r = pthread_setaffinity_np(pthread_self(), cpu_set_size, cpu_set);
+  if (r) {
+    return -r;
+  }
+  thread_numa_node = -1;
+  return 0;
+}
+
+int get_thread_numa_node()
+{
+  return thread_numa_node;
+}
+
+int get_current_numa_node()
+{
+  if (thread_numa_node >= 0) {
+    return thread_numa_node;
+  }
+  // sched_getcpu() is served by the vdso, unlike a getcpu syscall
+  int node = get_cpu_numa_node(sched_getcpu());
+  return node < 0 ? -1 : node;
+}
+
+int get_socket_numa_node(int fd)
+{
+#ifdef SO_INCOMING_CPU
+  int cpu = -1;
+  socklen_t len = sizeof(cpu);
+  if (::getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0 ||
+      cpu < 0) {
+    return -1;
+  }
+  int node = get_cpu_numa_node(cpu);
+  return node < 0 ? -1 : node;
+#else
+  return -1;
+#endif
+}
+
 #else
 int parse_cpu_set_list(const char *s,
 		       size_t *cpu_set_size,
@@ -221,4 +340,39 @@ int set_cpu_affinity_all_threads(size_t cpu_set_size,
   return -ENOTSUP;
 }
 
+int get_numa_nodes(std::set<int> *nodes)
+{
+  return -ENOTSUP;
+}
+
+int get_cpu_numa_node(int cpu)
+{
+  return -ENOTSUP;
+}
+
+int set_thread_numa_affinity(int node)
+{
+  return -ENOTSUP;
+}
+
+int set_thread_cpu_affinity(size_t cpu_set_size, const cpu_set_t *cpu_set)
+{
+  return -ENOTSUP;
+}
+
+int get_thread_numa_node()
+{
+  return -1;
+}
+
+int get_current_numa_node()
+{
+  return -1;
+}
+
+int get_socket_numa_node(int fd)
+{
+  return -1;
+}
+
 #endif
@@ -22,3 +22,27 @@ int get_numa_node_cpu_set(int node,
 
 int set_cpu_affinity_all_threads(size_t cpu_set_size,
 				 cpu_set_t *cpu_set);
+
+/// the numa nodes of the system
+int get_numa_nodes(std::set<int> *nodes);
+
+/// the numa node of @p cpu, or a negative error code
+int get_cpu_numa_node(int cpu);
+
+/// bind the calling thread to the CPUs of numa node @p node
+int set_thread_numa_affinity(int node);
+
+/// set the CPU affinity of the calling thread to @p cpu_set, which undoes
+/// set_thread_numa_affinity()
+int set_thread_cpu_affinity(size_t cpu_set_size, const cpu_set_t *cpu_set);
+
+/// @return the node the calling thread was bound to by
+/// set_thread_numa_affinity(), or -1
+int get_thread_numa_node();
+
+/// @return the numa node the calling thread runs on, or -1 if unknown
+int get_current_numa_node();
+
+/// @return the numa node of the CPU which receives the packets of the
+/// socket @p fd (SO_INCOMING_CPU), or -1 if unknown
+int get_socket_numa_node(int fd);
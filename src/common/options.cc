@@ -673,6 +673,26 @@ std::vector<Option> get_global_options() {
     .add_tag("performance")
     .add_tag("service"),
 
+    Option("log_binary", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("write the log file in binary form, through per-thread lock-free buffers")
+    .set_long_description("Log entries are queued into per-thread lock-free "
+			  "ring buffers instead of the shared log queue, and "
+			  "written to log_file with '.bin' appended as "
+			  "binary records; their time stamp, thread and "
+			  "priority are only rendered by ceph-log-decode, and "
+			  "so is the text of the entries logged with their "
+			  "arguments (ldout_args), such as the debug_osd 10 "
+			  "lines of the op dispatch, the PG op path and the "
+			  "peering events. The other entries are still "
+			  "formatted when logged. The recent events dumped on a crash are "
+			  "written the same way. Changing it reopens the log "
+			  "file.")
+    .add_service("common")
+    .add_tag("performance")
+    .add_tag("service")
+    .add_see_also("log_file"),
+
 
     // unmodified
     Option("clog_to_monitors", Option::TYPE_STR, Option::LEVEL_ADVANCED)
@@ -1149,6 +1169,13 @@ std::vector<Option> get_global_options() {
     .set_min_max(1, 24)
     .set_description("Threadpool size for AsyncMessenger (ms_type=async)"),
 
+    Option("ms_async_numa_spread", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Spread the AsyncMessenger workers over the numa nodes")
+    .set_long_description("Each worker thread is bound to the CPUs of one numa node, and an accepted connection is handed to a worker on the numa node whose CPU receives its packets (SO_INCOMING_CPU), so that its data stays on one node.")
+    .add_see_also({"ms_async_op_threads", "osd_numa_spread"}),
+
     Option("ms_async_rdma_device_name", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description(""),
@@ -1275,6 +1302,17 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description("send ourselves a SIGTERM early during startup"),
 
+    Option("op_tracker_lockless", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .add_service({"mon", "osd", "mds"})
+    .set_description("track ops without taking locks on their hot paths")
+    .set_long_description("Record the well known events of tracked ops as ids "
+			  "and timestamps in a preallocated array per op, and "
+			  "keep the completed ops in lock-free rings, one per "
+			  "op tracker shard.  Event descriptions are only "
+			  "built when the ops are dumped."),
+
     // MON
     Option("mon_enable_op_tracker", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
@@ -2266,6 +2304,14 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description(""),
 
+    Option("paxos_propose_batch", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .add_service("mon")
+    .set_description("Batch the pending changes of services that are about to propose into one proposal")
+    .set_long_description("When a service proposes, the pending changes of the other services whose proposal delay expires within paxos_min_wait are included in the same Paxos round, instead of each waiting for a round of its own.")
+    .add_see_also("paxos_propose_interval")
+    .add_see_also("paxos_min_wait"),
+
     Option("paxos_min", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(500)
     .add_service("mon")
@@ -2517,6 +2563,13 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_STARTUP)
     .set_description("automatically set affinity to numa node when storage and network match"),
 
+    Option("osd_numa_spread", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("spread the op shards over the numa nodes")
+    .set_long_description("Rather than binding the whole process to one numa node, bind the threads of each op shard to one node, in contiguous runs; the PGs of a shard are loaded at boot on its node, and from then on the PGs and the cache shards of a shard (osd_num_cache_shards is rounded up to a multiple of the number of op shards) are allocated by its threads, hence on their node.  Ignored if osd_numa_node is set.  The messenger workers are spread with ms_async_numa_spread.")
+    .add_see_also({"osd_numa_node", "ms_async_numa_spread"}),
+
     Option("osd_numa_node", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(-1)
     .set_flag(Option::FLAG_STARTUP)
@@ -2638,6 +2691,13 @@ std::vector<Option> get_global_options() {
     .set_default(0)
     .set_description("maximum number of in-flight client requests"),
 
+    Option("osd_client_throttle_target_latency", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Target latency (in seconds) of the client ops")
+    .set_long_description("If nonzero, the in-flight client bytes and requests are throttled below osd_client_message_size_cap and osd_client_message_cap as needed to keep the latency of the client ops, from their admission, under this target.")
+    .add_see_also({"osd_client_message_size_cap", "osd_client_message_cap", "throttle_adaptive_interval"}),
+
     Option("osd_crush_update_weight_set", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("update CRUSH weight-set weights when updating weights")
@@ -2844,7 +2904,7 @@ std::vector<Option> get_global_options() {
 
     Option("osd_tier_default_cache_hit_set_type", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("bloom")
-    .set_enum_allowed({"bloom", "explicit_hash", "explicit_object"})
+    .set_enum_allowed({"bloom", "explicit_hash", "explicit_object", "count_min"})
     .set_flag(Option::FLAG_RUNTIME)
     .set_description(""),
 
@@ -2871,7 +2931,8 @@ std::vector<Option> get_global_options() {
 
     Option("osd_map_dedup", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
-    .set_description(""),
+    .set_description("Share unchanged structures between cached OSDMaps")
+    .set_long_description("When an OSDMap is added to the OSD's map cache, its crush map, addresses, pg_temp, primary_temp, upmaps, uuids and primary affinities are compared with those of the nearest cached epoch and shared if they are identical."),
 
     Option("osd_map_cache_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(50)
@@ -3413,6 +3474,20 @@ std::vector<Option> get_global_options() {
     .set_default(512_K)
     .set_description("Number of bytes to read from an object at a time during deep scrub"),
 
+    Option("osd_scrub_scan_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of threads used to scan the objects of a scrub chunk in parallel")
+    .set_long_description("When non-zero, the stat, attribute read and deep-scrub digest computation of the objects in a scrub chunk are dispatched to a dedicated thread pool, and the PG lock is only held to assemble the results. Zero scans the objects one at a time on the op thread, as is always done for erasure coded pools.")
+    .add_see_also("osd_scrub_scan_max_bytes"),
+
+    Option("osd_scrub_scan_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(16_M)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Maximum amount of object data read concurrently by the parallel scrub scanner")
+    .add_see_also("osd_scrub_scan_threads")
+    .add_see_also("osd_deep_scrub_stride"),
+
     Option("osd_deep_scrub_keys", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1024)
     .set_description("Number of keys to read from an object at a time during deep scrub"),
@@ -3749,6 +3824,12 @@ std::vector<Option> get_global_options() {
     .set_default(2)
     .set_description(""),
 
+    Option("memdb_index", Option::TYPE_STR, Option::LEVEL_DEV)
+    .set_default("map")
+    .set_enum_allowed({"map", "skiplist"})
+    .set_description("Ordered index of the in-memory key/value store")
+    .set_long_description("'map' keeps the keys in a std::map behind one lock. 'skiplist' keeps them in a skiplist the readers walk without locking, which lets gets and iterators scale with the threads; the writers are still serialized."),
+
     Option("leveldb_log_to_ceph_log", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
@@ -3810,6 +3891,12 @@ std::vector<Option> get_global_options() {
     .set_default("binned_lru")
     .set_description(""),
 
+    Option("rocksdb_cache_partitions", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("Column families that get a partition of the shared block cache")
+    .set_long_description("Comma separated list of column_family=min:max. Each listed column family gets an LRU of its own, so that e.g. omap scans cannot evict the blocks of other column families, but its capacity is taken out of the shared binned_lru block cache. When the cache is autotuned, the capacity is split again between the partitions (and the rest of the cache) according to their recent hits, but each partition keeps between min and max of the whole. Column families with a block_cache of their own are not affected. Example: 'm=0.1:0.5,p=0.1:0.5,L=0:0.2'")
+    .add_see_also("rocksdb_cache_type"),
+
     Option("rocksdb_block_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(4_K)
     .set_description(""),
@@ -3834,6 +3921,38 @@ std::vector<Option> get_global_options() {
     .set_default(1048576)
     .set_description("The number of keys required to invoke DeleteRange when deleting muliple keys."),
 
+    Option("rocksdb_delete_range_mode", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("threshold")
+    .set_enum_allowed({"threshold", "always"})
+    .set_description("How to remove a range of keys, e.g. an object's omap")
+    .set_long_description("'threshold' deletes the keys one by one, unless there are at least rocksdb_delete_range_threshold of them, in which case a single DeleteRange is used. 'always' uses DeleteRange right away, and does not need to iterate over the keys first.")
+    .add_see_also("rocksdb_delete_range_threshold"),
+
+    Option("rocksdb_tombstone_compact_threshold", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(262144)
+    .set_description("Compact the key ranges removed from a column family once they left this many tombstones behind")
+    .set_long_description("Every key deleted by a range removal, and every DeleteRange, counts as a tombstone. Iterators have to skip the tombstones until a compaction drops them, so the ranges they are in are queued for compaction once a column family accumulates this many. 0 disables this.")
+    .add_see_also("rocksdb_delete_range_mode"),
+
+    Option("rocksdb_reshard_online_keys_per_batch", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_min(1)
+    .set_description("Maximum number of keys moved by one batch of an online reshard")
+    .set_long_description("A batch is scanned without blocking other writes. Writes to the prefixes being resharded only wait for the batch to be written, but a batch whose prefix was written meanwhile is scanned again, so smaller batches waste less work on busy prefixes at the expense of a longer reshard.")
+    .add_see_also("rocksdb_reshard_online_bytes_per_batch"),
+
+    Option("rocksdb_reshard_online_bytes_per_batch", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_M)
+    .set_min(4_K)
+    .set_description("Maximum size of the keys and values moved by one batch of an online reshard")
+    .add_see_also("rocksdb_reshard_online_keys_per_batch"),
+
+    Option("rocksdb_reshard_online_batch_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.01)
+    .set_min(0.0)
+    .set_description("Seconds to pause between the batches of an online reshard")
+    .set_long_description("Leaves room for the client writes between the batches. 0 moves the keys as fast as possible."),
+
     Option("rocksdb_bloom_bits_per_key", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(20)
     .set_description("Number of bits per key to use for RocksDB's bloom filters.")
@@ -4185,6 +4304,14 @@ std::vector<Option> get_global_options() {
     .set_description("Enabled buffered IO for bluefs reads.")
     .set_long_description("When this option is enabled, bluefs will in some cases perform buffered reads.  This allows the kernel page cache to act as a secondary cache for things like RocksDB compaction.  For example, if the rocksdb block cache isn't large enough to hold blocks from the compressed SST files itself, they can be read from page cache instead of from the disk.  This option previously was enabled by default, however in some test cases it appears to cause excessive swap utilization by the linux kernel and a large negative performance impact after several hours of run time.  Please exercise caution when enabling."),
 
+    Option("bluefs_buffer_cache_block_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_K)
+    .set_min(4_K)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Size of the blocks the bluefs buffer cache keeps file data in")
+    .set_long_description("Rounded up to the page size.  The size of the cache itself is set by bluestore_cache_bluefs_ratio.")
+    .add_see_also("bluestore_cache_bluefs_ratio"),
+
     Option("bluefs_sync_write", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -4519,6 +4646,13 @@ std::vector<Option> get_global_options() {
     .add_see_also("bluestore_cache_size")
     .set_description("Ratio of bluestore cache to devote to kv onode column family (rocksdb)"),
 
+    Option("bluestore_cache_bluefs_ratio", Option::TYPE_FLOAT, Option::LEVEL_DEV)
+    .set_default(0)
+    .set_description("Ratio of bluestore cache to devote to the bluefs buffer cache")
+    .set_long_description("The bluefs buffer cache keeps the data of RocksDB's table files and hands it to the readers without a copy.  It is disabled when this is 0.")
+    .add_see_also("bluestore_cache_size")
+    .add_see_also("bluefs_buffer_cache_block_size"),
+
     Option("bluestore_cache_autotune", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(true)
     .add_see_also("bluestore_cache_size")
@@ -4649,6 +4783,13 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_RUNTIME)
     .set_description("Maximum bytes in flight before we throttle IO submission"),
 
+    Option("bluestore_throttle_target_latency", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Target latency (in seconds) from submission to kv commit")
+    .set_long_description("If nonzero, the max of the bluestore_throttle_bytes throttle is adapted, below bluestore_throttle_bytes, to keep the latency of the transactions under this target.")
+    .add_see_also({"bluestore_throttle_bytes", "throttle_adaptive_interval"}),
+
     Option("bluestore_throttle_deferred_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(128_M)
     .set_flag(Option::FLAG_RUNTIME)
@@ -5425,6 +5566,15 @@ std::vector<Option> get_global_options() {
                           "if you simply do not require the most up to date "
                           "performance counter data."),
 
+    Option("mgr_pg_digest_delta", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .add_service("mgr")
+    .set_description("Send only the changes to the PG digest to the monitors")
+    .set_long_description("Once the monitors have acknowledged a full PG "
+                          "digest, report just the pools and OSDs whose "
+                          "stats changed since the previous report.")
+    .add_see_also("mgr_stats_period"),
+
     Option("mgr_client_bytes", Option::TYPE_SIZE, Option::LEVEL_DEV)
     .set_default(128_M)
     .add_service("mgr"),
@@ -5508,6 +5658,19 @@ std::vector<Option> get_global_options() {
     .set_default(true)
     .set_description(""),
 
+    Option("throttle_adaptive_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.1)
+    .set_min(.001)
+    .set_description("Interval (in seconds) between the adjustments of an adaptive throttle")
+    .set_long_description("An adaptive throttle compares the minimum latency of the requests it admitted during this interval to its target latency, and lowers or raises its max accordingly.")
+    .add_see_also({"bluestore_throttle_target_latency", "osd_client_throttle_target_latency"}),
+
+    Option("throttle_adaptive_min_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.05)
+    .set_min_max(.0, 1.)
+    .set_description("Lowest max of an adaptive throttle, as a ratio of its configured max")
+    .add_see_also("throttle_adaptive_interval"),
+
     Option("event_tracing", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -18,6 +18,13 @@
 #include "common/valgrind.h"
 #include "include/common_fwd.h"
 
+#include <algorithm>
+#include <functional>
+#include <thread>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 using std::ostringstream;
 using std::make_pair;
 using std::pair;
@@ -168,13 +175,7 @@ void PerfCounters::inc(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt;
-    data.avgcount2++;
-  } else {
-    data.u64 += amt;
-  }
+  data.add(amt);
 }
 
 void PerfCounters::dec(int idx, uint64_t amt)
@@ -190,7 +191,7 @@ void PerfCounters::dec(int idx, uint64_t amt)
   ceph_assert(!(data.type & PERFCOUNTER_LONGRUNAVG));
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  data.u64 -= amt;
+  data.sub(amt);
 }
 
 void PerfCounters::set(int idx, uint64_t amt)
@@ -208,13 +209,7 @@ void PerfCounters::set(int idx, uint64_t amt)
 
   ANNOTATE_BENIGN_RACE_SIZED(&data.u64, sizeof(data.u64),
                              "perf counter atomic");
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 = amt;
-    data.avgcount2++;
-  } else {
-    data.u64 = amt;
-  }
+  data.store(amt);
 }
 
 uint64_t PerfCounters::get(int idx) const
@@ -229,7 +224,7 @@ uint64_t PerfCounters::get(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return 0;
-  return data.u64;
+  return data.read_u64();
 }
 
 void PerfCounters::tinc(int idx, utime_t amt)
@@ -244,13 +239,7 @@ void PerfCounters::tinc(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.to_nsec();
-    data.avgcount2++;
-  } else {
-    data.u64 += amt.to_nsec();
-  }
+  data.add(amt.to_nsec());
 }
 
 void PerfCounters::tinc(int idx, ceph::timespan amt)
@@ -265,13 +254,7 @@ void PerfCounters::tinc(int idx, ceph::timespan amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.count();
-    data.avgcount2++;
-  } else {
-    data.u64 += amt.count();
-  }
+  data.add(amt.count());
 }
 
 void PerfCounters::tset(int idx, utime_t amt)
@@ -286,7 +269,7 @@ void PerfCounters::tset(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  data.u64 = amt.to_nsec();
+  data.store(amt.to_nsec());
   if (data.type & PERFCOUNTER_LONGRUNAVG)
     ceph_abort();
 }
@@ -303,7 +286,7 @@ utime_t PerfCounters::tget(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return utime_t();
-  uint64_t v = data.u64;
+  uint64_t v = data.read_u64();
   return utime_t(v / 1000000000ull, v % 1000000000ull);
 }
 
@@ -451,7 +434,7 @@ void PerfCounters::dump_formatted_generic(Formatter *f, bool schema,
         d->histogram->dump_formatted(f);
         f->close_section();
       } else {
-	uint64_t v = d->u64;
+	uint64_t v = d->read_u64();
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned(d->name, v);
 	} else if (d->type & PERFCOUNTER_TIME) {
@@ -467,6 +450,26 @@ void PerfCounters::dump_formatted_generic(Formatter *f, bool schema,
   f->close_section();
 }
 
+unsigned PerfCounters::perf_counter_data_any_d::get_num_shards()
+{
+  static const unsigned num_shards =
+    std::clamp(std::thread::hardware_concurrency(), 1u, 64u);
+  return num_shards;
+}
+
+PerfCounters::perf_counter_data_any_d::shard_t&
+PerfCounters::perf_counter_data_any_d::get_shard()
+{
+#ifdef __linux__
+  if (int cpu = sched_getcpu(); cpu >= 0) {
+    return shards[cpu % get_num_shards()];
+  }
+#endif
+  static thread_local unsigned slot =
+    std::hash<std::thread::id>{}(std::this_thread::get_id()) % get_num_shards();
+  return shards[slot];
+}
+
 const std::string &PerfCounters::get_name() const
 {
   return m_name;
@@ -573,6 +576,20 @@ void PerfCountersBuilder::add_impl(
   data.histogram = std::move(histogram);
 }
 
+void PerfCountersBuilder::set_sharded(int idx)
+{
+  ceph_assert(idx > m_perf_counters->m_lower_bound);
+  ceph_assert(idx < m_perf_counters->m_upper_bound);
+  PerfCounters::perf_counter_data_any_d
+    &data(m_perf_counters->m_data[idx - m_perf_counters->m_lower_bound - 1]);
+  // gauges are set rather than bumped, histograms are not summed
+  ceph_assert(data.type & (PERFCOUNTER_COUNTER | PERFCOUNTER_LONGRUNAVG));
+  ceph_assert(!(data.type & PERFCOUNTER_HISTOGRAM));
+  data.shards.reset(
+    new PerfCounters::perf_counter_data_any_d::shard_t[
+      PerfCounters::perf_counter_data_any_d::get_num_shards()]);
+}
+
 PerfCounters *PerfCountersBuilder::create_perf_counters()
 {
   PerfCounters::perf_counter_data_vec_t::const_iterator d = m_perf_counters->m_data.begin();
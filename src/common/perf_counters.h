@@ -113,6 +113,10 @@ public:
     prio_default = prio_;
   }
 
+  /// spread the updates of counter @p key over per-CPU slots, summed when
+  /// read; for counters and averages bumped by many threads at once
+  void set_sharded(int key);
+
   PerfCounters* create_perf_counters();
 private:
   PerfCountersBuilder(const PerfCountersBuilder &rhs);
@@ -169,7 +173,7 @@ public:
         nick(other.nick),
 	 type(other.type),
 	 unit(other.unit),
-	 u64(other.u64.load()) {
+	 u64(other.read_u64()) {
       auto a = other.read_avg();
       u64 = a.first;
       avgcount = a.second;
@@ -190,22 +194,118 @@ public:
     std::atomic<uint64_t> avgcount2 = { 0 };
     std::unique_ptr<PerfHistogram<>> histogram;
 
+    /// a per-CPU slot of a sharded counter, the u64/avgcount/avgcount2
+    /// above are unused then
+    struct alignas(64) shard_t {
+      std::atomic<uint64_t> u64 = { 0 };
+      std::atomic<uint64_t> avgcount = { 0 };
+      std::atomic<uint64_t> avgcount2 = { 0 };
+    };
+    std::unique_ptr<shard_t[]> shards;
+
+    static unsigned get_num_shards();
+    /// the slot of the CPU we are running on
+    shard_t& get_shard();
+
     void reset()
     {
       if (type != PERFCOUNTER_U64) {
 	    u64 = 0;
 	    avgcount = 0;
 	    avgcount2 = 0;
+	if (shards) {
+	  for (unsigned i = 0; i < get_num_shards(); ++i) {
+	    shards[i].u64 = 0;
+	    shards[i].avgcount = 0;
+	    shards[i].avgcount2 = 0;
+	  }
+	}
       }
       if (histogram) {
         histogram->reset();
       }
     }
 
+    /// add @p v to the value, counting it if we are an average
+    void add(uint64_t v) {
+      if (shards) {
+	add(get_shard(), v);
+      } else {
+	add(*this, v);
+      }
+    }
+    void sub(uint64_t v) {
+      (shards ? get_shard().u64 : u64) -= v;
+    }
+    /// replace the value, which the other slots stop contributing to
+    void store(uint64_t v) {
+      if (!shards) {
+	store(*this, v);
+	return;
+      }
+      auto& mine = get_shard();
+      for (unsigned i = 0; i < get_num_shards(); ++i) {
+	if (&shards[i] != &mine) {
+	  shards[i].u64 = 0;
+	}
+      }
+      store(mine, v);
+    }
+
+    uint64_t read_u64() const {
+      if (!shards) {
+	return u64;
+      }
+      uint64_t sum = 0;
+      for (unsigned i = 0; i < get_num_shards(); ++i) {
+	sum += shards[i].u64;
+      }
+      return sum;
+    }
+
     // read <sum, count> safely by making sure the post- and pre-count
     // are identical; in other words the whole loop needs to be run
-    // without any intervening calls to inc, set, or tinc.
+    // without any intervening calls to inc, set, or tinc.  a sharded
+    // counter is read slot by slot.
     std::pair<uint64_t,uint64_t> read_avg() const {
+      if (!shards) {
+	return read_avg(u64, avgcount, avgcount2);
+      }
+      std::pair<uint64_t,uint64_t> total = { 0, 0 };
+      for (unsigned i = 0; i < get_num_shards(); ++i) {
+	auto a = read_avg(shards[i].u64, shards[i].avgcount,
+			  shards[i].avgcount2);
+	total.first += a.first;
+	total.second += a.second;
+      }
+      return total;
+    }
+
+  private:
+    template <typename T>
+    void add(T& to, uint64_t v) {
+      if (type & PERFCOUNTER_LONGRUNAVG) {
+	to.avgcount++;
+	to.u64 += v;
+	to.avgcount2++;
+      } else {
+	to.u64 += v;
+      }
+    }
+    template <typename T>
+    void store(T& to, uint64_t v) {
+      if (type & PERFCOUNTER_LONGRUNAVG) {
+	to.avgcount++;
+	to.u64 = v;
+	to.avgcount2++;
+      } else {
+	to.u64 = v;
+      }
+    }
+    static std::pair<uint64_t,uint64_t> read_avg(
+      const std::atomic<uint64_t>& u64,
+      const std::atomic<uint64_t>& avgcount,
+      const std::atomic<uint64_t>& avgcount2) {
       uint64_t sum, count;
       do {
 	count = avgcount2;
@@ -117,6 +117,8 @@ struct error_code;
   int get_missed_crc();
   /// enable/disable tracking of cached crcs
   void track_cached_crc(bool b);
+  /// enable/disable the per-thread caches of ptr_nodes and small buffers
+  void use_thread_cache(bool b);
 
   /*
    * an abstract raw buffer.  with a reference count.
@@ -371,6 +373,10 @@ struct error_code;
 
     ~ptr_node() = default;
 
+    // from a per-thread cache
+    static void* operator new(size_t size);
+    static void operator delete(void* p, size_t size);
+
     static std::unique_ptr<ptr_node, disposer>
     create(ceph::unique_leakable_ptr<raw> r) {
       return create_hypercombined(std::move(r));
@@ -36,6 +36,8 @@ inline namespace v15_2_0 {
     char *data;
     unsigned len;
   public:
+    /// counted with atomic ops by every thread; the per-thread caches
+    /// only recycle the memory of raw buffers, not their references
     ceph::atomic<unsigned> nref { 0 };
     int mempool;
 
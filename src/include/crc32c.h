@@ -50,6 +50,24 @@ static inline uint32_t ceph_crc32c(uint32_t crc, unsigned char const *data, unsi
   return ceph_crc32c_func(crc, data, length);
 }
 
+/**
+ * combine the crc32c of two adjacent buffers
+ *
+ * ceph_crc32c(crc, a + b, len_a + len_b) ==
+ *   ceph_crc32c_combine(ceph_crc32c(crc, a, len_a),
+ *                       ceph_crc32c(0, b, len_b), len_b)
+ *
+ * so that the pieces of a buffer may be computed independently.
+ *
+ * @param crc_a crc32c of the first buffer
+ * @param crc_b crc32c of the second buffer, from an initial value of 0
+ * @param length_b length of the second buffer
+ */
+static inline uint32_t ceph_crc32c_combine(uint32_t crc_a, uint32_t crc_b, unsigned length_b)
+{
+  return ceph_crc32c_zeros(crc_a, length_b) ^ crc_b;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,9 +26,11 @@
 
 #include <array>
 #include <cstring>
+#include <iterator>
 #include <map>
 #include <optional>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -412,6 +414,90 @@ struct denc_traits<T, std::enable_if_t<!std::is_void_v<_denc::ExtType_t<T>>>>
   }
 };
 
+// le layout
+//
+// Types whose encoding is the very bytes they hold in memory: the raw and
+// integer types (on little-endian hosts), and the types whose denc_traits
+// say so with
+//
+//   static constexpr bool le_layout = true;
+//
+// Runs of them are encoded and decoded in bulk: a contiguous container of
+// them is one memcpy, the others are bounds-checked once for all their
+// elements.  A type holding native integers may only say so on
+// little-endian hosts, i.e. #ifndef CEPH_BIG_ENDIAN.
+namespace _denc {
+template<typename T, typename=void>
+struct traits_le_layout : std::false_type {};
+template<typename T>
+struct traits_le_layout<T, std::void_t<decltype(denc_traits<T>::le_layout)>>
+  : std::bool_constant<denc_traits<T>::le_layout> {
+  static_assert(!denc_traits<T>::le_layout ||
+		(std::is_trivially_copyable_v<T> &&
+		 std::has_unique_object_representations_v<T>),
+		"le_layout types must be trivially copyable and unpadded");
+};
+
+template<typename T>
+inline constexpr bool is_le_layout_v =
+  is_any_of<underlying_type_t<T>, ceph_le64, ceph_le32, ceph_le16, uint8_t
+#ifndef _CHAR_IS_SIGNED
+	    , int8_t
+#endif
+	    > ||
+#ifndef CEPH_BIG_ENDIAN
+  (!std::is_same_v<T, bool> && !std::is_void_v<ExtType_t<T>>) ||
+#endif
+  traits_le_layout<T>::value;
+
+/// how a container element is copied in and out of the encoding, if it
+/// can be: @p value is true and the element takes @p size bytes
+template<typename T>
+struct le_element {
+  static constexpr bool value = is_le_layout_v<T>;
+  static constexpr std::size_t size = sizeof(T);
+  static void store(const T& t, char* p) {
+    memcpy(p, &t, sizeof(T));
+  }
+  static T load(const char* p) {
+    T t;
+    memcpy(&t, p, sizeof(T));
+    return t;
+  }
+};
+template<typename A, typename B>
+struct le_element<std::pair<A, B>> {
+  using first_type = std::remove_const_t<A>;
+  static constexpr bool value =
+    is_le_layout_v<first_type> && is_le_layout_v<B>;
+  static constexpr std::size_t size = sizeof(A) + sizeof(B);
+  static void store(const std::pair<A, B>& t, char* p) {
+    memcpy(p, &t.first, sizeof(A));
+    memcpy(p + sizeof(A), &t.second, sizeof(B));
+  }
+  static std::pair<first_type, B> load(const char* p) {
+    std::pair<first_type, B> t;
+    memcpy(&t.first, p, sizeof(A));
+    memcpy(&t.second, p + sizeof(A), sizeof(B));
+    return t;
+  }
+};
+
+/// containers keeping their elements in one array
+template<typename C>
+struct is_contiguous_container : std::false_type {};
+template<typename T, typename ...Ts>
+struct is_contiguous_container<std::vector<T, Ts...>>
+  : std::bool_constant<!std::is_same_v<T, bool>> {};
+template<typename T, std::size_t N, typename ...Ts>
+struct is_contiguous_container<boost::container::small_vector<T, N, Ts...>>
+  : std::true_type {};
+
+template<typename C, typename T>
+inline constexpr bool is_memcpy_container_v =
+  is_contiguous_container<C>::value && is_le_layout_v<T>;
+} // namespace _denc
+
 // varint
 //
 // high bit of each byte indicates another byte follows.
@@ -999,6 +1085,20 @@ namespace _denc {
     // nohead
     static void encode_nohead(const container& s, ceph::buffer::list::contiguous_appender& p,
 			      uint64_t f = 0) {
+      if constexpr (is_memcpy_container_v<container, T>) {
+	if (!s.empty()) {
+	  memcpy(p.get_pos_add(s.size() * sizeof(T)), s.data(),
+		 s.size() * sizeof(T));
+	}
+	return;
+      } else if constexpr (le_element<T>::value) {
+	char* pos = p.get_pos_add(s.size() * le_element<T>::size);
+	for (const T& e : s) {
+	  le_element<T>::store(e, pos);
+	  pos += le_element<T>::size;
+	}
+	return;
+      }
       for (const T& e : s) {
         if constexpr (traits::featured) {
           denc(e, p, f);
@@ -1011,6 +1111,22 @@ namespace _denc {
 			      ceph::buffer::ptr::const_iterator& p,
 			      uint64_t f=0) {
       s.clear();
+      if constexpr (le_element<T>::value) {
+	// check the bounds before trusting num
+	const char* pos = p.get_pos_add(num * le_element<T>::size);
+	if constexpr (is_memcpy_container_v<container, T>) {
+	  s.resize(num);
+	  if (num) {
+	    memcpy(s.data(), pos, num * sizeof(T));
+	  }
+	} else {
+	  Details::reserve(s, num);
+	  for (; num; --num, pos += le_element<T>::size) {
+	    Details::insert(s, le_element<T>::load(pos));
+	  }
+	}
+	return;
+      }
       Details::reserve(s, num);
       while (num--) {
 	T t;
@@ -1023,6 +1139,16 @@ namespace _denc {
     decode_nohead(size_t num, container& s,
 		  ceph::buffer::list::const_iterator& p) {
       s.clear();
+      if constexpr (is_memcpy_container_v<container, T>) {
+	if (p.get_remaining() < num * sizeof(T)) {
+	  throw ceph::buffer::end_of_buffer();
+	}
+	s.resize(num);
+	if (num) {
+	  p.copy(num * sizeof(T), reinterpret_cast<char*>(s.data()));
+	}
+	return;
+      }
       Details::reserve(s, num);
       while (num--) {
 	T t;
@@ -1086,6 +1212,140 @@ struct denc_traits<
 				 _denc::pushback_details<std::vector<T, Ts...>>,
 				 T, Ts...> {};
 
+/**
+ * denc_vector_view
+ *
+ * A vector<T> of le layout elements, decoded in place: decoding takes a
+ * reference to the bytes of the contiguous buffer instead of copying them
+ * (bounds are checked once, for the whole array), and the elements are
+ * only loaded when read.  It encodes as, and decodes from, a vector<T>.
+ */
+template<typename T>
+class denc_vector_view {
+  static_assert(_denc::is_le_layout_v<T>,
+		"denc_vector_view needs an le layout element type");
+  ceph::buffer::ptr bp;
+
+  template<typename, typename> friend struct denc_traits;
+
+public:
+  class const_iterator {
+    const char* pos;
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = T;
+
+    explicit const_iterator(const char* pos) : pos(pos) {}
+    T operator*() const {
+      return _denc::le_element<T>::load(pos);
+    }
+    T operator[](difference_type i) const {
+      return _denc::le_element<T>::load(pos + i * sizeof(T));
+    }
+    const_iterator& operator++() {
+      pos += sizeof(T);
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto i = *this;
+      pos += sizeof(T);
+      return i;
+    }
+    const_iterator& operator--() {
+      pos -= sizeof(T);
+      return *this;
+    }
+    const_iterator& operator+=(difference_type n) {
+      pos += n * sizeof(T);
+      return *this;
+    }
+    const_iterator operator+(difference_type n) const {
+      return const_iterator(pos + n * sizeof(T));
+    }
+    difference_type operator-(const const_iterator& o) const {
+      return (pos - o.pos) / difference_type(sizeof(T));
+    }
+    bool operator==(const const_iterator& o) const {
+      return pos == o.pos;
+    }
+    bool operator!=(const const_iterator& o) const {
+      return pos != o.pos;
+    }
+    bool operator<(const const_iterator& o) const {
+      return pos < o.pos;
+    }
+  };
+
+  denc_vector_view() = default;
+  explicit denc_vector_view(const std::vector<T>& v)
+    : bp(ceph::buffer::copy(reinterpret_cast<const char*>(v.data()),
+			    v.size() * sizeof(T))) {}
+
+  std::size_t size() const {
+    return bp.length() / sizeof(T);
+  }
+  bool empty() const {
+    return bp.length() == 0;
+  }
+  T operator[](std::size_t i) const {
+    return _denc::le_element<T>::load(bp.c_str() + i * sizeof(T));
+  }
+  T at(std::size_t i) const {
+    if (i >= size()) {
+      throw std::out_of_range("denc_vector_view");
+    }
+    return (*this)[i];
+  }
+  const_iterator begin() const {
+    return const_iterator(bp.length() ? bp.c_str() : nullptr);
+  }
+  const_iterator end() const {
+    return begin() + size();
+  }
+  std::vector<T> to_vector() const {
+    std::vector<T> v(size());
+    if (!v.empty()) {
+      memcpy(v.data(), bp.c_str(), bp.length());
+    }
+    return v;
+  }
+  /// the encoded elements
+  const ceph::buffer::ptr& get_ptr() const {
+    return bp;
+  }
+};
+
+template<typename T>
+struct denc_traits<denc_vector_view<T>> {
+  static constexpr bool supported = true;
+  static constexpr bool featured = false;
+  static constexpr bool bounded = false;
+  static constexpr bool need_contiguous = true;
+
+  static void bound_encode(const denc_vector_view<T>& v, size_t& p,
+			   uint64_t f = 0) {
+    p += sizeof(uint32_t) + v.bp.length();
+  }
+  static void encode(const denc_vector_view<T>& v,
+		     ceph::buffer::list::contiguous_appender& p,
+		     uint64_t f = 0) {
+    denc((uint32_t)v.size(), p);
+    if (v.bp.length()) {
+      memcpy(p.get_pos_add(v.bp.length()), v.bp.c_str(), v.bp.length());
+    }
+  }
+  static void decode(denc_vector_view<T>& v,
+		     ceph::buffer::ptr::const_iterator& p,
+		     uint64_t f = 0) {
+    uint32_t num;
+    denc(num, p);
+    v.bp = p.get_ptr(num * sizeof(T));
+  }
+};
+
 template<typename T, std::size_t N, typename ...Ts>
 struct denc_traits<
   boost::container::small_vector<T, N, Ts...>,
@@ -1153,6 +1413,13 @@ public:
   // nohead
   static void encode_nohead(const container& s, ceph::buffer::list::contiguous_appender& p,
 			    uint64_t f = 0) {
+    if constexpr (_denc::is_le_layout_v<T>) {
+      if (!s.empty()) {
+	memcpy(p.get_pos_add(s.size() * sizeof(T)), s.data(),
+	       s.size() * sizeof(T));
+      }
+      return;
+    }
     for (const T& e : s) {
       if constexpr (traits::featured) {
         denc(e, p, f);
@@ -1165,6 +1432,14 @@ public:
 			    ceph::buffer::ptr::const_iterator& p,
 			    uint64_t f=0) {
     s.clear();
+    if constexpr (_denc::is_le_layout_v<T>) {
+      const char* pos = p.get_pos_add(num * sizeof(T));
+      s.resize(num);
+      if (num) {
+	memcpy(s.data(), pos, num * sizeof(T));
+      }
+      return;
+    }
     s.reserve(num);
     while (num--) {
       T t;
@@ -128,6 +128,20 @@ This will dump information about *all* memory pools.  When debug mode
 is enabled, the runtime complexity of dump is O(num_shards *
 num_types).  When debug name is disabled it is O(num_shards).
 
+Arenas
+------
+
+Memory that lives as long as one operation can come from an arena
+instead:
+
+  mempool::osd_op::arena<1024> arena;
+  mempool::arena_list<Foo> foos{mempool::arena_allocator<Foo>(&arena)};
+
+The arena hands out the memory of an inline buffer (of 1024 bytes here),
+then of chunks it takes from the heap, and only gives it back when it is
+destroyed, so the containers using it must go first.  The pool accounts
+one item per arena and the bytes it holds.
+
 You can also interrogate a specific pool programmatically with
 
   size_t bytes = mempool::unittest_2::allocated_bytes();
@@ -169,6 +183,7 @@ namespace mempool {
   f(buffer_meta)		      \
   f(osd)			      \
   f(osd_mapbl)			      \
+  f(osd_op)			      \
   f(osd_pglog)			      \
   f(osdmap)			      \
   f(osdmap_mapping)		      \
@@ -400,6 +415,123 @@ public:
 };
 
 
+// --------------------------------------------------------------
+// arenas
+
+class arena_t {
+  struct chunk_t {
+    chunk_t *next;
+  };
+
+  shard_t *shard;
+  const size_t chunk_size;
+  chunk_t *chunks = nullptr;
+  char *pos;
+  char *end;
+  size_t total;  ///< bytes accounted to the pool
+
+  void *allocate_slow(size_t size, size_t align);
+
+public:
+  arena_t(pool_index_t ix, char *buf, size_t buf_size, size_t chunk_size);
+  ~arena_t();
+  arena_t(const arena_t&) = delete;
+  arena_t& operator=(const arena_t&) = delete;
+
+  void *allocate(size_t size, size_t align) {
+    auto p = reinterpret_cast<char*>(
+      (reinterpret_cast<uintptr_t>(pos) + align - 1) & ~(uintptr_t)(align - 1));
+    if (p <= end && size <= size_t(end - p)) {
+      pos = p + size;
+      return p;
+    }
+    return allocate_slow(size, align);
+  }
+  void deallocate(void *p, size_t size) {
+    // only the last allocation can be taken back before the arena goes
+    if (static_cast<char*>(p) + size == pos) {
+      pos = static_cast<char*>(p);
+    }
+  }
+
+  size_t allocated_bytes() const {
+    return total;
+  }
+};
+
+template<pool_index_t pool_ix, size_t inline_size = 0>
+class arena : public arena_t {
+  alignas(std::max_align_t) char buf[inline_size ? inline_size : 1];
+public:
+  explicit arena(size_t chunk_size = 4096)
+    : arena_t(pool_ix, buf, inline_size, chunk_size) {}
+};
+
+// STL allocator taking its memory from an arena; deallocating is a no-op,
+// mostly.  Without an arena it takes it from the heap.
+template<typename T>
+class arena_allocator {
+  arena_t *a = nullptr;
+
+public:
+  typedef T value_type;
+  typedef value_type *pointer;
+  typedef const value_type * const_pointer;
+  typedef value_type& reference;
+  typedef const value_type& const_reference;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  template<typename U> struct rebind {
+    typedef arena_allocator<U> other;
+  };
+
+  arena_allocator() = default;
+  explicit arena_allocator(arena_t *a) : a(a) {}
+  template<typename U>
+  arena_allocator(const arena_allocator<U>& o) : a(o.get_arena()) {}
+
+  T* allocate(size_t n, void *p = nullptr) {
+    if (!a) {
+      return std::allocator<T>().allocate(n);
+    }
+    return static_cast<T*>(a->allocate(sizeof(T) * n, alignof(T)));
+  }
+  void deallocate(T* p, size_t n) {
+    if (!a) {
+      std::allocator<T>().deallocate(p, n);
+      return;
+    }
+    a->deallocate(p, sizeof(T) * n);
+  }
+
+  arena_t *get_arena() const {
+    return a;
+  }
+
+  template<typename U>
+  bool operator==(const arena_allocator<U>& o) const {
+    return a == o.get_arena();
+  }
+  template<typename U>
+  bool operator!=(const arena_allocator<U>& o) const {
+    return a != o.get_arena();
+  }
+};
+
+template<typename v>
+using arena_list = std::list<v, arena_allocator<v>>;
+
+template<typename v>
+using arena_vector = std::vector<v, arena_allocator<v>>;
+
+template<typename k, typename v, typename cmp = std::less<k>>
+using arena_map = std::map<k, v, cmp, arena_allocator<std::pair<const k, v>>>;
+
+using arena_string = std::basic_string<char, std::char_traits<char>,
+				       arena_allocator<char>>;
+
+
 // Namespace mempool
 
 #define P(x)								\
@@ -453,6 +585,9 @@ public:
     using unordered_map =						\
       std::unordered_map<k,v,h,eq,pool_allocator<std::pair<const k,v>>>;\
                                                                         \
+    template<size_t inline_size = 0>					\
+    using arena = mempool::arena<id, inline_size>;			\
+                                                                        \
     inline size_t allocated_bytes() {					\
       return mempool::get_pool(id).allocated_bytes();			\
     }									\
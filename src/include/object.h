@@ -142,6 +142,10 @@ struct denc_traits<snapid_t> {
   static constexpr bool featured = false;
   static constexpr bool bounded = true;
   static constexpr bool need_contiguous = true;
+#ifndef CEPH_BIG_ENDIAN
+  // encoded as its uint64_t
+  static constexpr bool le_layout = true;
+#endif
   static void bound_encode(const snapid_t& o, size_t& p) {
     denc(o.val, p);
   }
@@ -96,6 +96,15 @@ void MemDB::_save()
     return;
   }
   bufferlist bl;
+  if (m_skiplist) {
+    // the writers are held off by m_lock, and they are the only ones
+    // freeing nodes
+    for (auto n = m_skiplist->first(); n; n = n->get_next(0)) {
+      dout(10) << __func__ << " Key:"<< n->key << dendl;
+      encode(n->key, bl);
+      encode(n->get_value(), bl);
+    }
+  }
   mdb_iter_t iter = m_map.begin();
   while (iter != m_map.end()) {
     dout(10) << __func__ << " Key:"<< iter->first << dendl;
@@ -142,8 +151,12 @@ int MemDB::_load()
     bytes_done += ceph::decode_file(fd, datap);
 
     dout(10) << __func__ << " Key:"<< key << dendl;
-    m_map[key] = datap;
     m_total_bytes += datap.length();
+    if (m_skiplist) {
+      m_skiplist->set(key, std::move(datap));
+    } else {
+      m_map[key] = datap;
+    }
   }
   VOID_TEMP_FAILURE_RETRY(::close(fd));
   return 0;
@@ -322,6 +335,15 @@ int MemDB::_setkey(ms_op_t &op)
 
   m_total_bytes += bl.length();
 
+  if (m_skiplist) {
+    bufferptr old;
+    if (m_skiplist->set(key, bufferptr(bl.c_str(), bl.length()), &old)) {
+      ceph_assert(m_total_bytes >= old.length());
+      m_total_bytes -= old.length();
+    }
+    return 0;
+  }
+
   bufferlist bl_old;
   if (_get(op.first.first, op.first.second, &bl_old)) {
     /*
@@ -342,6 +364,16 @@ int MemDB::_rmkey(ms_op_t &op)
   std::lock_guard<std::mutex> l(m_lock);
   std::string key = make_key(op.first.first, op.first.second);
 
+  if (m_skiplist) {
+    bufferptr old;
+    if (!m_skiplist->erase(key, &old)) {
+      return 0;
+    }
+    ceph_assert(m_total_bytes >= old.length());
+    m_total_bytes -= old.length();
+    return 1;
+  }
+
   bufferlist bl_old;
   if (_get(op.first.first, op.first.second, &bl_old)) {
     ceph_assert(m_total_bytes >= bl_old.length());
@@ -391,14 +423,22 @@ int MemDB::_merge(ms_op_t &op)
      * Merge non existent.
      */
     mop->merge_nonexistent(bl.c_str(), bl.length(), &new_val);
-    m_map[key] = bufferptr(new_val.c_str(), new_val.length());
+    if (m_skiplist) {
+      m_skiplist->set(key, bufferptr(new_val.c_str(), new_val.length()));
+    } else {
+      m_map[key] = bufferptr(new_val.c_str(), new_val.length());
+    }
   } else {
     /*
      * Merge existing.
      */
     std::string new_val;
     mop->merge(bl_old.c_str(), bl_old.length(), bl.c_str(), bl.length(), &new_val);
-    m_map[key] = bufferptr(new_val.c_str(), new_val.length());
+    if (m_skiplist) {
+      m_skiplist->set(key, bufferptr(new_val.c_str(), new_val.length()));
+    } else {
+      m_map[key] = bufferptr(new_val.c_str(), new_val.length());
+    }
     bytes_adjusted -= bl_old.length();
     bl_old.clear();
   }
@@ -410,12 +450,21 @@ int MemDB::_merge(ms_op_t &op)
 }
 
 /*
- * Caller take btree lock.
+ * Caller take btree lock, or holds a skiplist ReadGuard.
  */
 bool MemDB::_get(const string &prefix, const string &k, bufferlist *out)
 {
   string key = make_key(prefix, k);
 
+  if (m_skiplist) {
+    auto n = m_skiplist->find(key);
+    if (!n) {
+      return false;
+    }
+    out->push_back(n->get_value().clone());
+    return true;
+  }
+
   mdb_iter_t iter = m_map.find(key);
   if (iter == m_map.end()) {
     return false;
@@ -427,6 +476,10 @@ bool MemDB::_get(const string &prefix, const string &k, bufferlist *out)
 
 bool MemDB::_get_locked(const string &prefix, const string &k, bufferlist *out)
 {
+  if (m_skiplist) {
+    MemDBSkipList::ReadGuard g(*m_skiplist);
+    return _get(prefix, k, out);
+  }
   std::lock_guard<std::mutex> l(m_lock);
   return _get(prefix, k, out);
 }
@@ -659,3 +712,113 @@ int MemDB::MDBWholeSpaceIteratorImpl::lower_bound(const std::string &prefix,
   }
   return -1;
 }
+
+int MemDB::MDBSkipListIteratorImpl::fill_current(MemDBSkipList::Node *n,
+						 uint64_t generation)
+{
+  m_key_value.first.clear();
+  m_key_value.second.clear();
+  m_node = nullptr;
+  if (!n) {
+    return -1;
+  }
+  m_key_value.first = n->key;
+  m_key_value.second.push_back(n->get_value().clone());
+  if (!n->removed) {
+    m_node = n;
+    m_generation = generation;
+  }
+  return 0;
+}
+
+int MemDB::MDBSkipListIteratorImpl::seek_to_first(const std::string &k)
+{
+  MemDBSkipList::ReadGuard g(*m_skiplist);
+  uint64_t generation = m_skiplist->get_generation();
+  return fill_current(k.empty() ? m_skiplist->first() :
+		      m_skiplist->lower_bound(k), generation);
+}
+
+int MemDB::MDBSkipListIteratorImpl::seek_to_last(const std::string &k)
+{
+  MemDBSkipList::ReadGuard g(*m_skiplist);
+  uint64_t generation = m_skiplist->get_generation();
+  if (k.empty()) {
+    return fill_current(m_skiplist->last(), generation);
+  }
+  // the last key of prefix k
+  string limit = k;
+  limit.push_back(KEY_DELIM + 1);
+  return fill_current(m_skiplist->find_less_than(limit), generation);
+}
+
+int MemDB::MDBSkipListIteratorImpl::upper_bound(const std::string &prefix,
+						const std::string &after)
+{
+  dtrace << "upper_bound " << prefix.c_str() << after.c_str() << dendl;
+  MemDBSkipList::ReadGuard g(*m_skiplist);
+  uint64_t generation = m_skiplist->get_generation();
+  return fill_current(m_skiplist->upper_bound(make_key(prefix, after)),
+		      generation);
+}
+
+int MemDB::MDBSkipListIteratorImpl::lower_bound(const std::string &prefix,
+						const std::string &to)
+{
+  dtrace << "lower_bound " << prefix.c_str() << to.c_str() << dendl;
+  MemDBSkipList::ReadGuard g(*m_skiplist);
+  uint64_t generation = m_skiplist->get_generation();
+  return fill_current(m_skiplist->lower_bound(make_key(prefix, to)),
+		      generation);
+}
+
+int MemDB::MDBSkipListIteratorImpl::next()
+{
+  if (!valid()) {
+    return -1;
+  }
+  MemDBSkipList::ReadGuard g(*m_skiplist);
+  uint64_t generation = m_skiplist->get_generation();
+  if (m_node && m_generation == generation) {
+    return fill_current(m_node->get_next(0), generation);
+  }
+  return fill_current(m_skiplist->upper_bound(m_key_value.first), generation);
+}
+
+int MemDB::MDBSkipListIteratorImpl::prev()
+{
+  if (!valid()) {
+    return -1;
+  }
+  MemDBSkipList::ReadGuard g(*m_skiplist);
+  uint64_t generation = m_skiplist->get_generation();
+  return fill_current(m_skiplist->find_less_than(m_key_value.first),
+		      generation);
+}
+
+string MemDB::MDBSkipListIteratorImpl::key()
+{
+  string prefix, key;
+  split_key(m_key_value.first, &prefix, &key);
+  return key;
+}
+
+std::pair<string,string> MemDB::MDBSkipListIteratorImpl::raw_key()
+{
+  string prefix, key;
+  split_key(m_key_value.first, &prefix, &key);
+  return { prefix, key };
+}
+
+bool MemDB::MDBSkipListIteratorImpl::raw_key_is_prefixed(
+    const string &prefix)
+{
+  return m_key_value.first.size() > prefix.size() &&
+    m_key_value.first.compare(0, prefix.size(), prefix) == 0 &&
+    m_key_value.first[prefix.size()] == KEY_DELIM;
+}
+
+bufferlist MemDB::MDBSkipListIteratorImpl::value()
+{
+  return m_key_value.second;
+}
@@ -19,6 +19,7 @@
 #include "include/encoding.h"
 #include "include/btree_map.h"
 #include "KeyValueDB.h"
+#include "MemDBSkipList.h"
 #include "osd/osd_types.h"
 
 #define KEY_DELIM '\0' 
@@ -45,6 +46,9 @@ class MemDB : public KeyValueDB
   bool m_using_btree;
 
   mdb_map_t m_map;
+  /// the index instead of m_map with memdb_index = skiplist; the writers
+  /// still take m_lock, the readers don't
+  std::unique_ptr<MemDBSkipList> m_skiplist;
 
   CephContext *m_cct;
   PerfCounters *logger;
@@ -68,7 +72,9 @@ public:
     m_total_bytes(0), m_allocated_bytes(0), m_using_btree(false),
     m_cct(c), logger(NULL), m_priv(p), m_db_path(path), iterator_seq_no(1)
   {
-    //Nothing as of now
+    if (c->_conf.get_val<std::string>("memdb_index") == "skiplist") {
+      m_skiplist = std::make_unique<MemDBSkipList>();
+    }
   }
 
   ~MemDB() override;
@@ -198,6 +204,42 @@ public:
     ~MDBWholeSpaceIteratorImpl() override;
   };
 
+  class MDBSkipListIteratorImpl : public KeyValueDB::WholeSpaceIteratorImpl {
+    MemDBSkipList *m_skiplist;
+    /// the current node, usable as long as nothing got unlinked since
+    /// m_generation, otherwise look the key up again
+    MemDBSkipList::Node *m_node = nullptr;
+    uint64_t m_generation = 0;
+    std::pair<std::string, ceph::bufferlist> m_key_value;
+
+    int fill_current(MemDBSkipList::Node *n, uint64_t generation);
+
+  public:
+    explicit MDBSkipListIteratorImpl(MemDBSkipList *skiplist)
+      : m_skiplist(skiplist) {}
+
+    int seek_to_first(const std::string &k) override;
+    int seek_to_last(const std::string &k) override;
+
+    int seek_to_first() override { return seek_to_first(std::string()); };
+    int seek_to_last() override { return seek_to_last(std::string()); };
+
+    int upper_bound(const std::string &prefix, const std::string &after) override;
+    int lower_bound(const std::string &prefix, const std::string &to) override;
+    bool valid() override {
+      return !m_key_value.first.empty();
+    }
+
+    int next() override;
+    int prev() override;
+    int status() override { return 0; };
+
+    std::string key() override;
+    std::pair<std::string,std::string> raw_key() override;
+    bool raw_key_is_prefixed(const std::string &prefix) override;
+    ceph::bufferlist value() override;
+  };
+
   uint64_t get_estimated_size(std::map<std::string,uint64_t> &extra) override {
       std::lock_guard<std::mutex> l(m_lock);
       return m_allocated_bytes;
@@ -213,6 +255,9 @@ public:
   }
 
   WholeSpaceIterator get_wholespace_iterator(IteratorOpts opts = 0) override {
+    if (m_skiplist) {
+      return std::make_shared<MDBSkipListIteratorImpl>(m_skiplist.get());
+    }
     return std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
       new MDBWholeSpaceIteratorImpl(&m_map, &m_lock, &iterator_seq_no, m_using_btree));
   }
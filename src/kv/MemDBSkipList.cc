@@ -0,0 +1,216 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "MemDBSkipList.h"
+
+#include <functional>
+#include <thread>
+
+#include "include/ceph_assert.h"
+
+using ceph::bufferptr;
+
+MemDBSkipList::ReadGuard::ReadGuard(const MemDBSkipList& sl)
+  : sl(sl)
+{
+  static thread_local unsigned shard =
+    std::hash<std::thread::id>{}(std::this_thread::get_id()) % NUM_READER_SHARDS;
+  // register in the current epoch; if it moved on meanwhile, reclaim() may
+  // not wait for us, so try again
+  while (true) {
+    uint64_t e = sl.epoch.load();
+    slot = &sl.readers[shard].active[e & 1];
+    slot->fetch_add(1);
+    if (sl.epoch.load() == e) {
+      break;
+    }
+    slot->fetch_sub(1);
+  }
+}
+
+MemDBSkipList::MemDBSkipList()
+  : head(new Node(std::string(), nullptr, MAX_HEIGHT))
+{
+}
+
+MemDBSkipList::~MemDBSkipList()
+{
+  Node* n = head->get_next(0);
+  while (n) {
+    Node* next = n->get_next(0);
+    delete n;
+    n = next;
+  }
+  delete head;
+  for (auto n : retired_nodes) {
+    delete n;
+  }
+  for (auto v : retired_values) {
+    delete v;
+  }
+}
+
+int MemDBSkipList::random_height()
+{
+  // a quarter of the nodes go up one level
+  int h = 1;
+  while (h < MAX_HEIGHT && rng() % 4 == 0) {
+    ++h;
+  }
+  return h;
+}
+
+MemDBSkipList::Node* MemDBSkipList::find_greater_or_equal(
+  const std::string& key, Node** prev) const
+{
+  Node* x = head;
+  int level = height.load(std::memory_order_relaxed) - 1;
+  while (true) {
+    Node* n = x->get_next(level);
+    if (n && n->key < key) {
+      x = n;
+    } else {
+      if (prev) {
+	prev[level] = x;
+      }
+      if (level == 0) {
+	return n;
+      }
+      --level;
+    }
+  }
+}
+
+MemDBSkipList::Node* MemDBSkipList::find(const std::string& key) const
+{
+  Node* n = find_greater_or_equal(key, nullptr);
+  return (n && n->key == key) ? n : nullptr;
+}
+
+MemDBSkipList::Node* MemDBSkipList::lower_bound(const std::string& key) const
+{
+  return find_greater_or_equal(key, nullptr);
+}
+
+MemDBSkipList::Node* MemDBSkipList::upper_bound(const std::string& key) const
+{
+  Node* n = find_greater_or_equal(key, nullptr);
+  while (n && n->key == key) {
+    n = n->get_next(0);
+  }
+  return n;
+}
+
+MemDBSkipList::Node* MemDBSkipList::find_less_than(const std::string& key) const
+{
+  Node* x = head;
+  int level = height.load(std::memory_order_relaxed) - 1;
+  while (true) {
+    Node* n = x->get_next(level);
+    if (n && n->key < key) {
+      x = n;
+    } else if (level == 0) {
+      return x == head ? nullptr : x;
+    } else {
+      --level;
+    }
+  }
+}
+
+MemDBSkipList::Node* MemDBSkipList::last() const
+{
+  Node* x = head;
+  int level = height.load(std::memory_order_relaxed) - 1;
+  while (true) {
+    Node* n = x->get_next(level);
+    if (n) {
+      x = n;
+    } else if (level == 0) {
+      return x == head ? nullptr : x;
+    } else {
+      --level;
+    }
+  }
+}
+
+bool MemDBSkipList::set(const std::string& key, bufferptr&& value,
+			bufferptr* old)
+{
+  Node* prev[MAX_HEIGHT];
+  Node* n = find_greater_or_equal(key, prev);
+  if (n && n->key == key) {
+    bufferptr* v = n->value.exchange(new bufferptr(std::move(value)));
+    if (old) {
+      *old = *v;
+    }
+    retired_values.push_back(v);
+    maybe_reclaim();
+    return true;
+  }
+
+  int h = random_height();
+  int cur_height = height.load(std::memory_order_relaxed);
+  if (h > cur_height) {
+    for (int i = cur_height; i < h; ++i) {
+      prev[i] = head;
+    }
+    // readers seeing the new height before the node find nullptrs up
+    // there, and just move down
+    height.store(h, std::memory_order_relaxed);
+  }
+  n = new Node(key, new bufferptr(std::move(value)), h);
+  for (int i = 0; i < h; ++i) {
+    // the node is not published yet, the release store below publishes
+    // its links
+    n->next[i].store(prev[i]->get_next(i), std::memory_order_relaxed);
+    prev[i]->next[i].store(n, std::memory_order_release);
+  }
+  ++num_keys;
+  return false;
+}
+
+bool MemDBSkipList::erase(const std::string& key, bufferptr* old)
+{
+  Node* prev[MAX_HEIGHT];
+  Node* n = find_greater_or_equal(key, prev);
+  if (!n || n->key != key) {
+    return false;
+  }
+  // the node keeps its own links for the readers standing on it
+  for (int i = n->height - 1; i >= 0; --i) {
+    ceph_assert(prev[i]->get_next(i) == n);
+    prev[i]->next[i].store(n->get_next(i), std::memory_order_release);
+  }
+  n->removed = true;
+  ++generation;
+  if (old) {
+    *old = n->get_value();
+  }
+  --num_keys;
+  retired_nodes.push_back(n);
+  maybe_reclaim();
+  return true;
+}
+
+void MemDBSkipList::reclaim()
+{
+  if (retired_nodes.empty() && retired_values.empty()) {
+    return;
+  }
+  // all of the retired nodes were unlinked before the epoch moves on: the
+  // readers coming after can't see them, those before must be waited for
+  uint64_t e = epoch.fetch_add(1);
+  for (auto& shard : readers) {
+    while (shard.active[e & 1].load() > 0) {
+      std::this_thread::yield();
+    }
+  }
+  for (auto n : retired_nodes) {
+    delete n;
+  }
+  retired_nodes.clear();
+  for (auto v : retired_values) {
+    delete v;
+  }
+  retired_values.clear();
+}
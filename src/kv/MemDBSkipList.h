@@ -0,0 +1,127 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_KV_MEMDBSKIPLIST_H
+#define CEPH_KV_MEMDBSKIPLIST_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "include/buffer.h"
+
+/**
+ * MemDBSkipList
+ *
+ * The ordered index of MemDB's "skiplist" engine.  Readers never lock:
+ * they walk the list inside a ReadGuard, which keeps the nodes they may
+ * see alive.  Writers must be serialized by the caller (MemDB's m_lock);
+ * a removed node, or a replaced value, is freed once all the readers that
+ * may have seen it are gone (epoch based reclamation).
+ */
+class MemDBSkipList {
+public:
+  static constexpr int MAX_HEIGHT = 16;
+
+  struct Node {
+    const std::string key;
+    std::atomic<ceph::bufferptr*> value;
+    std::atomic<bool> removed = {false};
+    const int height;
+    std::unique_ptr<std::atomic<Node*>[]> next;
+
+    Node(const std::string& key, ceph::bufferptr* value, int height)
+      : key(key), value(value), height(height),
+	next(new std::atomic<Node*>[height]) {
+      for (int i = 0; i < height; ++i) {
+	next[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+    ~Node() {
+      delete value.load(std::memory_order_relaxed);
+    }
+    Node* get_next(int level) const {
+      return next[level].load(std::memory_order_acquire);
+    }
+    ceph::bufferptr get_value() const {
+      return *value.load(std::memory_order_acquire);
+    }
+  };
+
+  /// keeps the nodes seen while it is held alive
+  class ReadGuard {
+    const MemDBSkipList& sl;
+    std::atomic<int64_t>* slot;
+  public:
+    explicit ReadGuard(const MemDBSkipList& sl);
+    ~ReadGuard() {
+      slot->fetch_sub(1);
+    }
+  };
+
+  MemDBSkipList();
+  ~MemDBSkipList();
+  MemDBSkipList(const MemDBSkipList&) = delete;
+  MemDBSkipList& operator=(const MemDBSkipList&) = delete;
+
+  // readers; the nodes returned are valid while the ReadGuard is held
+  Node* find(const std::string& key) const;
+  Node* lower_bound(const std::string& key) const;  ///< first >= key
+  Node* upper_bound(const std::string& key) const;  ///< first > key
+  Node* find_less_than(const std::string& key) const; ///< last < key
+  Node* first() const {
+    return head->get_next(0);
+  }
+  Node* last() const;
+  /// bumped whenever a node is unlinked
+  uint64_t get_generation() const {
+    return generation.load();
+  }
+
+  // writers, serialized by the caller; they need no ReadGuard
+  /// @return true and the previous value in @p old if @p key existed
+  bool set(const std::string& key, ceph::bufferptr&& value,
+	   ceph::bufferptr* old = nullptr);
+  /// @return true and the removed value in @p old if @p key existed
+  bool erase(const std::string& key, ceph::bufferptr* old = nullptr);
+  /// free what no reader can see anymore, if enough of it piled up
+  void maybe_reclaim() {
+    if (retired_nodes.size() + retired_values.size() >= RECLAIM_BATCH) {
+      reclaim();
+    }
+  }
+  void reclaim();
+
+  uint64_t size() const {
+    return num_keys;
+  }
+
+private:
+  static constexpr unsigned NUM_READER_SHARDS = 16;
+  static constexpr size_t RECLAIM_BATCH = 256;
+
+  /// readers in the even and odd epochs, spread to keep them off each
+  /// other's cache lines
+  struct alignas(64) ReaderShard {
+    std::atomic<int64_t> active[2] = {0, 0};
+  };
+
+  Node* const head;
+  std::atomic<int> height = {1};
+  std::atomic<uint64_t> generation = {0};
+  uint64_t num_keys = 0;
+  std::minstd_rand rng;
+
+  mutable std::atomic<uint64_t> epoch = {0};
+  mutable std::array<ReaderShard, NUM_READER_SHARDS> readers;
+  std::vector<Node*> retired_nodes;
+  std::vector<ceph::bufferptr*> retired_values;
+
+  int random_height();
+  Node* find_greater_or_equal(const std::string& key, Node** prev) const;
+};
+
+#endif
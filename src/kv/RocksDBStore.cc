@@ -1,10 +1,13 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <iterator>
 #include <set>
 #include <map>
 #include <string>
 #include <memory>
+#include <optional>
+#include <thread>
 #if __has_include(<filesystem>)
 #include <filesystem>
 namespace fs = std::filesystem;
@@ -26,6 +29,7 @@ namespace fs = std::experimental::filesystem;
 #include "rocksdb/utilities/convenience.h"
 #include "rocksdb/merge_operator.h"
 
+#include "common/admin_socket.h"
 #include "common/perf_counters.h"
 #include "common/PriorityCache.h"
 #include "include/common_fwd.h"
@@ -56,11 +60,14 @@ using std::vector;
 using ceph::bufferlist;
 using ceph::bufferptr;
 using ceph::Formatter;
+using TOPNSPC::common::cmd_getval;
 
 static const char* sharding_def_dir = "sharding";
 static const char* sharding_def_file = "sharding/def";
 static const char* sharding_recreate = "sharding/recreate_columns";
 static const char* resharding_column_lock = "reshardingXcommencingXlocked";
+// the target sharding of an online reshard in progress
+static const char* online_reshard_file = "sharding/online_reshard";
 
 static bufferlist to_bufferlist(rocksdb::Slice in) {
   bufferlist bl;
@@ -181,6 +188,70 @@ int RocksDBStore::set_merge_operator(
   return 0;
 }
 
+class RocksDBStore::SocketHook : public AdminSocketHook {
+  RocksDBStore* store;
+public:
+  static RocksDBStore::SocketHook* create(RocksDBStore* store)
+  {
+    RocksDBStore::SocketHook* hook = nullptr;
+    AdminSocket* admin_socket = store->cct->get_admin_socket();
+    if (admin_socket) {
+      hook = new RocksDBStore::SocketHook(store);
+      int r = admin_socket->register_command(
+	"rocksdb reshard online "
+	"name=sharding,type=CephString,n=N",
+	hook,
+	"Reshard the column families while in use. The keys are moved in "
+	"the background, and the new sharding is used once they all are.");
+      if (r != 0) {
+	// another store in this process has them
+	ldout(store->cct, 1) << __func__ << " cannot register SocketHook" << dendl;
+	delete hook;
+	hook = nullptr;
+      } else {
+	r = admin_socket->register_command("rocksdb reshard status",
+					   hook,
+					   "Show the progress of an online reshard.");
+	ceph_assert(r == 0);
+      }
+    }
+    return hook;
+  }
+
+  ~SocketHook() {
+    AdminSocket* admin_socket = store->cct->get_admin_socket();
+    admin_socket->unregister_commands(this);
+  }
+private:
+  SocketHook(RocksDBStore* store) :
+    store(store) {}
+  int call(std::string_view command, const cmdmap_t& cmdmap,
+	   Formatter *f,
+	   std::ostream& errss,
+	   bufferlist& out) override {
+    if (command == "rocksdb reshard online") {
+      vector<string> words;
+      cmd_getval(cmdmap, "sharding", words);
+      string sharding;
+      for (auto& w : words) {
+	if (!sharding.empty()) {
+	  sharding += " ";
+	}
+	sharding += w;
+      }
+      int r = store->reshard_online(sharding);
+      if (r < 0) {
+	errss << "cannot reshard to '" << sharding << "': " << cpp_strerror(r);
+	return r;
+      }
+    }
+    f->open_object_section("reshard");
+    store->dump_reshard_status(f);
+    f->close_section();
+    return 0;
+  }
+};
+
 class CephRocksdbLogger : public rocksdb::Logger {
   CephContext *cct;
 public:
@@ -458,11 +529,13 @@ int RocksDBStore::create_and_open(ostream &out,
 }
 
 std::shared_ptr<rocksdb::Cache> RocksDBStore::create_block_cache(
-    const std::string& cache_type, size_t cache_size, double cache_prio_high) {
+    const std::string& cache_type, size_t cache_size, double cache_prio_high,
+    const std::string& name) {
   std::shared_ptr<rocksdb::Cache> cache;
   auto shard_bits = cct->_conf->rocksdb_cache_shard_bits;
   if (cache_type == "binned_lru") {
-    cache = rocksdb_cache::NewBinnedLRUCache(cct, cache_size, shard_bits, false, cache_prio_high);
+    cache = rocksdb_cache::NewBinnedLRUCache(cct, cache_size, shard_bits, false, cache_prio_high,
+					     name);
   } else if (cache_type == "lru") {
     cache = rocksdb::NewLRUCache(cache_size, shard_bits);
   } else if (cache_type == "clock") {
@@ -626,19 +699,25 @@ bool RocksDBStore::is_column_family(const std::string& prefix) {
   return cf_handles.count(prefix);
 }
 
+rocksdb::ColumnFamilyHandle *RocksDBStore::get_shard(const prefix_shards& shards,
+						    const char* key, size_t keylen)
+{
+  if (shards.handles.size() == 1) {
+    return shards.handles[0];
+  } else {
+    uint32_t hash_l = std::min<uint32_t>(shards.hash_l, keylen);
+    uint32_t hash_h = std::min<uint32_t>(shards.hash_h, keylen);
+    uint32_t hash = ceph_str_hash_rjenkins(&key[hash_l], hash_h - hash_l);
+    return shards.handles[hash % shards.handles.size()];
+  }
+}
+
 rocksdb::ColumnFamilyHandle *RocksDBStore::get_cf_handle(const std::string& prefix, const std::string& key) {
   auto iter = cf_handles.find(prefix);
   if (iter == cf_handles.end()) {
     return nullptr;
   } else {
-    if (iter->second.handles.size() == 1) {
-      return iter->second.handles[0];
-    } else {
-      uint32_t hash_l = std::min<uint32_t>(iter->second.hash_l, key.size());
-      uint32_t hash_h = std::min<uint32_t>(iter->second.hash_h, key.size());
-      uint32_t hash = ceph_str_hash_rjenkins(&key[hash_l], hash_h - hash_l);
-      return iter->second.handles[hash % iter->second.handles.size()];
-    }
+    return get_shard(iter->second, key.data(), key.size());
   }
 }
 
@@ -647,14 +726,7 @@ rocksdb::ColumnFamilyHandle *RocksDBStore::get_cf_handle(const std::string& pref
   if (iter == cf_handles.end()) {
     return nullptr;
   } else {
-    if (iter->second.handles.size() == 1) {
-      return iter->second.handles[0];
-    } else {
-      uint32_t hash_l = std::min<uint32_t>(iter->second.hash_l, keylen);
-      uint32_t hash_h = std::min<uint32_t>(iter->second.hash_h, keylen);
-      uint32_t hash = ceph_str_hash_rjenkins(&key[hash_l], hash_h - hash_l);
-      return iter->second.handles[hash % iter->second.handles.size()];
-    }
+    return get_shard(iter->second, key, keylen);
   }
 }
 
@@ -875,11 +947,72 @@ int RocksDBStore::extract_block_cache_options(const std::string& opts_str,
 
 
 
+/// parse "name=min:max,..." into the min and max share of each partition
+static int parse_cache_partitions(
+  const std::string& text,
+  std::map<std::string, std::pair<double, double>>* partitions)
+{
+  std::map<std::string, std::string> str_map;
+  int r = get_str_map(text, &str_map, ",; \t");
+  if (r < 0) {
+    return r;
+  }
+  for (auto& [name, shares] : str_map) {
+    auto colon = shares.find(':');
+    std::string err_min, err_max;
+    double min_ratio = 0, max_ratio = 1;
+    if (colon == std::string::npos) {
+      err_min = "missing ':'";
+    } else {
+      min_ratio = strict_strtod(shares.substr(0, colon).c_str(), &err_min);
+      max_ratio = strict_strtod(shares.substr(colon + 1).c_str(), &err_max);
+    }
+    if (!err_min.empty() || !err_max.empty() ||
+	min_ratio < 0 || min_ratio > max_ratio || max_ratio > 1) {
+      derr << __func__ << " invalid rocksdb_cache_partitions entry '" << name
+	   << "=" << shares << "', expected name=min:max with "
+	   << "0 <= min <= max <= 1" << dendl;
+      return -EINVAL;
+    }
+    (*partitions)[name] = {min_ratio, max_ratio};
+  }
+  return 0;
+}
+
+int RocksDBStore::get_online_cf_options(const std::vector<ColumnFamily>& sharding_def,
+					const std::string& cf_name,
+					rocksdb::ColumnFamilyOptions* cf_opt)
+{
+  std::string base_name = cf_name.substr(0, cf_name.find('-'));
+  for (const auto& column : sharding_def) {
+    if (column.name != base_name) {
+      continue;
+    }
+    // a block cache of its own is only set up on the next open
+    std::unordered_map<std::string, std::string> options_map;
+    std::string block_cache_opt;
+    if (extract_block_cache_options(column.options, &options_map,
+				    &block_cache_opt) != 0) {
+      return -EINVAL;
+    }
+    auto status = rocksdb::GetColumnFamilyOptionsFromMap(*cf_opt, options_map, cf_opt);
+    if (!status.ok()) {
+      derr << __func__ << " invalid db column family options for CF '"
+	   << column.name << "': " << column.options << dendl;
+      return -EINVAL;
+    }
+    break;
+  }
+  install_cf_mergeop(base_name, cf_opt);
+  return 0;
+}
+
 int RocksDBStore::verify_sharding(const rocksdb::Options& opt,
 				  std::vector<rocksdb::ColumnFamilyDescriptor>& existing_cfs,
 				  std::vector<std::pair<size_t, RocksDBStore::ColumnFamily> >& existing_cfs_shard,
 				  std::vector<rocksdb::ColumnFamilyDescriptor>& missing_cfs,
-				  std::vector<std::pair<size_t, RocksDBStore::ColumnFamily> >& missing_cfs_shard)
+				  std::vector<std::pair<size_t, RocksDBStore::ColumnFamily> >& missing_cfs_shard,
+				  std::vector<rocksdb::ColumnFamilyDescriptor>& online_reshard_cfs)
 {
   rocksdb::Status status;
   std::string stored_sharding_text;
@@ -925,6 +1058,13 @@ int RocksDBStore::verify_sharding(const rocksdb::Options& opt,
     }
   };
 
+  std::map<std::string, std::pair<double, double>> cache_partitions;
+  if (int r = parse_cache_partitions(
+	cct->_conf.get_val<std::string>("rocksdb_cache_partitions"),
+	&cache_partitions); r < 0) {
+    return r;
+  }
+
   for (auto& column : stored_sharding_def) {
     rocksdb::ColumnFamilyOptions cf_opt(opt);
     std::unordered_map<std::string, std::string> options_map;
@@ -998,7 +1138,8 @@ int RocksDBStore::verify_sharding(const rocksdb::Options& opt,
 	column_bbt_opts.no_block_cache = true;
       } else {
 	if (require_new_block_cache) {
-	  block_cache = create_block_cache(cache_type, cache_size, high_pri_pool_ratio);
+	  block_cache = create_block_cache(cache_type, cache_size, high_pri_pool_ratio,
+					   column.name);
 	  if (!block_cache) {
 	    dout(5) << __func__ << " failed to create block cache for params: " << block_cache_opt << dendl;
 	    return -EINVAL;
@@ -1010,6 +1151,20 @@ int RocksDBStore::verify_sharding(const rocksdb::Options& opt,
       column_bbt_opts.block_cache = block_cache;
       cf_bbt_opts[column.name] = column_bbt_opts;
       cf_opt.table_factory.reset(NewBlockBasedTableFactory(cf_bbt_opts[column.name]));
+    } else if (auto p = cache_partitions.find(column.name);
+	       p != cache_partitions.end()) {
+      auto binned = dynamic_pointer_cast<rocksdb_cache::BinnedLRUCache>(
+	bbt_opts.block_cache);
+      if (!binned) {
+	dout(1) << __func__ << " rocksdb_cache_partitions needs a binned_lru "
+		<< "cache, ignoring the one for " << column.name << dendl;
+      } else {
+	rocksdb::BlockBasedTableOptions column_bbt_opts = bbt_opts;
+	column_bbt_opts.block_cache = binned->create_partition(
+	  column.name, p->second.first, p->second.second);
+	cf_bbt_opts[column.name] = column_bbt_opts;
+	cf_opt.table_factory.reset(NewBlockBasedTableFactory(cf_bbt_opts[column.name]));
+      }
     }
     if (column.shard_cnt == 1) {
       emplace_cf(column, 0, column.name, cf_opt);
@@ -1022,7 +1177,31 @@ int RocksDBStore::verify_sharding(const rocksdb::Options& opt,
   }
   existing_cfs.emplace_back("default", opt);
 
- if (existing_cfs.size() != rocksdb_cfs.size()) {
+  // an interrupted online reshard leaves the column families of the target
+  // sharding behind, or the ones it did not get to drop yet
+  std::string online_sharding_text;
+  if (opt.env->FileExists(online_reshard_file).ok() &&
+      rocksdb::ReadFileToString(opt.env, online_reshard_file,
+				&online_sharding_text).ok()) {
+    dout(1) << __func__ << " online reshard to '" << online_sharding_text
+	    << "' in progress" << dendl;
+    std::vector<ColumnFamily> online_sharding_def;
+    parse_sharding_def(online_sharding_text, online_sharding_def);
+    for (const auto& name : rocksdb_cfs) {
+      if (std::find_if(existing_cfs.begin(), existing_cfs.end(),
+		       [&](const rocksdb::ColumnFamilyDescriptor& c) {
+			 return c.name == name; }) != existing_cfs.end()) {
+	continue;
+      }
+      rocksdb::ColumnFamilyOptions cf_opt(opt);
+      if (int r = get_online_cf_options(online_sharding_def, name, &cf_opt); r < 0) {
+	return r;
+      }
+      online_reshard_cfs.emplace_back(name, cf_opt);
+    }
+  }
+
+ if (existing_cfs.size() + online_reshard_cfs.size() != rocksdb_cfs.size()) {
    std::vector<std::string> columns_from_stored;
    sharding_def_to_columns(stored_sharding_def, columns_from_stored);
    derr << __func__ << " extra columns in rocksdb. rocksdb columns = " << rocksdb_cfs
@@ -1050,6 +1229,18 @@ std::ostream& operator<<(std::ostream& out, const RocksDBStore::ColumnFamily& cf
   return out;
 }
 
+static RocksDBStore::resharding_ctrl get_online_ctrl(CephContext* cct)
+{
+  RocksDBStore::resharding_ctrl ctrl;
+  ctrl.keys_per_batch =
+    cct->_conf.get_val<uint64_t>("rocksdb_reshard_online_keys_per_batch");
+  ctrl.bytes_per_batch =
+    cct->_conf.get_val<Option::size_t>("rocksdb_reshard_online_bytes_per_batch");
+  ctrl.batch_interval =
+    cct->_conf.get_val<double>("rocksdb_reshard_online_batch_interval");
+  return ctrl;
+}
+
 int RocksDBStore::do_open(ostream &out,
 			  bool create_if_missing,
 			  bool open_readonly,
@@ -1079,10 +1270,12 @@ int RocksDBStore::do_open(ostream &out,
     std::vector<std::pair<size_t, RocksDBStore::ColumnFamily> > existing_cfs_shard;
     std::vector<rocksdb::ColumnFamilyDescriptor> missing_cfs;
     std::vector<std::pair<size_t, RocksDBStore::ColumnFamily> > missing_cfs_shard;
+    std::vector<rocksdb::ColumnFamilyDescriptor> online_cfs;
 
     r = verify_sharding(opt,
 			existing_cfs, existing_cfs_shard,
-			missing_cfs, missing_cfs_shard);
+			missing_cfs, missing_cfs_shard,
+			online_cfs);
     if (r < 0) {
       return r;
     }
@@ -1120,21 +1313,24 @@ int RocksDBStore::do_open(ostream &out,
       default_cf = db->DefaultColumnFamily();
     } else {
       std::vector<rocksdb::ColumnFamilyHandle*> handles;
+      std::vector<rocksdb::ColumnFamilyDescriptor> cfs_to_open = existing_cfs;
+      cfs_to_open.insert(cfs_to_open.end(), online_cfs.begin(), online_cfs.end());
       if (open_readonly) {
         status = rocksdb::DB::OpenForReadOnly(rocksdb::DBOptions(opt),
-				              path, existing_cfs,
+				              path, cfs_to_open,
 					      &handles, &db);
       } else {
         status = rocksdb::DB::Open(rocksdb::DBOptions(opt),
-				   path, existing_cfs, &handles, &db);
+				   path, cfs_to_open, &handles, &db);
       }
       if (!status.ok()) {
 	derr << status.ToString() << dendl;
 	return -EINVAL;
       }
       ceph_assert(existing_cfs.size() == existing_cfs_shard.size() + 1);
-      ceph_assert(handles.size() == existing_cfs.size());
-      dout(10) << __func__ << " existing_cfs=" << existing_cfs.size() << dendl;
+      ceph_assert(handles.size() == cfs_to_open.size());
+      dout(10) << __func__ << " existing_cfs=" << existing_cfs.size()
+	       << " online_cfs=" << online_cfs.size() << dendl;
       for (size_t i = 0; i < existing_cfs_shard.size(); i++) {
 	add_column_family(existing_cfs_shard[i].second.name,
 			  existing_cfs_shard[i].second.hash_l,
@@ -1142,8 +1338,11 @@ int RocksDBStore::do_open(ostream &out,
 			  existing_cfs_shard[i].first,
 			  handles[i]);
       }
-      default_cf = handles[handles.size() - 1];
+      default_cf = handles[existing_cfs.size() - 1];
       must_close_default_cf = true;
+      for (size_t i = 0; i < online_cfs.size(); i++) {
+	online_reshard_cfs[online_cfs[i].name] = handles[existing_cfs.size() + i];
+      }
 
       if (missing_cfs.size() > 0 &&
 	  std::find_if(missing_cfs.begin(), missing_cfs.end(),
@@ -1187,9 +1386,40 @@ int RocksDBStore::do_open(ostream &out,
   plb.add_time_avg(l_rocksdb_write_delay_time, "rocksdb_write_delay_time", "Rocksdb write delay time");
   plb.add_time_avg(l_rocksdb_write_pre_and_post_process_time, 
       "rocksdb_write_pre_and_post_time", "total time spent on writing a record, excluding write process");
+  plb.add_u64_counter(l_rocksdb_point_tombstones, "point_tombstones",
+		      "Keys deleted one by one while removing a key range");
+  plb.add_u64_counter(l_rocksdb_range_tombstones, "range_tombstones",
+		      "Key ranges removed with DeleteRange");
+  plb.add_u64_counter(l_rocksdb_tombstone_compact, "tombstone_compact",
+		      "Range compactions queued to get rid of tombstones");
+  plb.add_u64_counter(l_rocksdb_reshard_moved, "reshard_moved",
+		      "Keys moved to their new column family by online resharding");
   logger = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 
+  if (std::string online_sharding_text;
+      opt.env->FileExists(online_reshard_file).ok() &&
+      rocksdb::ReadFileToString(opt.env, online_reshard_file,
+				&online_sharding_text).ok()) {
+    std::string stored_sharding_text;
+    get_sharding(stored_sharding_text);
+    if (online_sharding_text == stored_sharding_text) {
+      // interrupted right after the switch
+      r = cleanup_online_reshard(open_readonly);
+    } else {
+      r = start_online_reshard(online_sharding_text, get_online_ctrl(cct),
+			       true, open_readonly);
+    }
+    if (r < 0) {
+      derr << __func__ << " cannot resume online reshard to '"
+	   << online_sharding_text << "': " << cpp_strerror(r) << dendl;
+      return r;
+    }
+  }
+  if (!open_readonly) {
+    asok_hook = SocketHook::create(this);
+  }
+
   if (compact_on_mount) {
     derr << "Compacting rocksdb store..." << dendl;
     compact();
@@ -1219,6 +1449,12 @@ RocksDBStore::~RocksDBStore()
 
 void RocksDBStore::close()
 {
+  if (asok_hook) {
+    delete asok_hook;
+    asok_hook = nullptr;
+  }
+  stop_online_reshard();
+
   // stop compaction thread
   compact_queue_lock.lock();
   if (compact_thread.is_started()) {
@@ -1245,6 +1481,22 @@ void RocksDBStore::close()
     }
   }
   cf_handles.clear();
+  if (online_reshard) {
+    // resumed on the next open
+    for (auto h : online_reshard->created) {
+      db->DestroyColumnFamilyHandle(h);
+    }
+    online_reshard.reset();
+  }
+  resharding = false;
+  for (auto& [name, h] : online_reshard_cfs) {
+    db->DestroyColumnFamilyHandle(h);
+  }
+  online_reshard_cfs.clear();
+  for (auto h : retired_cfs) {
+    db->DestroyColumnFamilyHandle(h);
+  }
+  retired_cfs.clear();
   if (must_close_default_cf) {
     db->DestroyColumnFamilyHandle(default_cf);
     must_close_default_cf = false;
@@ -1332,9 +1584,17 @@ int64_t RocksDBStore::estimate_prefix_size(const string& prefix,
   uint8_t flags =
     //rocksdb::DB::INCLUDE_MEMTABLES |  // do not include memtables...
     rocksdb::DB::INCLUDE_FILES;
+  ReshardGuard l{*this};
   auto p_iter = cf_handles.find(prefix);
   if (p_iter != cf_handles.end()) {
-    for (auto cf : p_iter->second.handles) {
+    const auto* shards = &p_iter->second.handles;
+    if (online_reshard) {
+      if (auto p = online_reshard->all_shards.find(prefix);
+	  p != online_reshard->all_shards.end()) {
+	shards = &p->second;
+      }
+    }
+    for (auto cf : *shards) {
       uint64_t s = 0;
       string start = key_prefix + string(1, '\x00');
       string limit = key_prefix + string("\xff\xff\xff\xff");
@@ -1407,6 +1667,19 @@ void RocksDBStore::get_statistics(Formatter *f)
     f->dump_string("rocksdb_index_filter_blocks_usage", str);
     f->close_section();
   }
+  {
+    std::lock_guard l(tombstone_lock);
+    f->open_object_section("rocksdb_tombstones");
+    for (auto& [cf, stats] : tombstone_stats) {
+      f->open_object_section(cf.c_str());
+      f->dump_unsigned("point", stats.point);
+      f->dump_unsigned("range", stats.range);
+      f->dump_unsigned("pending", stats.pending);
+      f->dump_unsigned("compactions", stats.compactions);
+      f->close_section();
+    }
+    f->close_section();
+  }
 }
 
 struct RocksDBStore::RocksWBHandler: public rocksdb::WriteBatch::Handler {
@@ -1485,6 +1758,25 @@ int RocksDBStore::submit_common(rocksdb::WriteOptions& woptions, KeyValueDB::Tra
 
   RocksDBTransactionImpl * _t =
     static_cast<RocksDBTransactionImpl *>(t.get());
+  // the ops on prefixes that are being resharded online go to the batch now.
+  // a merge may have to move the key first, nothing else may write it then
+  std::optional<ReshardGuard> reshard_guard;
+  std::shared_lock reshard_shared{reshard_lock, std::defer_lock};
+  std::unique_lock reshard_unique{reshard_lock, std::defer_lock};
+  std::vector<std::string> reshard_prefixes;
+  if (_t->reshard_ops.empty()) {
+    reshard_guard.emplace(*this);
+  } else {
+    if (_t->reshard_merges) {
+      reshard_unique.lock();
+    } else {
+      reshard_shared.lock();
+    }
+    for (auto& op : _t->reshard_ops) {
+      reshard_prefixes.push_back(op.prefix);
+    }
+    _t->apply_reshard_ops(online_reshard.get());
+  }
   woptions.disableWAL = disableWAL;
   lgeneric_subdout(cct, rocksdb, 30) << __func__;
   RocksWBHandler bat_txc(*this);
@@ -1492,11 +1784,22 @@ int RocksDBStore::submit_common(rocksdb::WriteOptions& woptions, KeyValueDB::Tra
   *_dout << " Rocksdb transaction: " << bat_txc.seen.str() << dendl;
   
   rocksdb::Status s = db->Write(woptions, &_t->bat);
+  if (!reshard_prefixes.empty() && online_reshard) {
+    // after the write, see reshard_thread_entry()
+    for (auto& prefix : reshard_prefixes) {
+      if (auto p = online_reshard->submitted.find(prefix);
+	  p != online_reshard->submitted.end()) {
+	++p->second;
+      }
+    }
+  }
   if (!s.ok()) {
     RocksWBHandler rocks_txc(*this);
     _t->bat.Iterate(&rocks_txc);
     derr << __func__ << " error: " << s.ToString() << " code = " << s.code()
          << " Rocksdb transaction: " << rocks_txc.seen.str() << dendl;
+  } else if (!_t->removals.empty()) {
+    note_removals(_t->removals);
   }
 
   if (cct->_conf->rocksdb_perf) {
@@ -1553,6 +1856,140 @@ int RocksDBStore::submit_transaction_sync(KeyValueDB::Transaction t)
 RocksDBStore::RocksDBTransactionImpl::RocksDBTransactionImpl(RocksDBStore *_db)
 {
   db = _db;
+  // count ourselves before looking, the reshard thread does it the other
+  // way round: either it waits for us, or we see the reshard
+  ++db->untracked_txns;
+  reshard = std::atomic_load(&db->online_reshard);
+  if (reshard) {
+    --db->untracked_txns;
+  } else {
+    untracked = true;
+  }
+}
+
+RocksDBStore::RocksDBTransactionImpl::~RocksDBTransactionImpl()
+{
+  if (untracked) {
+    --db->untracked_txns;
+  }
+}
+
+bool RocksDBStore::RocksDBTransactionImpl::defer_op(
+  ReshardOp::op_t op,
+  const string &prefix,
+  const string &k,
+  const string &end,
+  const bufferlist *bl)
+{
+  if (!reshard || reshard->target.count(prefix) == 0) {
+    return false;
+  }
+  reshard_ops.push_back(ReshardOp{op, prefix, k, end,
+				  bl ? *bl : bufferlist()});
+  reshard_merges |= (op == ReshardOp::MERGE);
+  return true;
+}
+
+void RocksDBStore::RocksDBTransactionImpl::apply_reshard_ops(
+  const OnlineReshard* r)
+{
+  // from now on the ops go to the batch right away
+  reshard.reset();
+  auto ops = std::move(reshard_ops);
+  reshard_ops.clear();
+  reshard_merges = false;
+
+  // the value a merge applies to is moved to the new shard along, unless
+  // this batch wrote or removed the key already
+  std::set<pair<string,string>> written;
+  vector<const ReshardOp*> removed;
+  auto is_removed = [&](const ReshardOp& op) {
+    for (auto rm : removed) {
+      if (rm->prefix == op.prefix && rm->key <= op.key && op.key < rm->end) {
+	return true;
+      }
+    }
+    return written.count({op.prefix, op.key}) > 0;
+  };
+  for (auto& op : ops) {
+    const prefix_shards* target = nullptr;
+    if (r) {
+      if (auto p = r->target.find(op.prefix); p != r->target.end()) {
+	target = &p->second;
+      }
+    }
+    if (!target) {
+      // the reshard is over
+      switch (op.op) {
+      case ReshardOp::SET:
+	set(op.prefix, op.key, op.bl);
+	break;
+      case ReshardOp::RMKEY:
+	rmkey(op.prefix, op.key);
+	break;
+      case ReshardOp::MERGE:
+	merge(op.prefix, op.key, op.bl);
+	break;
+      case ReshardOp::RM_RANGE:
+	rm_range_keys(op.prefix, op.key, op.end);
+	break;
+      }
+      continue;
+    }
+    auto from = db->get_cf_handle(op.prefix, op.key);
+    auto to = get_shard(*target, op.key.data(), op.key.size());
+    switch (op.op) {
+    case ReshardOp::SET:
+      if (r->active) {
+	put_bat(bat, to, op.key, op.bl);
+	if (from != to) {
+	  bat.Delete(from, op.key);
+	}
+      } else {
+	put_bat(bat, from, op.key, op.bl);
+      }
+      written.emplace(op.prefix, op.key);
+      break;
+    case ReshardOp::RMKEY:
+      bat.Delete(from, op.key);
+      if (from != to) {
+	bat.Delete(to, op.key);
+      }
+      written.emplace(op.prefix, op.key);
+      break;
+    case ReshardOp::MERGE:
+      if (!r->active) {
+	merge_bat(from, op.key, op.bl);
+	break;
+      }
+      if (from != to && !is_removed(op)) {
+	rocksdb::PinnableSlice value;
+	auto s = db->db->Get(rocksdb::ReadOptions(), from, op.key, &value);
+	if (s.ok()) {
+	  bat.Put(to, op.key, value);
+	  bat.Delete(from, op.key);
+	} else if (!s.IsNotFound()) {
+	  ceph_abort_msg(s.getState());
+	}
+      }
+      merge_bat(to, op.key, op.bl);
+      written.emplace(op.prefix, op.key);
+      break;
+    case ReshardOp::RM_RANGE:
+      {
+	RangeRemoval removal{op.prefix, combine_strings(op.prefix, op.key),
+			     combine_strings(op.prefix, op.end), 0, false};
+	for (auto cf : r->all_shards.at(op.prefix)) {
+	  delete_range(cf, op.key, op.end, &removal);
+	}
+	if (removal.range || removal.point_deletes) {
+	  removals.push_back(std::move(removal));
+	}
+	removed.push_back(&op);
+      }
+      break;
+    }
+  }
 }
 
 void RocksDBStore::RocksDBTransactionImpl::put_bat(
@@ -1581,6 +2018,9 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   const string &k,
   const bufferlist &to_set_bl)
 {
+  if (defer_op(ReshardOp::SET, prefix, k, string(), &to_set_bl)) {
+    return;
+  }
   auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     put_bat(bat, cf, k, to_set_bl);
@@ -1595,6 +2035,10 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   const char *k, size_t keylen,
   const bufferlist &to_set_bl)
 {
+  if (reshard &&
+      defer_op(ReshardOp::SET, prefix, string(k, keylen), string(), &to_set_bl)) {
+    return;
+  }
   auto cf = db->get_cf_handle(prefix, k, keylen);
   if (cf) {
     string key(k, keylen);  // fixme?
@@ -1609,6 +2053,9 @@ void RocksDBStore::RocksDBTransactionImpl::set(
 void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const string &k)
 {
+  if (defer_op(ReshardOp::RMKEY, prefix, k)) {
+    return;
+  }
   auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     bat.Delete(cf, rocksdb::Slice(k));
@@ -1621,6 +2068,9 @@ void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const char *k,
 						 size_t keylen)
 {
+  if (reshard && defer_op(ReshardOp::RMKEY, prefix, string(k, keylen))) {
+    return;
+  }
   auto cf = db->get_cf_handle(prefix, k, keylen);
   if (cf) {
     bat.Delete(cf, rocksdb::Slice(k, keylen));
@@ -1634,6 +2084,11 @@ void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 void RocksDBStore::RocksDBTransactionImpl::rm_single_key(const string &prefix,
 					                 const string &k)
 {
+  // the key may be in either shard, and a SingleDelete must not meet more
+  // than a single Put there
+  if (defer_op(ReshardOp::RMKEY, prefix, k)) {
+    return;
+  }
   auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     bat.SingleDelete(cf, k);
@@ -1642,89 +2097,101 @@ void RocksDBStore::RocksDBTransactionImpl::rm_single_key(const string &prefix,
   }
 }
 
-void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix)
+void RocksDBStore::RocksDBTransactionImpl::delete_range(
+  rocksdb::ColumnFamilyHandle *cf,
+  const string &start,
+  const string &end,
+  RangeRemoval *removal)
 {
-  auto p_iter = db->cf_handles.find(prefix);
-  if (p_iter == db->cf_handles.end()) {
+  if (!db->delete_range_always) {
     uint64_t cnt = db->delete_range_threshold;
+    uint64_t deleted = 0;
     bat.SetSavePoint();
-    auto it = db->get_iterator(prefix);
-    for (it->seek_to_first(); it->valid() && (--cnt) != 0; it->next()) {
-      bat.Delete(db->default_cf, combine_strings(prefix, it->key()));
-    }
-    if (cnt == 0) {
-	bat.RollbackToSavePoint();
-	string endprefix = prefix;
-        endprefix.push_back('\x01');
-	bat.DeleteRange(db->default_cf,
-                        combine_strings(prefix, string()),
-                        combine_strings(endprefix, string()));
-    } else {
+    rocksdb::ReadOptions options;
+    rocksdb::Slice upper(end);
+    options.iterate_upper_bound = &upper;
+    std::unique_ptr<rocksdb::Iterator> it{db->db->NewIterator(options, cf)};
+    for (it->Seek(start); it->Valid() && (--cnt) != 0; it->Next()) {
+      bat.Delete(cf, it->key());
+      ++deleted;
+    }
+    if (cnt != 0) {
       bat.PopSavePoint();
+      removal->point_deletes += deleted;
+      return;
     }
+    bat.RollbackToSavePoint();
+  }
+  bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
+  removal->range = true;
+}
+
+void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix)
+{
+  if (defer_op(ReshardOp::RM_RANGE, prefix, string(), "\xff\xff\xff\xff")) {
+    return;
+  }
+  RangeRemoval removal{"default", combine_strings(prefix, string()),
+		       past_prefix(prefix), 0, false};
+  auto p_iter = db->cf_handles.find(prefix);
+  if (p_iter == db->cf_handles.end()) {
+    delete_range(db->default_cf, removal.start, removal.end, &removal);
   } else {
     ceph_assert(p_iter->second.handles.size() >= 1);
+    string endprefix = "\xff\xff\xff\xff";  // FIXME: this is cheating...
+    removal.cf = prefix;
+    removal.end = combine_strings(prefix, endprefix);
     for (auto cf : p_iter->second.handles) {
-      uint64_t cnt = db->delete_range_threshold;
-      bat.SetSavePoint();
-      auto it = db->new_shard_iterator(cf);
-      for (it->SeekToFirst(); it->Valid() && (--cnt) != 0; it->Next()) {
-	bat.Delete(cf, it->key());
-      }
-      if (cnt == 0) {
-	bat.RollbackToSavePoint();
-	string endprefix = "\xff\xff\xff\xff";  // FIXME: this is cheating...
-	bat.DeleteRange(cf, string(), endprefix);
-      } else {
-	bat.PopSavePoint();
-      }
+      delete_range(cf, string(), endprefix, &removal);
     }
   }
+  if (removal.range || removal.point_deletes) {
+    removals.push_back(std::move(removal));
+  }
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
                                                          const string &start,
                                                          const string &end)
 {
+  if (defer_op(ReshardOp::RM_RANGE, prefix, start, end)) {
+    return;
+  }
+  RangeRemoval removal{"default", combine_strings(prefix, start),
+		       combine_strings(prefix, end), 0, false};
   auto p_iter = db->cf_handles.find(prefix);
   if (p_iter == db->cf_handles.end()) {
-    uint64_t cnt = db->delete_range_threshold;
-    bat.SetSavePoint();
-    auto it = db->get_iterator(prefix);
-    for (it->lower_bound(start);
-	 it->valid() && db->comparator->Compare(it->key(), end) < 0 && (--cnt) != 0;
-	 it->next()) {
-      bat.Delete(db->default_cf, combine_strings(prefix, it->key()));
-    }
-    if (cnt == 0) {
-      bat.RollbackToSavePoint();
-      bat.DeleteRange(db->default_cf,
-		      rocksdb::Slice(combine_strings(prefix, start)),
-		      rocksdb::Slice(combine_strings(prefix, end)));
-    } else {
-      bat.PopSavePoint();
-    }
+    delete_range(db->default_cf, removal.start, removal.end, &removal);
   } else {
     ceph_assert(p_iter->second.handles.size() >= 1);
+    removal.cf = prefix;
     for (auto cf : p_iter->second.handles) {
-      uint64_t cnt = db->delete_range_threshold;
-      bat.SetSavePoint();
-      rocksdb::Iterator* it = db->new_shard_iterator(cf);
-      ceph_assert(it != nullptr);
-      for (it->Seek(start);
-	   it->Valid() && db->comparator->Compare(it->key(), end) < 0 && (--cnt) != 0;
-	   it->Next()) {
-	bat.Delete(cf, it->key());
-      }
-      if (cnt == 0) {
-	bat.RollbackToSavePoint();
-	bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
-      } else {
-	bat.PopSavePoint();
-      }
-      delete it;
+      delete_range(cf, start, end, &removal);
     }
   }
+  if (removal.range || removal.point_deletes) {
+    removals.push_back(std::move(removal));
+  }
+}
+
+void RocksDBStore::RocksDBTransactionImpl::merge_bat(
+  rocksdb::ColumnFamilyHandle *cf,
+  const string &key,
+  const bufferlist &to_set_bl)
+{
+  // bufferlist::c_str() is non-constant, so we can't call c_str()
+  if (to_set_bl.is_contiguous() && to_set_bl.length() > 0) {
+    bat.Merge(
+      cf,
+      rocksdb::Slice(key),
+      rocksdb::Slice(to_set_bl.buffers().front().c_str(), to_set_bl.length()));
+  } else {
+    // make a copy
+    rocksdb::Slice key_slice(key);
+    vector<rocksdb::Slice> value_slices(to_set_bl.get_num_buffers());
+    bat.Merge(cf, rocksdb::SliceParts(&key_slice, 1),
+	      prepare_sliceparts(to_set_bl, &value_slices));
+  }
 }
 
 void RocksDBStore::RocksDBTransactionImpl::merge(
@@ -1732,38 +2199,14 @@ void RocksDBStore::RocksDBTransactionImpl::merge(
   const string &k,
   const bufferlist &to_set_bl)
 {
+  if (defer_op(ReshardOp::MERGE, prefix, k, string(), &to_set_bl)) {
+    return;
+  }
   auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
-    // bufferlist::c_str() is non-constant, so we can't call c_str()
-    if (to_set_bl.is_contiguous() && to_set_bl.length() > 0) {
-      bat.Merge(
-	cf,
-	rocksdb::Slice(k),
-	rocksdb::Slice(to_set_bl.buffers().front().c_str(), to_set_bl.length()));
-    } else {
-      // make a copy
-      rocksdb::Slice key_slice(k);
-      vector<rocksdb::Slice> value_slices(to_set_bl.get_num_buffers());
-      bat.Merge(cf, rocksdb::SliceParts(&key_slice, 1),
-		prepare_sliceparts(to_set_bl, &value_slices));
-    }
+    merge_bat(cf, k, to_set_bl);
   } else {
-    string key = combine_strings(prefix, k);
-    // bufferlist::c_str() is non-constant, so we can't call c_str()
-    if (to_set_bl.is_contiguous() && to_set_bl.length() > 0) {
-      bat.Merge(
-	db->default_cf,
-	rocksdb::Slice(key),
-	rocksdb::Slice(to_set_bl.buffers().front().c_str(), to_set_bl.length()));
-    } else {
-      // make a copy
-      rocksdb::Slice key_slice(key);
-      vector<rocksdb::Slice> value_slices(to_set_bl.get_num_buffers());
-      bat.Merge(
-	db->default_cf,
-	rocksdb::SliceParts(&key_slice, 1),
-	prepare_sliceparts(to_set_bl, &value_slices));
-    }
+    merge_bat(db->default_cf, combine_strings(prefix, k), to_set_bl);
   }
 }
 
@@ -1774,13 +2217,19 @@ int RocksDBStore::get(
 {
   rocksdb::PinnableSlice value;
   utime_t start = ceph_clock_now();
+  ReshardGuard l{*this};
   if (cf_handles.count(prefix) > 0) {
+    auto target = get_reshard_target(prefix);
     for (auto& key : keys) {
-      auto cf_handle = get_cf_handle(prefix, key);
-      auto status = db->Get(rocksdb::ReadOptions(),
-			    cf_handle,
-			    rocksdb::Slice(key),
-			    &value);
+      rocksdb::Status status;
+      if (target) {
+	status = get_resharded(prefix, *target, rocksdb::Slice(key), &value);
+      } else {
+	status = db->Get(rocksdb::ReadOptions(),
+			 get_cf_handle(prefix, key),
+			 rocksdb::Slice(key),
+			 &value);
+      }
       if (status.ok()) {
 	(*out)[key].append(value.data(), value.size());
       } else if (status.IsIOError()) {
@@ -1819,8 +2268,11 @@ int RocksDBStore::get(
   int r = 0;
   rocksdb::PinnableSlice value;
   rocksdb::Status s;
+  ReshardGuard l{*this};
   auto cf = get_cf_handle(prefix, key);
-  if (cf) {
+  if (auto target = cf ? get_reshard_target(prefix) : nullptr; target) {
+    s = get_resharded(prefix, *target, rocksdb::Slice(key), &value);
+  } else if (cf) {
     s = db->Get(rocksdb::ReadOptions(),
 		cf,
 		rocksdb::Slice(key),
@@ -1856,8 +2308,11 @@ int RocksDBStore::get(
   int r = 0;
   rocksdb::PinnableSlice value;
   rocksdb::Status s;
+  ReshardGuard l{*this};
   auto cf = get_cf_handle(prefix, key, keylen);
-  if (cf) {
+  if (auto target = cf ? get_reshard_target(prefix) : nullptr; target) {
+    s = get_resharded(prefix, *target, rocksdb::Slice(key, keylen), &value);
+  } else if (cf) {
     s = db->Get(rocksdb::ReadOptions(),
 		cf,
 		rocksdb::Slice(key, keylen),
@@ -1906,16 +2361,80 @@ int RocksDBStore::split_key(rocksdb::Slice in, string *prefix, string *key)
 void RocksDBStore::compact()
 {
   logger->inc(l_rocksdb_compact);
+  {
+    std::lock_guard l(tombstone_lock);
+    for (auto& [cf, stats] : tombstone_stats) {
+      stats.pending = 0;
+      stats.ranges.clear();
+    }
+  }
+  std::vector<rocksdb::ColumnFamilyHandle*> shards;
+  {
+    ReshardGuard l{*this};
+    for (auto& cf : cf_handles) {
+      shards.insert(shards.end(), cf.second.handles.begin(), cf.second.handles.end());
+    }
+    if (online_reshard) {
+      shards.insert(shards.end(), online_reshard->created.begin(),
+		    online_reshard->created.end());
+    }
+  }
   rocksdb::CompactRangeOptions options;
   db->CompactRange(options, default_cf, nullptr, nullptr);
-  for (auto cf : cf_handles) {
-    for (auto shard_cf : cf.second.handles) {
-      db->CompactRange(
-	options,
-	shard_cf,
-	nullptr, nullptr);
+  for (auto shard_cf : shards) {
+    db->CompactRange(
+      options,
+      shard_cf,
+      nullptr, nullptr);
+  }
+}
+
+void RocksDBStore::note_removals(const std::vector<RangeRemoval>& removals)
+{
+  std::vector<std::pair<std::string,std::string>> to_compact;
+  {
+    std::lock_guard l(tombstone_lock);
+    for (auto& r : removals) {
+      auto& stats = tombstone_stats[r.cf];
+      // a range tombstone hides many keys, but it is a single entry for the
+      // iterators to skip; count it like a point delete
+      uint64_t tombstones = r.point_deletes + (r.range ? 1 : 0);
+      stats.point += r.point_deletes;
+      stats.range += r.range ? 1 : 0;
+      logger->inc(l_rocksdb_point_tombstones, r.point_deletes);
+      if (r.range) {
+	logger->inc(l_rocksdb_range_tombstones);
+      }
+      if (tombstone_compact_threshold == 0) {
+	continue;
+      }
+      stats.pending += tombstones;
+      // keep the list short: removals tend to be clustered (e.g. all the
+      // omap of a PG's objects), so cover the pending ones with a single
+      // range once there are too many
+      if (stats.ranges.size() < 32) {
+	stats.ranges.emplace_back(r.start, r.end);
+      } else {
+	auto& last = stats.ranges.back();
+	last.first = std::min(last.first, r.start);
+	last.second = std::max(last.second, r.end);
+      }
+      if (stats.pending >= tombstone_compact_threshold) {
+	dout(10) << __func__ << " " << r.cf << " has " << stats.pending
+		 << " tombstones in " << stats.ranges.size()
+		 << " ranges, compacting" << dendl;
+	std::move(stats.ranges.begin(), stats.ranges.end(),
+		  std::back_inserter(to_compact));
+	stats.ranges.clear();
+	stats.pending = 0;
+	++stats.compactions;
+      }
     }
   }
+  for (auto& [start, end] : to_compact) {
+    logger->inc(l_rocksdb_tombstone_compact);
+    compact_range_async(start, end);
+  }
 }
 
 void RocksDBStore::compact_thread_entry()
@@ -2006,38 +2525,53 @@ void RocksDBStore::compact_range(const string& start, const string& end)
   string key_highest = "\xff\xff\xff\xff"; //cheating
   string key_lowest = "";
 
+  // look the shards up first, and compact without holding reshard_lock
+  std::vector<std::tuple<rocksdb::ColumnFamilyHandle*, string, string>> ranges;
   auto compact_range = [&] (const decltype(cf_handles)::iterator column_it,
 			    const std::string& start,
 			    const std::string& end) {
-    rocksdb::Slice cstart(start);
-    rocksdb::Slice cend(end);
-    for (const auto& shard_it : column_it->second.handles) {
-      db->CompactRange(options, shard_it, &cstart, &cend);
+    const auto* shards = &column_it->second.handles;
+    if (online_reshard) {
+      if (auto p = online_reshard->all_shards.find(column_it->first);
+	  p != online_reshard->all_shards.end()) {
+	shards = &p->second;
+      }
+    }
+    for (const auto& shard_it : *shards) {
+      ranges.emplace_back(shard_it, start, end);
     }
   };
   db->CompactRange(options, default_cf, &cstart, &cend);
   split_key(cstart, &prefix_start, &key_start);
   split_key(cend, &prefix_end, &key_end);
-  if (prefix_start == prefix_end) {
-    const auto& column = cf_handles.find(prefix_start);
-    if (column != cf_handles.end()) {
-      compact_range(column, key_start, key_end);
-    }
-  } else {
-    auto column = cf_handles.find(prefix_start);
-    if (column != cf_handles.end()) {
-      compact_range(column, key_start, key_highest);
-      ++column;
-    }
-    const auto& column_end = cf_handles.find(prefix_end);
-    while (column != column_end) {
-      compact_range(column, key_lowest, key_highest);
-      column++;
-    }
-    if (column != cf_handles.end()) {
-      compact_range(column, key_lowest, key_end);
+  {
+    ReshardGuard l{*this};
+    if (prefix_start == prefix_end) {
+      const auto& column = cf_handles.find(prefix_start);
+      if (column != cf_handles.end()) {
+	compact_range(column, key_start, key_end);
+      }
+    } else {
+      auto column = cf_handles.find(prefix_start);
+      if (column != cf_handles.end()) {
+	compact_range(column, key_start, key_highest);
+	++column;
+      }
+      const auto& column_end = cf_handles.find(prefix_end);
+      while (column != column_end) {
+	compact_range(column, key_lowest, key_highest);
+	column++;
+      }
+      if (column != cf_handles.end()) {
+	compact_range(column, key_lowest, key_end);
+      }
     }
   }
+  for (auto& [shard, start, end] : ranges) {
+    rocksdb::Slice cstart(start);
+    rocksdb::Slice cend(end);
+    db->CompactRange(options, shard, &cstart, &cend);
+  }
 }
 
 RocksDBStore::RocksDBWholeSpaceIteratorImpl::~RocksDBWholeSpaceIteratorImpl()
@@ -2709,21 +3243,29 @@ private:
   KeyLess keyless;
   string prefix;
   std::vector<rocksdb::Iterator*> iters;
+  const rocksdb::Snapshot* snapshot;
 public:
+  /// @param snapshot to release when done, for a consistent view of all shards
   explicit ShardMergeIteratorImpl(const RocksDBStore* db,
 				  const std::string& prefix,
-				  const std::vector<rocksdb::ColumnFamilyHandle*>& shards)
-    : db(db), keyless(db->comparator), prefix(prefix)
+				  const std::vector<rocksdb::ColumnFamilyHandle*>& shards,
+				  const rocksdb::Snapshot* snapshot = nullptr)
+    : db(db), keyless(db->comparator), prefix(prefix), snapshot(snapshot)
   {
+    rocksdb::ReadOptions options;
+    options.snapshot = snapshot;
     iters.reserve(shards.size());
     for (auto& s : shards) {
-      iters.push_back(db->db->NewIterator(rocksdb::ReadOptions(), s));
+      iters.push_back(db->db->NewIterator(options, s));
     }
   }
   ~ShardMergeIteratorImpl() {
     for (auto& it : iters) {
       delete it;
     }
+    if (snapshot) {
+      db->db->ReleaseSnapshot(snapshot);
+    }
   }
   int seek_to_first() override {
     for (auto& it : iters) {
@@ -2890,21 +3432,34 @@ public:
 
 KeyValueDB::Iterator RocksDBStore::get_iterator(const std::string& prefix, IteratorOpts opts)
 {
-  auto cf_it = cf_handles.find(prefix);
-  if (cf_it != cf_handles.end()) {
-    if (cf_it->second.handles.size() == 1) {
-      return std::make_shared<CFIteratorImpl>(
-        prefix,
-        db->NewIterator(rocksdb::ReadOptions(), cf_it->second.handles[0]));
-    } else {
-      return std::make_shared<ShardMergeIteratorImpl>(
-        this,
-        prefix,
-        cf_it->second.handles);
+  {
+    ReshardGuard l{*this};
+    auto cf_it = cf_handles.find(prefix);
+    if (cf_it != cf_handles.end()) {
+      if (online_reshard) {
+	if (auto p = online_reshard->all_shards.find(prefix);
+	    p != online_reshard->all_shards.end()) {
+	  // each key is in one of the old and new shards at a time
+	  return std::make_shared<ShardMergeIteratorImpl>(
+	    this,
+	    prefix,
+	    p->second,
+	    db->GetSnapshot());
+	}
+      }
+      if (cf_it->second.handles.size() == 1) {
+	return std::make_shared<CFIteratorImpl>(
+	  prefix,
+	  db->NewIterator(rocksdb::ReadOptions(), cf_it->second.handles[0]));
+      } else {
+	return std::make_shared<ShardMergeIteratorImpl>(
+	  this,
+	  prefix,
+	  cf_it->second.handles);
+      }
     }
-  } else {
-    return KeyValueDB::get_iterator(prefix, opts);
   }
+  return KeyValueDB::get_iterator(prefix, opts);
 }
 
 rocksdb::Iterator* RocksDBStore::new_shard_iterator(rocksdb::ColumnFamilyHandle* cf)
@@ -3327,10 +3882,498 @@ int RocksDBStore::reshard(const std::string& new_sharding, const RocksDBStore::r
     derr << __func__ << " cannot write to " << sharding_def_file << dendl;
     return -EIO;
   }
+  // every key is where the new sharding wants it, whatever an interrupted
+  // online reshard was up to
+  env->DeleteFile(online_reshard_file);
 
   return r;
 }
 
+int RocksDBStore::reshard_online(const std::string& new_sharding,
+				 const RocksDBStore::resharding_ctrl* ctrl_in)
+{
+  if (is_resharding_online()) {
+    return -EBUSY;
+  }
+  if (reshard_thread.is_started()) {
+    // done with the last one
+    reshard_thread.join();
+  }
+  return start_online_reshard(new_sharding,
+			      ctrl_in ? *ctrl_in : get_online_ctrl(cct),
+			      false, false);
+}
+
+int RocksDBStore::start_online_reshard(const std::string& new_sharding,
+				       const RocksDBStore::resharding_ctrl& ctrl,
+				       bool resume,
+				       bool read_only)
+{
+  dout(1) << __func__ << " to '" << new_sharding << "'"
+	  << (resume ? " (resumed)" : "") << dendl;
+  if (!last_online_reshard.expired()) {
+    dout(1) << __func__ << " transactions of the last online reshard are "
+	    << "still around" << dendl;
+    return -EBUSY;
+  }
+  std::vector<ColumnFamily> new_sharding_def;
+  char const* error_position;
+  std::string error_msg;
+  if (!parse_sharding_def(new_sharding, new_sharding_def, &error_position,
+			  &error_msg)) {
+    dout(1) << __func__ << " bad sharding: " << dendl;
+    dout(1) << __func__ << new_sharding << dendl;
+    dout(1) << __func__ << std::string(error_position - &new_sharding[0], ' ')
+	    << "^" << error_msg << dendl;
+    return -EINVAL;
+  }
+  std::string stored_sharding_text;
+  get_sharding(stored_sharding_text);
+  if (!resume && stored_sharding_text == new_sharding) {
+    return 0;
+  }
+  std::vector<ColumnFamily> stored_sharding_def;
+  parse_sharding_def(stored_sharding_text, stored_sharding_def);
+
+  // the keys of a prefix in the default column family are prefixed, and
+  // would have to be rewritten rather than moved
+  auto find_column = [](const std::vector<ColumnFamily>& sharding_def,
+			const std::string& name) {
+    return std::find_if(sharding_def.begin(), sharding_def.end(),
+			[&](const ColumnFamily& c) { return c.name == name; });
+  };
+  for (const auto& column : stored_sharding_def) {
+    if (find_column(new_sharding_def, column.name) == new_sharding_def.end()) {
+      derr << __func__ << " " << column.name << " would move to the default "
+	   << "column family, which needs an offline reshard" << dendl;
+      return -EOPNOTSUPP;
+    }
+  }
+  auto r = std::make_shared<OnlineReshard>();
+  r->sharding_text = new_sharding;
+  for (const auto& column : new_sharding_def) {
+    auto old = find_column(stored_sharding_def, column.name);
+    if (old == stored_sharding_def.end()) {
+      derr << __func__ << " " << column.name << " would move from the default "
+	   << "column family, which needs an offline reshard" << dendl;
+      return -EOPNOTSUPP;
+    }
+    if (old->shard_cnt == column.shard_cnt &&
+	old->hash_l == column.hash_l &&
+	old->hash_h == column.hash_h) {
+      continue;
+    }
+    auto& target = r->target[column.name];
+    target.hash_l = column.hash_l;
+    target.hash_h = column.hash_h;
+    target.handles.resize(column.shard_cnt);
+  }
+
+  // the shards of the old sharding are reused by name, the others created
+  std::map<std::string, rocksdb::ColumnFamilyHandle*> old_shards;
+  for (const auto& [prefix, shards] : cf_handles) {
+    for (size_t i = 0; i < shards.handles.size(); i++) {
+      old_shards[shards.handles.size() == 1 ?
+		 prefix : prefix + "-" + to_string(i)] = shards.handles[i];
+    }
+  }
+  std::vector<rocksdb::ColumnFamilyHandle*> created_now;
+  bool started = false;
+  auto undo = make_scope_guard([&] {
+    if (started) {
+      return;
+    }
+    for (auto h : created_now) {
+      db->DropColumnFamily(h);
+      db->DestroyColumnFamilyHandle(h);
+    }
+    // back to where close() finds them
+    for (auto h : r->created) {
+      if (std::find(created_now.begin(), created_now.end(), h) == created_now.end()) {
+	online_reshard_cfs[h->GetName()] = h;
+      }
+    }
+  });
+  for (auto& [prefix, target] : r->target) {
+    for (size_t i = 0; i < target.handles.size(); i++) {
+      std::string name = target.handles.size() == 1 ?
+	prefix : prefix + "-" + to_string(i);
+      if (auto p = old_shards.find(name); p != old_shards.end()) {
+	target.handles[i] = p->second;
+      } else if (auto p = online_reshard_cfs.find(name);
+		 p != online_reshard_cfs.end()) {
+	target.handles[i] = p->second;
+	r->created.push_back(p->second);
+	online_reshard_cfs.erase(p);
+      } else if (read_only) {
+	derr << __func__ << " missing column family " << name << dendl;
+	return -EIO;
+      } else {
+	rocksdb::ColumnFamilyOptions cf_opt(db->GetOptions(default_cf));
+	if (int ret = get_online_cf_options(new_sharding_def, name, &cf_opt);
+	    ret < 0) {
+	  return ret;
+	}
+	rocksdb::ColumnFamilyHandle *cf;
+	auto status = db->CreateColumnFamily(cf_opt, name, &cf);
+	if (!status.ok()) {
+	  derr << __func__ << " failed to create rocksdb column family: "
+	       << name << dendl;
+	  return -EINVAL;
+	}
+	dout(10) << __func__ << " created column " << name << dendl;
+	target.handles[i] = cf;
+	r->created.push_back(cf);
+	created_now.push_back(cf);
+      }
+    }
+    auto& all = r->all_shards[prefix];
+    all = cf_handles.at(prefix).handles;
+    for (auto h : target.handles) {
+      if (std::find(all.begin(), all.end(), h) == all.end()) {
+	all.push_back(h);
+      }
+    }
+  }
+  if (!online_reshard_cfs.empty()) {
+    // not part of either sharding, i.e. not ours
+    derr << __func__ << " unexpected column families: "
+	 << online_reshard_cfs.size() << dendl;
+    return -EIO;
+  }
+  if (!resume) {
+    // from now on an open resumes the reshard
+    env->CreateDir(sharding_def_dir);
+    if (auto status = rocksdb::WriteStringToFile(env, new_sharding,
+						 online_reshard_file, true);
+	!status.ok()) {
+      derr << __func__ << " cannot write to " << online_reshard_file << dendl;
+      return -EIO;
+    }
+  }
+  for (const auto& [prefix, target] : r->target) {
+    r->submitted[prefix] = 0;
+  }
+  set_resharding();
+  {
+    std::unique_lock l{reshard_lock};
+    ceph_assert(!online_reshard);
+    for (auto h : r->created) {
+      cf_ids_to_prefix.emplace(h->GetID(), h->GetName().substr(0, h->GetName().find('-')));
+    }
+    // no transaction is around yet when we resume
+    r->active = resume;
+    std::atomic_store(&online_reshard, r);
+    last_online_reshard = r;
+  }
+  started = true;
+  if (!read_only) {
+    online_ctrl = ctrl;
+    reshard_thread.create("rstore_reshard");
+  }
+  return 0;
+}
+
+RocksDBStore::ReshardGuard::ReshardGuard(RocksDBStore& db)
+  : l{db.reshard_lock, std::defer_lock}
+{
+  static thread_local unsigned shard =
+    std::hash<std::thread::id>{}(std::this_thread::get_id()) % NUM_READER_SHARDS;
+  // count ourselves before looking, set_resharding() does it the other way
+  // round: either it waits for us, or we see the reshard
+  auto s = &db.unlocked_readers[shard].active;
+  s->fetch_add(1);
+  if (!db.resharding) {
+    slot = s;
+    return;
+  }
+  s->fetch_sub(1);
+  l.lock();
+}
+
+void RocksDBStore::set_resharding()
+{
+  resharding = true;
+  for (auto& readers : unlocked_readers) {
+    while (readers.active > 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void RocksDBStore::reshard_thread_entry()
+{
+  auto r = std::atomic_load(&online_reshard);
+  ceph_assert(r);
+  dout(1) << __func__ << " resharding " << r->target.size()
+	  << " prefixes to '" << r->sharding_text << "'" << dendl;
+  {
+    // a key that a transaction writes to its old shard only must not be
+    // moved before that transaction is submitted
+    std::unique_lock l{reshard_thread_lock};
+    auto last_report = ceph::mono_clock::now();
+    while (!r->stop && untracked_txns > 0) {
+      reshard_cond.wait_for(l, std::chrono::milliseconds(100));
+      if (ceph::mono_clock::now() - last_report > std::chrono::seconds(30)) {
+	dout(1) << __func__ << " waiting for " << untracked_txns
+		<< " transactions" << dendl;
+	last_report = ceph::mono_clock::now();
+      }
+    }
+  }
+  {
+    std::unique_lock l{reshard_lock};
+    r->active = true;
+  }
+
+  for (const auto& [prefix, target] : r->target) {
+    // only we switch cf_handles
+    const auto sources = cf_handles.at(prefix).handles;
+    for (auto source : sources) {
+      std::string from;  // the first key of the next batch
+      bool done = false;
+      while (!done) {
+	if (r->stop) {
+	  dout(1) << __func__ << " stopped, moved " << r->moved << " keys"
+		  << dendl;
+	  return;
+	}
+	size_t keys = 0, bytes = 0, scanned = 0;
+	std::string next;
+	rocksdb::WriteBatch bat;
+	auto scan = [&] {
+	  keys = bytes = scanned = 0;
+	  done = false;
+	  bat.Clear();
+	  std::unique_ptr<rocksdb::Iterator> it{
+	    db->NewIterator(rocksdb::ReadOptions(), source)};
+	  for (from.empty() ? it->SeekToFirst() : it->Seek(from); ; it->Next()) {
+	    if (!it->Valid()) {
+	      ceph_assert(it->status().ok());
+	      done = true;
+	      break;
+	    }
+	    if (keys >= online_ctrl.keys_per_batch ||
+		bytes >= online_ctrl.bytes_per_batch ||
+		scanned >= online_ctrl.keys_per_iterator) {
+	      next = it->key().ToString();
+	      break;
+	    }
+	    ++scanned;
+	    rocksdb::Slice key = it->key();
+	    auto to = get_shard(target, key.data(), key.size());
+	    if (to == source) {
+	      continue;
+	    }
+	    bat.Put(to, key, it->value());
+	    bat.Delete(source, key);
+	    ++keys;
+	    bytes += key.size() * 2 + it->value().size();
+	  }
+	};
+	{
+	  // scan without blocking the transactions. one that is submitted
+	  // with ops on this prefix meanwhile may have written a key we are
+	  // about to move, so the batch is only good if none was. those
+	  // count themselves after their write and under reshard_lock, and
+	  // our iterator sees the writes that were counted before it.
+	  auto& submitted = r->submitted.at(prefix);
+	  int tries = 0;
+	  std::unique_lock l{reshard_lock, std::defer_lock};
+	  while (true) {
+	    uint64_t seen = submitted;
+	    scan();
+	    l.lock();
+	    if (submitted == seen) {
+	      break;
+	    }
+	    if (++tries >= 3) {
+	      // busy prefix: scan again under the lock
+	      scan();
+	      break;
+	    }
+	    l.unlock();
+	  }
+	  r->current = prefix;
+	  if (keys > 0) {
+	    rocksdb::WriteOptions woptions;
+	    woptions.disableWAL = disableWAL;
+	    rocksdb::Status s = db->Write(woptions, &bat);
+	    ceph_assert(s.ok());
+	  }
+	}
+	if (!done) {
+	  from = std::move(next);
+	}
+	r->moved += keys;
+	logger->inc(l_rocksdb_reshard_moved, keys);
+	dout(20) << __func__ << " " << prefix << " moved " << keys << " of "
+		 << scanned << " keys, " << bytes << " bytes" << dendl;
+	if (online_ctrl.unittest_stop_online_after_first_batch) {
+	  return;
+	}
+	if (!done && online_ctrl.batch_interval > 0) {
+	  std::unique_lock l{reshard_thread_lock};
+	  reshard_cond.wait_for(l, ceph::make_timespan(online_ctrl.batch_interval),
+				[&] { return r->stop.load(); });
+	}
+      }
+    }
+  }
+  finish_online_reshard(*r);
+}
+
+int RocksDBStore::finish_online_reshard(OnlineReshard& r)
+{
+  dout(1) << __func__ << " moved " << r.moved << " keys, switching to '"
+	  << r.sharding_text << "'" << dendl;
+  std::vector<rocksdb::ColumnFamilyHandle*> retired;
+  {
+    std::unique_lock l{reshard_lock};
+    for (const auto& [prefix, target] : r.target) {
+      auto& shards = cf_handles.at(prefix);
+      for (auto h : shards.handles) {
+	if (std::find(target.handles.begin(), target.handles.end(), h) ==
+	    target.handles.end()) {
+	  retired.push_back(h);
+	}
+      }
+      shards = target;
+    }
+    // part of cf_handles now
+    r.created.clear();
+    std::atomic_store(&online_reshard, std::shared_ptr<OnlineReshard>());
+  }
+  resharding = false;
+  // until this is stored, an open resumes the reshard, finding nothing to move
+  env->CreateDir(sharding_def_dir);
+  int ret = 0;
+  if (auto status = rocksdb::WriteStringToFile(env, r.sharding_text,
+					       sharding_def_file, true);
+      !status.ok()) {
+    derr << __func__ << " cannot write to " << sharding_def_file << dendl;
+    ret = -EIO;
+  }
+  for (auto h : ret == 0 ? retired : std::vector<rocksdb::ColumnFamilyHandle*>()) {
+    std::unique_ptr<rocksdb::Iterator> it{
+      db->NewIterator(rocksdb::ReadOptions(), h)};
+    it->SeekToFirst();
+    ceph_assert(!it->Valid());
+    dout(5) << __func__ << " dropping column " << h->GetName() << dendl;
+    if (auto status = db->DropColumnFamily(h); !status.ok()) {
+      derr << __func__ << " failed to drop column " << h->GetName() << dendl;
+      ret = -EIO;
+    }
+  }
+  {
+    // iterators may still use them
+    std::lock_guard l{reshard_thread_lock};
+    retired_cfs.insert(retired_cfs.end(), retired.begin(), retired.end());
+  }
+  if (ret == 0) {
+    env->DeleteFile(online_reshard_file);
+  }
+  return ret;
+}
+
+void RocksDBStore::stop_online_reshard()
+{
+  if (!reshard_thread.is_started()) {
+    return;
+  }
+  {
+    std::lock_guard l{reshard_thread_lock};
+    if (auto r = std::atomic_load(&online_reshard); r) {
+      r->stop = true;
+    }
+    reshard_cond.notify_all();
+  }
+  reshard_thread.join();
+}
+
+int RocksDBStore::cleanup_online_reshard(bool read_only)
+{
+  // the new sharding is stored, what is left of the old one is empty
+  for (auto& [name, h] : online_reshard_cfs) {
+    if (read_only) {
+      retired_cfs.push_back(h);
+      continue;
+    }
+    std::unique_ptr<rocksdb::Iterator> it{
+      db->NewIterator(rocksdb::ReadOptions(), h)};
+    it->SeekToFirst();
+    if (it->Valid()) {
+      derr << __func__ << " column " << name << " is not part of the sharding, "
+	   << "but not empty" << dendl;
+      return -EIO;
+    }
+    dout(5) << __func__ << " dropping column " << name << dendl;
+    if (auto status = db->DropColumnFamily(h); !status.ok()) {
+      derr << __func__ << " failed to drop column " << name << dendl;
+      return -EIO;
+    }
+    retired_cfs.push_back(h);
+  }
+  online_reshard_cfs.clear();
+  if (!read_only) {
+    env->DeleteFile(online_reshard_file);
+  }
+  return 0;
+}
+
+const RocksDBStore::prefix_shards* RocksDBStore::get_reshard_target(
+  const std::string& prefix) const
+{
+  if (!online_reshard) {
+    return nullptr;
+  }
+  auto p = online_reshard->target.find(prefix);
+  return p == online_reshard->target.end() ? nullptr : &p->second;
+}
+
+rocksdb::Status RocksDBStore::get_resharded(const std::string& prefix,
+					    const prefix_shards& target,
+					    const rocksdb::Slice& key,
+					    rocksdb::PinnableSlice* value)
+{
+  // keys only move from their old shard to the new one, so looking in this
+  // order finds a key that a transaction moves meanwhile
+  auto from = get_cf_handle(prefix, key.data(), key.size());
+  auto s = db->Get(rocksdb::ReadOptions(), from, key, value);
+  if (s.IsNotFound()) {
+    if (auto to = get_shard(target, key.data(), key.size()); to != from) {
+      value->Reset();
+      s = db->Get(rocksdb::ReadOptions(), to, key, value);
+    }
+  }
+  return s;
+}
+
+bool RocksDBStore::is_resharding_online()
+{
+  return std::atomic_load(&online_reshard) != nullptr;
+}
+
+void RocksDBStore::dump_reshard_status(Formatter *f)
+{
+  std::string sharding;
+  get_sharding(sharding);
+  f->dump_string("sharding", sharding);
+  std::shared_lock l{reshard_lock};
+  f->dump_bool("in_progress", online_reshard != nullptr);
+  if (online_reshard) {
+    f->dump_string("target", online_reshard->sharding_text);
+    f->dump_bool("moving", online_reshard->active);
+    f->dump_string("current", online_reshard->current);
+    f->dump_unsigned("keys_moved", online_reshard->moved);
+    f->open_array_section("prefixes");
+    for (const auto& [prefix, target] : online_reshard->target) {
+      f->dump_string("prefix", prefix);
+    }
+    f->close_section();
+  }
+}
+
 bool RocksDBStore::get_sharding(std::string& sharding) {
   rocksdb::Status status;
   std::string stored_sharding_text;
@@ -6,7 +6,10 @@
 #include "include/types.h"
 #include "include/buffer_fwd.h"
 #include "KeyValueDB.h"
+#include <array>
+#include <atomic>
 #include <set>
+#include <shared_mutex>
 #include <map>
 #include <string>
 #include <memory>
@@ -43,6 +46,10 @@ enum {
   l_rocksdb_write_memtable_time,
   l_rocksdb_write_delay_time,
   l_rocksdb_write_pre_and_post_process_time,
+  l_rocksdb_point_tombstones,
+  l_rocksdb_range_tombstones,
+  l_rocksdb_tombstone_compact,
+  l_rocksdb_reshard_moved,
   l_rocksdb_last,
 };
 
@@ -122,6 +129,8 @@ private:
   bool is_column_family(const std::string& prefix);
   rocksdb::ColumnFamilyHandle *get_cf_handle(const std::string& prefix, const std::string& key);
   rocksdb::ColumnFamilyHandle *get_cf_handle(const std::string& prefix, const char* key, size_t keylen);
+  static rocksdb::ColumnFamilyHandle *get_shard(const prefix_shards& shards,
+						const char* key, size_t keylen);
 
   int submit_common(rocksdb::WriteOptions& woptions, KeyValueDB::Transaction t);
   int install_cf_mergeop(const std::string &cf_name, rocksdb::ColumnFamilyOptions *cf_opt);
@@ -149,17 +158,46 @@ private:
 		      std::vector<rocksdb::ColumnFamilyDescriptor>& existing_cfs,
 		      std::vector<std::pair<size_t, RocksDBStore::ColumnFamily> >& existing_cfs_shard,
 		      std::vector<rocksdb::ColumnFamilyDescriptor>& missing_cfs,
-		      std::vector<std::pair<size_t, RocksDBStore::ColumnFamily> >& missing_cfs_shard);
-  std::shared_ptr<rocksdb::Cache> create_block_cache(const std::string& cache_type, size_t cache_size, double cache_prio_high = 0.0);
+		      std::vector<std::pair<size_t, RocksDBStore::ColumnFamily> >& missing_cfs_shard,
+		      std::vector<rocksdb::ColumnFamilyDescriptor>& online_reshard_cfs);
+  std::shared_ptr<rocksdb::Cache> create_block_cache(const std::string& cache_type, size_t cache_size, double cache_prio_high = 0.0,
+						     const std::string& name = "default");
   int extract_block_cache_options(const std::string& opts_str,
 				  std::unordered_map<std::string, std::string>* column_opts_map,
 				  std::string* block_cache_opt);
+  /// options of a column family that an online reshard creates
+  int get_online_cf_options(const std::vector<ColumnFamily>& sharding_def,
+			    const std::string& cf_name,
+			    rocksdb::ColumnFamilyOptions* cf_opt);
   // manage async compactions
   ceph::mutex compact_queue_lock =
     ceph::make_mutex("RocksDBStore::compact_thread_lock");
   ceph::condition_variable compact_queue_cond;
   std::list<std::pair<std::string,std::string>> compact_queue;
   bool compact_queue_stop;
+
+  /// a key range removed by a transaction
+  struct RangeRemoval {
+    std::string cf;          ///< column family name
+    std::string start, end;  ///< prefixed keys, as for compact_range_async()
+    uint64_t point_deletes;
+    bool range;              ///< removed with DeleteRange
+  };
+  /// tombstones written to a column family since we last compacted them away
+  struct TombstoneStats {
+    uint64_t pending = 0;
+    uint64_t point = 0;   ///< point tombstones, ever
+    uint64_t range = 0;   ///< range tombstones, ever
+    uint64_t compactions = 0;
+    std::vector<std::pair<std::string,std::string>> ranges; ///< the pending ones
+  };
+  ceph::mutex tombstone_lock =
+    ceph::make_mutex("RocksDBStore::tombstone_lock");
+  std::map<std::string, TombstoneStats> tombstone_stats;  ///< by column family
+  /// account for the removals of a committed transaction, and queue the
+  /// compaction of the ranges of a column family once it has too many tombstones
+  void note_removals(const std::vector<RangeRemoval>& removals);
+
   class CompactThread : public Thread {
     RocksDBStore *db;
   public:
@@ -173,6 +211,100 @@ private:
 
   void compact_thread_entry();
 
+  /**
+   * an online reshard in progress
+   *
+   * Only the prefixes that are column families both before and after get
+   * resharded online. A key of such a prefix is in its old shard until the
+   * reshard thread (or a transaction that writes it) moves it to the new one.
+   * Readers therefore look in the old shard first, and in the new one after.
+   */
+  struct OnlineReshard {
+    std::string sharding_text;  ///< the target sharding definition
+    std::map<std::string, prefix_shards> target;  ///< the resharded prefixes
+    /// old and new shards of each resharded prefix, for the iterators
+    std::map<std::string, std::vector<rocksdb::ColumnFamilyHandle*>> all_shards;
+    /// the column families that are not part of the old sharding
+    std::vector<rocksdb::ColumnFamilyHandle*> created;
+    /// writes go to the new shards and the keys are being moved; set once
+    /// no transaction that writes to the old shards only is left
+    bool active = false;           ///< protected by reshard_lock
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> moved = 0;
+    std::string current;           ///< the prefix being moved
+    /// transactions submitted with ops on each resharded prefix; a batch
+    /// that was scanned while this changed may carry stale values
+    std::map<std::string, std::atomic<uint64_t>> submitted;
+  };
+  /// ops on resharded prefixes; reshard_lock orders their submission with
+  /// the switch to the new shards and with the reshard thread's batches
+  ceph::shared_mutex reshard_lock =
+    ceph::make_shared_mutex("RocksDBStore::reshard_lock");
+  /// set while an online reshard is in progress; only then do readers take
+  /// reshard_lock
+  std::atomic<bool> resharding = false;
+
+  static constexpr unsigned NUM_READER_SHARDS = 16;
+  /// readers that did not take reshard_lock, spread to keep them off each
+  /// other's cache lines
+  struct alignas(64) ReaderShard {
+    std::atomic<int64_t> active = 0;
+  };
+  std::array<ReaderShard, NUM_READER_SHARDS> unlocked_readers;
+
+  /// shares reshard_lock with the reshard, if one is in progress
+  class ReshardGuard {
+    std::atomic<int64_t>* slot = nullptr;
+    std::shared_lock<ceph::shared_mutex> l;
+  public:
+    explicit ReshardGuard(RocksDBStore& db);
+    ~ReshardGuard() {
+      if (slot) {
+	slot->fetch_sub(1);
+      }
+    }
+  };
+  /// make the readers take reshard_lock, once those that do not are done
+  void set_resharding();
+  std::shared_ptr<OnlineReshard> online_reshard;
+  /// to refuse a new reshard while transactions of the last one are around
+  std::weak_ptr<OnlineReshard> last_online_reshard;
+  /// transactions created without an online reshard in progress
+  std::atomic<int64_t> untracked_txns = 0;
+  /// the column families of an interrupted online reshard, found on open
+  std::map<std::string, rocksdb::ColumnFamilyHandle*> online_reshard_cfs;
+  /// dropped by an online reshard, the handles go away on close
+  std::vector<rocksdb::ColumnFamilyHandle*> retired_cfs;
+  ceph::mutex reshard_thread_lock =
+    ceph::make_mutex("RocksDBStore::reshard_thread_lock");
+  ceph::condition_variable reshard_cond;
+
+  class ReshardThread : public Thread {
+    RocksDBStore *db;
+  public:
+    explicit ReshardThread(RocksDBStore *d) : db(d) {}
+    void *entry() override {
+      db->reshard_thread_entry();
+      return NULL;
+    }
+  } reshard_thread;
+
+  void reshard_thread_entry();
+  int finish_online_reshard(OnlineReshard& r);
+  void stop_online_reshard();
+  /// drop the column families an interrupted online reshard left behind
+  int cleanup_online_reshard(bool read_only);
+  /// the target of a prefix being resharded online, under reshard_lock
+  const prefix_shards* get_reshard_target(const std::string& prefix) const;
+  /// read a key of a prefix that is being resharded online
+  rocksdb::Status get_resharded(const std::string& prefix,
+				const prefix_shards& target,
+				const rocksdb::Slice& key,
+				rocksdb::PinnableSlice* value);
+
+  class SocketHook;
+  SocketHook* asok_hook = nullptr;
+
   void compact_range(const std::string& start, const std::string& end);
   void compact_range_async(const std::string& start, const std::string& end);
   int tryInterpret(const std::string& key, const std::string& val,
@@ -183,6 +315,10 @@ public:
   bool compact_on_mount;
   bool disableWAL;
   const uint64_t delete_range_threshold;
+  /// skip the iteration and always use DeleteRange for range removals
+  const bool delete_range_always;
+  /// tombstones in a column family that trigger a compaction, 0 to disable
+  const uint64_t tombstone_compact_threshold;
   void compact() override;
 
   void compact_async() override {
@@ -226,9 +362,12 @@ public:
     dbstats(NULL),
     compact_queue_stop(false),
     compact_thread(this),
+    reshard_thread(this),
     compact_on_mount(false),
     disableWAL(false),
-    delete_range_threshold(cct->_conf.get_val<uint64_t>("rocksdb_delete_range_threshold"))
+    delete_range_threshold(cct->_conf.get_val<uint64_t>("rocksdb_delete_range_threshold")),
+    delete_range_always(cct->_conf.get_val<std::string>("rocksdb_delete_range_mode") == "always"),
+    tombstone_compact_threshold(cct->_conf.get_val<uint64_t>("rocksdb_tombstone_compact_threshold"))
   {}
 
   ~RocksDBStore() override;
@@ -268,14 +407,51 @@ public:
   public:
     rocksdb::WriteBatch bat;
     RocksDBStore *db;
+    std::vector<RangeRemoval> removals;
 
     explicit RocksDBTransactionImpl(RocksDBStore *_db);
+    ~RocksDBTransactionImpl() override;
   private:
+    /// an op on a prefix that is being resharded online
+    struct ReshardOp {
+      enum op_t { SET, RMKEY, MERGE, RM_RANGE } op;
+      std::string prefix;
+      std::string key;  ///< or the start of the range
+      std::string end;  ///< of the range
+      ceph::bufferlist bl;
+    };
+    /// the online reshard in progress when we were created
+    std::shared_ptr<OnlineReshard> reshard;
+    /// where the ops go depends on whether the keys are moved already, so
+    /// they are added to the batch on submission
+    std::vector<ReshardOp> reshard_ops;
+    bool reshard_merges = false;
+    bool untracked = false;
+
+    bool defer_op(ReshardOp::op_t op,
+		  const std::string &prefix,
+		  const std::string &k,
+		  const std::string &end = std::string(),
+		  const ceph::bufferlist *bl = nullptr);
+    /// add the deferred ops to the batch, under reshard_lock
+    void apply_reshard_ops(const OnlineReshard* r);
+    friend class RocksDBStore;
+
     void put_bat(
       rocksdb::WriteBatch& bat,
       rocksdb::ColumnFamilyHandle *cf,
       const std::string &k,
       const ceph::bufferlist &to_set_bl);
+    void merge_bat(
+      rocksdb::ColumnFamilyHandle *cf,
+      const std::string &k,
+      const ceph::bufferlist &to_set_bl);
+    /// delete [start, end) of cf, key by key or with a DeleteRange
+    void delete_range(
+      rocksdb::ColumnFamilyHandle *cf,
+      const std::string &start,
+      const std::string &end,
+      RangeRemoval *removal);
   public:
     void set(
       const std::string &prefix,
@@ -488,6 +664,11 @@ err:
       get_priority_cache(string prefix) const override {
     auto it = cf_bbt_opts.find(prefix);
     if (it != cf_bbt_opts.end()) {
+      // a partition is balanced by the cache it is carved out of
+      if (auto binned = dynamic_pointer_cast<rocksdb_cache::BinnedLRUCache>(
+            it->second.block_cache); binned && binned->is_partition()) {
+	return nullptr;
+      }
       return dynamic_pointer_cast<PriorityCache::PriCache>(
           it->second.block_cache);
     }
@@ -511,11 +692,36 @@ public:
     size_t keys_per_iterator =  10000;
     size_t bytes_per_batch =    1000000;  /// amount of data before submitting batch
     size_t keys_per_batch =     1000;
+    double batch_interval =     0;        /// online: seconds to wait between batches
     bool   unittest_fail_after_first_batch = false;
     bool   unittest_fail_after_processing_column = false;
     bool   unittest_fail_after_successful_processing = false;
+    bool   unittest_stop_online_after_first_batch = false;
   };
   int reshard(const std::string& new_sharding, const resharding_ctrl* ctrl = nullptr);
+  /**
+   * reshard while the store is in use
+   *
+   * Moves the keys to their new column family in the background, in batches,
+   * and switches to the new sharding once they are all moved. An interrupted
+   * online reshard is resumed on open. Only prefixes that have column
+   * families of their own before and after can be resharded online.
+   *
+   * @return 0 once the reshard is started, -EBUSY if one is in progress,
+   *         -EOPNOTSUPP if a prefix moves from or to the default column family
+   */
+  int reshard_online(const std::string& new_sharding,
+		     const resharding_ctrl* ctrl = nullptr);
+  bool is_resharding_online();
+  void dump_reshard_status(ceph::Formatter *f);
+private:
+  resharding_ctrl online_ctrl;  ///< of the online reshard in progress
+  /// @param resume: of an online reshard interrupted before we opened
+  int start_online_reshard(const std::string& new_sharding,
+			   const resharding_ctrl& ctrl,
+			   bool resume,
+			   bool read_only);
+public:
   bool get_sharding(std::string& sharding);
 
 };
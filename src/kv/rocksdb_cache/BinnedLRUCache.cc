@@ -17,6 +17,8 @@
 #include <stdlib.h>
 #include <string>
 
+#include "common/perf_counters.h"
+
 #define dout_context cct
 #define dout_subsys ceph_subsys_rocksdb
 #undef dout_prefix
@@ -284,10 +286,23 @@ rocksdb::Cache::Handle* BinnedLRUCacheShard::Lookup(const rocksdb::Slice& key, u
     }
     e->refs++;
     e->SetHit();
+    hits_++;
+  } else {
+    misses_++;
   }
   return reinterpret_cast<rocksdb::Cache::Handle*>(e);
 }
 
+uint64_t BinnedLRUCacheShard::GetHits() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return hits_;
+}
+
+uint64_t BinnedLRUCacheShard::GetMisses() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return misses_;
+}
+
 bool BinnedLRUCacheShard::Ref(rocksdb::Cache::Handle* h) {
   BinnedLRUHandle* handle = reinterpret_cast<BinnedLRUHandle*>(h);
   std::lock_guard<std::mutex> l(mutex_);
@@ -468,8 +483,10 @@ BinnedLRUCache::BinnedLRUCache(CephContext *c,
                                size_t capacity, 
                                int num_shard_bits,
                                bool strict_capacity_limit, 
-                               double high_pri_pool_ratio)
-    : ShardedCache(capacity, num_shard_bits, strict_capacity_limit), cct(c) {
+                               double high_pri_pool_ratio,
+                               const std::string& name)
+    : ShardedCache(capacity, num_shard_bits, strict_capacity_limit), cct(c),
+      name_(name), committed_bytes_(capacity) {
   num_shards_ = 1 << num_shard_bits;
   // TODO: Switch over to use mempool
   int rc = posix_memalign((void**) &shards_, 
@@ -483,9 +500,23 @@ BinnedLRUCache::BinnedLRUCache(CephContext *c,
     new (&shards_[i])
         BinnedLRUCacheShard(c, per_shard, strict_capacity_limit, high_pri_pool_ratio);
   }
+
+  PerfCountersBuilder plb(cct, "rocksdb_cache_" + name_,
+                          l_rocksdb_cache_first, l_rocksdb_cache_last);
+  plb.add_u64_counter(l_rocksdb_cache_hit, "hit", "Block cache hits");
+  plb.add_u64_counter(l_rocksdb_cache_miss, "miss", "Block cache misses");
+  plb.add_u64(l_rocksdb_cache_capacity, "capacity", "Block cache capacity",
+              NULL, 0, unit_t(UNIT_BYTES));
+  plb.add_u64(l_rocksdb_cache_usage, "usage", "Block cache usage",
+              NULL, 0, unit_t(UNIT_BYTES));
+  logger = plb.create_perf_counters();
+  cct->get_perfcounters_collection()->add(logger);
+  logger->set(l_rocksdb_cache_capacity, capacity);
 }
 
 BinnedLRUCache::~BinnedLRUCache() {
+  cct->get_perfcounters_collection()->remove(logger);
+  delete logger;
   for (int i = 0; i < num_shards_; i++) {
     shards_[i].~BinnedLRUCacheShard();
   }
@@ -531,6 +562,10 @@ void BinnedLRUCache::SetHighPriPoolRatio(double high_pri_pool_ratio) {
   for (int i = 0; i < num_shards_; i++) {
     shards_[i].SetHighPriPoolRatio(high_pri_pool_ratio);
   }
+  std::lock_guard<std::mutex> l(partitions_mutex_);
+  for (auto& p : partitions_) {
+    p->SetHighPriPoolRatio(high_pri_pool_ratio);
+  }
 }
 
 double BinnedLRUCache::GetHighPriPoolRatio() const {
@@ -550,25 +585,168 @@ size_t BinnedLRUCache::GetHighPriPoolUsage() const {
   return usage;
 }
 
+uint64_t BinnedLRUCache::get_hits() const {
+  uint64_t hits = 0;
+  for (int s = 0; s < num_shards_; s++) {
+    hits += shards_[s].GetHits();
+  }
+  return hits;
+}
+
+uint64_t BinnedLRUCache::get_misses() const {
+  uint64_t misses = 0;
+  for (int s = 0; s < num_shards_; s++) {
+    misses += shards_[s].GetMisses();
+  }
+  return misses;
+}
+
+// Partitions
+
+std::shared_ptr<BinnedLRUCache> BinnedLRUCache::create_partition(
+    const std::string& name,
+    double min_ratio,
+    double max_ratio) {
+  ceph_assert(!is_partition_);
+  ceph_assert(0.0 <= min_ratio && min_ratio <= max_ratio && max_ratio <= 1.0);
+  auto partition = std::make_shared<BinnedLRUCache>(
+      cct, 0, GetNumShardBits(), HasStrictCapacityLimit(),
+      GetHighPriPoolRatio(), name);
+  partition->is_partition_ = true;
+  partition->min_ratio_ = min_ratio;
+  partition->max_ratio_ = max_ratio;
+  {
+    std::lock_guard<std::mutex> l(partitions_mutex_);
+    partitions_.push_back(partition);
+  }
+  ldout(cct, 5) << __func__ << " " << name << " min " << min_ratio
+                << " max " << max_ratio << dendl;
+  balance_partitions(committed_bytes_);
+  return partition;
+}
+
+std::vector<uint64_t> BinnedLRUCache::split_capacity(
+    uint64_t total,
+    const std::vector<double>& weights,
+    const std::vector<std::pair<double, double>>& ratios) {
+  const size_t n = weights.size();
+  ceph_assert(ratios.size() == n);
+  double min_sum = 0;
+  for (auto& r : ratios) {
+    min_sum += r.first;
+  }
+  // the minimums may add up to more than the whole cache
+  double scale = min_sum > 1.0 ? 1.0 / min_sum : 1.0;
+  std::vector<double> alloc(n);
+  std::vector<bool> full(n);
+  double left = total;
+  for (size_t i = 0; i < n; i++) {
+    alloc[i] = ratios[i].first * scale * total;
+    left -= alloc[i];
+    full[i] = alloc[i] >= ratios[i].second * total;
+  }
+  // hand out what is left by weight. whoever hits its max drops out of the
+  // next round, so this takes at most n + 1 rounds.
+  while (left >= 1.0) {
+    double weight_sum = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (!full[i]) {
+        weight_sum += weights[i];
+      }
+    }
+    if (weight_sum <= 0) {
+      break;
+    }
+    double given = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (full[i]) {
+        continue;
+      }
+      double add = left * weights[i] / weight_sum;
+      double room = ratios[i].second * total - alloc[i];
+      if (add >= room) {
+        add = room;
+        full[i] = true;
+      }
+      alloc[i] += add;
+      given += add;
+    }
+    left -= given;
+  }
+  std::vector<uint64_t> result(n);
+  for (size_t i = 0; i < n; i++) {
+    result[i] = alloc[i];
+  }
+  return result;
+}
+
+void BinnedLRUCache::balance_partitions(uint64_t total) {
+  std::vector<BinnedLRUCache*> caches;
+  std::vector<double> weights;
+  std::vector<std::pair<double, double>> ratios;
+  std::lock_guard<std::mutex> l(partitions_mutex_);
+  caches.push_back(this);
+  for (auto& p : partitions_) {
+    caches.push_back(p.get());
+  }
+  for (auto c : caches) {
+    // hit rate feedback: a moving average of the hits since the last round.
+    // everyone gets a share of what is not reserved, so that an idle
+    // partition can still earn its first hits.
+    uint64_t hits = c->get_hits();
+    c->hits_avg_ = (c->hits_avg_ + (hits - c->last_hits_)) / 2;
+    c->last_hits_ = hits;
+    weights.push_back(c->hits_avg_ + 1.0);
+    ratios.emplace_back(c->min_ratio_, c->max_ratio_);
+  }
+  auto sizes = split_capacity(total, weights, ratios);
+  for (size_t i = 0; i < caches.size(); i++) {
+    ldout(cct, 10) << __func__ << " " << caches[i]->get_name()
+                   << " hits " << caches[i]->hits_avg_
+                   << " capacity " << sizes[i] << dendl;
+    caches[i]->ShardedCache::SetCapacity(sizes[i]);
+    caches[i]->committed_bytes_ = sizes[i];
+    caches[i]->update_perf_counters();
+  }
+  // we always answer for the whole of it
+  committed_bytes_ = total;
+}
+
+void BinnedLRUCache::update_perf_counters() {
+  logger->set(l_rocksdb_cache_hit, get_hits());
+  logger->set(l_rocksdb_cache_miss, get_misses());
+  logger->set(l_rocksdb_cache_capacity, GetCapacity());
+  logger->set(l_rocksdb_cache_usage, GetUsage());
+}
+
 // PriCache
 
 int64_t BinnedLRUCache::request_cache_bytes(PriorityCache::Priority pri, uint64_t total_cache) const
 {
   int64_t assigned = get_cache_bytes(pri);
   int64_t request = 0;
+  int64_t high_pri_usage = GetHighPriPoolUsage();
+  int64_t usage = GetUsage();
+  {
+    std::lock_guard<std::mutex> l(partitions_mutex_);
+    for (auto& p : partitions_) {
+      high_pri_usage += p->GetHighPriPoolUsage();
+      usage += p->GetUsage();
+    }
+  }
 
   switch (pri) {
   // PRI0 is for rocksdb's high priority items (indexes/filters)
   case PriorityCache::Priority::PRI0:
     {
-      request = GetHighPriPoolUsage();
+      request = high_pri_usage;
       break;
     }
   // All other cache items are currently shoved into the PRI1 priority. 
   case PriorityCache::Priority::PRI1:
     {
-      request = GetUsage();
-      request -= GetHighPriPoolUsage();
+      request = usage;
+      request -= high_pri_usage;
       break;
     }
   default:
@@ -582,12 +760,12 @@ int64_t BinnedLRUCache::request_cache_bytes(PriorityCache::Priority pri, uint64_
 
 int64_t BinnedLRUCache::commit_cache_size(uint64_t total_bytes)
 {
-  size_t old_bytes = GetCapacity();
+  size_t old_bytes = committed_bytes_;
   int64_t new_bytes = PriorityCache::get_chunk(
       get_cache_bytes(), total_bytes);
   ldout(cct, 10) << __func__ << " old: " << old_bytes
                  << " new: " << new_bytes << dendl;
-  SetCapacity((size_t) new_bytes);
+  balance_partitions(new_bytes);
 
   double ratio = 0;
   if (new_bytes > 0) {
@@ -606,7 +784,8 @@ std::shared_ptr<rocksdb::Cache> NewBinnedLRUCache(
     size_t capacity,
     int num_shard_bits,
     bool strict_capacity_limit,
-    double high_pri_pool_ratio) {
+    double high_pri_pool_ratio,
+    const std::string& name) {
   if (num_shard_bits >= 20) {
     return nullptr;  // the cache cannot be sharded into too many fine pieces
   }
@@ -618,7 +797,8 @@ std::shared_ptr<rocksdb::Cache> NewBinnedLRUCache(
     num_shard_bits = GetDefaultCacheShardBits(capacity);
   }
   return std::make_shared<BinnedLRUCache>(
-      c, capacity, num_shard_bits, strict_capacity_limit, high_pri_pool_ratio);
+      c, capacity, num_shard_bits, strict_capacity_limit, high_pri_pool_ratio,
+      name);
 }
 
 }  // namespace rocksdb_cache
@@ -12,6 +12,7 @@
 
 #include <string>
 #include <mutex>
+#include <vector>
 
 #include "ShardedCache.h"
 #include "common/autovector.h"
@@ -19,6 +20,15 @@
 #include "include/ceph_assert.h"
 #include "common/ceph_context.h"
 
+enum {
+  l_rocksdb_cache_first = 34400,
+  l_rocksdb_cache_hit,
+  l_rocksdb_cache_miss,
+  l_rocksdb_cache_capacity,
+  l_rocksdb_cache_usage,
+  l_rocksdb_cache_last,
+};
+
 namespace rocksdb_cache {
 
 // LRU cache implementation
@@ -52,7 +62,8 @@ std::shared_ptr<rocksdb::Cache> NewBinnedLRUCache(
     size_t capacity,
     int num_shard_bits = -1,
     bool strict_capacity_limit = false,
-    double high_pri_pool_ratio = 0.0);
+    double high_pri_pool_ratio = 0.0,
+    const std::string& name = "default");
 
 struct BinnedLRUHandle {
   void* value;
@@ -224,6 +235,10 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
   // Retrieves high pri pool usage
   size_t GetHighPriPoolUsage() const;
 
+  // Lookups which found / did not find their entry
+  uint64_t GetHits() const;
+  uint64_t GetMisses() const;
+
  private:
   CephContext *cct;
   void LRU_Remove(BinnedLRUHandle* e);
@@ -286,6 +301,11 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
   // Memory size for entries residing only in the LRU list
   size_t lru_usage_;
 
+  // Lookup outcomes, counted here rather than in the cache's PerfCounters
+  // so that a lookup does not touch a cache line shared by all the shards
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+
   // mutex_ protects the following state.
   // We don't count mutex_ as the cache's internal state so semantically we
   // don't mind mutex_ invoking the non-const actions.
@@ -295,7 +315,8 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
 class BinnedLRUCache : public ShardedCache {
  public:
   BinnedLRUCache(CephContext *c, size_t capacity, int num_shard_bits,
-      bool strict_capacity_limit, double high_pri_pool_ratio);
+      bool strict_capacity_limit, double high_pri_pool_ratio,
+      const std::string& name = "default");
   virtual ~BinnedLRUCache();
   virtual const char* Name() const override { return "BinnedLRUCache"; }
   virtual CacheShard* GetShard(int shard) override;
@@ -304,31 +325,77 @@ class BinnedLRUCache : public ShardedCache {
   virtual size_t GetCharge(Handle* handle) const override;
   virtual uint32_t GetHash(Handle* handle) const override;
   virtual void DisownData() override;
-
   //  Retrieves number of elements in LRU, for unit test purpose only
   size_t TEST_GetLRUSize();
-  // Sets the high pri pool ratio
+  // Sets the high pri pool ratio, of this cache and of its partitions
   void SetHighPriPoolRatio(double high_pri_pool_ratio);
   //  Retrieves high pri pool ratio
   double GetHighPriPoolRatio() const;
   // Retrieves high pri pool usage
   size_t GetHighPriPoolUsage() const;
 
+  // Partitions
+  //
+  // A partition is a cache of its own (e.g. for the blocks of a column
+  // family), so that it does not compete with the others in a single LRU.
+  // But its capacity is carved out of this cache's: whenever the
+  // PriorityCache balancer commits a new size, it is split between this
+  // cache and its partitions according to their recent hits, while
+  // respecting the min/max ratio of each partition.
+  std::shared_ptr<BinnedLRUCache> create_partition(const std::string& name,
+                                                   double min_ratio,
+                                                   double max_ratio);
+  bool is_partition() const {
+    return is_partition_;
+  }
+  const std::string& get_name() const {
+    return name_;
+  }
+  uint64_t get_hits() const;
+  uint64_t get_misses() const;
+
+  /**
+   * split total bytes among caches, in proportion to their weights but
+   * within their [min, max] ratio of total
+   */
+  static std::vector<uint64_t> split_capacity(
+      uint64_t total,
+      const std::vector<double>& weights,
+      const std::vector<std::pair<double, double>>& ratios);
+
   // PriorityCache
   virtual int64_t request_cache_bytes(
       PriorityCache::Priority pri, uint64_t total_cache) const;
   virtual int64_t commit_cache_size(uint64_t total_cache);
   virtual int64_t get_committed_size() const {
-    return GetCapacity();
+    return committed_bytes_;
   }
   virtual std::string get_cache_name() const {
     return "RocksDB Binned LRU Cache";
   }
 
  private:
+  // split committed bytes between this cache and its partitions
+  void balance_partitions(uint64_t total);
+  /// also sums up the hits and misses of the shards, once per tuning round
+  void update_perf_counters();
+
   CephContext *cct;
   BinnedLRUCacheShard* shards_;
   int num_shards_ = 0;
+
+  const std::string name_;
+  PerfCounters *logger = nullptr;
+  std::atomic<int64_t> committed_bytes_;
+
+  mutable std::mutex partitions_mutex_;
+  std::vector<std::shared_ptr<BinnedLRUCache>> partitions_;
+  // the following are protected by the parent's partitions_mutex_
+  bool is_partition_ = false;
+  double min_ratio_ = 0.0;
+  double max_ratio_ = 1.0;
+  uint64_t last_hits_ = 0;
+  double hits_avg_ = 0.0;
 };
 
 }  // namespace rocksdb_cache
@@ -0,0 +1,275 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "BinaryLog.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "include/ceph_assert.h"
+
+#include "LogClock.h"
+
+namespace ceph {
+namespace logging {
+
+ThreadLogRing::ThreadLogRing(std::size_t size)
+  : size(size),
+    buf(new char[size])
+{
+  ceph_assert(size && (size & (size - 1)) == 0);
+}
+
+void ThreadLogRing::copy_in(uint64_t pos, const char* p, std::size_t n)
+{
+  std::size_t off = pos & (size - 1);
+  std::size_t first = std::min(n, size - off);
+  memcpy(buf.get() + off, p, first);
+  memcpy(buf.get(), p + first, n - first);
+}
+
+void ThreadLogRing::copy_out(uint64_t pos, char* p, std::size_t n) const
+{
+  std::size_t off = pos & (size - 1);
+  std::size_t first = std::min(n, size - off);
+  memcpy(p, buf.get() + off, first);
+  memcpy(p + first, buf.get(), n - first);
+}
+
+bool ThreadLogRing::try_write(const binary_record_t& r, std::string_view text)
+{
+  ceph_assert(r.len == text.size());
+  uint64_t h = head.load(std::memory_order_relaxed);
+  std::size_t need = sizeof(r) + text.size();
+  if (size - (h - tail.load(std::memory_order_acquire)) < need) {
+    return false;
+  }
+  copy_in(h, reinterpret_cast<const char*>(&r), sizeof(r));
+  copy_in(h + sizeof(r), text.data(), text.size());
+  // publish the record
+  head.store(h + need, std::memory_order_release);
+  return true;
+}
+
+bool ThreadLogRing::read(binary_record_t* r, std::string* text)
+{
+  uint64_t t = tail.load(std::memory_order_relaxed);
+  if (head.load(std::memory_order_acquire) == t) {
+    return false;
+  }
+  copy_out(t, reinterpret_cast<char*>(r), sizeof(*r));
+  text->resize(r->len);
+  copy_out(t + sizeof(*r), text->data(), r->len);
+  // hand the room back to the producer
+  tail.store(t + sizeof(*r) + r->len, std::memory_order_release);
+  return true;
+}
+
+namespace {
+struct BinaryFormats {
+  static constexpr unsigned MAX = 1 << 16;
+  std::mutex lock;
+  unsigned num = 1;  ///< 0 is no format
+  const char* formats[MAX] = {};
+};
+
+BinaryFormats& binary_formats()
+{
+  static BinaryFormats formats;
+  return formats;
+}
+}
+
+uint16_t register_binary_format(const char* fmt)
+{
+  auto& bf = binary_formats();
+  std::lock_guard l(bf.lock);
+  for (unsigned i = 1; i < bf.num; i++) {
+    if (strcmp(bf.formats[i], fmt) == 0) {
+      return i;
+    }
+  }
+  ceph_assert(bf.num < BinaryFormats::MAX);
+  bf.formats[bf.num] = fmt;
+  return bf.num++;
+}
+
+const char* get_binary_format(uint16_t id)
+{
+  const char* fmt = binary_formats().formats[id];
+  return fmt ? fmt : "";
+}
+
+void BinaryArgs::append(std::string_view s)
+{
+  if (full || len + 1 + sizeof(uint32_t) >= MAX) {
+    full = true;
+    return;
+  }
+  uint32_t n = std::min(s.size(), MAX - len - 1 - sizeof(n));
+  buf[len++] = TAG_STR;
+  memcpy(buf + len, &n, sizeof(n));
+  len += sizeof(n);
+  memcpy(buf + len, s.data(), n);
+  len += n;
+  full = n < s.size();
+}
+
+/// render the next of @p args, @return false if there is none left
+static bool render_binary_arg(std::string_view* args, std::string* out)
+{
+  auto take = [args](auto* v) {
+    if (args->size() < sizeof(*v)) {
+      return false;
+    }
+    memcpy(v, args->data(), sizeof(*v));
+    args->remove_prefix(sizeof(*v));
+    return true;
+  };
+  char tag;
+  if (!take(&tag)) {
+    return false;
+  }
+  auto o = std::back_inserter(*out);
+  switch (tag) {
+  case BinaryArgs::TAG_BOOL:
+    if (uint8_t v; take(&v)) {
+      out->append(v ? "true" : "false");
+      return true;
+    }
+    break;
+  case BinaryArgs::TAG_INT:
+    if (int64_t v; take(&v)) {
+      fmt::format_to(o, "{}", v);
+      return true;
+    }
+    break;
+  case BinaryArgs::TAG_UINT:
+    if (uint64_t v; take(&v)) {
+      fmt::format_to(o, "{}", v);
+      return true;
+    }
+    break;
+  case BinaryArgs::TAG_DOUBLE:
+    if (double v; take(&v)) {
+      fmt::format_to(o, "{}", v);
+      return true;
+    }
+    break;
+  case BinaryArgs::TAG_PTR:
+    if (uint64_t v; take(&v)) {
+      fmt::format_to(o, "{:#x}", v);
+      return true;
+    }
+    break;
+  case BinaryArgs::TAG_STR:
+    if (uint32_t n; take(&n) && n <= args->size()) {
+      out->append(args->substr(0, n));
+      args->remove_prefix(n);
+      return true;
+    }
+    break;
+  }
+  // garbled, drop the rest
+  *args = std::string_view();
+  return false;
+}
+
+void render_binary_args(std::string_view fmt, std::string_view args,
+			std::string* out)
+{
+  for (std::size_t i = 0; i < fmt.size(); i++) {
+    char c = fmt[i];
+    char next = i + 1 < fmt.size() ? fmt[i + 1] : '\0';
+    if ((c == '{' || c == '}') && next == c) {
+      // escaped
+      out->push_back(c);
+      i++;
+    } else if (c == '{' && next == '}') {
+      if (!render_binary_arg(&args, out)) {
+	out->append("{?}");
+      }
+      i++;
+    } else {
+      out->push_back(c);
+    }
+  }
+}
+
+void render_binary_record(const binary_record_t& r, std::string_view fmt,
+			  std::string_view text, std::string* out)
+{
+  if (r.format != binary_record_t::FORMAT_ENTRY &&
+      r.format != binary_record_t::FORMAT_ARGS) {
+    out->append(text);
+    return;
+  }
+  char prefix[128];
+  int used = 0;
+  if (r.flags & binary_record_t::FLAG_CRASH) {
+    used += snprintf(prefix, sizeof(prefix), "%6ld> ", (long)r.crash_index);
+  }
+  log_time stamp{log_clock::duration(
+    _logclock::taggedrep(r.stamp, r.flags & binary_record_t::FLAG_COARSE))};
+  used += append_time(stamp, prefix + used, sizeof(prefix) - used);
+  used += snprintf(prefix + used, sizeof(prefix) - used, " %lx %2d ",
+		   (unsigned long)r.thread, (int)r.prio);
+  out->append(prefix, used);
+  if (r.format == binary_record_t::FORMAT_ARGS) {
+    render_binary_args(fmt, text, out);
+  } else {
+    out->append(text);
+  }
+}
+
+int decode_binary_log(std::istream& in, std::ostream& out)
+{
+  std::string magic(BINARY_LOG_MAGIC.size(), '\0');
+  if (!in.read(magic.data(), magic.size()) || magic != BINARY_LOG_MAGIC) {
+    return -EINVAL;
+  }
+  binary_record_t r;
+  std::string text, line;
+  std::vector<std::string> formats;
+  while (in.read(reinterpret_cast<char*>(&r), sizeof(r))) {
+    if (r.format < binary_record_t::FORMAT_ENTRY ||
+	r.format > binary_record_t::FORMAT_DEFINE) {
+      return -EINVAL;
+    }
+    text.resize(r.len);
+    if (!in.read(text.data(), r.len)) {
+      // torn by a crash; keep what we have
+      break;
+    }
+    if (r.format == binary_record_t::FORMAT_DEFINE) {
+      if (formats.size() <= r.fmt_id) {
+	formats.resize(r.fmt_id + 1);
+      }
+      formats[r.fmt_id] = text;
+      continue;
+    }
+    std::string_view fmt;
+    if (r.format == binary_record_t::FORMAT_ARGS) {
+      if (r.fmt_id >= formats.size()) {
+	return -EINVAL;
+      }
+      fmt = formats[r.fmt_id];
+    }
+    line.clear();
+    render_binary_record(r, fmt, text, &line);
+    line.push_back('\n');
+    out << line;
+  }
+  return 0;
+}
+
+}
+}
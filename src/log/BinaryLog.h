@@ -0,0 +1,214 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LOG_BINARYLOG_H
+#define CEPH_LOG_BINARYLOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "common/StackStringStream.h"
+
+namespace ceph {
+namespace logging {
+
+/**
+ * The binary log format
+ *
+ * With log_binary, the log file holds records instead of text lines: the
+ * time stamp, thread and priority are stored raw and only rendered by the
+ * decoder (ceph-log-decode).  The file starts with BINARY_LOG_MAGIC, and
+ * each record is a binary_record_t followed by its len bytes of text.
+ *
+ * The entries logged with lsubdout_args() and friends are records of
+ * their format id and arguments; they are only rendered when someone
+ * reads them.  The file defines each format before its first use.
+ */
+static constexpr std::string_view BINARY_LOG_MAGIC = "ceph binary log v1\n";
+
+struct binary_record_t {
+  enum : uint8_t {
+    FORMAT_ENTRY = 1,   ///< "[crash index> ]stamp thread prio text"
+    FORMAT_MESSAGE = 2, ///< "text", as the dump_recent() banners
+    FORMAT_ARGS = 3,    ///< as FORMAT_ENTRY, with the text rendered from
+			///< the format fmt_id and the BinaryArgs following
+    FORMAT_DEFINE = 4,  ///< the text is the format fmt_id
+  };
+  enum : uint8_t {
+    FLAG_COARSE = 1,    ///< the stamp came from the coarse clock
+    FLAG_CRASH = 2,     ///< part of a dump of the recent events
+  };
+
+  uint32_t len = 0;     ///< of the text following the record
+  uint8_t format = 0;
+  uint8_t flags = 0;
+  int16_t prio = 0;
+  int16_t subsys = 0;
+  uint16_t fmt_id = 0;  ///< of FORMAT_ARGS and FORMAT_DEFINE
+  int32_t crash_index = 0;
+  uint64_t stamp = 0;   ///< ns since the epoch
+  uint64_t thread = 0;
+};
+static_assert(sizeof(binary_record_t) == 32,
+	      "the binary log format must not depend on the compiler");
+
+/**
+ * ThreadLogRing
+ *
+ * A single producer, single consumer byte ring: the logging thread appends
+ * records, the log's flusher drains them; neither of them takes a lock.
+ * Records may wrap around the end of the buffer.
+ */
+class ThreadLogRing {
+public:
+  explicit ThreadLogRing(std::size_t size);
+  ThreadLogRing(const ThreadLogRing&) = delete;
+  ThreadLogRing& operator=(const ThreadLogRing&) = delete;
+
+  std::size_t capacity() const {
+    return size;
+  }
+  std::size_t used() const {
+    return head.load(std::memory_order_acquire) -
+      tail.load(std::memory_order_acquire);
+  }
+  bool empty() const {
+    return used() == 0;
+  }
+
+  /// producer side: @return false if there is no room for the record
+  bool try_write(const binary_record_t& r, std::string_view text);
+  /// consumer side: @return false if the ring is empty
+  bool read(binary_record_t* r, std::string* text);
+
+  /// the producing thread is gone, the ring goes once drained
+  std::atomic<bool> orphaned = {false};
+  /// the consuming log is gone, the producer should forget the ring
+  std::atomic<bool> detached = {false};
+
+private:
+  const std::size_t size;  ///< a power of 2
+  std::unique_ptr<char[]> buf;
+  alignas(64) std::atomic<uint64_t> head = {0};  ///< written by the producer
+  alignas(64) std::atomic<uint64_t> tail = {0};  ///< written by the consumer
+
+  void copy_in(uint64_t pos, const char* p, std::size_t n);
+  void copy_out(uint64_t pos, char* p, std::size_t n) const;
+};
+
+/// @return the id of the format @p fmt, which must stay valid for good,
+/// e.g. a literal; its "{}"s stand for the arguments in turn
+uint16_t register_binary_format(const char* fmt);
+const char* get_binary_format(uint16_t id);
+
+/**
+ * BinaryArgs
+ *
+ * The arguments of a FORMAT_ARGS record, each a tag and its raw value,
+ * built on the stack of the logging thread.  Only the types without a
+ * raw form are rendered right away, as the stream interface would.  A
+ * string which does not fit is cut, the arguments after it are dropped.
+ */
+class BinaryArgs {
+public:
+  static constexpr std::size_t MAX = 1024;
+  enum : char {
+    TAG_BOOL = 'b',
+    TAG_INT = 'i',
+    TAG_UINT = 'u',
+    TAG_DOUBLE = 'd',
+    TAG_PTR = 'p',
+    TAG_STR = 's',
+  };
+
+  void append(bool v) {
+    _append_raw(TAG_BOOL, uint8_t(v));
+  }
+  void append(char c) {
+    append(std::string_view(&c, 1));
+  }
+  void append(const char* s) {
+    append(std::string_view(s ? s : "(null)"));
+  }
+  void append(const std::string& s) {
+    append(std::string_view(s));
+  }
+  void append(std::string_view s);
+  template<typename T>
+  void append(const T& v) {
+    if constexpr (std::is_enum_v<T>) {
+      append(static_cast<std::underlying_type_t<T>>(v));
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+      _append_raw(TAG_INT, int64_t(v));
+    } else if constexpr (std::is_integral_v<T>) {
+      _append_raw(TAG_UINT, uint64_t(v));
+    } else if constexpr (std::is_floating_point_v<T>) {
+      _append_raw(TAG_DOUBLE, double(v));
+    } else if constexpr (std::is_same_v<T, char*>) {
+      append(static_cast<const char*>(v));
+    } else if constexpr (std::is_pointer_v<T>) {
+      _append_raw(TAG_PTR, uint64_t(reinterpret_cast<std::uintptr_t>(v)));
+    } else {
+      CachedStackStringStream css;
+      *css << v;
+      append(css->strv());
+    }
+  }
+
+  std::string_view str() const {
+    return std::string_view(buf, len);
+  }
+
+private:
+  char buf[MAX];
+  std::size_t len = 0;
+  bool full = false;
+
+  template<typename V>
+  void _append_raw(char tag, V v) {
+    if (full || len + 1 + sizeof(v) > MAX) {
+      full = true;
+      return;
+    }
+    buf[len++] = tag;
+    memcpy(buf + len, &v, sizeof(v));
+    len += sizeof(v);
+  }
+};
+
+/// render @p args as the format @p fmt says; the "{}"s left without an
+/// argument come out as "{?}"
+void render_binary_args(std::string_view fmt, std::string_view args,
+			std::string* out);
+
+/// @return the text of an entry logged with its arguments, for the ones
+/// which cannot go to the rings
+template<typename... Args>
+std::string render_args(const char* fmt, const Args&... args)
+{
+  BinaryArgs a;
+  (a.append(args), ...);
+  std::string out;
+  render_binary_args(fmt, a.str(), &out);
+  return out;
+}
+
+/// render the text of a record, as the text log would have it; @p fmt
+/// is the format of a FORMAT_ARGS record
+void render_binary_record(const binary_record_t& r, std::string_view fmt,
+			  std::string_view text, std::string* out);
+
+/// render a binary log file read from @p in into @p out
+/// @return 0, or -EINVAL if @p in is not (or no more) a binary log
+int decode_binary_log(std::istream& in, std::ostream& out);
+
+}
+}
+
+#endif
@@ -12,6 +12,7 @@
 
 #include <pthread.h>
 
+#include <cstdint>
 #include <string_view>
 
 namespace ceph {
@@ -28,6 +29,12 @@ public:
     m_prio(pr),
     m_subsys(sub)
   {}
+  Entry(time stamp, pthread_t thread, short pr, short sub) :
+    m_stamp(stamp),
+    m_thread(thread),
+    m_prio(pr),
+    m_subsys(sub)
+  {}
   Entry(const Entry &) = default;
   Entry& operator=(const Entry &) = default;
   Entry(Entry &&e) = default;
@@ -40,6 +47,8 @@ public:
   time m_stamp;
   pthread_t m_thread;
   short m_prio, m_subsys;
+  /// the format of an entry logged with its arguments, or 0
+  uint16_t m_fmt_id = 0;
 
   static log_clock& clock() {
     static log_clock clock;
@@ -82,18 +91,34 @@ public:
     auto strv = e.strv();
     str.reserve(strv.size());
     str.insert(str.end(), strv.begin(), strv.end());
+    // only the text is copied
+    m_fmt_id = 0;
+  }
+  ConcreteEntry(time stamp, pthread_t thread, short pr, short sub,
+		std::string_view s) :
+    Entry(stamp, thread, pr, sub), str(s.begin(), s.end()) {}
+  /// an entry logged with its arguments; its text is empty until
+  /// set_text()
+  ConcreteEntry(time stamp, pthread_t thread, short pr, short sub,
+		uint16_t fmt_id, std::string_view a) :
+    Entry(stamp, thread, pr, sub), args(a.begin(), a.end()) {
+    m_fmt_id = fmt_id;
   }
   ConcreteEntry& operator=(const Entry& e) {
     Entry::operator=(e);
     auto strv = e.strv();
     str.reserve(strv.size());
     str.assign(strv.begin(), strv.end());
+    args.clear();
+    m_fmt_id = 0;
     return *this;
   }
-  ConcreteEntry(ConcreteEntry&& e) : Entry(e), str(std::move(e.str)) {}
+  ConcreteEntry(ConcreteEntry&& e)
+    : Entry(e), str(std::move(e.str)), args(std::move(e.args)) {}
   ConcreteEntry& operator=(ConcreteEntry&& e) {
     Entry::operator=(e);
     str = std::move(e.str);
+    args = std::move(e.args);
     return *this;
   }
   ~ConcreteEntry() override = default;
@@ -105,8 +130,19 @@ public:
     return str.size();
   }
 
+  std::string_view get_args() const {
+    return std::string_view(args.data(), args.size());
+  }
+  bool has_text() const {
+    return !m_fmt_id || !str.empty();
+  }
+  void set_text(std::string_view s) {
+    str.assign(s.begin(), s.end());
+  }
+
 private:
   boost::container::small_vector<char, 1024> str;
+  boost::container::small_vector<char, 64> args;
 };
 
 }
@@ -20,6 +20,7 @@
 #include <fcntl.h>
 #include <syslog.h>
 
+#include <algorithm>
 #include <iostream>
 #include <set>
 
@@ -32,6 +33,64 @@ namespace logging {
 
 static OnExitManager exit_callbacks;
 
+namespace {
+/// the rings of the calling thread, one per log it wrote to
+struct ThreadRings {
+  std::vector<std::pair<uint64_t, std::shared_ptr<ThreadLogRing>>> rings;
+  ~ThreadRings();
+};
+thread_local ThreadRings thread_rings;
+thread_local bool thread_rings_gone = false;
+
+ThreadRings::~ThreadRings()
+{
+  thread_rings_gone = true;
+  for (auto& [id, ring] : rings) {
+    ring->orphaned = true;
+  }
+}
+
+std::atomic<uint64_t> next_log_id = {1};
+}
+
+template<typename T>
+static uint64_t tid_to_int(T tid)
+{
+  if constexpr (std::is_pointer_v<T>) {
+    return reinterpret_cast<std::uintptr_t>(tid);
+  } else {
+    return tid;
+  }
+}
+
+template<typename T>
+static T int_to_tid(uint64_t i)
+{
+  if constexpr (std::is_pointer_v<T>) {
+    return reinterpret_cast<T>(static_cast<std::uintptr_t>(i));
+  } else {
+    return static_cast<T>(i);
+  }
+}
+
+static binary_record_t make_record(Entry::time when, pthread_t thread,
+				   short prio, short subsys,
+				   uint16_t fmt_id, std::string_view payload)
+{
+  binary_record_t r;
+  auto stamp = when.time_since_epoch().count();
+  r.len = payload.size();
+  r.format = fmt_id ? binary_record_t::FORMAT_ARGS :
+    binary_record_t::FORMAT_ENTRY;
+  r.flags = stamp.coarse ? binary_record_t::FLAG_COARSE : 0;
+  r.prio = prio;
+  r.subsys = subsys;
+  r.fmt_id = fmt_id;
+  r.stamp = stamp.count;
+  r.thread = tid_to_int(thread);
+  return r;
+}
+
 static void log_on_exit(void *p)
 {
   Log *l = *(Log **)p;
@@ -42,6 +101,7 @@ static void log_on_exit(void *p)
 
 Log::Log(const SubsystemMap *s)
   : m_indirect_this(nullptr),
+    m_id(next_log_id++),
     m_subs(s),
     m_recent(DEFAULT_MAX_RECENT)
 {
@@ -57,6 +117,11 @@ Log::~Log()
   ceph_assert(!is_started());
   if (m_fd >= 0)
     VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+
+  std::scoped_lock lock(m_rings_mutex);
+  for (auto& ring : m_rings) {
+    ring->detached = true;
+  }
 }
 
 
@@ -69,6 +134,12 @@ void Log::set_coarse_timestamps(bool coarse) {
     Entry::clock().refine();
 }
 
+void Log::set_binary(bool binary)
+{
+  std::scoped_lock lock(m_flush_mutex);
+  m_binary = binary;
+}
+
 void Log::set_flush_on_exit()
 {
   std::scoped_lock lock(m_flush_mutex);
@@ -116,14 +187,21 @@ void Log::reopen_log_file()
   if (m_fd >= 0)
     VOID_TEMP_FAILURE_RETRY(::close(m_fd));
   if (m_log_file.length()) {
-    m_fd = ::open(m_log_file.c_str(), O_CREAT|O_WRONLY|O_APPEND|O_CLOEXEC, 0644);
+    // never append records to a text log, or lines to a binary one
+    m_fd_binary = m_binary;
+    m_fmt_defined.clear();
+    std::string fn = m_fd_binary ? m_log_file + ".bin" : m_log_file;
+    m_fd = ::open(fn.c_str(), O_CREAT|O_WRONLY|O_APPEND|O_CLOEXEC, 0644);
     if (m_fd >= 0 && (m_uid || m_gid)) {
       if (::fchown(m_fd, m_uid, m_gid) < 0) {
 	int e = errno;
-	std::cerr << "failed to chown " << m_log_file << ": " << cpp_strerror(e)
+	std::cerr << "failed to chown " << fn << ": " << cpp_strerror(e)
 	     << std::endl;
       }
     }
+    if (m_fd >= 0 && m_fd_binary && ::lseek(m_fd, 0, SEEK_END) == 0) {
+      _log_safe_write(BINARY_LOG_MAGIC);
+    }
   } else {
     m_fd = -1;
   }
@@ -178,8 +256,99 @@ void Log::stop_graylog()
   m_graylog.reset();
 }
 
+ThreadLogRing* Log::_get_thread_ring()
+{
+  if (thread_rings_gone) {
+    return nullptr;
+  }
+  auto& rings = thread_rings.rings;
+  for (auto i = rings.begin(); i != rings.end(); ) {
+    if (i->first == m_id) {
+      return i->second.get();
+    }
+    if (i->second->detached) {
+      i = rings.erase(i);
+    } else {
+      ++i;
+    }
+  }
+  auto ring = std::make_shared<ThreadLogRing>(BINARY_RING_SIZE);
+  {
+    std::scoped_lock lock(m_rings_mutex);
+    m_rings.push_back(ring);
+  }
+  rings.emplace_back(m_id, ring);
+  return ring.get();
+}
+
+bool Log::_write_ring(const binary_record_t& r, std::string_view payload)
+{
+  // only the flusher drains the rings
+  if (!is_started() ||
+      sizeof(binary_record_t) + payload.size() > BINARY_RING_SIZE / 2) {
+    return false;
+  }
+  auto ring = _get_thread_ring();
+  if (!ring) {
+    return false;
+  }
+
+  if (unlikely(m_inject_segv))
+    *(volatile int *)(0) = 0xdead;
+
+  if (likely(ring->try_write(r, payload))) {
+    if (ring->used() > BINARY_RING_SIZE / 2) {
+      m_cond_flusher.notify_one();
+    }
+    return true;
+  }
+
+  // wait for flush to catch up; it drains the rings under the queue lock
+  std::unique_lock lock(m_queue_mutex);
+  m_queue_mutex_holder = pthread_self();
+  bool written = false;
+  ++m_ring_waiters;
+  m_cond_flusher.notify_all();
+  m_cond_loggers.wait(lock, [&] {
+    written = ring->try_write(r, payload);
+    // if we are stopping, force addition through the queue
+    return written || m_stop;
+  });
+  --m_ring_waiters;
+  m_queue_mutex_holder = 0;
+  return written;
+}
+
+bool Log::_submit_binary(const Entry& e)
+{
+  auto text = e.strv();
+  return _write_ring(make_record(e.m_stamp, e.m_thread, e.m_prio, e.m_subsys,
+				 0, text),
+		     text);
+}
+
+void Log::_submit_args(short prio, short sub, uint16_t fmt_id,
+		       std::string_view args)
+{
+  auto stamp = Entry::clock().now();
+  if (m_binary &&
+      _write_ring(make_record(stamp, pthread_self(), prio, sub, fmt_id, args),
+		  args)) {
+    return;
+  }
+  // the queue takes text
+  std::string text;
+  render_binary_args(get_binary_format(fmt_id), args, &text);
+  submit_entry(ConcreteEntry(stamp, pthread_self(), prio, sub, text));
+}
+
 void Log::submit_entry(Entry&& e)
 {
+  // the rings take what fits in them, the locked queue the rest
+  if (m_binary && _submit_binary(e)) {
+    return;
+  }
+
   std::unique_lock lock(m_queue_mutex);
   m_queue_mutex_holder = pthread_self();
 
@@ -208,6 +377,9 @@ void Log::flush()
     m_queue_mutex_holder = pthread_self();
     assert(m_flush.empty());
     m_flush.swap(m_new);
+    // the loggers waiting for room in their rings look for it under the
+    // queue lock
+    _drain_rings(m_flush);
     m_cond_loggers.notify_all();
     m_queue_mutex_holder = 0;
   }
@@ -216,6 +388,63 @@ void Log::flush()
   m_flush_mutex_holder = 0;
 }
 
+void Log::_drain_rings(EntryVector& q)
+{
+  std::scoped_lock lock(m_rings_mutex);
+  const auto n = q.size();
+  binary_record_t r;
+  for (auto i = m_rings.begin(); i != m_rings.end(); ) {
+    auto& ring = *i;
+    // a thread done with its ring wrote all it had before saying so
+    bool orphaned = ring->orphaned;
+    // take what is there now, the rest waits for the next round
+    for (auto avail = ring->used();
+	 avail > 0 && ring->read(&r, &m_ring_text);
+	 avail -= sizeof(r) + r.len) {
+      Entry::time stamp{log_clock::duration(
+	_logclock::taggedrep(r.stamp, r.flags & binary_record_t::FLAG_COARSE))};
+      if (r.format == binary_record_t::FORMAT_ARGS) {
+	// rendered if someone reads it, see _render()
+	q.emplace_back(stamp, int_to_tid<pthread_t>(r.thread),
+		       r.prio, r.subsys, r.fmt_id, m_ring_text);
+      } else {
+	q.emplace_back(stamp, int_to_tid<pthread_t>(r.thread),
+		       r.prio, r.subsys, m_ring_text);
+      }
+    }
+    if (orphaned && ring->empty()) {
+      i = m_rings.erase(i);
+    } else {
+      ++i;
+    }
+  }
+  if (q.size() > n) {
+    // each ring is in order, but they are not among each other
+    std::stable_sort(q.begin(), q.end(), [](const auto& a, const auto& b) {
+      return a.m_stamp < b.m_stamp;
+    });
+  }
+}
+
+void Log::_append_record(const binary_record_t& r, std::string_view text)
+{
+  const std::size_t cur = m_log_buf.size();
+  m_log_buf.resize(cur + sizeof(r) + text.size());
+  memcpy(m_log_buf.data() + cur, &r, sizeof(r));
+  memcpy(m_log_buf.data() + cur + sizeof(r), text.data(), text.size());
+}
+
+std::string_view Log::_render(ConcreteEntry& e)
+{
+  if (!e.has_text()) {
+    m_args_text.clear();
+    render_binary_args(get_binary_format(e.m_fmt_id), e.get_args(),
+		       &m_args_text);
+    e.set_text(m_args_text);
+  }
+  return e.strv();
+}
+
 void Log::_log_safe_write(std::string_view sv)
 {
   if (m_fd < 0)
@@ -253,25 +482,52 @@ void Log::_flush(EntryVector& t, bool crash)
     auto stamp = e.m_stamp;
     auto sub = e.m_subsys;
     auto thread = e.m_thread;
-    auto str = e.strv();
 
     bool should_log = crash || m_subs->get_log_level(sub) >= prio;
     bool do_fd = m_fd >= 0 && should_log;
     bool do_syslog = m_syslog_crash >= prio && should_log;
     bool do_stderr = m_stderr_crash >= prio && should_log;
     bool do_graylog2 = m_graylog_crash >= prio && should_log;
+    long crash_index = crash ? -(--len) : 0;
+
+    if (do_fd && m_fd_binary) {
+      // the time stamp and the rest are rendered by the decoder
+      auto payload = e.m_fmt_id ? e.get_args() : e.strv();
+      if (e.m_fmt_id) {
+	if (m_fmt_defined.size() <= e.m_fmt_id) {
+	  m_fmt_defined.resize(e.m_fmt_id + 1);
+	}
+	if (!m_fmt_defined[e.m_fmt_id]) {
+	  std::string_view fmt = get_binary_format(e.m_fmt_id);
+	  binary_record_t d;
+	  d.len = fmt.size();
+	  d.format = binary_record_t::FORMAT_DEFINE;
+	  d.fmt_id = e.m_fmt_id;
+	  _append_record(d, fmt);
+	  m_fmt_defined[e.m_fmt_id] = true;
+	}
+      }
+      auto r = make_record(stamp, thread, prio, sub, e.m_fmt_id, payload);
+      if (crash) {
+	r.flags |= binary_record_t::FLAG_CRASH;
+	r.crash_index = crash_index;
+      }
+      _append_record(r, payload);
+      do_fd = false;
+    }
 
     if (do_fd || do_syslog || do_stderr) {
+      auto str = _render(e);
       const std::size_t cur = m_log_buf.size();
       std::size_t used = 0;
-      const std::size_t allocated = e.size() + 80;
+      const std::size_t allocated = str.size() + 80;
       m_log_buf.resize(cur + allocated);
 
       char* const start = m_log_buf.data();
       char* pos = start + cur;
 
       if (crash) {
-        used += (std::size_t)snprintf(pos + used, allocated - used, "%6ld> ", -(--len));
+        used += (std::size_t)snprintf(pos + used, allocated - used, "%6ld> ", crash_index);
       }
       used += (std::size_t)append_time(stamp, pos + used, allocated - used);
       used += (std::size_t)snprintf(pos + used, allocated - used, " %lx %2d ", (unsigned long)thread, prio);
@@ -294,15 +550,16 @@ void Log::_flush(EntryVector& t, bool crash)
       if (do_fd) {
         m_log_buf.resize(cur + used);
       } else {
-        m_log_buf.resize(0);
+        m_log_buf.resize(cur);
       }
+    }
 
-      if (m_log_buf.size() > MAX_LOG_BUF) {
-        _flush_logbuf();
-      }
+    if (m_log_buf.size() > MAX_LOG_BUF) {
+      _flush_logbuf();
     }
 
     if (do_graylog2 && m_graylog) {
+      _render(e);
       m_graylog->log_entry(e);
     }
 
@@ -315,7 +572,14 @@ void Log::_flush(EntryVector& t, bool crash)
 
 void Log::_log_message(std::string_view s, bool crash)
 {
-  if (m_fd >= 0) {
+  if (m_fd >= 0 && m_fd_binary) {
+    binary_record_t r;
+    r.len = s.size();
+    r.format = binary_record_t::FORMAT_MESSAGE;
+    r.flags = crash ? binary_record_t::FLAG_CRASH : 0;
+    _append_record(r, s);
+    _flush_logbuf();
+  } else if (m_fd >= 0) {
     std::string b = fmt::format("{}\n", s);
     int r = safe_write(m_fd, b.data(), b.size());
     if (r < 0)
@@ -330,16 +594,6 @@ void Log::_log_message(std::string_view s, bool crash)
   }
 }
 
-template<typename T>
-static uint64_t tid_to_int(T tid)
-{
-  if constexpr (std::is_pointer_v<T>) {
-    return reinterpret_cast<std::uintptr_t>(tid);
-  } else {
-    return tid;
-  }
-}
-
 void Log::dump_recent()
 {
   std::scoped_lock lock1(m_flush_mutex);
@@ -350,6 +604,8 @@ void Log::dump_recent()
     m_queue_mutex_holder = pthread_self();
     assert(m_flush.empty());
     m_flush.swap(m_new);
+    _drain_rings(m_flush);
+    m_cond_loggers.notify_all();
     m_queue_mutex_holder = 0;
   }
 
@@ -427,7 +683,21 @@ void *Log::entry()
     std::unique_lock lock(m_queue_mutex);
     m_queue_mutex_holder = pthread_self();
     while (!m_stop) {
-      if (!m_new.empty()) {
+      if (!m_new.empty() || m_ring_waiters) {
+        m_queue_mutex_holder = 0;
+        lock.unlock();
+        flush();
+        lock.lock();
+        m_queue_mutex_holder = pthread_self();
+        continue;
+      }
+
+      if (m_binary) {
+        // the loggers only wake us up when their ring fills up, or they
+        // wait for room in it
+        m_cond_flusher.wait_for(lock, BINARY_FLUSH_INTERVAL);
+        if (m_stop)
+          break;
         m_queue_mutex_holder = 0;
         lock.unlock();
         flush();
@@ -6,6 +6,8 @@
 
 #include <boost/circular_buffer.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -16,6 +18,7 @@
 #include "common/Thread.h"
 #include "common/likely.h"
 
+#include "log/BinaryLog.h"
 #include "log/Entry.h"
 
 namespace ceph {
@@ -31,9 +34,13 @@ class Log : private Thread
 
   static const std::size_t DEFAULT_MAX_NEW = 100;
   static const std::size_t DEFAULT_MAX_RECENT = 10000;
+  static const std::size_t BINARY_RING_SIZE = 1 << 16;
+  static constexpr std::chrono::milliseconds BINARY_FLUSH_INTERVAL{10};
 
   Log **m_indirect_this;
 
+  const uint64_t m_id;  ///< tells our thread rings from other logs'
+
   const SubsystemMap *m_subs;
 
   std::mutex m_queue_mutex;
@@ -48,8 +55,18 @@ class Log : private Thread
   EntryRing m_recent; ///< recent (less new) entries we've already written at low detail
   EntryVector m_flush; ///< entries to be flushed (here to optimize heap allocations)
 
+  std::atomic<bool> m_binary = {false};
+  std::mutex m_rings_mutex;
+  std::vector<std::shared_ptr<ThreadLogRing>> m_rings; ///< of the threads logging to us
+  std::string m_ring_text;  ///< of the record being drained
+  std::string m_args_text;  ///< of the entry being rendered
+  int m_ring_waiters = 0;  ///< loggers waiting for room in their rings,
+			   ///< protected by m_queue_mutex
+
   std::string m_log_file;
   int m_fd = -1;
+  bool m_fd_binary = false;  ///< m_fd is a binary log
+  std::vector<bool> m_fmt_defined;  ///< the formats m_fd has a definition of
   uid_t m_uid = 0;
   gid_t m_gid = 0;
 
@@ -80,6 +97,15 @@ class Log : private Thread
 
   void _log_message(std::string_view s, bool crash);
 
+  ThreadLogRing* _get_thread_ring();
+  bool _write_ring(const binary_record_t& r, std::string_view payload);
+  bool _submit_binary(const Entry& e);
+  void _submit_args(short prio, short sub, uint16_t fmt_id,
+		    std::string_view args);
+  void _drain_rings(EntryVector& q);
+  void _append_record(const binary_record_t& r, std::string_view text);
+  std::string_view _render(ConcreteEntry& e);
+
 public:
   using Thread::is_started;
 
@@ -89,6 +115,10 @@ public:
   void set_flush_on_exit();
 
   void set_coarse_timestamps(bool coarse);
+  /// queue entries through per-thread rings and write them as binary
+  /// records, once the log is started; the file changes over on the next
+  /// reopen_log_file()
+  void set_binary(bool binary);
   void set_max_new(std::size_t n);
   void set_max_recent(std::size_t n);
   void set_log_file(std::string_view fn);
@@ -110,6 +140,16 @@ public:
   std::shared_ptr<Graylog> graylog() { return m_graylog; }
 
   void submit_entry(Entry&& e);
+  /// log @p args formatted as the format @p fmt_id says, see
+  /// register_binary_format(); with log_binary only the format id and
+  /// the arguments are queued, the text is rendered if someone reads it
+  template<typename... Args>
+  void submit_args(short prio, short sub, uint16_t fmt_id,
+		   const Args&... args) {
+    BinaryArgs a;
+    (a.append(args), ...);
+    _submit_args(prio, sub, fmt_id, a.str());
+  }
 
   void start();
   void stop();
@@ -10,6 +10,10 @@
 #include "global/global_context.h"
 #include "common/dout.h"
 
+#include <fstream>
+#include <sstream>
+#include <thread>
+
 using namespace ceph::logging;
 
 TEST(Log, Simple)
@@ -341,6 +345,155 @@ TEST(Log, Speed_nogather)
   }
 }
 
+TEST(Log, Binary)
+{
+  static const char* test_file = "binary_log";
+  static const std::string bin_file = std::string(test_file) + ".bin";
+  SubsystemMap subs;
+  subs.set_log_level(1, 10);
+  subs.set_gather_level(1, 20);
+  Log log(&subs);
+  log.set_binary(true);
+  log.start();
+  unlink(bin_file.c_str());
+  log.set_log_file(test_file);
+  log.reopen_log_file();
+
+  constexpr int threads = 4, entries = 10000;
+  std::vector<std::thread> ts;
+  for (int t = 0; t < threads; ++t) {
+    ts.emplace_back([&log, t] {
+      for (int i = 0; i < entries; ++i) {
+	MutableEntry e(i % 2 ? 10 : 20, 1);
+	e.get_ostream() << "thread " << t << " entry " << i;
+	log.submit_entry(std::move(e));
+      }
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  {
+    // too large for the rings, it goes through the queue
+    MutableEntry e(10, 1);
+    e.get_ostream() << std::string(100000, 'a');
+    log.submit_entry(std::move(e));
+  }
+  log.flush();
+  log.dump_recent();
+  log.stop();
+
+  std::ifstream in(bin_file, std::ios::binary);
+  ASSERT_TRUE(in);
+  std::stringstream out;
+  ASSERT_EQ(0, decode_binary_log(in, out));
+  int written = 0, dumped = 0, large = 0;
+  bool begin = false, end = false;
+  std::string line;
+  while (std::getline(out, line)) {
+    if (line.find(" entry ") != std::string::npos) {
+      // the crash dump lines start with their index
+      if (line.find("> ") == 6) {
+	++dumped;
+      } else {
+	++written;
+	// only the entries within the log level make it to the file
+	ASSERT_NE(std::string::npos, line.find(" 10 thread "));
+      }
+    } else if (line.find(std::string(100000, 'a')) != std::string::npos) {
+      ++large;
+    } else if (line == "--- begin dump of recent events ---") {
+      begin = true;
+    } else if (line == "--- end dump of recent events ---") {
+      end = true;
+    }
+  }
+  ASSERT_EQ(threads * entries / 2, written);
+  ASSERT_LT(0, dumped);
+  ASSERT_EQ(2, large);
+  ASSERT_TRUE(begin);
+  ASSERT_TRUE(end);
+
+  std::stringstream text("not a binary log\n");
+  ASSERT_EQ(-EINVAL, decode_binary_log(text, out));
+}
+
+struct Point {
+  int x, y;
+};
+
+std::ostream& operator<<(std::ostream& out, const Point& p)
+{
+  return out << "(" << p.x << "," << p.y << ")";
+}
+
+TEST(Log, RenderArgs)
+{
+  int* p = reinterpret_cast<int*>(0x10);
+  ASSERT_EQ("1 -2 3 x str std view true 1.5 0x10 {} {?}",
+	    render_args("{} {} {} {} {} {} {} {} {} {{}} {}",
+			1, short(-2), 3ull, 'x', "str", std::string("std"),
+			std::string_view("view"), true, 1.5, p));
+  // the types without a raw form are rendered right away
+  ASSERT_EQ("(1,2)", render_args("{}", Point{1, 2}));
+  // the strings which do not fit are cut, the rest is dropped
+  std::string large(2 * BinaryArgs::MAX, 'a');
+  auto out = render_args("{}/{}", large, 1);
+  ASSERT_LT(out.size(), BinaryArgs::MAX);
+  ASSERT_EQ("/{?}", out.substr(out.size() - 4));
+  auto a = register_binary_format("test format {}");
+  ASSERT_EQ(a, register_binary_format("test format {}"));
+  ASSERT_STREQ("test format {}", get_binary_format(a));
+}
+
+TEST(Log, BinaryArgs)
+{
+  static const char* test_file = "binary_args_log";
+  static const std::string bin_file = std::string(test_file) + ".bin";
+  SubsystemMap subs;
+  subs.set_log_level(1, 10);
+  subs.set_gather_level(1, 20);
+  Log log(&subs);
+  auto fmt_id = register_binary_format("args {} of {}");
+  log.set_binary(true);
+  unlink(bin_file.c_str());
+  log.set_log_file(test_file);
+  log.reopen_log_file();
+  // not started, the queue takes the rendered text
+  log.submit_args(10, 1, fmt_id, -1, "queue");
+  log.start();
+  constexpr int entries = 1000;
+  for (int i = 0; i < entries; ++i) {
+    log.submit_args(i % 2 ? 10 : 20, 1, fmt_id, i, "ring");
+  }
+  log.flush();
+  log.dump_recent();
+  log.stop();
+
+  std::ifstream in(bin_file, std::ios::binary);
+  ASSERT_TRUE(in);
+  std::stringstream out;
+  ASSERT_EQ(0, decode_binary_log(in, out));
+  int written = 0, dumped = 0, queued = 0;
+  std::string line;
+  while (std::getline(out, line)) {
+    if (line.find(" of ring") != std::string::npos) {
+      if (line.find("> ") == 6) {
+	++dumped;
+      } else {
+	++written;
+	ASSERT_NE(std::string::npos, line.find(" 10 args "));
+      }
+    } else if (line.find("args -1 of queue") != std::string::npos) {
+      ++queued;
+    }
+  }
+  ASSERT_EQ(entries / 2, written);
+  ASSERT_LT(0, dumped);
+  // once written, once dumped
+  ASSERT_EQ(2, queued);
+}
+
 TEST(Log, GarbleRecovery)
 {
   static const char* test_file="log_for_moment";
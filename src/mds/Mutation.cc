@@ -527,8 +527,7 @@ void MDRequestImpl::_dump(Formatter *f) const
   }
   {
     f->open_array_section("events");
-    std::lock_guard l(lock);
-    for (auto& i : events) {
+    for (auto& i : get_events()) {
       f->dump_object("event", i);
     }
     f->close_section(); // events
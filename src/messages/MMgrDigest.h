@@ -23,9 +23,16 @@
  * other than the cluster maps, which are needed by 
  */
 class MMgrDigest final : public Message {
+private:
+  static constexpr int HEAD_VERSION = 2;
+  static constexpr int COMPAT_VERSION = 1;
+
 public:
   ceph::buffer::list mon_status_json;
   ceph::buffer::list health_json;
+  /// seq of the last PGMapDigest the mons committed from MMonMgrReport, or
+  /// 0 if they need a full one
+  uint64_t pg_digest_seq = 0;
 
   std::string_view get_type_name() const override { return "mgrdigest"; }
   void print(std::ostream& out) const override {
@@ -37,16 +44,20 @@ public:
     auto p = payload.cbegin();
     decode(mon_status_json, p);
     decode(health_json, p);
+    if (header.version >= 2) {
+      decode(pg_digest_seq, p);
+    }
   }
   void encode_payload(uint64_t features) override {
     using ceph::encode;
     encode(mon_status_json, payload);
     encode(health_json, payload);
+    encode(pg_digest_seq, payload);
   }
 
 private:
   MMgrDigest() :
-    Message{MSG_MGR_DIGEST} {}
+    Message{MSG_MGR_DIGEST, HEAD_VERSION, COMPAT_VERSION} {}
   ~MMgrDigest() final {}
 
   using RefCountedObject::put;
@@ -23,7 +23,7 @@
 
 class MMonMgrReport final : public PaxosServiceMessage {
 private:
-  static constexpr int HEAD_VERSION = 2;
+  static constexpr int HEAD_VERSION = 3;
   static constexpr int COMPAT_VERSION = 1;
 
 public:
@@ -32,6 +32,15 @@ public:
   ceph::buffer::list service_map_bl;  // encoded ServiceMap
   std::map<std::string,ProgressEvent> progress_events;
 
+  // the data payload is a delta against digest_base_seq, unless that is 0,
+  // in which case it carries the full PGMapDigest.
+  uint64_t digest_seq = 0;
+  uint64_t digest_base_seq = 0;
+
+  bool has_digest_delta() const {
+    return digest_base_seq != 0;
+  }
+
   MMonMgrReport()
     : PaxosServiceMessage{MSG_MON_MGR_REPORT, 0, HEAD_VERSION, COMPAT_VERSION}
   {}
@@ -43,7 +52,14 @@ public:
 
   void print(std::ostream& out) const override {
     out << get_type_name() << "(" << health_checks.checks.size() << " checks, "
-	<< progress_events.size() << " progress events)";
+	<< progress_events.size() << " progress events";
+    if (digest_seq) {
+      out << ", digest " << digest_seq;
+      if (has_digest_delta()) {
+	out << " delta from " << digest_base_seq;
+      }
+    }
+    out << ")";
   }
 
   void encode_payload(uint64_t features) override {
@@ -52,9 +68,12 @@ public:
     encode(health_checks, payload);
     encode(service_map_bl, payload);
     encode(progress_events, payload);
+    encode(digest_seq, payload);
+    encode(digest_base_seq, payload);
 
-    if (!HAVE_FEATURE(features, SERVER_NAUTILUS) ||
-	!HAVE_FEATURE(features, SERVER_MIMIC)) {
+    if (!has_digest_delta() &&
+	(!HAVE_FEATURE(features, SERVER_NAUTILUS) ||
+	 !HAVE_FEATURE(features, SERVER_MIMIC))) {
       // PGMapDigest had a backwards-incompatible change between
       // luminous and mimic, and conditionally encodes based on
       // provided features, so reencode the one in our data payload.
@@ -79,6 +98,10 @@ public:
     if (header.version >= 2) {
       decode(progress_events, p);
     }
+    if (header.version >= 3) {
+      decode(digest_seq, p);
+      decode(digest_base_seq, p);
+    }
   }
 private:
   template<class T, typename... Args>
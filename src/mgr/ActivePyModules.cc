@@ -38,6 +38,21 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "mgr " << __func__ << " "
 
+namespace {
+  // typed arrays are handed to python as bytes, which can be cast() into
+  // a memoryview without copying them again
+  template<typename T>
+  PyObject *as_pybytes(const std::vector<T>& v) {
+    return PyBytes_FromStringAndSize(reinterpret_cast<const char*>(v.data()),
+				     v.size() * sizeof(T));
+  }
+
+  void set_pyitem(PyObject *dict, const char *name, PyObject *value) {
+    PyDict_SetItemString(dict, name, value);
+    Py_DECREF(value);
+  }
+}
+
 ActivePyModules::ActivePyModules(
   PyModuleConfig &module_config_,
   std::map<std::string, std::string> store_data,
@@ -371,6 +386,25 @@ PyObject *ActivePyModules::get_python(const std::string &what)
       pg_map.dump_pg_stats(&f, false);
       return f.get();
     });
+  } else if (what == "pg_stats_columns") {
+    auto pools = cluster_state.get_pg_columns().snapshot();
+    with_gil_t with_gil{no_gil};
+    PyObject *result = PyDict_New();
+    for (const auto& [poolid, columns] : pools) {
+      PyObject *pool = PyDict_New();
+      set_pyitem(pool, "pg_num", PyLong_FromSize_t(columns.size()));
+      set_pyitem(pool, "state", as_pybytes(columns.state));
+      set_pyitem(pool, "reported_epoch", as_pybytes(columns.reported_epoch));
+      set_pyitem(pool, "reported_seq", as_pybytes(columns.reported_seq));
+      set_pyitem(pool, "num_bytes", as_pybytes(columns.num_bytes));
+      set_pyitem(pool, "num_objects", as_pybytes(columns.num_objects));
+      set_pyitem(pool, "acting_primary", as_pybytes(columns.acting_primary));
+      PyObject *key = PyLong_FromLongLong(poolid);
+      PyDict_SetItem(result, key, pool);
+      Py_DECREF(key);
+      Py_DECREF(pool);
+    }
+    return result;
   } else if (what == "pool_stats") {
     return cluster_state.with_pgmap([&](const PGMap &pg_map) {
       with_gil_t with_gil{no_gil};
@@ -946,6 +980,122 @@ PyObject* ActivePyModules::get_perf_schema_python(
   return f.get();
 }
 
+PyObject* ActivePyModules::get_latest_counters_python(
+    const std::string &svc_type,
+    int prio_limit)
+{
+  struct Counters {
+    std::vector<std::string> paths;
+    std::vector<uint8_t> types;
+    std::vector<uint64_t> values;
+    std::vector<uint64_t> counts;
+  };
+  std::map<std::string, Counters> all;
+  {
+    without_gil_t no_gil;
+    std::lock_guard l(lock);
+    auto daemons = svc_type.empty() ? daemon_state.get_all() :
+      daemon_state.get_by_service(svc_type);
+    for (auto& [key, state] : daemons) {
+      std::lock_guard l(state->lock);
+      auto& counters = all[ceph::to_string(key)];
+      const auto& perf_counters = state->perf_counters;
+      for (const auto& [path, instance] : perf_counters.instances) {
+	auto type = perf_counters.types.find(path);
+	if (type == perf_counters.types.end() ||
+	    type->second.priority < prio_limit) {
+	  continue;
+	}
+	uint64_t value = 0, count = 0;
+	if (type->second.type & PERFCOUNTER_LONGRUNAVG) {
+	  if (!instance.get_data_avg().empty()) {
+	    value = instance.get_latest_data_avg().s;
+	    count = instance.get_latest_data_avg().c;
+	  }
+	} else if (!instance.get_data().empty()) {
+	  value = instance.get_latest_data().v;
+	}
+	counters.paths.push_back(path);
+	counters.types.push_back(type->second.type);
+	counters.values.push_back(value);
+	counters.counts.push_back(count);
+      }
+    }
+  }
+
+  // most daemons of a kind share their counter names, so share the strs too
+  std::map<std::string_view, PyObject*> names;
+  PyObject *result = PyDict_New();
+  for (auto& [key, counters] : all) {
+    PyObject *paths = PyTuple_New(counters.paths.size());
+    for (size_t i = 0; i < counters.paths.size(); ++i) {
+      auto [name, inserted] = names.emplace(counters.paths[i], nullptr);
+      if (inserted) {
+	name->second = PyUnicode_FromStringAndSize(counters.paths[i].data(),
+						   counters.paths[i].size());
+      }
+      Py_INCREF(name->second);
+      PyTuple_SET_ITEM(paths, i, name->second);
+    }
+    PyObject *daemon = PyDict_New();
+    set_pyitem(daemon, "paths", paths);
+    set_pyitem(daemon, "type", as_pybytes(counters.types));
+    set_pyitem(daemon, "value", as_pybytes(counters.values));
+    set_pyitem(daemon, "count", as_pybytes(counters.counts));
+    set_pyitem(result, key.c_str(), daemon);
+  }
+  for (auto& [_, name] : names) {
+    Py_DECREF(name);
+  }
+  return result;
+}
+
+PyObject* ActivePyModules::get_counter_series_python(
+    const std::string &svc_type,
+    const std::string &svc_id,
+    const std::string &path)
+{
+  std::vector<double> t;
+  std::vector<uint64_t> v, c;
+  {
+    without_gil_t no_gil;
+    std::lock_guard l(lock);
+    auto state = daemon_state.get(DaemonKey{svc_type, svc_id});
+    if (state) {
+      std::lock_guard l2(state->lock);
+      auto& perf_counters = state->perf_counters;
+      auto instance = perf_counters.instances.find(path);
+      auto type = perf_counters.types.find(path);
+      if (instance != perf_counters.instances.end() &&
+	  type != perf_counters.types.end()) {
+	if (type->second.type & PERFCOUNTER_LONGRUNAVG) {
+	  for (const auto& datapoint : instance->second.get_data_avg()) {
+	    t.push_back(datapoint.t);
+	    v.push_back(datapoint.s);
+	    c.push_back(datapoint.c);
+	  }
+	} else {
+	  for (const auto& datapoint : instance->second.get_data()) {
+	    t.push_back(datapoint.t);
+	    v.push_back(datapoint.v);
+	  }
+	}
+      } else {
+	dout(4) << "Missing counter: '" << path << "' ("
+		<< svc_type << "." << svc_id << ")" << dendl;
+      }
+    } else {
+      dout(4) << "No daemon state for " << svc_type << "." << svc_id << ")"
+	      << dendl;
+    }
+  }
+  PyObject *result = PyDict_New();
+  set_pyitem(result, "t", as_pybytes(t));
+  set_pyitem(result, "v", as_pybytes(v));
+  set_pyitem(result, "c", as_pybytes(c));
+  return result;
+}
+
 PyObject *ActivePyModules::get_context()
 {
   auto l = without_gil([&] {
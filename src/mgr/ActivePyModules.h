@@ -98,6 +98,15 @@ public:
   PyObject *get_perf_schema_python(
      const std::string &svc_type,
      const std::string &svc_id);
+  /// latest value of every counter of every daemon, as typed arrays
+  PyObject *get_latest_counters_python(
+    const std::string &svc_type,
+    int prio_limit);
+  /// the time series of a counter, as typed arrays
+  PyObject *get_counter_series_python(
+    const std::string &svc_type,
+    const std::string &svc_id,
+    const std::string &path);
   PyObject *get_context();
   PyObject *get_osdmap();
   /// @note @c fct is not allowed to acquire locks when holding GIL
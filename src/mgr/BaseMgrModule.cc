@@ -662,6 +662,32 @@ get_perf_schema(BaseMgrModule *self, PyObject *args)
   return self->py_modules->get_perf_schema_python(type_str, svc_id);
 }
 
+static PyObject*
+get_latest_counters(BaseMgrModule *self, PyObject *args)
+{
+  char *svc_type = nullptr;
+  int prio_limit = 0;
+  if (!PyArg_ParseTuple(args, "si:get_latest_counters", &svc_type,
+                                                       &prio_limit)) {
+    return nullptr;
+  }
+  return self->py_modules->get_latest_counters_python(svc_type, prio_limit);
+}
+
+static PyObject*
+get_counter_series(BaseMgrModule *self, PyObject *args)
+{
+  char *svc_type = nullptr;
+  char *svc_id = nullptr;
+  char *counter_path = nullptr;
+  if (!PyArg_ParseTuple(args, "sss:get_counter_series", &svc_type,
+                                                        &svc_id, &counter_path)) {
+    return nullptr;
+  }
+  return self->py_modules->get_counter_series_python(
+      svc_type, svc_id, counter_path);
+}
+
 static PyObject *
 ceph_get_osdmap(BaseMgrModule *self, PyObject *args)
 {
@@ -1437,6 +1463,12 @@ PyMethodDef BaseMgrModule_methods[] = {
   {"_ceph_get_perf_schema", (PyCFunction)get_perf_schema, METH_VARARGS,
     "Get the performance counter schema"},
 
+  {"_ceph_get_latest_counters", (PyCFunction)get_latest_counters, METH_VARARGS,
+    "Get the latest value of all performance counters as arrays"},
+
+  {"_ceph_get_counter_series", (PyCFunction)get_counter_series, METH_VARARGS,
+    "Get a performance counter's time series as arrays"},
+
   {"_ceph_log", (PyCFunction)ceph_log, METH_VARARGS,
    "Emit a (local) log message"},
 
@@ -65,17 +65,23 @@ void ClusterState::load_digest(MMgrDigest *m)
   std::lock_guard l(lock);
   health_json = std::move(m->health_json);
   mon_status_json = std::move(m->mon_status_json);
+  mon_pg_digest_seq = m->pg_digest_seq;
 }
 
 void ClusterState::ingest_pgstats(ref_t<MPGStats> stats)
 {
-  std::lock_guard l(lock);
-
   const int from = stats->get_orig_source().num();
   bool is_in = with_osdmap([from](const OSDMap& osdmap) {
     return osdmap.is_in(from);
   });
 
+  // screen the PGs under the per-pool locks first, so that we only hold
+  // our lock to move the accepted stats into pending_inc
+  std::vector<PGStatColumns::pg_stat_map_t::iterator> accepted;
+  pg_columns.ingest(stats->pg_stat, &accepted);
+
+  std::lock_guard l(lock);
+
   if (is_in) {
     pending_inc.update_stat(from, std::move(stats->osd_stat));
   } else {
@@ -84,43 +90,16 @@ void ClusterState::ingest_pgstats(ref_t<MPGStats> stats)
     pending_inc.update_stat(from, std::move(empty_stat));  
   }
 
-  for (auto p : stats->pg_stat) {
-    pg_t pgid = p.first;
-    const auto &pg_stats = p.second;
-
-    // In case we're hearing about a PG that according to last
-    // OSDMap update should not exist
+  for (auto p : accepted) {
+    const pg_t pgid = p->first;
+    // the osdmap may have changed since we screened the PGs
     auto r = existing_pools.find(pgid.pool());
-    if (r == existing_pools.end()) {
-      dout(15) << " got " << pgid
-	       << " reported at " << pg_stats.reported_epoch << ":"
-               << pg_stats.reported_seq
-               << " state " << pg_state_string(pg_stats.state)
-               << " but pool not in " << existing_pools
-               << dendl;
+    if (r == existing_pools.end() || pgid.ps() >= r->second) {
+      dout(15) << " got " << pgid << " but it is gone from the osdmap"
+	       << dendl;
       continue;
     }
-    if (pgid.ps() >= r->second) {
-      dout(15) << " got " << pgid
-	       << " reported at " << pg_stats.reported_epoch << ":"
-               << pg_stats.reported_seq
-               << " state " << pg_state_string(pg_stats.state)
-               << " but > pg_num " << r->second
-               << dendl;
-      continue;
-    }
-    // In case we already heard about more recent stats from this PG
-    // from another OSD
-    const auto q = pg_map.pg_stat.find(pgid);
-    if (q != pg_map.pg_stat.end() &&
-	q->second.get_version_pair() > pg_stats.get_version_pair()) {
-      dout(15) << " had " << pgid << " from "
-	       << q->second.reported_epoch << ":"
-	       << q->second.reported_seq << dendl;
-      continue;
-    }
-
-    pending_inc.pg_stat_updates[pgid] = pg_stats;
+    pending_inc.pg_stat_updates[pgid] = std::move(p->second);
   }
   for (auto p : stats->pool_stat) {
     pending_inc.pool_statfs_updates[std::make_pair(p.first, from)] = p.second;
@@ -144,6 +123,7 @@ void ClusterState::update_delta_stats()
   jf.flush(*_dout);
   *_dout << dendl;
   pg_map.apply_incremental(g_ceph_context, pending_inc);
+  pg_columns.apply(pending_inc);
   pending_inc = PGMap::Incremental();
 }
 
@@ -163,6 +143,7 @@ void ClusterState::notify_osdmap(const OSDMap &osd_map)
   for (auto& p : osd_map.get_pools()) {
     existing_pools[p.first] = p.second.get_pg_num();
   }
+  pg_columns.set_pools(existing_pools);
 
   // brute force this for now (don't bother being clever by only
   // checking osds that went up/down)
@@ -182,6 +163,7 @@ void ClusterState::notify_osdmap(const OSDMap &osd_map)
   *_dout << dendl;
 
   pg_map.apply_incremental(g_ceph_context, pending_inc);
+  pg_columns.apply(pending_inc);
   pending_inc = PGMap::Incremental();
   // TODO: Complete the separation of PG state handling so
   // that a cut-down set of functionality remains in PGMonitor
@@ -21,6 +21,7 @@
 #include "osdc/Objecter.h"
 #include "mon/MonClient.h"
 #include "mon/PGMap.h"
+#include "mgr/PGStatColumns.h"
 #include "mgr/ServiceMap.h"
 
 class MMgrDigest;
@@ -46,19 +47,29 @@ protected:
   map<int64_t,unsigned> existing_pools; ///< pools that exist, and pg_num, as of PGMap epoch
   PGMap pg_map;
   PGMap::Incremental pending_inc;
+  PGStatColumns pg_columns;  ///< has its own locks
 
   bufferlist health_json;
   bufferlist mon_status_json;
+  uint64_t mon_pg_digest_seq = 0;  ///< last PGMapDigest committed by the mons
 
   class ClusterSocketHook *asok_hook;
 
 public:
 
   void load_digest(MMgrDigest *m);
+  uint64_t get_mon_pg_digest_seq() const {
+    std::lock_guard l(lock);
+    return mon_pg_digest_seq;
+  }
   void ingest_pgstats(ceph::ref_t<MPGStats> stats);
 
   void update_delta_stats();
 
+  const PGStatColumns& get_pg_columns() const {
+    return pg_columns;
+  }
+
   ClusterState(MonClient *monc_, Objecter *objecter_, const MgrMap& mgrmap);
 
   void set_objecter(Objecter *objecter_);
@@ -2527,6 +2527,7 @@ void DaemonServer::send_report()
   auto m = ceph::make_message<MMonMgrReport>();
   py_modules.get_health_checks(&m->health_checks);
   py_modules.get_progress_events(&m->progress_events);
+  const uint64_t mon_digest_seq = cluster_state.get_mon_pg_digest_seq();
 
   cluster_state.with_mutable_pgmap([&](PGMap& pg_map) {
       cluster_state.update_delta_stats();
@@ -2543,10 +2544,29 @@ void DaemonServer::send_report()
       }
 
       cluster_state.with_osdmap([&](const OSDMap& osdmap) {
+	  if (!last_digest_seq) {
+	    // start from the clock, so we never extend another mgr's chain
+	    last_digest_seq = ceph_clock_now().to_nsec();
+	  }
+	  m->digest_seq = ++last_digest_seq;
+	  pg_map.calc_digest(osdmap);
 	  // FIXME: no easy way to get mon features here.  this will do for
 	  // now, though, as long as we don't make a backward-incompat change.
-	  pg_map.encode_digest(osdmap, m->get_data(), CEPH_FEATURES_ALL);
-	  dout(10) << pg_map << dendl;
+	  if (g_conf().get_val<bool>("mgr_pg_digest_delta") &&
+	      full_digest_seq &&
+	      mon_digest_seq >= full_digest_seq &&
+	      mon_digest_seq < m->digest_seq) {
+	    // the mons have our last full digest and are following along
+	    m->digest_base_seq = m->digest_seq - 1;
+	    pg_map.encode_delta(last_digest, m->get_data(), CEPH_FEATURES_ALL);
+	  } else {
+	    pg_map.PGMapDigest::encode(m->get_data(), CEPH_FEATURES_ALL);
+	    full_digest_seq = m->digest_seq;
+	  }
+	  last_digest = pg_map;
+	  dout(10) << pg_map << " digest " << m->digest_seq
+		   << (m->has_digest_delta() ? " (delta)" : "")
+		   << " mon has " << mon_digest_seq << dendl;
 
 	  pg_map.get_health_checks(g_ceph_context, osdmap,
 				   &m->health_checks);
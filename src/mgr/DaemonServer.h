@@ -152,6 +152,11 @@ protected:
 
   epoch_t pending_service_map_dirty = 0;
 
+  // the PGMapDigest we last reported to the mon, to diff the next one against
+  PGMapDigest last_digest;
+  uint64_t last_digest_seq = 0;
+  uint64_t full_digest_seq = 0;  ///< seq of the last full digest we sent
+
   ceph::mutex lock = ceph::make_mutex("DaemonServer");
 
   static void _generate_command_map(cmdmap_t& cmdmap,
@@ -0,0 +1,156 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "mgr/PGStatColumns.h"
+
+#include <shared_mutex>
+
+#include "common/debug.h"
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_mgr
+#undef dout_prefix
+#define dout_prefix *_dout << "mgr " << __func__ << " "
+
+void PGStatColumns::Columns::resize(unsigned pg_num)
+{
+  state.resize(pg_num);
+  reported_epoch.resize(pg_num);
+  reported_seq.resize(pg_num);
+  num_bytes.resize(pg_num);
+  num_objects.resize(pg_num);
+  acting_primary.resize(pg_num, -1);
+}
+
+void PGStatColumns::Columns::set(ps_t ps, const pg_stat_t& s)
+{
+  state[ps] = s.state;
+  reported_epoch[ps] = s.reported_epoch;
+  reported_seq[ps] = s.reported_seq;
+  num_bytes[ps] = s.stats.sum.num_bytes;
+  num_objects[ps] = s.stats.sum.num_objects;
+  acting_primary[ps] = s.acting_primary;
+}
+
+void PGStatColumns::Columns::clear(ps_t ps)
+{
+  state[ps] = 0;
+  reported_epoch[ps] = 0;
+  reported_seq[ps] = 0;
+  num_bytes[ps] = 0;
+  num_objects[ps] = 0;
+  acting_primary[ps] = -1;
+}
+
+void PGStatColumns::set_pools(const std::map<int64_t, unsigned>& pg_nums)
+{
+  std::unique_lock l{lock};
+  for (auto p = pools.begin(); p != pools.end();) {
+    if (pg_nums.count(p->first) == 0) {
+      p = pools.erase(p);
+    } else {
+      ++p;
+    }
+  }
+  for (auto& [poolid, pg_num] : pg_nums) {
+    auto& pool = pools[poolid];
+    if (!pool) {
+      pool = std::make_unique<Pool>();
+    }
+    // no one else can be holding the pool lock while we hold ours
+    pool->columns.resize(pg_num);
+  }
+}
+
+void PGStatColumns::ingest(pg_stat_map_t& stats,
+			   std::vector<pg_stat_map_t::iterator>* accepted)
+{
+  accepted->reserve(stats.size());
+  std::shared_lock l{lock};
+  // the stats are sorted by pool, so we take each pool's lock only once
+  Pool* pool = nullptr;
+  std::unique_lock<ceph::mutex> pool_lock;
+  int64_t last_pool = -1;
+  for (auto i = stats.begin(); i != stats.end(); ++i) {
+    const pg_t& pgid = i->first;
+    const pg_stat_t& s = i->second;
+    if (pgid.pool() != (uint64_t)last_pool || !pool_lock.owns_lock()) {
+      if (pool_lock.owns_lock()) {
+	pool_lock.unlock();
+      }
+      last_pool = pgid.pool();
+      auto p = pools.find(last_pool);
+      pool = p == pools.end() ? nullptr : p->second.get();
+      if (pool) {
+	pool_lock = std::unique_lock{pool->lock};
+      }
+    }
+    if (!pool) {
+      dout(15) << " got " << pgid
+	       << " reported at " << s.reported_epoch << ":"
+	       << s.reported_seq
+	       << " state " << pg_state_string(s.state)
+	       << " but pool not in osdmap" << dendl;
+      continue;
+    }
+    auto& columns = pool->columns;
+    if (pgid.ps() >= columns.size()) {
+      dout(15) << " got " << pgid
+	       << " reported at " << s.reported_epoch << ":"
+	       << s.reported_seq
+	       << " state " << pg_state_string(s.state)
+	       << " but > pg_num " << columns.size() << dendl;
+      continue;
+    }
+    // in case we already heard about more recent stats from this PG
+    // from another OSD
+    if (columns.get_version_pair(pgid.ps()) > s.get_version_pair()) {
+      dout(15) << " had " << pgid << " from "
+	       << columns.reported_epoch[pgid.ps()] << ":"
+	       << columns.reported_seq[pgid.ps()] << dendl;
+      continue;
+    }
+    columns.set(pgid.ps(), s);
+    accepted->push_back(i);
+  }
+}
+
+void PGStatColumns::apply(const PGMap::Incremental& inc)
+{
+  std::shared_lock l{lock};
+  auto with_pg = [this](const pg_t& pgid, auto&& fn) {
+    auto p = pools.find(pgid.pool());
+    if (p == pools.end()) {
+      return;
+    }
+    std::lock_guard pl{p->second->lock};
+    if (pgid.ps() < p->second->columns.size()) {
+      fn(p->second->columns, pgid.ps());
+    }
+  };
+  for (auto& [pgid, s] : inc.pg_stat_updates) {
+    with_pg(pgid, [&s=s](Columns& columns, ps_t ps) {
+      // don't step back behind a report we've already screened but which
+      // is not in a PGMap::Incremental yet
+      if (s.get_version_pair() >= columns.get_version_pair(ps)) {
+	columns.set(ps, s);
+      }
+    });
+  }
+  for (auto& pgid : inc.pg_remove) {
+    with_pg(pgid, [](Columns& columns, ps_t ps) {
+      columns.clear(ps);
+    });
+  }
+}
+
+std::map<int64_t, PGStatColumns::Columns> PGStatColumns::snapshot() const
+{
+  std::map<int64_t, Columns> result;
+  std::shared_lock l{lock};
+  for (auto& [poolid, pool] : pools) {
+    std::lock_guard pl{pool->lock};
+    result.emplace(poolid, pool->columns);
+  }
+  return result;
+}
@@ -0,0 +1,74 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "mon/PGMap.h"
+#include "osd/osd_types.h"
+
+/**
+ * PGStatColumns
+ *
+ * The most used pg_stat_t fields of every PG, stored per pool in arrays
+ * indexed by the PG's seed. Each pool has its own lock. That way MPGStats
+ * from different OSDs can be screened concurrently, and modules can copy
+ * out a pool's columns, without holding ClusterState's lock.
+ */
+class PGStatColumns {
+public:
+  struct Columns {
+    std::vector<uint64_t> state;
+    std::vector<epoch_t> reported_epoch;
+    std::vector<version_t> reported_seq;
+    std::vector<int64_t> num_bytes;
+    std::vector<int64_t> num_objects;
+    std::vector<int32_t> acting_primary;
+
+    size_t size() const {
+      return state.size();
+    }
+    void resize(unsigned pg_num);
+    void set(ps_t ps, const pg_stat_t& s);
+    void clear(ps_t ps);
+    std::pair<epoch_t, version_t> get_version_pair(ps_t ps) const {
+      return {reported_epoch[ps], reported_seq[ps]};
+    }
+  };
+
+  using pg_stat_map_t = std::map<pg_t, pg_stat_t>;
+
+  /// match the pools and their pg_num with the osdmap's
+  void set_pools(const std::map<int64_t, unsigned>& pg_nums);
+
+  /**
+   * record the stats that are more recent than the ones we have
+   *
+   * @param stats the pg stats reported by an OSD
+   * @param accepted [out] the entries of @p stats that were recorded. Skipped
+   *                 entries are stale, or belong to a pool or PG that the
+   *                 osdmap does not know about.
+   */
+  void ingest(pg_stat_map_t& stats,
+	      std::vector<pg_stat_map_t::iterator>* accepted);
+
+  /// follow the updates and removals the mgr applied to its PGMap
+  void apply(const PGMap::Incremental& inc);
+
+  /// copy all pools' columns
+  std::map<int64_t, Columns> snapshot() const;
+
+private:
+  struct Pool {
+    ceph::mutex lock = ceph::make_mutex("PGStatColumns::Pool::lock");
+    Columns columns;
+  };
+
+  mutable ceph::shared_mutex lock =
+    ceph::make_shared_mutex("PGStatColumns::lock");
+  std::map<int64_t, std::unique_ptr<Pool>> pools;
+};
@@ -23,6 +23,7 @@
 #include "OSDMonitor.h"
 #include "ConfigMonitor.h"
 #include "HealthMonitor.h"
+#include "MgrStatMonitor.h"
 
 #include "MgrMonitor.h"
 
@@ -709,6 +710,11 @@ void MgrMonitor::send_digests()
     f.flush(mdigest->mon_status_json);
     f.reset();
 
+    // only invite PGMapDigest deltas once every mon can apply them
+    if (mon.monmap->min_mon_release >= ceph_release_t::quincy) {
+      mdigest->pg_digest_seq = mon.mgrstatmon()->get_digest_seq();
+    }
+
     sub->session->con->send_message2(mdigest);
   }
 
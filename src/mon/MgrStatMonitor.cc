@@ -81,9 +81,14 @@ void MgrStatMonitor::update_from_paxos(bool *need_bootstrap)
       if (!p.end()) {
 	decode(progress_events, p);
       }
+      digest_seq = 0;
+      if (!p.end()) {
+	decode(digest_seq, p);
+      }
       dout(10) << __func__ << " v" << version
 	       << " service_map e" << service_map.epoch
 	       << " " << progress_events.size() << " progress events"
+	       << " digest seq " << digest_seq
 	       << dendl;
     }
     catch (ceph::buffer::error& e) {
@@ -141,6 +146,7 @@ void MgrStatMonitor::create_pending()
 {
   dout(10) << " " << version << dendl;
   pending_digest = digest;
+  pending_digest_seq = digest_seq;
   pending_health_checks = get_health_checks();
   pending_service_map_bl.clear();
   encode(service_map, pending_service_map_bl, mon.get_quorum_con_features());
@@ -155,6 +161,7 @@ void MgrStatMonitor::encode_pending(MonitorDBStore::TransactionRef t)
   ceph_assert(pending_service_map_bl.length());
   bl.append(pending_service_map_bl);
   encode(pending_progress_events, bl);
+  encode(pending_digest_seq, bl);
   put_version(t, version, bl);
   put_last_committed(t, version);
 
@@ -220,7 +227,20 @@ bool MgrStatMonitor::prepare_report(MonOpRequestRef op)
   auto m = op->get_req<MMonMgrReport>();
   bufferlist bl = m->get_data();
   auto p = bl.cbegin();
-  decode(pending_digest, p);
+  if (!m->has_digest_delta()) {
+    decode(pending_digest, p);
+    pending_digest_seq = m->digest_seq;
+  } else if (m->digest_base_seq == pending_digest_seq) {
+    pending_digest.apply_delta(p);
+    pending_digest_seq = m->digest_seq;
+  } else {
+    // we missed (or never had) the digest the mgr diffed against; keep the
+    // current one and let the mgr know it should send a full digest again.
+    dout(10) << __func__ << " ignoring digest delta " << m->digest_base_seq
+	     << ".." << m->digest_seq << ", have " << pending_digest_seq
+	     << dendl;
+    pending_digest_seq = 0;
+  }
   pending_health_checks.swap(m->health_checks);
   if (m->service_map_bl.length()) {
     pending_service_map_bl.swap(m->service_map_bl);
@@ -12,11 +12,13 @@ class MgrStatMonitor : public PaxosService {
   // live version
   version_t version = 0;
   PGMapDigest digest;
+  uint64_t digest_seq = 0;  ///< mgr's seq for digest, 0 if unknown
   ServiceMap service_map;
   std::map<std::string,ProgressEvent> progress_events;
 
   // pending commit
   PGMapDigest pending_digest;
+  uint64_t pending_digest_seq = 0;
   health_check_map_t pending_health_checks;
   std::map<std::string,ProgressEvent> pending_progress_events;
   ceph::buffer::list pending_service_map_bl;
@@ -82,6 +84,9 @@ public:
   const PGMapDigest& get_digest() {
     return digest;
   }
+  uint64_t get_digest_seq() const {
+    return digest_seq;
+  }
 
   ceph_statfs get_statfs(OSDMap& osdmap,
 			 boost::optional<int64_t> data_pool) const {
@@ -104,7 +104,7 @@ private:
   void _dump(ceph::Formatter *f) const override {
     {
       f->open_array_section("events");
-      std::lock_guard l(lock);
+      auto events = get_events();
     for (auto i = events.begin(); i != events.end(); ++i) {
       f->open_object_section("event");
       f->dump_string("event", i->str);
@@ -774,6 +774,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     dout(7) << __func__ << " loading latest full map e" << latest_full << dendl;
     osdmap = OSDMap();
     osdmap.decode(latest_bl);
+    mapping_delta_valid = false;
   }
 
   bufferlist bl;
@@ -812,8 +813,10 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     dout(7) << "update_from_paxos  applying incremental " << osdmap.epoch+1
 	    << dendl;
     OSDMap::Incremental inc(inc_bl);
+    auto prev_crush = osdmap.crush;
     err = osdmap.apply_incremental(inc);
     ceph_assert(err == 0);
+    note_mapping_delta(prev_crush.get(), inc);
 
     if (!t)
       t.reset(new MonitorDBStore::Transaction);
@@ -856,6 +859,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
 
 	osdmap = OSDMap();
 	osdmap.decode(orig_full_bl);
+	mapping_delta_valid = false;
 
 	dout(20) << __func__ << " canonical full osdmap:\n";
 	JSONFormatter jf(true);
@@ -1044,6 +1048,19 @@ int OSDMonitor::_set_cache_ratios()
   return 0;
 }
 
+void OSDMonitor::note_mapping_delta(const CrushWrapper *prev_crush,
+				    const OSDMap::Incremental& inc)
+{
+  if (mapping_delta_valid &&
+      !OSDMapMapping::get_affected_pgs(osdmap, prev_crush, inc,
+				       &mapping_delta_pools,
+				       &mapping_delta_pgs)) {
+    dout(20) << __func__ << " e" << inc.epoch << " requires a full remap"
+	     << dendl;
+    mapping_delta_valid = false;
+  }
+}
+
 void OSDMonitor::start_mapping()
 {
   // initiate mapping job
@@ -1052,17 +1069,36 @@ void OSDMonitor::start_mapping()
 	     << dendl;
     mapping_job->abort();
   }
+  // only remap what changed since the last complete mapping, if we can
+  bool incremental = mapping_delta_valid &&
+    mapping.is_valid() &&
+    mapping.get_epoch() == mapping_delta_from;
   if (!osdmap.get_pools().empty()) {
     auto fin = new C_UpdateCreatingPGs(this, osdmap.get_epoch());
-    mapping_job = mapping.start_update(osdmap, mapper,
-				       g_conf()->mon_osd_mapping_pgs_per_chunk);
-    dout(10) << __func__ << " started mapping job " << mapping_job.get()
-	     << " at " << fin->start << dendl;
+    if (incremental) {
+      mapping_job = mapping.start_update(
+	osdmap, mapper, g_conf()->mon_osd_mapping_pgs_per_chunk,
+	mapping_delta_pools, mapping_delta_pgs);
+      dout(10) << __func__ << " started incremental mapping job "
+	       << mapping_job.get() << " e" << mapping_delta_from << ".."
+	       << osdmap.get_epoch() << " (" << mapping_delta_pools.size()
+	       << " pools, " << mapping_delta_pgs.size() << " pgs) at "
+	       << fin->start << dendl;
+    } else {
+      mapping_job = mapping.start_update(
+	osdmap, mapper, g_conf()->mon_osd_mapping_pgs_per_chunk);
+      dout(10) << __func__ << " started mapping job " << mapping_job.get()
+	       << " at " << fin->start << dendl;
+    }
     mapping_job->set_finish_event(fin);
   } else {
     dout(10) << __func__ << " no pools, no mapping job" << dendl;
     mapping_job = nullptr;
   }
+  mapping_delta_pools.clear();
+  mapping_delta_pgs.clear();
+  mapping_delta_from = osdmap.get_epoch();
+  mapping_delta_valid = true;
 }
 
 void OSDMonitor::update_msgr_features()
@@ -8394,7 +8430,13 @@ int OSDMonitor::prepare_command_pool_set(const cmdmap_t& cmdmap,
 	p.hit_set_params = HitSet::Params(new ExplicitHashHitSet::Params);
       else if (val == "explicit_object")
 	p.hit_set_params = HitSet::Params(new ExplicitObjectHitSet::Params);
-      else {
+      else if (val == "count_min") {
+	if (osdmap.require_osd_release < ceph_release_t::quincy) {
+	  ss << "hit_set_type count_min requires require_osd_release >= quincy";
+	  return -EPERM;
+	}
+	p.hit_set_params = HitSet::Params(new CountMinHitSet::Params);
+      } else {
 	ss << "unrecognized hit_set type '" << val << "'";
 	return -EINVAL;
       }
@@ -13363,6 +13405,14 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
       hsp = HitSet::Params(new ExplicitHashHitSet::Params);
     } else if (cache_hit_set_type == "explicit_object") {
       hsp = HitSet::Params(new ExplicitObjectHitSet::Params);
+    } else if (cache_hit_set_type == "count_min") {
+      if (osdmap.require_osd_release < ceph_release_t::quincy) {
+	ss << "osd tier cache default hit set type 'count_min' requires "
+	   << "require_osd_release >= quincy";
+	err = -EPERM;
+	goto reply;
+      }
+      hsp = HitSet::Params(new CountMinHitSet::Params);
     } else {
       ss << "osd tier cache default hit set type '"
 	 << cache_hit_set_type << "' is not a known type";
@@ -14104,7 +14154,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap mappings for this pool
-  for (auto& p : osdmap.pg_upmap) {
+  for (auto& p : *osdmap.pg_upmap) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap "
@@ -14127,7 +14177,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap_items mappings for this pool
-  for (auto& p : osdmap.pg_upmap_items) {
+  for (auto& p : *osdmap.pg_upmap_items) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap_items " << p.first
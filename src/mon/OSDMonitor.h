@@ -390,6 +390,13 @@ private:
   ParallelPGMapper mapper;                        ///< for background pg work
   OSDMapMapping mapping;                          ///< pg <-> osd mappings
   std::unique_ptr<ParallelPGMapper::Job> mapping_job;  ///< background mapping job
+  /// pools and pgs whose mapping changed since mapping_delta_from
+  std::set<int64_t> mapping_delta_pools;
+  std::set<pg_t> mapping_delta_pgs;
+  epoch_t mapping_delta_from = 0;
+  bool mapping_delta_valid = false;  ///< false if we need a full remap
+  void note_mapping_delta(const CrushWrapper *prev_crush,
+			  const OSDMap::Incremental& inc);
   void start_mapping();
 
   void update_logger();
@@ -95,6 +95,114 @@ void PGMapDigest::decode(bufferlist::const_iterator& p)
   DECODE_FINISH(p);
 }
 
+template<typename Map>
+static void encode_map_delta(const Map& base, const Map& cur,
+			     bufferlist& bl, uint64_t features)
+{
+  Map changed;
+  set<typename Map::key_type> removed;
+  for (auto& [k, v] : cur) {
+    auto i = base.find(k);
+    if (i == base.end() || !(i->second == v)) {
+      changed.emplace(k, v);
+    }
+  }
+  for (auto& i : base) {
+    if (cur.count(i.first) == 0) {
+      removed.insert(i.first);
+    }
+  }
+  encode(changed, bl, features);
+  encode(removed, bl);
+}
+
+template<typename Map>
+static void apply_map_delta(Map& m, bufferlist::const_iterator& p)
+{
+  Map changed;
+  set<typename Map::key_type> removed;
+  decode(changed, p);
+  decode(removed, p);
+  for (auto& k : removed) {
+    m.erase(k);
+  }
+  for (auto& [k, v] : changed) {
+    m[k] = std::move(v);
+  }
+}
+
+void PGMapDigest::encode_delta(const PGMapDigest& base,
+			       bufferlist& bl, uint64_t features) const
+{
+  ENCODE_START(1, 1, bl);
+  encode(num_pg, bl);
+  encode(num_pg_active, bl);
+  encode(num_pg_unknown, bl);
+  encode(num_osd, bl);
+  encode_map_delta(base.pg_pool_sum, pg_pool_sum, bl, features);
+  encode(pg_sum, bl, features);
+  encode(osd_sum, bl, features);
+  encode(num_pg_by_state, bl);
+  encode_map_delta(base.num_pg_by_osd, num_pg_by_osd, bl, features);
+  encode_map_delta(base.num_pg_by_pool, num_pg_by_pool, bl, features);
+  {
+    map<uint32_t,uint64_t> changed;
+    for (uint32_t i = 0; i < osd_last_seq.size(); ++i) {
+      if (i >= base.osd_last_seq.size() ||
+	  base.osd_last_seq[i] != osd_last_seq[i]) {
+	changed[i] = osd_last_seq[i];
+      }
+    }
+    encode((uint32_t)osd_last_seq.size(), bl);
+    encode(changed, bl);
+  }
+  encode_map_delta(base.per_pool_sum_delta, per_pool_sum_delta, bl, features);
+  encode_map_delta(base.per_pool_sum_deltas_stamps, per_pool_sum_deltas_stamps,
+		   bl, features);
+  encode(pg_sum_delta, bl, features);
+  encode(stamp_delta, bl);
+  encode(avail_space_by_rule, bl);
+  encode_map_delta(base.purged_snaps, purged_snaps, bl, features);
+  encode_map_delta(base.osd_sum_by_class, osd_sum_by_class, bl, features);
+  ENCODE_FINISH(bl);
+}
+
+void PGMapDigest::apply_delta(bufferlist::const_iterator& p)
+{
+  DECODE_START(1, p);
+  decode(num_pg, p);
+  decode(num_pg_active, p);
+  decode(num_pg_unknown, p);
+  decode(num_osd, p);
+  apply_map_delta(pg_pool_sum, p);
+  decode(pg_sum, p);
+  decode(osd_sum, p);
+  decode(num_pg_by_state, p);
+  apply_map_delta(num_pg_by_osd, p);
+  apply_map_delta(num_pg_by_pool, p);
+  {
+    uint32_t size;
+    map<uint32_t,uint64_t> changed;
+    decode(size, p);
+    decode(changed, p);
+    osd_last_seq.resize(size);
+    for (auto& [osd, seq] : changed) {
+      if (osd >= size) {
+	throw ceph::buffer::malformed_input("osd_last_seq delta out of range");
+      }
+      osd_last_seq[osd] = seq;
+    }
+  }
+  apply_map_delta(per_pool_sum_delta, p);
+  apply_map_delta(per_pool_sum_deltas_stamps, p);
+  decode(pg_sum_delta, p);
+  decode(stamp_delta, p);
+  decode(avail_space_by_rule, p);
+  apply_map_delta(purged_snaps, p);
+  apply_map_delta(osd_sum_by_class, p);
+  DECODE_FINISH(p);
+}
+
 void PGMapDigest::dump(ceph::Formatter *f) const
 {
   f->dump_unsigned("num_pg", num_pg);
@@ -1135,7 +1243,12 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
     pool_stat_t &pool_sum_ref = pg_pool_sum[update_pool];
     if (pg_stat_iter == pg_stat.end()) {
       pg_stat.insert(make_pair(update_pg, update_stat));
+      purged_snaps_dirty.insert(update_pool);
     } else {
+      if ((pg_stat_iter->second.state == 0) != (update_stat.state == 0) ||
+	  !(pg_stat_iter->second.purged_snaps == update_stat.purged_snaps)) {
+	purged_snaps_dirty.insert(update_pool);
+      }
       stat_pg_sub(update_pg, pg_stat_iter->second);
       pool_sum_ref.sub(pg_stat_iter->second);
       pg_stat_iter->second = update_stat;
@@ -1197,6 +1310,7 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
       }
 
       pg_stat.erase(s);
+      purged_snaps_dirty.insert(removed_pg.pool());
       if (pool_erased) {
         deleted_pools.insert(removed_pg.pool());
       }
@@ -1269,6 +1383,7 @@ void PGMap::calc_stats()
   num_pg_by_state.clear();
   num_pg_by_pool_state.clear();
   num_pg_by_osd.clear();
+  purged_snaps_all_dirty = true;
 
   for (auto p = pg_stat.begin();
        p != pg_stat.end();
@@ -1426,9 +1541,23 @@ bool PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
 
 void PGMap::calc_purged_snaps()
 {
-  purged_snaps.clear();
+  // a pool's purged_snaps is the intersection over all of its PGs, which we
+  // cannot update incrementally, but we can skip the pools that didn't change.
+  if (purged_snaps_all_dirty) {
+    purged_snaps.clear();
+  } else if (purged_snaps_dirty.empty()) {
+    return;
+  } else {
+    for (auto pool : purged_snaps_dirty) {
+      purged_snaps.erase(pool);
+    }
+  }
   set<int64_t> unknown;
   for (auto& i : pg_stat) {
+    if (!purged_snaps_all_dirty &&
+	!purged_snaps_dirty.count(i.first.pool())) {
+      continue;
+    }
     if (i.second.state == 0) {
       unknown.insert(i.first.pool());
       purged_snaps.erase(i.first.pool());
@@ -1444,6 +1573,8 @@ void PGMap::calc_purged_snaps()
       j->second.intersection_of(i.second.purged_snaps);
     }
   }
+  purged_snaps_dirty.clear();
+  purged_snaps_all_dirty = false;
 }
 
 void PGMap::calc_osd_sum_by_class(const OSDMap& osdmap)
@@ -1475,12 +1606,17 @@ void PGMap::stat_osd_sub(int osd, const osd_stat_t &s)
   osd_last_seq[osd] = 0;
 }
 
-void PGMap::encode_digest(const OSDMap& osdmap,
-			  bufferlist& bl, uint64_t features)
+void PGMap::calc_digest(const OSDMap& osdmap)
 {
   get_rules_avail(osdmap, &avail_space_by_rule);
   calc_osd_sum_by_class(osdmap);
   calc_purged_snaps();
+}
+
+void PGMap::encode_digest(const OSDMap& osdmap,
+			  bufferlist& bl, uint64_t features)
+{
+  calc_digest(osdmap);
   PGMapDigest::encode(bl, features);
 }
 
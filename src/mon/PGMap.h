@@ -66,6 +66,11 @@ public:
       decode(up_not_acting, p);
       decode(primary, p);
     }
+    bool operator==(const pg_count& o) const {
+      return acting == o.acting &&
+	up_not_acting == o.up_not_acting &&
+	primary == o.primary;
+    }
   };
   mempool::pgmap::unordered_map<int32_t,pg_count> num_pg_by_osd;
 
@@ -224,6 +229,17 @@ public:
 
   void encode(ceph::buffer::list& bl, uint64_t features) const;
   void decode(ceph::buffer::list::const_iterator& p);
+
+  /**
+   * encode only what changed since @p base
+   *
+   * The per-pool and per-osd maps carry just the updated and removed
+   * entries; apply_delta() to a copy of @p base reproduces this digest.
+   */
+  void encode_delta(const PGMapDigest& base,
+		    ceph::buffer::list& bl, uint64_t features) const;
+  void apply_delta(ceph::buffer::list::const_iterator& p);
+
   void dump(ceph::Formatter *f) const;
   static void generate_test_instances(std::list<PGMapDigest*>& ls);
 };
@@ -309,6 +325,10 @@ public:
 
   utime_t stamp;
 
+  // pools whose purged_snaps need to be recalculated
+  std::set<int64_t> purged_snaps_dirty;
+  bool purged_snaps_all_dirty = true;
+
   void update_pool_deltas(
     CephContext *cct,
     const utime_t ts,
@@ -330,6 +350,8 @@ public:
     per_pool_sum_deltas.erase(pool);
     per_pool_sum_deltas_stamps.erase(pool);
     per_pool_sum_delta.erase(pool);
+    purged_snaps.erase(pool);
+    purged_snaps_dirty.erase(pool);
   }
 
  private:
@@ -424,6 +446,7 @@ public:
 		   bool sameosds=false);
   bool stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
 		   bool sameosds=false);
+  /// recalculate purged_snaps for the pools whose PGs changed since last time
   void calc_purged_snaps();
   void calc_osd_sum_by_class(const OSDMap& osdmap);
   void stat_osd_add(int osd, const osd_stat_t &s);
@@ -432,6 +455,8 @@ public:
   void encode(ceph::buffer::list &bl, uint64_t features=-1) const;
   void decode(ceph::buffer::list::const_iterator &bl);
 
+  /// update the PGMapDigest fields that depend on the osdmap
+  void calc_digest(const OSDMap& osdmap);
   /// encode subset of our data to a PGMapDigest
   void encode_digest(const OSDMap& osdmap,
 		     ceph::buffer::list& bl, uint64_t features);
@@ -132,6 +132,7 @@ void Paxos::init_logger()
   pcb.add_u64_avg(l_paxos_share_state_bytes, "share_state_bytes", "Data in shared state", NULL, 0, unit_t(UNIT_BYTES));
   pcb.add_u64_counter(l_paxos_new_pn, "new_pn", "New proposal number queries");
   pcb.add_time_avg(l_paxos_new_pn_latency, "new_pn_latency", "New proposal number getting latency");
+  pcb.add_u64_counter(l_paxos_propose_batched, "propose_batched", "Service proposals batched into another service's proposal");
   logger = pcb.create_perf_counters();
   g_ceph_context->get_perfcounters_collection()->add(logger);
 }
@@ -668,21 +669,10 @@ void Paxos::begin(bufferlist& v)
   logger->inc(l_paxos_begin_keys, t->get_keys());
   logger->inc(l_paxos_begin_bytes, t->get_bytes());
 
-  auto start = ceph::coarse_mono_clock::now();
-  get_store()->apply_transaction(t);
-  auto end = ceph::coarse_mono_clock::now();
-
-  logger->tinc(l_paxos_begin_latency, to_timespan(end - start));
-
-  ceph_assert(g_conf()->paxos_kill_at != 3);
-
-  if (mon.get_quorum().size() == 1) {
-    // we're alone, take it easy
-    commit_start();
-    return;
-  }
-
-  // ask others to accept it too!
+  // ask others to accept it too!  we do so before persisting the value
+  // ourselves, so that our write overlaps with the peons' round trip.
+  // this is safe: we hold mon.lock until our own write is done, so we
+  // cannot see (let alone act on) any accept before we accepted, too.
   for (auto p = mon.get_quorum().begin();
        p != mon.get_quorum().end();
        ++p) {
@@ -698,6 +688,21 @@ void Paxos::begin(bufferlist& v)
     mon.send_mon_message(begin, *p);
   }
 
+  auto start = ceph::coarse_mono_clock::now();
+  get_store()->apply_transaction(t);
+  auto end = ceph::coarse_mono_clock::now();
+
+  logger->tinc(l_paxos_begin_latency, to_timespan(end - start));
+
+  // the peons may have accepted the value by now, too
+  ceph_assert(g_conf()->paxos_kill_at != 3);
+
+  if (mon.get_quorum().size() == 1) {
+    // we're alone, take it easy
+    commit_start();
+    return;
+  }
+
   // set timeout event
   accept_timeout_event = mon.timer.add_event_after(
     g_conf()->mon_accept_timeout_factor * g_conf()->mon_lease,
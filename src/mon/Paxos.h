@@ -156,6 +156,7 @@ enum {
   l_paxos_share_state_bytes,
   l_paxos_new_pn,
   l_paxos_new_pn_latency,
+  l_paxos_propose_batched,
   l_paxos_last,
 };
 
@@ -135,6 +135,7 @@ bool PaxosService::dispatch(MonOpRequestRef op)
     dout(10) << " setting proposal_timer " << do_propose
              << " with delay of " << delay << dendl;
     proposal_timer = mon.timer.add_event_after(delay, do_propose);
+    proposal_due = ceph::coarse_mono_clock::now() + ceph::make_timespan(delay);
   } else {
     dout(10) << " proposal_timer already set" << dendl;
   }
@@ -249,6 +250,28 @@ void PaxosService::propose_pending()
     }
   };
   paxos.queue_pending_finisher(new C_Committed(this));
+
+  if (g_conf().get_val<bool>("paxos_propose_batch") &&
+      !paxos.is_plugged()) {
+    // the other services whose proposal delay is about to run out anyway
+    // ride along in this round, rather than each waiting for (and paying
+    // for) a round of their own.  services that are still damping their
+    // updates keep on gathering them.
+    auto due_by = ceph::coarse_mono_clock::now() +
+      ceph::make_timespan(g_conf()->paxos_min_wait);
+    paxos.plug();
+    for (auto& svc : mon.paxos_service) {
+      if (svc.get() == this || !svc->proposal_timer ||
+	  svc->proposal_due > due_by || !svc->is_writeable()) {
+	continue;
+      }
+      dout(10) << __func__ << " batching pending " << svc->get_service_name()
+	       << dendl;
+      paxos.logger->inc(l_paxos_propose_batched);
+      svc->propose_pending();
+    }
+    paxos.unplug();
+  }
   paxos.trigger_propose();
 }
 
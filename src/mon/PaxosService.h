@@ -68,6 +68,10 @@ protected:
    * runs out and fires.
    */
   Context *proposal_timer;
+  /**
+   * When the proposal_timer is due to fire, if it is set.
+   */
+  ceph::coarse_mono_time proposal_due;
   /**
    * If the implementation class has anything pending to be proposed to Paxos,
    * then have_pending should be true; otherwise, false.
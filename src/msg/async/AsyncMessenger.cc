@@ -194,6 +194,10 @@ void Processor::accept()
 	ldout(msgr->cct, 10) << __func__ << " accepted incoming on sd "
 			     << cli_socket.fd() << dendl;
 
+	if (msgr->get_stack()->support_numa_steering()) {
+	  w = msgr->get_stack()->steer_accepted(w, cli_socket.fd());
+	}
+
 	msgr->add_accept(
 	  w, std::move(cli_socket),
 	  msgr->get_myaddrs().v[listen_socket.get_addr_slot()],
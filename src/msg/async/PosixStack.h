@@ -47,6 +47,8 @@ class PosixNetworkStack : public NetworkStack {
  public:
   explicit PosixNetworkStack(CephContext *c);
 
+  bool support_numa_steering() const override { return true; }
+
   void spawn_worker(std::function<void ()> &&func) override {
     threads.emplace_back(std::move(func));
   }
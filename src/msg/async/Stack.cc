@@ -19,6 +19,7 @@
 #include "include/compat.h"
 #include "common/Cond.h"
 #include "common/errno.h"
+#include "common/numa.h"
 #include "PosixStack.h"
 #ifdef HAVE_RDMA
 #include "rdma/RDMAStack.h"
@@ -40,6 +41,13 @@ std::function<void ()> NetworkStack::add_thread(Worker* w)
       char tp_name[16];
       sprintf(tp_name, "msgr-worker-%u", w->id);
       ceph_pthread_setname(pthread_self(), tp_name);
+      if (w->numa_node >= 0) {
+        int r = set_thread_numa_affinity(w->numa_node);
+        if (r < 0) {
+          lderr(cct) << __func__ << " unable to bind to numa node "
+                     << w->numa_node << ": " << cpp_strerror(r) << dendl;
+        }
+      }
       const unsigned EventMaxWaitUs = 30000000;
       w->center.set_owner();
       ldout(cct, 10) << __func__ << " starting" << dendl;
@@ -103,6 +111,20 @@ std::shared_ptr<NetworkStack> NetworkStack::create(CephContext *c,
     stack->workers.push_back(w);
   }
 
+  std::set<int> nodes;
+  if (c->_conf.get_val<bool>("ms_async_numa_spread") &&
+      get_numa_nodes(&nodes) == 0 && nodes.size() > 1) {
+    // contiguous runs of workers per node
+    std::vector<int> v(nodes.begin(), nodes.end());
+    for (unsigned worker_id = 0; worker_id < num_workers; ++worker_id) {
+      stack->workers[worker_id]->numa_node =
+        v[worker_id * v.size() / num_workers];
+    }
+    stack->numa_spread = true;
+    ldout(c, 1) << __func__ << " spreading " << num_workers
+                << " workers over numa nodes " << nodes << dendl;
+  }
+
   return stack;
 }
 
@@ -157,6 +179,52 @@ Worker* NetworkStack::get_worker()
   return current_best;
 }
 
+Worker* NetworkStack::get_worker_on(int node)
+{
+  if (node < 0) {
+    return get_worker();
+  }
+  unsigned min_load = std::numeric_limits<int>::max();
+  Worker* current_best = nullptr;
+
+  pool_spin.lock();
+  for (Worker* worker : workers) {
+    if (worker->numa_node != node) {
+      continue;
+    }
+    unsigned worker_load = worker->references.load();
+    if (worker_load < min_load) {
+      current_best = worker;
+      min_load = worker_load;
+    }
+  }
+  pool_spin.unlock();
+  if (!current_best) {
+    return get_worker();
+  }
+  ++current_best->references;
+  return current_best;
+}
+
+Worker* NetworkStack::steer_accepted(Worker *w, int fd)
+{
+  if (!numa_spread) {
+    return w;
+  }
+  int node = get_socket_numa_node(fd);
+  if (node < 0 || w->numa_node == node) {
+    return w;
+  }
+  Worker *best = get_worker_on(node);
+  w->release_worker();
+  if (best->numa_node != node) {
+    best->perf_logger->inc(l_msgr_numa_remote_connections);
+  }
+  ldout(cct, 20) << __func__ << " sd " << fd << " numa node " << node
+                 << " worker " << best->id << dendl;
+  return best;
+}
+
 void NetworkStack::stop()
 {
   std::lock_guard lk(pool_spin);
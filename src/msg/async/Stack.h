@@ -203,6 +203,8 @@ enum {
   l_msgr_send_messages_queue_lat,
   l_msgr_handle_ack_lat,
 
+  l_msgr_numa_remote_connections,
+
   l_msgr_last,
 };
 
@@ -217,6 +219,7 @@ class Worker {
   CephContext *cct;
   PerfCounters *perf_logger;
   unsigned id;
+  int numa_node = -1;  ///< the thread is bound to, with ms_async_numa_spread
 
   std::atomic_uint references;
   EventCenter center;
@@ -245,6 +248,7 @@ class Worker {
 
     plb.add_time_avg(l_msgr_send_messages_queue_lat, "msgr_send_messages_queue_lat", "Network sent messages lat");
     plb.add_time_avg(l_msgr_handle_ack_lat, "msgr_handle_ack_lat", "Connection handle ack lat");
+    plb.add_u64_counter(l_msgr_numa_remote_connections, "msgr_numa_remote_connections", "Accepted connections handled off the numa node receiving their packets");
 
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
@@ -297,6 +301,7 @@ class NetworkStack {
   bool started = false;
 
   std::function<void ()> add_thread(Worker* w);
+  bool numa_spread = false;  ///< the workers are bound to numa nodes
 
   virtual Worker* create_worker(CephContext *c, unsigned i) = 0;
 
@@ -324,6 +329,9 @@ class NetworkStack {
   // need to let each thread do binding port.
   virtual bool support_local_listen_table() const { return false; }
   virtual bool nonblock_connect_need_writable_event() const { return true; }
+  // backend need to override this method if an accepted socket may be
+  // handed to any worker, rather than the one given to accept().
+  virtual bool support_numa_steering() const { return false; }
 
   void start();
   void stop();
@@ -331,6 +339,11 @@ class NetworkStack {
   Worker *get_worker(unsigned worker_id) {
     return workers[worker_id];
   }
+  /// the least loaded worker on numa node @p node, or any if there is none
+  Worker *get_worker_on(int node);
+  /// with ms_async_numa_spread, swap @p w, given to accept() the socket
+  /// @p fd, for a worker on the numa node receiving its packets
+  Worker *steer_accepted(Worker *w, int fd);
   void drain();
   unsigned get_num_worker() const {
     return workers.size();
@@ -183,6 +183,163 @@ private:
   }
 };
 
+BlueFSBufferCache::BlueFSBufferCache(CephContext* cct)
+  : cct(cct),
+    block_size(p2roundup<uint64_t>(
+      cct->_conf.get_val<Option::size_t>("bluefs_buffer_cache_block_size"),
+      CEPH_PAGE_SIZE))
+{
+}
+
+bool BlueFSBufferCache::lookup(uint64_t ino, uint64_t off, bufferptr* out)
+{
+  auto& shard = get_shard(ino, off);
+  std::lock_guard l(shard.lock);
+  auto p = shard.blocks.find(std::make_pair(ino, off));
+  if (p == shard.blocks.end()) {
+    return false;
+  }
+  // a block on probation is promoted
+  shard.unlink(p->second);
+  p->second.cold = false;
+  shard.lru.push_front(p->second);
+  *out = p->second.data;
+  return true;
+}
+
+bool BlueFSBufferCache::contains(uint64_t ino, uint64_t off)
+{
+  auto& shard = get_shard(ino, off);
+  std::lock_guard l(shard.lock);
+  return shard.blocks.count(std::make_pair(ino, off));
+}
+
+void BlueFSBufferCache::insert(uint64_t ino, uint64_t off, bufferptr data,
+			       bool cold)
+{
+  auto& shard = get_shard(ino, off);
+  std::lock_guard l(shard.lock);
+  if (shard.max == 0) {
+    return;
+  }
+  uint64_t len = data.length();
+  auto [p, inserted] = shard.blocks.try_emplace(std::make_pair(ino, off),
+						ino, off, std::move(data), cold);
+  if (!inserted) {
+    // raced with another reader, keep theirs
+    return;
+  }
+  if (cold) {
+    shard.probation.push_front(p->second);
+    shard.probation_bytes += len;
+  } else {
+    shard.lru.push_front(p->second);
+  }
+  shard.bytes += len;
+  shard.trim();
+}
+
+void BlueFSBufferCache::discard(uint64_t ino)
+{
+  for (auto& shard : shards) {
+    std::lock_guard l(shard.lock);
+    auto p = shard.blocks.lower_bound(std::make_pair(ino, 0));
+    while (p != shard.blocks.end() && p->first.first == ino) {
+      shard.unlink(p->second);
+      shard.bytes -= p->second.data.length();
+      p = shard.blocks.erase(p);
+    }
+  }
+}
+
+void BlueFSBufferCache::clear()
+{
+  for (auto& shard : shards) {
+    std::lock_guard l(shard.lock);
+    shard.lru.clear();
+    shard.probation.clear();
+    shard.blocks.clear();
+    shard.bytes = 0;
+    shard.probation_bytes = 0;
+  }
+}
+
+void BlueFSBufferCache::set_max(uint64_t bytes)
+{
+  max_bytes = bytes;
+  for (auto& shard : shards) {
+    std::lock_guard l(shard.lock);
+    shard.max = bytes / NUM_SHARDS;
+    shard.trim();
+  }
+}
+
+uint64_t BlueFSBufferCache::get_bytes() const
+{
+  uint64_t bytes = 0;
+  for (auto& shard : shards) {
+    std::lock_guard l(shard.lock);
+    bytes += shard.bytes;
+  }
+  return bytes;
+}
+
+void BlueFSBufferCache::Shard::unlink(Block& b)
+{
+  if (b.cold) {
+    probation.erase(probation.iterator_to(b));
+    probation_bytes -= b.data.length();
+  } else {
+    lru.erase(lru.iterator_to(b));
+  }
+}
+
+void BlueFSBufferCache::Shard::trim()
+{
+  while (bytes > max) {
+    // the read ahead gets its share before it evicts what was looked up;
+    // past that, it evicts its own oldest blocks rather than the hot ones
+    bool cold = !probation.empty() &&
+      (probation_bytes > max / PROBATION_RATIO || lru.empty());
+    auto& b = cold ? probation.back() : lru.back();
+    unlink(b);
+    bytes -= b.data.length();
+    blocks.erase(std::make_pair(b.ino, b.off));
+  }
+}
+
+int64_t BlueFSBufferCache::request_cache_bytes(
+  PriorityCache::Priority pri, uint64_t total_cache) const
+{
+  int64_t assigned = get_cache_bytes(pri);
+  switch (pri) {
+  // like the mempool caches, everything goes into PRI1
+  case PriorityCache::Priority::PRI1:
+    {
+      int64_t request = get_bytes();
+      return (request > assigned) ? request - assigned : 0;
+    }
+  default:
+    break;
+  }
+  return -EOPNOTSUPP;
+}
+
+int64_t BlueFSBufferCache::get_cache_bytes() const
+{
+  int64_t total = 0;
+  for (int i = 0; i < PriorityCache::Priority::LAST + 1; i++) {
+    total += cache_bytes[i];
+  }
+  return total;
+}
+
+int64_t BlueFSBufferCache::commit_cache_size(uint64_t total_cache)
+{
+  committed_bytes = PriorityCache::get_chunk(get_cache_bytes(), total_cache);
+  return committed_bytes;
+}
+
 BlueFS::BlueFS(CephContext* cct)
   : cct(cct),
     bdev(MAX_BDEV),
@@ -190,7 +347,8 @@ BlueFS::BlueFS(CephContext* cct)
     block_reserved(MAX_BDEV),
     alloc(MAX_BDEV),
     alloc_size(MAX_BDEV, 0),
-    pending_release(MAX_BDEV)
+    pending_release(MAX_BDEV),
+    buffer_cache(std::make_shared<BlueFSBufferCache>(cct))
 {
   discard_cb[BDEV_WAL] = wal_discard_cb;
   discard_cb[BDEV_DB] = db_discard_cb;
@@ -248,6 +406,10 @@ void BlueFS::_init_logger()
   b.add_u64_counter(l_bluefs_logged_bytes, "logged_bytes",
 		    "Bytes written to the metadata log", "j",
 		    PerfCountersBuilder::PRIO_CRITICAL, unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluefs_log_sync_requests, "log_sync_requests",
+		    "Fsyncs that had to commit file metadata to the log");
+  b.add_u64_counter(l_bluefs_log_sync_grouped, "log_sync_grouped",
+		    "Fsyncs committed by the log write of another one");
   b.add_u64_counter(l_bluefs_files_written_wal, "files_written_wal",
 		    "Files written to WAL");
   b.add_u64_counter(l_bluefs_files_written_sst, "files_written_sst",
@@ -299,6 +461,22 @@ void BlueFS::_init_logger()
 	    "How many times bluefs read found page with all 0s");
   b.add_u64(l_bluefs_read_zeros_errors, "read_zeros_errors",
 	    "How many times bluefs read found transient page with all 0s");
+  b.add_u64_counter(l_bluefs_read_cache_hit_count, "read_cache_hit_count",
+		    "Blocks found in the buffer cache");
+  b.add_u64_counter(l_bluefs_read_cache_hit_bytes, "read_cache_hit_bytes",
+		    "Bytes found in the buffer cache", NULL,
+		    PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluefs_read_cache_miss_count, "read_cache_miss_count",
+		    "Blocks read into the buffer cache on demand");
+  b.add_u64_counter(l_bluefs_read_cache_miss_bytes, "read_cache_miss_bytes",
+		    "Bytes read into the buffer cache on demand", NULL,
+		    PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluefs_read_ahead_bytes, "read_ahead_bytes",
+		    "Bytes read ahead into the buffer cache", NULL,
+		    PerfCountersBuilder::PRIO_INTERESTING, unit_t(UNIT_BYTES));
+  b.add_u64(l_bluefs_cache_bytes, "cache_bytes",
+	    "Size of the buffer cache",
+	    NULL, PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
 
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
@@ -315,6 +493,7 @@ void BlueFS::_update_logger_stats()
   // we must be holding the lock
   logger->set(l_bluefs_num_files, file_map.size());
   logger->set(l_bluefs_log_bytes, log_writer->file->fnode.size);
+  logger->set(l_bluefs_cache_bytes, buffer_cache->get_bytes());
 
   if (alloc[BDEV_WAL]) {
     logger->set(l_bluefs_wal_total_bytes, _get_total(BDEV_WAL));
@@ -850,6 +1029,7 @@ void BlueFS::umount(bool avoid_compact)
 
   vselector.reset(nullptr);
   _stop_alloc();
+  buffer_cache->clear();
   file_map.clear();
   dir_map.clear();
   super = bluefs_super_t();
@@ -1847,6 +2027,7 @@ void BlueFS::_drop_link(FileRef file)
     }
     file_map.erase(file->fnode.ino);
     file->deleted = true;
+    buffer_cache->discard(file->fnode.ino);
 
     if (file->dirty_seq) {
       ceph_assert(file->dirty_seq > log_seq_stable);
@@ -1858,6 +2039,131 @@ void BlueFS::_drop_link(FileRef file)
   }
 }
 
+bool BlueFS::_use_buffer_cache(FileReader *h) const
+{
+  return buffer_cache->is_enabled() &&
+    h->random &&
+    !h->ignore_eof &&
+    h->file->num_writers.load() == 0;
+}
+
+void BlueFS::_fill_buffer_cache(
+  const FileRef& f,
+  uint64_t off,
+  uint64_t length,
+  bool cold,
+  std::vector<bufferptr>::iterator out)
+{
+  const uint64_t bs = buffer_cache->get_block_size();
+  const uint64_t size = f->fnode.size;
+  ceph_assert(off % bs == 0);
+  ceph_assert(off < size);
+  length = std::min(length, size - off);
+  uint64_t want = round_up_to(length, super.block_size);
+  dout(20) << __func__ << " ino " << f->fnode.ino
+	   << " 0x" << std::hex << off << "~" << want << std::dec
+	   << (cold ? " (read ahead)" : "") << dendl;
+
+  // one read per extent the run touches, then a block per bs of it: the
+  // blocks are evicted one by one, so they must not share the buffer
+  bufferptr run = buffer::create_small_page_aligned(want);
+  uint64_t pos = 0;
+  uint64_t x_off = 0;
+  auto p = f->fnode.seek(off, &x_off);
+  while (pos < want) {
+    ceph_assert(p != f->fnode.extents.end());
+    uint64_t l = std::min(p->length - x_off, want - pos);
+    int r;
+    if (!cct->_conf->bluefs_check_for_zeros) {
+      r = bdev[p->bdev]->read_random(p->offset + x_off, l, run.c_str() + pos,
+				     cct->_conf->bluefs_buffered_io);
+    } else {
+      r = read_random(p->bdev, p->offset + x_off, l, run.c_str() + pos,
+		      cct->_conf->bluefs_buffered_io);
+    }
+    ceph_assert(r == 0);
+    logger->inc(l_bluefs_read_random_disk_count, 1);
+    logger->inc(l_bluefs_read_random_disk_bytes, l);
+    pos += l;
+    ++p;
+    x_off = 0;
+  }
+
+  for (pos = 0; pos < length; pos += bs, ++out) {
+    uint64_t l = std::min(bs, length - pos);
+    bufferptr b(buffer::create_aligned_in_mempool(
+      l, CEPH_PAGE_SIZE, mempool::mempool_bluefs_file_reader));
+    memcpy(b.c_str(), run.c_str() + pos, l);
+    buffer_cache->insert(f->fnode.ino, off + pos, b, cold);
+    *out = std::move(b);
+  }
+}
+
+int64_t BlueFS::_read_cached(
+  FileReader *h,         ///< [in] read from here
+  uint64_t off,          ///< [in] offset
+  uint64_t len,          ///< [in] this many bytes, not past the eof
+  uint64_t ahead,        ///< [in] and cache this many bytes more
+  char *out)             ///< [out] copy it here
+{
+  const FileRef& f = h->file;
+  const uint64_t ino = f->fnode.ino;
+  const uint64_t bs = buffer_cache->get_block_size();
+  const uint64_t start = p2align(off, bs);
+  const uint64_t end = p2roundup(off + len, bs);
+
+  std::vector<bufferptr> blocks((end - start) / bs);
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    if (buffer_cache->lookup(ino, start + i * bs, &blocks[i])) {
+      logger->inc(l_bluefs_read_cache_hit_count, 1);
+      logger->inc(l_bluefs_read_cache_hit_bytes, blocks[i].length());
+    }
+  }
+  // read the runs of missing blocks
+  for (size_t i = 0; i < blocks.size(); ) {
+    if (blocks[i].have_raw()) {
+      ++i;
+      continue;
+    }
+    size_t j = i + 1;
+    while (j < blocks.size() && !blocks[j].have_raw()) {
+      ++j;
+    }
+    _fill_buffer_cache(f, start + i * bs, (j - i) * bs, false,
+		       blocks.begin() + i);
+    for (; i < j; ++i) {
+      logger->inc(l_bluefs_read_cache_miss_count, 1);
+      logger->inc(l_bluefs_read_cache_miss_bytes, blocks[i].length());
+    }
+  }
+
+  int64_t ret = 0;
+  uint64_t pos = off;
+  for (auto& b : blocks) {
+    uint64_t b_off = pos - p2align(pos, bs);
+    uint64_t l = std::min<uint64_t>(b.length() - b_off, off + len - pos);
+    memcpy(out, b.c_str() + b_off, l);
+    out += l;
+    pos += l;
+    ret += l;
+  }
+  ceph_assert(ret == (int64_t)len);
+
+  // read ahead what is not cached yet, leaving it at the cold end
+  uint64_t ra_end = std::min(p2roundup(off + len + ahead, bs),
+			     p2roundup<uint64_t>(f->fnode.size, bs));
+  uint64_t ra = end;
+  while (ra < ra_end && buffer_cache->contains(ino, ra)) {
+    ra += bs;
+  }
+  if (ra < ra_end) {
+    std::vector<bufferptr> ahead_blocks((ra_end - ra) / bs);
+    _fill_buffer_cache(f, ra, ra_end - ra, true, ahead_blocks.begin());
+    logger->inc(l_bluefs_read_ahead_bytes, ra_end - ra);
+  }
+  return ret;
+}
+
 int64_t BlueFS::_read_random(
   FileReader *h,         ///< [in] read from here
   uint64_t off,          ///< [in] offset
@@ -1885,6 +2191,22 @@ int64_t BlueFS::_read_random(
   logger->inc(l_bluefs_read_random_count, 1);
   logger->inc(l_bluefs_read_random_bytes, len);
 
+  if (_use_buffer_cache(h)) {
+    // grow the read ahead window while the reads are sequential, which
+    // compaction's are; readers hinted RANDOM never get one
+    const uint64_t bs = buffer_cache->get_block_size();
+    uint64_t ahead = 0;
+    if (h->buf.max_prefetch >= bs && off == h->next_off) {
+      ahead = std::min(std::max(2 * h->read_ahead.load(), bs),
+		       h->buf.max_prefetch);
+    }
+    h->read_ahead = ahead;
+    h->next_off = off + len;
+    ret = len ? _read_cached(h, off, len, ahead, out) : 0;
+    dout(20) << __func__ << " got " << ret << " (cached)" << dendl;
+    --h->file->num_reading;
+    return ret;
+  }
   std::shared_lock s_lock(h->lock);
   buf->bl.reassign_to_mempool(mempool::mempool_bluefs_file_reader);
   while (len > 0) {
@@ -1950,6 +2272,38 @@ int64_t BlueFS::_read_random(
   return ret;
 }
 
+void BlueFS::prefetch(FileReader *h, uint64_t off, size_t len)
+{
+  if (!_use_buffer_cache(h)) {
+    _read(h, off, len, nullptr, nullptr);
+    return;
+  }
+  dout(10) << __func__ << " h " << h
+	   << " 0x" << std::hex << off << "~" << len << std::dec
+	   << " from " << h->file->fnode << dendl;
+  ++h->file->num_reading;
+  const uint64_t bs = buffer_cache->get_block_size();
+  const uint64_t size = h->file->fnode.size;
+  uint64_t end = std::min(p2roundup<uint64_t>(off + len, bs),
+			  p2roundup(size, bs));
+  for (uint64_t pos = p2align<uint64_t>(off, bs); pos < end; ) {
+    if (buffer_cache->contains(h->file->fnode.ino, pos)) {
+      pos += bs;
+      continue;
+    }
+    uint64_t run_end = pos + bs;
+    while (run_end < end &&
+	   !buffer_cache->contains(h->file->fnode.ino, run_end)) {
+      run_end += bs;
+    }
+    std::vector<bufferptr> blocks((run_end - pos) / bs);
+    _fill_buffer_cache(h->file, pos, run_end - pos, true, blocks.begin());
+    logger->inc(l_bluefs_read_ahead_bytes, run_end - pos);
+    pos = run_end;
+  }
+  --h->file->num_reading;
+}
+
 int64_t BlueFS::_read(
   FileReader *h,         ///< [in] read from here
   uint64_t off,          ///< [in] offset
@@ -2109,7 +2463,7 @@ void BlueFS::compact_log()
   std::unique_lock<ceph::mutex> l(lock);
   if (!cct->_conf->bluefs_replay_recovery_disable_compact) {
     if (cct->_conf->bluefs_compact_log_sync) {
-      _compact_log_sync();
+      _compact_log_sync(l);
     } else {
       _compact_log_async(l);
     }
@@ -2183,9 +2537,14 @@ void BlueFS::_compact_log_dump_metadata(bluefs_transaction_t *t,
   }
 }
 
-void BlueFS::_compact_log_sync()
+void BlueFS::_compact_log_sync(std::unique_lock<ceph::mutex>& l)
 {
   dout(10) << __func__ << dendl;
+  // a racing _flush_and_sync_log() writes through log_writer w/o the lock
+  while (log_flushing) {
+    dout(10) << __func__ << " log is currently flushing, waiting" << dendl;
+    log_cond.wait(l);
+  }
   auto prefer_bdev =
     vselector->select_prefer_bdev(log_writer->file->vselector_hint);
   _rewrite_log_and_layout_sync(true,
@@ -2204,6 +2563,8 @@ void BlueFS::_rewrite_log_and_layout_sync(bool allocate_with_fallback,
 					  int flags,
 					  std::optional<bluefs_layout_t> layout)
 {
+  // the log writer is replaced below: its aio must not be in flight
+  ceph_assert(!log_flushing);
   File *log_file = log_writer->file.get();
 
   // clear out log (be careful who calls us!!!)
@@ -2489,10 +2850,14 @@ int BlueFS::_flush_and_sync_log(std::unique_lock<ceph::mutex>& l,
     ceph_assert(!jump_to);
     log_cond.wait(l);
   }
+  if (want_seq) {
+    logger->inc(l_bluefs_log_sync_requests);
+  }
   if (want_seq && want_seq <= log_seq_stable) {
     dout(10) << __func__ << " want_seq " << want_seq << " <= log_seq_stable "
 	     << log_seq_stable << ", done" << dendl;
     ceph_assert(!jump_to);
+    logger->inc(l_bluefs_log_sync_grouped);
     return 0;
   }
   if (log_t.empty() && dirty_files.empty()) {
@@ -2565,7 +2930,8 @@ int BlueFS::_flush_and_sync_log(std::unique_lock<ceph::mutex>& l,
   log_t.seq = 0;  // just so debug output is less confusing
   log_flushing = true;
 
-  int r = _flush(log_writer, true);
+  FlushedRange pending;
+  int r = _flush(log_writer, true, nullptr, &pending);
   ceph_assert(r == 0);
 
   if (jump_to) {
@@ -2577,7 +2943,10 @@ int BlueFS::_flush_and_sync_log(std::unique_lock<ceph::mutex>& l,
     vselector->add_usage(log_writer->file->vselector_hint, log_writer->file->fnode.size);
   }
 
-  _flush_bdev_safely(log_writer);
+  // Write the log w/o the lock: log_flushing keeps the other flushes of the
+  // log out, and the files dirtied meanwhile go to the next transaction, so
+  // the fsyncs waiting for them are committed together by a single write.
+  _flush_bdev_safely(log_writer, &pending);
 
   log_flushing = false;
   log_cond.notify_all();
@@ -2681,6 +3050,17 @@ ceph::bufferlist BlueFS::FileWriter::flush_buffer(
 }
 
 int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
+{
+  FlushedRange r;
+  int ret = _prepare_flush_range(h, offset, length, &r);
+  if (ret == 0) {
+    _submit_flush(h, r);
+  }
+  return ret;
+}
+
+int BlueFS::_prepare_flush_range(FileWriter *h, uint64_t offset, uint64_t length,
+				 FlushedRange *fr)
 {
   dout(10) << __func__ << " " << h << " pos 0x" << std::hex << h->pos
 	   << " 0x" << offset << "~" << length << std::dec
@@ -2688,11 +3068,10 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
   ceph_assert(!h->file->deleted);
   ceph_assert(h->file->num_readers.load() == 0);
 
-  bool buffered;
   if (h->file->fnode.ino == 1)
-    buffered = false;
+    fr->buffered = false;
   else
-    buffered = cct->_conf->bluefs_buffered_io;
+    fr->buffered = cct->_conf->bluefs_buffered_io;
 
   if (offset + length <= h->pos)
     return 0;
@@ -2775,12 +3154,7 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
     x_off -= partial;
     offset -= partial;
     length += partial;
-    dout(20) << __func__ << " waiting for previous aio to complete" << dendl;
-    for (auto p : h->iocv) {
-      if (p) {
-	p->aio_wait();
-      }
-    }
+    fr->wait_prior_aio = true;
   }
 
   auto bl = h->flush_buffer(cct, partial, length, super);
@@ -2802,26 +3176,47 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
   *_dout << dendl;
 
   uint64_t bloff = 0;
-  uint64_t bytes_written_slow = 0;
   while (length > 0) {
     uint64_t x_len = std::min(p->length - x_off, length);
     bufferlist t;
     t.substr_of(bl, bloff, x_len);
-    if (cct->_conf->bluefs_sync_write) {
-      bdev[p->bdev]->write(p->offset + x_off, t, buffered, h->write_hint);
-    } else {
-      bdev[p->bdev]->aio_write(p->offset + x_off, t, h->iocv[p->bdev], buffered, h->write_hint);
-    }
-    h->dirty_devs[p->bdev] = true;
-    if (p->bdev == BDEV_SLOW) {
-      bytes_written_slow += t.length();
-    }
+    fr->writes.emplace_back(p->bdev, p->offset + x_off, std::move(t));
 
     bloff += x_len;
     length -= x_len;
     ++p;
     x_off = 0;
   }
+  vselector->add_usage(h->file->vselector_hint, h->file->fnode);
+  dout(20) << __func__ << " h " << h << " pos now 0x"
+           << std::hex << h->pos << std::dec << dendl;
+  return 0;
+}
+
+void BlueFS::_submit_flush(FileWriter *h, FlushedRange& r)
+{
+  // NOTE: this is safe to call without a lock, as long as no one else
+  // flushes h meanwhile: the extents were resolved by _prepare_flush_range.
+  if (r.wait_prior_aio) {
+    dout(20) << __func__ << " waiting for previous aio to complete" << dendl;
+    for (auto p : h->iocv) {
+      if (p) {
+	p->aio_wait();
+      }
+    }
+  }
+  uint64_t bytes_written_slow = 0;
+  for (auto& [id, offset, t] : r.writes) {
+    if (cct->_conf->bluefs_sync_write) {
+      bdev[id]->write(offset, t, r.buffered, h->write_hint);
+    } else {
+      bdev[id]->aio_write(offset, t, h->iocv[id], r.buffered, h->write_hint);
+    }
+    h->dirty_devs[id] = true;
+    if (id == BDEV_SLOW) {
+      bytes_written_slow += t.length();
+    }
+  }
   if (bytes_written_slow) {
     logger->inc(l_bluefs_bytes_written_slow, bytes_written_slow);
   }
@@ -2832,10 +3227,6 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
       }
     }
   }
-  vselector->add_usage(h->file->vselector_hint, h->file->fnode);
-  dout(20) << __func__ << " h " << h << " pos now 0x"
-           << std::hex << h->pos << std::dec << dendl;
-  return 0;
 }
 
 #ifdef HAVE_LIBAIO
@@ -2871,14 +3262,36 @@ void BlueFS::wait_for_aio(FileWriter *h)
 int BlueFS::_flush(FileWriter *h, bool force, std::unique_lock<ceph::mutex>& l)
 {
   bool flushed = false;
-  int r = _flush(h, force, &flushed);
+  int r = _flush_unlocked_io(h, force, l, &flushed);
   if (r == 0 && flushed) {
     _maybe_compact_log(l);
   }
   return r;
 }
 
-int BlueFS::_flush(FileWriter *h, bool force, bool *flushed)
+/*
+ * Flush h, but drop the BlueFS lock while its data is written.  The lock is
+ * only needed to allocate the space and to dirty the fnode, and h->lock keeps
+ * the other flushes of h out, so writers of different files (e.g. the WAL and
+ * the SSTs of a compaction) do not wait for each other's I/O.
+ */
+int BlueFS::_flush_unlocked_io(FileWriter *h, bool force,
+			       std::unique_lock<ceph::mutex>& l,
+			       bool *flushed)
+{
+  ceph_assert(ceph_mutex_is_locked(h->lock));
+  FlushedRange pending;
+  int r = _flush(h, force, flushed, &pending);
+  if (r == 0 && !pending.empty()) {
+    l.unlock();
+    _submit_flush(h, pending);
+    l.lock();
+  }
+  return r;
+}
+
+int BlueFS::_flush(FileWriter *h, bool force, bool *flushed,
+		   FlushedRange *pending)
 {
   uint64_t length = h->get_buffer_length();
   uint64_t offset = h->pos;
@@ -2901,7 +3314,9 @@ int BlueFS::_flush(FileWriter *h, bool force, bool *flushed)
            << std::hex << offset << "~" << length << std::dec
 	   << " to " << h->file->fnode << dendl;
   ceph_assert(h->pos <= h->file->fnode.size);
-  int r = _flush_range(h, offset, length);
+  int r = pending ?
+    _prepare_flush_range(h, offset, length, pending) :
+    _flush_range(h, offset, length);
   if (flushed) {
     *flushed = true;
   }
@@ -2949,7 +3364,7 @@ int BlueFS::_truncate(FileWriter *h, uint64_t offset)
 int BlueFS::_fsync(FileWriter *h, std::unique_lock<ceph::mutex>& l)
 {
   dout(10) << __func__ << " " << h << " " << h->file->fnode << dendl;
-  int r = _flush(h, true);
+  int r = _flush_unlocked_io(h, true, l);
   if (r < 0)
      return r;
   uint64_t old_dirty_seq = h->file->dirty_seq;
@@ -2967,26 +3382,27 @@ int BlueFS::_fsync(FileWriter *h, std::unique_lock<ceph::mutex>& l)
   return 0;
 }
 
-void BlueFS::_flush_bdev_safely(FileWriter *h)
+void BlueFS::_flush_bdev_safely(FileWriter *h, FlushedRange *pending)
 {
+  // h is ours until we are done: it is either flushed under its own lock,
+  // or it is one of the log writers, which only the log flush and the log
+  // compaction write to
+  lock.unlock();
+  if (pending) {
+    _submit_flush(h, *pending);
+  }
   std::array<bool, MAX_BDEV> flush_devs = h->dirty_devs;
   h->dirty_devs.fill(false);
 #ifdef HAVE_LIBAIO
   if (!cct->_conf->bluefs_sync_write) {
     list<aio_t> completed_ios;
     _claim_completed_aios(h, &completed_ios);
-    lock.unlock();
     wait_for_aio(h);
     completed_ios.clear();
-    flush_bdev(flush_devs);
-    lock.lock();
-  } else
-#endif
-  {
-    lock.unlock();
-    flush_bdev(flush_devs);
-    lock.lock();
   }
+#endif
+  flush_bdev(flush_devs);
+  lock.lock();
 }
 
 void BlueFS::flush_bdev(std::array<bool, MAX_BDEV>& dirty_bdevs)
@@ -3168,7 +3584,7 @@ void BlueFS::_maybe_compact_log(std::unique_lock<ceph::mutex>& l)
   if (!cct->_conf->bluefs_replay_recovery_disable_compact &&
       _should_compact_log()) {
     if (cct->_conf->bluefs_compact_log_sync) {
-      _compact_log_sync();
+      _compact_log_sync(l);
     } else {
       _compact_log_async(l);
     }
@@ -3233,6 +3649,8 @@ int BlueFS::open_for_write(
     }
   }
   ceph_assert(file->fnode.ino > 1);
+  // the cache only keeps files nobody writes to
+  buffer_cache->discard(file->fnode.ino);
 
   file->fnode.mtime = ceph_clock_now();
   file->vselector_hint = vselector->get_hint_by_dir(dirname);
@@ -3280,6 +3698,8 @@ BlueFS::FileWriter *BlueFS::_create_writer(FileRef f)
 void BlueFS::_close_writer(FileWriter *h)
 {
   dout(10) << __func__ << " " << h << " type " << h->writer_type << dendl;
+  // drop whatever a reader racing with open_for_write() may have cached
+  buffer_cache->discard(h->file->fnode.ino);
   //h->buffer.reassign_to_mempool(mempool::mempool_bluefs_file_writer);
   for (unsigned i=0; i<MAX_BDEV; ++i) {
     if (bdev[i]) {
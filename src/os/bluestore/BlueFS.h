@@ -6,12 +6,15 @@
 #include <atomic>
 #include <mutex>
 #include <limits>
+#include <tuple>
 
 #include "bluefs_types.h"
 #include "blk/BlockDevice.h"
 
+#include "common/PriorityCache.h"
 #include "common/RefCountedObj.h"
 #include "common/ceph_context.h"
+#include "common/ceph_mutex.h"
 #include "global/global_context.h"
 #include "include/common_fwd.h"
 
@@ -32,6 +35,8 @@ enum {
   l_bluefs_log_bytes,
   l_bluefs_log_compactions,
   l_bluefs_logged_bytes,
+  l_bluefs_log_sync_requests,
+  l_bluefs_log_sync_grouped,
   l_bluefs_files_written_wal,
   l_bluefs_files_written_sst,
   l_bluefs_bytes_written_wal,
@@ -52,6 +57,12 @@ enum {
   l_bluefs_read_prefetch_bytes,
   l_bluefs_read_zeros_candidate,
   l_bluefs_read_zeros_errors,
+  l_bluefs_read_cache_hit_count,
+  l_bluefs_read_cache_hit_bytes,
+  l_bluefs_read_cache_miss_count,
+  l_bluefs_read_cache_miss_bytes,
+  l_bluefs_read_ahead_bytes,
+  l_bluefs_cache_bytes,
 
   l_bluefs_last,
 };
@@ -90,6 +101,113 @@ struct bluefs_shared_alloc_context_t {
   }
 };
 
+/**
+ * BlueFSBufferCache
+ *
+ * Caches the data of the BlueFS files nobody writes to anymore, i.e.
+ * RocksDB's SSTs, in blocks of bluefs_buffer_cache_block_size.  A block is
+ * handed out as a bufferptr, so readers that take a bufferlist get it
+ * without a copy.  The cache is one of the store's PriorityCache caches;
+ * its size is whatever the manager (or the fixed ratio) assigns it.
+ */
+class BlueFSBufferCache : public PriorityCache::PriCache {
+public:
+  explicit BlueFSBufferCache(CephContext* cct);
+
+  static constexpr unsigned NUM_SHARDS = 8;
+  /// the cold blocks get 1/PROBATION_RATIO of the cache before they go first
+  static constexpr unsigned PROBATION_RATIO = 4;
+
+  uint64_t get_block_size() const {
+    return block_size;
+  }
+  bool is_enabled() const {
+    return max_bytes > 0;
+  }
+
+  /// get the block of file @p ino at @p off, and make it the hottest one
+  bool lookup(uint64_t ino, uint64_t off, ceph::buffer::ptr* out);
+  bool contains(uint64_t ino, uint64_t off);
+  /**
+   * add a block of file @p ino at @p off
+   *
+   * @param cold: keep it on probation until it is looked up; for the blocks
+   *              read ahead. The blocks on probation are the first to go
+   *              once they take more than 1/PROBATION_RATIO of the cache.
+   */
+  void insert(uint64_t ino, uint64_t off, ceph::buffer::ptr data, bool cold);
+  /// drop the blocks of file @p ino
+  void discard(uint64_t ino);
+  void clear();
+
+  void set_max(uint64_t bytes);
+  uint64_t get_bytes() const;
+
+  // PriorityCache::PriCache
+  int64_t request_cache_bytes(PriorityCache::Priority pri,
+			      uint64_t total_cache) const override;
+  int64_t get_cache_bytes(PriorityCache::Priority pri) const override {
+    return cache_bytes[pri];
+  }
+  int64_t get_cache_bytes() const override;
+  void set_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+    cache_bytes[pri] = bytes;
+  }
+  void add_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+    cache_bytes[pri] += bytes;
+  }
+  int64_t commit_cache_size(uint64_t total_cache) override;
+  int64_t get_committed_size() const override {
+    return committed_bytes;
+  }
+  double get_cache_ratio() const override {
+    return cache_ratio;
+  }
+  void set_cache_ratio(double ratio) override {
+    cache_ratio = ratio;
+  }
+  std::string get_cache_name() const override {
+    return "BlueFS Buffer Cache";
+  }
+
+private:
+  struct Block : public boost::intrusive::list_base_hook<> {
+    uint64_t ino;
+    uint64_t off;
+    ceph::buffer::ptr data;
+    bool cold;  ///< on probation
+    Block(uint64_t ino, uint64_t off, ceph::buffer::ptr&& data, bool cold)
+      : ino(ino), off(off), data(std::move(data)), cold(cold) {}
+  };
+  struct Shard {
+    ceph::mutex lock = ceph::make_mutex("BlueFSBufferCache::Shard::lock");
+    /// (ino, offset) -> block
+    mempool::bluefs::map<std::pair<uint64_t, uint64_t>, Block> blocks;
+    boost::intrusive::list<Block> lru;  ///< the hottest block first
+    boost::intrusive::list<Block> probation;  ///< the cold blocks, newest first
+    uint64_t bytes = 0;
+    uint64_t probation_bytes = 0;
+    uint64_t max = 0;
+
+    void unlink(Block& b);
+    void trim();
+  };
+
+  CephContext* cct;
+  const uint64_t block_size;
+  std::atomic<uint64_t> max_bytes = {0};
+  mutable std::array<Shard, NUM_SHARDS> shards;
+
+  int64_t cache_bytes[PriorityCache::Priority::LAST+1] = {0};
+  int64_t committed_bytes = 0;
+  double cache_ratio = 0;
+
+  Shard& get_shard(uint64_t ino, uint64_t off) {
+    // spread the consecutive blocks of a file
+    return shards[(ino + off / block_size) % NUM_SHARDS];
+  }
+};
+
 class BlueFS {
 public:
   CephContext* cct;
@@ -183,6 +301,7 @@ public:
     int writer_type = 0;    ///< WRITER_*
     int write_hint = WRITE_LIFE_NOT_SET;
 
+    /// serializes the flushes of this writer; taken before BlueFS::lock
     ceph::mutex lock = ceph::make_mutex("BlueFS::FileWriter::lock");
     std::array<IOContext*,MAX_BDEV> iocv; ///< for each bdev
     std::array<bool, MAX_BDEV> dirty_devs;
@@ -272,6 +391,10 @@ public:
     bool random;
     bool ignore_eof;        ///< used when reading our log file
 
+    // adaptive read ahead of the random reads going through the buffer cache
+    std::atomic<uint64_t> next_off = {0};   ///< where the last read ended
+    std::atomic<uint64_t> read_ahead = {0}; ///< current window
+
     ceph::shared_mutex lock {
      ceph::make_shared_mutex(std::string(), false, false, false)
     };
@@ -354,6 +477,8 @@ private:
     return id == shared_alloc_id;
   }
 
+  std::shared_ptr<BlueFSBufferCache> buffer_cache;
+
   class SocketHook;
   SocketHook* asok_hook = nullptr;
   // used to trigger zeros into read (debug / verify)
@@ -384,9 +509,28 @@ private:
   int _allocate_without_fallback(uint8_t id, uint64_t len,
 				 PExtentVector* extents);
 
+  /// the device writes of a flushed range, laid out by _prepare_flush_range
+  struct FlushedRange {
+    bool buffered = false;
+    bool wait_prior_aio = false;  ///< rewrites the partial tail block
+    /// bdev, offset, data
+    std::vector<std::tuple<uint8_t, uint64_t, ceph::buffer::list>> writes;
+
+    bool empty() const {
+      return writes.empty();
+    }
+  };
+
+  int _prepare_flush_range(FileWriter *h, uint64_t offset, uint64_t length,
+			   FlushedRange *fr);
+  void _submit_flush(FileWriter *h, FlushedRange& r);  // safe to call without a lock
   int _flush_range(FileWriter *h, uint64_t offset, uint64_t length);
   int _flush(FileWriter *h, bool force, std::unique_lock<ceph::mutex>& l);
-  int _flush(FileWriter *h, bool force, bool *flushed = nullptr);
+  int _flush(FileWriter *h, bool force, bool *flushed = nullptr,
+	     FlushedRange *pending = nullptr);
+  int _flush_unlocked_io(FileWriter *h, bool force,
+			 std::unique_lock<ceph::mutex>& l,
+			 bool *flushed = nullptr);
   int _fsync(FileWriter *h, std::unique_lock<ceph::mutex>& l);
 
 #ifdef HAVE_LIBAIO
@@ -408,7 +552,7 @@ private:
   };
   void _compact_log_dump_metadata(bluefs_transaction_t *t,
 				  int flags);
-  void _compact_log_sync();
+  void _compact_log_sync(std::unique_lock<ceph::mutex>& l);
   void _compact_log_async(std::unique_lock<ceph::mutex>& l);
 
   void _rewrite_log_and_layout_sync(bool allocate_with_fallback,
@@ -420,7 +564,7 @@ private:
 
   //void _aio_finish(void *priv);
 
-  void _flush_bdev_safely(FileWriter *h);
+  void _flush_bdev_safely(FileWriter *h, FlushedRange *pending = nullptr);
   void flush_bdev();  // this is safe to call without a lock
   void flush_bdev(std::array<bool, MAX_BDEV>& dirty_bdevs);  // this is safe to call without a lock
 
@@ -437,7 +581,22 @@ private:
     FileReader *h,   ///< [in] read from here
     uint64_t offset, ///< [in] offset
     uint64_t len,    ///< [in] this many bytes
-    char *out);      ///< [out] optional: or copy it here
+    char *out);      ///< [out] copy it here
+
+  bool _use_buffer_cache(FileReader *h) const;
+  int64_t _read_cached(
+    FileReader *h,   ///< [in] read from here
+    uint64_t offset, ///< [in] offset
+    uint64_t len,    ///< [in] this many bytes, not past the eof
+    uint64_t ahead,  ///< [in] and cache this many bytes more
+    char *out);      ///< [out] copy it here
+  /// read the blocks [off, off + length) of f into the buffer cache
+  void _fill_buffer_cache(
+    const FileRef& f,
+    uint64_t off,
+    uint64_t length,
+    bool cold,
+    std::vector<ceph::buffer::ptr>::iterator out);
 
   void _invalidate_cache(FileRef f, uint64_t offset, uint64_t length);
 
@@ -567,6 +726,7 @@ public:
   void handle_discard(unsigned dev, interval_set<uint64_t>& to_release);
 
   void flush(FileWriter *h, bool force = false) {
+    std::lock_guard hl(h->lock);
     std::unique_lock l(lock);
     int r = _flush(h, force, l);
     ceph_assert(r == 0);
@@ -593,10 +753,12 @@ public:
     }
   }
   void flush_range(FileWriter *h, uint64_t offset, uint64_t length) {
+    std::lock_guard hl(h->lock);
     std::lock_guard l(lock);
     _flush_range(h, offset, length);
   }
   int fsync(FileWriter *h) {
+    std::lock_guard hl(h->lock);
     std::unique_lock l(lock);
     int r = _fsync(h, l);
     _maybe_compact_log(l);
@@ -616,6 +778,11 @@ public:
     // atomics and asserts).
     return _read_random(h, offset, len, out);
   }
+  /// read ahead into the buffer cache, or h's prefetch buffer w/o it
+  void prefetch(FileReader *h, uint64_t offset, size_t len);
+  std::shared_ptr<BlueFSBufferCache> get_buffer_cache() {
+    return buffer_cache;
+  }
   void invalidate_cache(FileRef f, uint64_t offset, uint64_t len) {
     std::lock_guard l(lock);
     _invalidate_cache(f, offset, len);
@@ -625,6 +792,7 @@ public:
     return _preallocate(f, offset, len);
   }
   int truncate(FileWriter *h, uint64_t offset) {
+    std::lock_guard hl(h->lock);
     std::lock_guard l(lock);
     return _truncate(h, offset);
   }
@@ -124,7 +124,7 @@ class BlueRocksRandomAccessFile : public rocksdb::RandomAccessFile {
 
   // Readahead the file starting from offset by n bytes for caching.
   rocksdb::Status Prefetch(uint64_t offset, size_t n) override {
-    fs->read(h, offset, n, nullptr, nullptr);
+    fs->prefetch(h, offset, n);
     return rocksdb::Status::OK();
   }
 
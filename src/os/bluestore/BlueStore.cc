@@ -4094,6 +4094,9 @@ void *BlueStore::MempoolThread::entry()
 
   binned_kv_cache = store->db->get_priority_cache();
   binned_kv_onode_cache = store->db->get_priority_cache(PREFIX_OBJ);
+  if (store->bluefs && store->cache_bluefs_ratio > 0) {
+    bluefs_cache = store->bluefs->get_buffer_cache();
+  }
   if (store->cache_autotune && binned_kv_cache != nullptr) {
     pcm = std::make_shared<PriorityCache::Manager>(
         store->cct, min, max, target, true, "bluestore-pricache");
@@ -4103,6 +4106,9 @@ void *BlueStore::MempoolThread::entry()
     if (binned_kv_onode_cache != nullptr) {
       pcm->insert("kv_onode", binned_kv_onode_cache, true);
     }
+    if (bluefs_cache != nullptr) {
+      pcm->insert("bluefs", bluefs_cache, true);
+    }
   }
 
   utime_t next_balance = ceph_clock_now();
@@ -4176,6 +4182,10 @@ void *BlueStore::MempoolThread::entry()
   store->_record_allocation_stats();
   stop = false;
   pcm = nullptr;
+  if (bluefs_cache != nullptr) {
+    bluefs_cache->set_max(0);
+    bluefs_cache = nullptr;
+  }
   return NULL;
 }
 
@@ -4187,6 +4197,9 @@ void BlueStore::MempoolThread::_adjust_cache_settings()
   if (binned_kv_onode_cache != nullptr) {
     binned_kv_onode_cache->set_cache_ratio(store->cache_kv_onode_ratio);
   }
+  if (bluefs_cache != nullptr) {
+    bluefs_cache->set_cache_ratio(store->cache_bluefs_ratio);
+  }
   meta_cache->set_cache_ratio(store->cache_meta_ratio);
   data_cache->set_cache_ratio(store->cache_data_ratio);
 }
@@ -4197,6 +4210,7 @@ void BlueStore::MempoolThread::_resize_shards(bool interval_stats)
   size_t buffer_shards = store->buffer_cache_shards.size();
   int64_t kv_used = store->db->get_cache_usage();
   int64_t kv_onode_used = store->db->get_cache_usage(PREFIX_OBJ);
+  int64_t bluefs_used = bluefs_cache ? bluefs_cache->get_bytes() : 0;
   int64_t meta_used = meta_cache->_get_used_bytes();
   int64_t data_used = data_cache->_get_used_bytes();
 
@@ -4205,6 +4219,8 @@ void BlueStore::MempoolThread::_resize_shards(bool interval_stats)
      static_cast<int64_t>(store->cache_kv_ratio * cache_size); 
   int64_t kv_onode_alloc =
      static_cast<int64_t>(store->cache_kv_onode_ratio * cache_size);
+  int64_t bluefs_alloc =
+     static_cast<int64_t>(store->cache_bluefs_ratio * cache_size);
   int64_t meta_alloc =
      static_cast<int64_t>(store->cache_meta_ratio * cache_size);
   int64_t data_alloc =
@@ -4218,6 +4234,9 @@ void BlueStore::MempoolThread::_resize_shards(bool interval_stats)
     if (binned_kv_onode_cache != nullptr) {
       kv_onode_alloc = binned_kv_onode_cache->get_committed_size();
     }
+    if (bluefs_cache != nullptr) {
+      bluefs_alloc = bluefs_cache->get_committed_size();
+    }
   }
   
   if (interval_stats) {
@@ -4226,6 +4245,8 @@ void BlueStore::MempoolThread::_resize_shards(bool interval_stats)
                   << " kv_used: " << kv_used
                   << " kv_onode_alloc: " << kv_onode_alloc
                   << " kv_onode_used: " << kv_onode_used
+                  << " bluefs_alloc: " << bluefs_alloc
+                  << " bluefs_used: " << bluefs_used
                   << " meta_alloc: " << meta_alloc
                   << " meta_used: " << meta_used
                   << " data_alloc: " << data_alloc
@@ -4236,6 +4257,8 @@ void BlueStore::MempoolThread::_resize_shards(bool interval_stats)
                    << " kv_used: " << kv_used
                    << " kv_onode_alloc: " << kv_onode_alloc
                    << " kv_onode_used: " << kv_onode_used
+                   << " bluefs_alloc: " << bluefs_alloc
+                   << " bluefs_used: " << bluefs_used
                    << " meta_alloc: " << meta_alloc
                    << " meta_used: " << meta_used
                    << " data_alloc: " << data_alloc
@@ -4255,6 +4278,9 @@ void BlueStore::MempoolThread::_resize_shards(bool interval_stats)
   for (auto i : store->buffer_cache_shards) {
     i->set_max(max_shard_buffer);
   }
+  if (bluefs_cache != nullptr) {
+    bluefs_cache->set_max(bluefs_alloc);
+  }
 }
 
 void BlueStore::MempoolThread::_update_cache_settings()
@@ -4524,6 +4550,7 @@ const char **BlueStore::get_tracked_conf_keys() const
     "bluestore_deferred_batch_ops_ssd",
     "bluestore_throttle_bytes",
     "bluestore_throttle_deferred_bytes",
+    "bluestore_throttle_target_latency",
     "bluestore_throttle_cost_per_io_hdd",
     "bluestore_throttle_cost_per_io_ssd",
     "bluestore_throttle_cost_per_io",
@@ -4595,6 +4622,7 @@ void BlueStore::handle_conf_change(const ConfigProxy& conf,
   }
   if (changed.count("bluestore_throttle_bytes") ||
       changed.count("bluestore_throttle_deferred_bytes") ||
+      changed.count("bluestore_throttle_target_latency") ||
       changed.count("bluestore_throttle_trace_rate")) {
     throttle.reset_throttle(conf);
   }
@@ -4774,6 +4802,13 @@ int BlueStore::_set_cache_sizes()
     return -EINVAL;
   }
 
+  cache_bluefs_ratio = cct->_conf.get_val<double>("bluestore_cache_bluefs_ratio");
+  if (cache_bluefs_ratio < 0 || cache_bluefs_ratio > 1.0) {
+    derr << __func__ << " bluestore_cache_bluefs_ratio (" << cache_bluefs_ratio
+         << ") must be in range [0,1.0]" << dendl;
+    return -EINVAL;
+  }
+
   if (cache_meta_ratio + cache_kv_ratio > 1.0) {
     derr << __func__ << " bluestore_cache_meta_ratio (" << cache_meta_ratio
          << ") + bluestore_cache_kv_ratio (" << cache_kv_ratio
@@ -4785,7 +4820,8 @@ int BlueStore::_set_cache_sizes()
   cache_data_ratio = (double)1.0 - 
                      (double)cache_meta_ratio - 
                      (double)cache_kv_ratio - 
-                     (double)cache_kv_onode_ratio;
+                     (double)cache_kv_onode_ratio -
+                     (double)cache_bluefs_ratio;
   if (cache_data_ratio < 0) {
     // deal with floating point imprecision
     cache_data_ratio = 0;
@@ -4794,6 +4830,7 @@ int BlueStore::_set_cache_sizes()
   dout(1) << __func__ << " cache_size " << cache_size
           << " meta " << cache_meta_ratio
 	  << " kv " << cache_kv_ratio
+	  << " bluefs " << cache_bluefs_ratio
 	  << " data " << cache_data_ratio
 	  << dendl;
   return 0;
@@ -4999,6 +5036,12 @@ void BlueStore::_init_logger()
   b.add_time_avg(l_bluestore_remove_lat, "remove_lat",
     "Average removal latency");
 
+  // updated by all of the threads submitting and reading
+  for (int idx : {l_bluestore_state_prepare_lat, l_bluestore_throttle_lat,
+		  l_bluestore_submit_lat, l_bluestore_read_lat}) {
+    b.set_sharded(idx);
+  }
+
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 }
@@ -15655,6 +15698,7 @@ bool BlueStore::BlueStoreThrottle::try_start_transaction(
   mono_clock::time_point start_throttle_acquire)
 {
   throttle_bytes.get(txc.cost);
+  txc.throttled = mono_clock::now();
 
   if (!txc.deferred_txn || throttle_deferred_bytes.get_or_fail(txc.cost)) {
     emit_initial_tracepoint(db, txc, start_throttle_acquire);
@@ -15674,9 +15718,11 @@ void BlueStore::BlueStoreThrottle::finish_start_transaction(
   emit_initial_tracepoint(db, txc, start_throttle_acquire);
 }
 
-#if defined(WITH_LTTNG)
 void BlueStore::BlueStoreThrottle::complete_kv(TransContext &txc)
 {
+  // the time spent waiting for the throttle is its doing, not the device's
+  adaptive_bytes.sample(mono_clock::now() - txc.throttled);
+#if defined(WITH_LTTNG)
   pending_kv_ios -= 1;
   ios_completed_since_last_traced++;
   if (txc.tracing) {
@@ -15687,8 +15733,8 @@ void BlueStore::BlueStoreThrottle::complete_kv(TransContext &txc)
       txc.seq,
       ceph::to_seconds<double>(mono_clock::now() - txc.start));
   }
-}
 #endif
+}
 
 #if defined(WITH_LTTNG)
 void BlueStore::BlueStoreThrottle::complete(TransContext &txc)
@@ -1610,6 +1610,7 @@ public:
     uint64_t seq = 0;
     ceph::mono_clock::time_point start;
     ceph::mono_clock::time_point last_stamp;
+    ceph::mono_clock::time_point throttled;  ///< got throttle_bytes
 
     uint64_t last_nid = 0;     ///< if non-zero, highest new nid we allocated
     uint64_t last_blobid = 0;  ///< if non-zero, highest new blobid we allocated
@@ -1629,6 +1630,7 @@ public:
 	ioc(cct, this),
 	start(ceph::mono_clock::now()) {
       last_stamp = start;
+      throttled = start;
       if (on_commits) {
 	oncommits.swap(*on_commits);
       }
@@ -1753,20 +1755,21 @@ public:
 
     Throttle throttle_bytes;           ///< submit to commit
     Throttle throttle_deferred_bytes;  ///< submit to deferred complete
+    AdaptiveThrottle adaptive_bytes;   ///< of throttle_bytes
 
   public:
     BlueStoreThrottle(CephContext *cct) :
       throttle_bytes(cct, "bluestore_throttle_bytes", 0),
-      throttle_deferred_bytes(cct, "bluestore_throttle_deferred_bytes", 0)
+      throttle_deferred_bytes(cct, "bluestore_throttle_deferred_bytes", 0),
+      adaptive_bytes(cct, "bluestore_throttle_bytes", &throttle_bytes)
     {
       reset_throttle(cct->_conf);
     }
 
-#if defined(WITH_LTTNG)
     void complete_kv(TransContext &txc);
+#if defined(WITH_LTTNG)
     void complete(TransContext &txc);
 #else
-    void complete_kv(TransContext &txc) {}
     void complete(TransContext &txc) {}
 #endif
 
@@ -1790,7 +1793,10 @@ public:
       return throttle_deferred_bytes.past_midpoint();
     }
     void reset_throttle(const ConfigProxy &conf) {
-      throttle_bytes.reset_max(conf->bluestore_throttle_bytes);
+      adaptive_bytes.configure(
+	conf->bluestore_throttle_bytes,
+	ceph::make_timespan(
+	  conf.get_val<double>("bluestore_throttle_target_latency")));
       throttle_deferred_bytes.reset_max(
 	conf->bluestore_throttle_bytes +
 	conf->bluestore_throttle_deferred_bytes);
@@ -2151,6 +2157,7 @@ private:
   double cache_meta_ratio = 0;   ///< cache ratio dedicated to metadata
   double cache_kv_ratio = 0;     ///< cache ratio dedicated to kv (e.g., rocksdb)
   double cache_kv_onode_ratio = 0; ///< cache ratio dedicated to kv onodes (e.g., rocksdb onode CF)
+  double cache_bluefs_ratio = 0; ///< cache ratio dedicated to the bluefs buffer cache
   double cache_data_ratio = 0;   ///< cache ratio dedicated to object data
   bool cache_autotune = false;   ///< cache autotune setting
   double cache_autotune_interval = 0; ///< time to wait between cache rebalancing
@@ -2179,6 +2186,7 @@ private:
     bool stop = false;
     std::shared_ptr<PriorityCache::PriCache> binned_kv_cache = nullptr;
     std::shared_ptr<PriorityCache::PriCache> binned_kv_onode_cache = nullptr;
+    std::shared_ptr<BlueFSBufferCache> bluefs_cache = nullptr;
     std::shared_ptr<PriorityCache::Manager> pcm = nullptr;
 
     struct MempoolCache : public PriorityCache::PriCache {
@@ -571,6 +571,9 @@ FileStore::FileStore(CephContext* cct, const std::string &base,
   throttle_bytes(cct, "filestore_bytes", cct->_conf->filestore_caller_concurrency),
   m_ondisk_finisher_num(cct->_conf->filestore_ondisk_finisher_threads),
   m_apply_finisher_num(cct->_conf->filestore_apply_finisher_threads),
+  // fn_fstore<i>: the ondisk finishers' shards, then the apply ones
+  finisher_executor(cct, "fn_fstore",
+		    m_ondisk_finisher_num + m_apply_finisher_num),
   op_tp(cct, "FileStore::op_tp", "tp_fstore_op", cct->_conf->filestore_op_threads, "filestore_op_threads"),
   op_wq(this,
 	ceph::make_timespan(cct->_conf->filestore_op_thread_timeout),
@@ -607,13 +610,14 @@ FileStore::FileStore(CephContext* cct, const std::string &base,
   for (int i = 0; i < m_ondisk_finisher_num; ++i) {
     ostringstream oss;
     oss << "filestore-ondisk-" << i;
-    Finisher *f = new Finisher(cct, oss.str(), "fn_odsk_fstore");
+    Finisher *f = new Finisher(cct, oss.str(), &finisher_executor, i);
     ondisk_finishers.push_back(f);
   }
   for (int i = 0; i < m_apply_finisher_num; ++i) {
     ostringstream oss;
     oss << "filestore-apply-" << i;
-    Finisher *f = new Finisher(cct, oss.str(), "fn_appl_fstore");
+    Finisher *f = new Finisher(cct, oss.str(), &finisher_executor,
+			       m_ondisk_finisher_num + i);
     apply_finishers.push_back(f);
   }
 
@@ -1966,6 +1970,7 @@ int FileStore::mount()
   journal_start();
 
   op_tp.start();
+  finisher_executor.start();
   for (vector<Finisher*>::iterator it = ondisk_finishers.begin(); it != ondisk_finishers.end(); ++it) {
     (*it)->start();
   }
@@ -2090,6 +2095,7 @@ int FileStore::umount()
   for (vector<Finisher*>::iterator it = apply_finishers.begin(); it != apply_finishers.end(); ++it) {
     (*it)->stop();
   }
+  finisher_executor.stop();
 
   if (vdo_fd >= 0) {
     VOID_TEMP_FAILURE_RETRY(::close(vdo_fd));
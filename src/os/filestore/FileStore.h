@@ -386,6 +386,8 @@ private:
   BackoffThrottle throttle_ops, throttle_bytes;
   const int m_ondisk_finisher_num;
   const int m_apply_finisher_num;
+  /// one shard per finisher; the idle ones help the busy ones
+  CompletionExecutor finisher_executor;
   std::vector<Finisher*> ondisk_finishers;
   std::vector<Finisher*> apply_finishers;
 
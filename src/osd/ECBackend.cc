@@ -2515,6 +2515,7 @@ void ECBackend::rollback_append(
 }
 
 int ECBackend::be_deep_scrub(
+  const ScanContext &sctx,
   const hobject_t &poid,
   ScrubMap &map,
   ScrubMapBuilder &pos,
@@ -2545,7 +2546,7 @@ int ECBackend::be_deep_scrub(
   r = store->read(
     ch,
     ghobject_t(
-      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+      poid, ghobject_t::NO_GEN, sctx.shard),
     pos.data_pos,
     stride, bl,
     fadvise_flags);
@@ -2588,11 +2589,11 @@ int ECBackend::be_deep_scrub(
 	return 0;
       }
 
-      if (hinfo->get_chunk_hash(get_parent()->whoami_shard().shard) !=
+      if (hinfo->get_chunk_hash(sctx.shard) !=
 	  pos.data_hash.digest()) {
 	dout(0) << "_scan_list  " << poid << " got incorrect hash on read 0x"
 		<< std::hex << pos.data_hash.digest() << " !=  expected 0x"
-		<< hinfo->get_chunk_hash(get_parent()->whoami_shard().shard)
+		<< hinfo->get_chunk_hash(sctx.shard)
 		<< std::dec << dendl;
 	o.ec_hash_mismatch = true;
 	return 0;
@@ -671,6 +671,7 @@ public:
   bool auto_repair_supported() const override { return true; }
 
   int be_deep_scrub(
+    const ScanContext &sctx,
     const hobject_t &poid,
     ScrubMap &map,
     ScrubMapBuilder &pos,
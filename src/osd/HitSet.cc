@@ -41,6 +41,10 @@ HitSet::HitSet(const HitSet::Params& params)
     impl.reset(new ExplicitObjectHitSet(static_cast<ExplicitObjectHitSet::Params*>(params.impl.get())));
     break;
 
+  case TYPE_COUNT_MIN:
+    impl.reset(new CountMinHitSet(static_cast<CountMinHitSet::Params*>(params.impl.get())));
+    break;
+
   default:
     assert (0 == "unknown HitSet type");
   }
@@ -75,6 +79,9 @@ void HitSet::decode(ceph::buffer::list::const_iterator& bl)
   case TYPE_BLOOM:
     impl.reset(new BloomHitSet);
     break;
+  case TYPE_COUNT_MIN:
+    impl.reset(new CountMinHitSet);
+    break;
   case TYPE_NONE:
     impl.reset(NULL);
     break;
@@ -109,6 +116,10 @@ void HitSet::generate_test_instances(list<HitSet*>& o)
   o.back()->insert(hobject_t());
   o.back()->insert(hobject_t("asdf", "", CEPH_NOSNAP, 123, 1, ""));
   o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
+  o.push_back(new HitSet(new CountMinHitSet(10, 2, 1)));
+  o.back()->insert(hobject_t());
+  o.back()->insert(hobject_t("asdf", "", CEPH_NOSNAP, 123, 1, ""));
+  o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
 }
 
 HitSet::Params::Params(const Params& o) noexcept
@@ -162,6 +173,9 @@ bool HitSet::Params::create_impl(impl_type_t type)
   case TYPE_BLOOM:
     impl.reset(new BloomHitSet::Params);
     break;
+  case TYPE_COUNT_MIN:
+    impl.reset(new CountMinHitSet::Params);
+    break;
   case TYPE_NONE:
     impl.reset(NULL);
     break;
@@ -207,6 +221,8 @@ void HitSet::Params::generate_test_instances(list<HitSet::Params*>& o)
   loop_hitset_params(ExplicitHashHitSet);
   o.push_back(new Params(new ExplicitObjectHitSet::Params));
   loop_hitset_params(ExplicitObjectHitSet);
+  o.push_back(new Params(new CountMinHitSet::Params));
+  loop_hitset_params(CountMinHitSet);
 }
 
 ostream& operator<<(ostream& out, const HitSet::Params& p) {
@@ -254,3 +270,105 @@ void BloomHitSet::dump(Formatter *f) const {
   bloom.dump(f);
   f->close_section();
 }
+
+// -- CountMinHitSet --
+
+namespace {
+uint32_t count_min_width(uint64_t target_size)
+{
+  // ~1 counter per expected object per row keeps the overestimate of a
+  // single row at about one hit; the min over the rows does much better.
+  uint32_t width = 64;
+  while (width < target_size && width < (1u << 30))
+    width <<= 1;
+  return width;
+}
+}
+
+CountMinHitSet::CountMinHitSet(uint64_t target_size, uint32_t depth,
+			       uint64_t seed)
+  : width(count_min_width(target_size)),
+    depth(std::max(depth, 1u)),
+    seed(seed),
+    sample_size(10 * (uint64_t)width),
+    counters(((uint64_t)width * this->depth + 1) / 2, 0)
+{}
+
+uint64_t CountMinHitSet::slot(const hobject_t& o, uint32_t row) const
+{
+  // splitmix64 finalizer over (hash, row, seed)
+  uint64_t z = ((uint64_t)o.get_hash() << 32 | row) + seed +
+    0x9e3779b97f4a7c15ull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  z ^= z >> 31;
+  // width can be up to 2^30, so the index does not fit in 32 bits
+  return (uint64_t)row * width + (z & (width - 1));
+}
+
+void CountMinHitSet::insert(const hobject_t& o)
+{
+  ++count;
+  if (!width)
+    return;
+
+  // conservative update: only raise the counters that hold the minimum
+  unsigned cur = approx_hit_count(o);
+  if (cur == 0)
+    ++unique;
+  for (uint32_t row = 0; row < depth; ++row) {
+    uint64_t idx = slot(o, row);
+    if (get_counter(idx) == cur)
+      inc_counter(idx);
+  }
+
+  if (++samples >= sample_size)
+    halve();
+}
+
+unsigned CountMinHitSet::approx_hit_count(const hobject_t& o) const
+{
+  if (!width)
+    return 0;
+  unsigned m = MAX_COUNT;
+  for (uint32_t row = 0; row < depth && m; ++row)
+    m = std::min<unsigned>(m, get_counter(slot(o, row)));
+  return m;
+}
+
+void CountMinHitSet::halve()
+{
+  for (auto& b : counters)
+    b = (b >> 1) & 0x77;
+  unique /= 2;
+  samples = 0;
+}
+
+CountMinHitSet *CountMinHitSet::decayed() const
+{
+  auto *d = new CountMinHitSet(*this);
+  d->halve();
+  d->count = 0;
+  return d;
+}
+
+bool CountMinHitSet::same_layout(const Params& p) const
+{
+  return std::max(p.depth, 1u) == depth && p.seed == seed &&
+    (p.target_size == 0 || count_min_width(p.target_size) == width);
+}
+
+void CountMinHitSet::Params::dump(Formatter *f) const {
+  f->dump_int("target_size", target_size);
+  f->dump_unsigned("depth", depth);
+  f->dump_int("seed", seed);
+}
+
+void CountMinHitSet::dump(Formatter *f) const {
+  f->dump_unsigned("insert_count", count);
+  f->dump_unsigned("width", width);
+  f->dump_unsigned("depth", depth);
+  f->dump_unsigned("seed", seed);
+  f->dump_unsigned("sample_size", sample_size);
+  f->dump_unsigned("approx_unique_insert_count", unique);
+}
@@ -38,7 +38,8 @@ public:
     TYPE_NONE = 0,
     TYPE_EXPLICIT_HASH = 1,
     TYPE_EXPLICIT_OBJECT = 2,
-    TYPE_BLOOM = 3
+    TYPE_BLOOM = 3,
+    TYPE_COUNT_MIN = 4
   } impl_type_t;
 
   static std::string_view get_type_name(impl_type_t t) {
@@ -47,6 +48,7 @@ public:
     case TYPE_EXPLICIT_HASH: return "explicit_hash";
     case TYPE_EXPLICIT_OBJECT: return "explicit_object";
     case TYPE_BLOOM: return "bloom";
+    case TYPE_COUNT_MIN: return "count_min";
     default: return "???";
     }
   }
@@ -55,6 +57,11 @@ public:
       return get_type_name(impl->get_type());
     return get_type_name(TYPE_NONE);
   }
+  impl_type_t get_type() const {
+    if (impl)
+      return impl->get_type();
+    return TYPE_NONE;
+  }
 
   /// abstract interface for a HitSet implementation
   class Impl {
@@ -63,6 +70,11 @@ public:
     virtual bool is_full() const = 0;
     virtual void insert(const hobject_t& o) = 0;
     virtual bool contains(const hobject_t& o) const = 0;
+    /// approximate number of hits on the object (only counting sets
+    /// track more than presence)
+    virtual unsigned approx_hit_count(const hobject_t& o) const {
+      return contains(o) ? 1 : 0;
+    }
     virtual unsigned insert_count() const = 0;
     virtual unsigned approx_unique_insert_count() const = 0;
     virtual void encode(ceph::buffer::list &bl) const = 0;
@@ -147,6 +159,10 @@ public:
   bool contains(const hobject_t& o) const {
     return impl->contains(o);
   }
+  /// approximate number of hits on the object
+  unsigned approx_hit_count(const hobject_t& o) const {
+    return impl->approx_hit_count(o);
+  }
 
   unsigned insert_count() const {
     return impl->insert_count();
@@ -452,4 +468,162 @@ public:
 };
 WRITE_CLASS_ENCODER(BloomHitSet)
 
+/**
+ * use a count-min sketch to track (approximate) hit counts
+ *
+ * Records how often each object was hit, in fixed memory, with 4-bit
+ * saturating counters. To keep the counts fresh (TinyLFU-style), all the
+ * counters are halved every sample_size inserts and whenever the set is
+ * carried over into a new period (see decayed()), so a single set
+ * approximates the access frequency over several periods.
+ *
+ * Once all the counters of an object reach MAX_COUNT, its further hits
+ * are not counted until the next halving: approx_hit_count() never
+ * exceeds MAX_COUNT, and callers comparing it against a threshold must
+ * cap the threshold below that.
+ */
+class CountMinHitSet : public HitSet::Impl {
+public:
+  static constexpr unsigned MAX_COUNT = 15;
+
+private:
+  uint32_t width = 0;         ///< counters per row (a power of 2)
+  uint32_t depth = 0;         ///< number of rows/hash functions
+  uint64_t seed = 0;
+  uint64_t sample_size = 0;   ///< inserts between halvings of the counters
+  uint64_t count = 0;         ///< inserts in this period
+  uint64_t samples = 0;       ///< inserts since the last halving
+  uint64_t unique = 0;        ///< approx number of distinct objects counted
+  std::vector<uint8_t> counters;  ///< depth * width nibbles
+
+  uint64_t slot(const hobject_t& o, uint32_t row) const;
+  uint8_t get_counter(uint64_t idx) const {
+    uint8_t b = counters[idx >> 1];
+    return (idx & 1) ? (b >> 4) : (b & 0x0f);
+  }
+  void inc_counter(uint64_t idx) {
+    if (get_counter(idx) < MAX_COUNT)
+      counters[idx >> 1] += (idx & 1) ? 0x10 : 0x01;
+  }
+  void halve();
+
+public:
+  class Params : public HitSet::Params::Impl {
+  public:
+    HitSet::impl_type_t get_type() const override {
+      return HitSet::TYPE_COUNT_MIN;
+    }
+    HitSet::Impl *get_new_impl() const override {
+      return new CountMinHitSet;
+    }
+
+    uint64_t target_size;  ///< number of distinct objects we expect to track
+    uint32_t depth;        ///< number of hash functions (rows)
+    uint64_t seed;         ///< seed for the row hashes
+
+    Params()
+      : target_size(0), depth(4), seed(0) {}
+    Params(uint64_t t, uint32_t d, uint64_t s)
+      : target_size(t), depth(d), seed(s) {}
+    ~Params() override {}
+
+    void encode(ceph::buffer::list& bl) const override {
+      ENCODE_START(1, 1, bl);
+      encode(target_size, bl);
+      encode(depth, bl);
+      encode(seed, bl);
+      ENCODE_FINISH(bl);
+    }
+    void decode(ceph::buffer::list::const_iterator& bl) override {
+      DECODE_START(1, bl);
+      decode(target_size, bl);
+      decode(depth, bl);
+      decode(seed, bl);
+      DECODE_FINISH(bl);
+    }
+    void dump(ceph::Formatter *f) const override;
+    void dump_stream(std::ostream& o) const override {
+      o << "target_size: " << target_size
+	<< ", depth: " << depth
+	<< ", seed: " << seed;
+    }
+    static void generate_test_instances(std::list<Params*>& o) {
+      o.push_back(new Params);
+      o.push_back(new Params(1000, 3, 99));
+    }
+  };
+
+  CountMinHitSet() {}
+  CountMinHitSet(uint64_t target_size, uint32_t depth, uint64_t seed);
+  explicit CountMinHitSet(const CountMinHitSet::Params *p)
+    : CountMinHitSet(p->target_size, p->depth, p->seed) {}
+  CountMinHitSet(const CountMinHitSet &o) = default;
+
+  /// a copy of this set, with halved counters, to continue counting in a
+  /// new period
+  CountMinHitSet *decayed() const;
+
+  /// would a set built from these params have the same layout as ours?
+  bool same_layout(const Params& p) const;
+
+  HitSet::Impl *clone() const override {
+    return new CountMinHitSet(*this);
+  }
+
+  HitSet::impl_type_t get_type() const override {
+    return HitSet::TYPE_COUNT_MIN;
+  }
+  bool is_full() const override {
+    // the periodic halving keeps the error bounded however many inserts
+    return false;
+  }
+  void insert(const hobject_t& o) override;
+  bool contains(const hobject_t& o) const override {
+    return approx_hit_count(o) > 0;
+  }
+  unsigned approx_hit_count(const hobject_t& o) const override;
+  unsigned insert_count() const override {
+    return count;
+  }
+  unsigned approx_unique_insert_count() const override {
+    return unique;
+  }
+
+  void encode(ceph::buffer::list &bl) const override {
+    ENCODE_START(1, 1, bl);
+    encode(width, bl);
+    encode(depth, bl);
+    encode(seed, bl);
+    encode(sample_size, bl);
+    encode(count, bl);
+    encode(samples, bl);
+    encode(unique, bl);
+    encode(counters, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(ceph::buffer::list::const_iterator& bl) override {
+    DECODE_START(1, bl);
+    decode(width, bl);
+    decode(depth, bl);
+    decode(seed, bl);
+    decode(sample_size, bl);
+    decode(count, bl);
+    decode(samples, bl);
+    decode(unique, bl);
+    decode(counters, bl);
+    DECODE_FINISH(bl);
+    if (counters.size() != ((uint64_t)width * depth + 1) / 2)
+      throw ceph::buffer::malformed_input("bad CountMinHitSet layout");
+  }
+  void dump(ceph::Formatter *f) const override;
+  static void generate_test_instances(std::list<CountMinHitSet*>& o) {
+    o.push_back(new CountMinHitSet);
+    o.push_back(new CountMinHitSet(10, 2, 1));
+    o.back()->insert(hobject_t());
+    o.back()->insert(hobject_t("asdf", "", CEPH_NOSNAP, 123, 1, ""));
+    o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
+  }
+};
+WRITE_CLASS_ENCODER(CountMinHitSet)
+
 #endif
@@ -288,6 +288,7 @@ OSDService::OSDService(OSD *osd, ceph::async::io_context_pool& poolctx) :
   next_notif_id(0),
   recovery_request_timer(cct, recovery_request_lock, false),
   sleep_timer(cct, sleep_lock, false),
+  scrub_scanner(cct),
   reserver_finisher(cct),
   local_reserver(cct, &reserver_finisher, cct->_conf->osd_max_backfills,
 		 cct->_conf->osd_min_recovery_priority),
@@ -546,11 +547,40 @@ void OSDService::init()
   mono_timer.resume();
 
   agent_thread.create("osd_srv_agent");
+  scrub_scanner.start();
 
   if (cct->_conf->osd_recovery_delay_start)
     defer_recovery(cct->_conf->osd_recovery_delay_start);
 }
 
+void OSDService::init_client_throttles()
+{
+  Messenger::Policy pol = client_messenger->get_policy(entity_name_t::TYPE_CLIENT);
+  if (pol.throttler_bytes) {
+    client_bytes_adaptive = std::make_unique<AdaptiveThrottle>(
+      cct, "osd_client_bytes", pol.throttler_bytes);
+  }
+  if (pol.throttler_messages) {
+    client_messages_adaptive = std::make_unique<AdaptiveThrottle>(
+      cct, "osd_client_messages", pol.throttler_messages);
+  }
+  reset_client_throttles();
+}
+
+void OSDService::reset_client_throttles()
+{
+  auto target = ceph::make_timespan(
+    cct->_conf.get_val<double>("osd_client_throttle_target_latency"));
+  uint64_t bytes_cap = cct->_conf->osd_client_message_size_cap;
+  if (client_bytes_adaptive && bytes_cap > 0) {
+    client_bytes_adaptive->configure(bytes_cap, target);
+  }
+  uint64_t messages_cap = cct->_conf->osd_client_message_cap;
+  if (client_messages_adaptive && messages_cap > 0) {
+    client_messages_adaptive->configure(messages_cap, target);
+  }
+}
+
 void OSDService::final_init()
 {
   objecter->start(osdmap.get());
@@ -2369,6 +2399,36 @@ int OSD::pre_init()
   return 0;
 }
 
+void OSD::set_numa_spread()
+{
+  if (!cct->_conf.get_val<bool>("osd_numa_spread")) {
+    return;
+  }
+  if (cct->_conf.get_val<int64_t>("osd_numa_node") >= 0) {
+    dout(1) << __func__ << " osd_numa_node is set, not spreading" << dendl;
+    return;
+  }
+  std::set<int> nodes;
+  int r = get_numa_nodes(&nodes);
+  if (r < 0) {
+    derr << __func__ << " unable to list numa nodes: " << cpp_strerror(r)
+	 << dendl;
+    return;
+  }
+  if (nodes.size() < 2) {
+    dout(1) << __func__ << " single numa node, not spreading" << dendl;
+    return;
+  }
+  // contiguous runs of shards per node
+  std::vector<int> v(nodes.begin(), nodes.end());
+  for (uint32_t i = 0; i < num_shards; ++i) {
+    shards[i]->numa_node = v[i * v.size() / num_shards];
+  }
+  numa_spread_nodes = nodes;
+  dout(1) << __func__ << " spreading " << num_shards << " shards over numa nodes "
+	  << nodes << dendl;
+}
+
 int OSD::set_numa_affinity()
 {
   // storage numa node
@@ -2425,6 +2485,12 @@ int OSD::set_numa_affinity()
     // this takes precedence over the automagic logic above
     numa_node = node;
   }
+  if (!numa_spread_nodes.empty()) {
+    dout(1) << __func__ << " shards spread over numa nodes "
+	    << numa_spread_nodes << ", not setting numa affinity" << dendl;
+    numa_node = -1;
+    return 0;
+  }
   if (numa_node >= 0) {
     int r = get_numa_node_cpu_set(numa_node, &numa_cpu_set_size, &numa_cpu_set);
     if (r < 0) {
@@ -3302,7 +3368,13 @@ int OSD::enable_disable_fuse(bool stop)
 
 size_t OSD::get_num_cache_shards()
 {
-  return cct->_conf.get_val<Option::size_t>("osd_num_cache_shards");
+  size_t n = cct->_conf.get_val<Option::size_t>("osd_num_cache_shards");
+  if (!numa_spread_nodes.empty() && n % num_shards) {
+    // a PG's cache shard must belong to its op shard, hence to its node:
+    // both are picked by hash_to_shard()
+    n += num_shards - n % num_shards;
+  }
+  return n;
 }
 
 int OSD::get_num_op_shards()
@@ -3399,6 +3471,7 @@ int OSD::init()
   dout(2) << "journal " << journal_path << dendl;
   ceph_assert(store);  // call pre_init() first!
 
+  set_numa_spread();
   store->set_cache_shards(get_num_cache_shards());
 
   int r = store->mount();
@@ -3642,6 +3715,7 @@ int OSD::init()
   update_log_config();
 
   // i'm ready!
+  service.init_client_throttles();
   client_messenger->add_dispatcher_tail(&mgrc);
   client_messenger->add_dispatcher_tail(this);
   cluster_messenger->add_dispatcher_head(this);
@@ -4234,6 +4308,8 @@ int OSD::shutdown()
   osd_op_tp.stop();
   dout(10) << "op sharded tp stopped" << dendl;
 
+  service.scrub_scanner.stop();
+
   dout(10) << "stopping agent" << dendl;
   service.agent_stop();
 
@@ -4763,6 +4839,13 @@ void OSD::load_pgs()
     derr << "failed to list pgs: " << cpp_strerror(-r) << dendl;
   }
 
+  // with osd_numa_spread, make and read each pg on the node of its shard,
+  // so that it is allocated where the threads of the shard run
+  size_t cpu_set_size = sizeof(cpu_set_t);
+  cpu_set_t cpu_set;
+  bool numa_rebind = !numa_spread_nodes.empty() &&
+    pthread_getaffinity_np(pthread_self(), cpu_set_size, &cpu_set) == 0;
+
   int num = 0;
   for (vector<coll_t>::iterator it = ls.begin();
        it != ls.end();
@@ -4782,6 +4865,15 @@ void OSD::load_pgs()
     }
 
     dout(10) << "pgid " << pgid << " coll " << coll_t(pgid) << dendl;
+    uint32_t shard_index = pgid.hash_to_shard(shards.size());
+    if (int node = shards[shard_index]->numa_node;
+	numa_rebind && node != get_thread_numa_node()) {
+      int r = set_thread_numa_affinity(node);
+      if (r < 0) {
+	derr << __func__ << " unable to bind to numa node " << node
+	     << ": " << cpp_strerror(r) << dendl;
+      }
+    }
     epoch_t map_epoch = 0;
     int r = PG::peek_map_epoch(store, pgid, &map_epoch);
     if (r < 0) {
@@ -4832,11 +4924,8 @@ void OSD::load_pgs()
       recursive_remove_collection(cct, store, pgid, *it);
       continue;
     }
-    {
-      uint32_t shard_index = pgid.hash_to_shard(shards.size());
-      assert(NULL != shards[shard_index]);
-      store->set_collection_commit_queue(pg->coll, &(shards[shard_index]->context_queue));
-    }
+    assert(NULL != shards[shard_index]);
+    store->set_collection_commit_queue(pg->coll, &(shards[shard_index]->context_queue));
 
     pg->reg_next_scrub();
 
@@ -4846,6 +4935,9 @@ void OSD::load_pgs()
     register_pg(pg);
     ++num;
   }
+  if (numa_rebind) {
+    set_thread_cpu_affinity(cpu_set_size, &cpu_set);
+  }
   dout(0) << __func__ << " opened " << num << " pgs" << dendl;
 }
 
@@ -6673,6 +6765,9 @@ void OSD::_collect_metadata(map<string,string> *pm)
     }
   }
 
+  if (!numa_spread_nodes.empty()) {
+    (*pm)["numa_spread_nodes"] = stringify(numa_spread_nodes);
+  }
   if (numa_node >= 0) {
     (*pm)["numa_node"] = stringify(numa_node);
     (*pm)["numa_node_cpus"] = cpu_set_to_str_list(numa_cpu_set_size,
@@ -8044,14 +8139,29 @@ void OSD::handle_osd_map(MOSDMap *m)
 
       OSDMap *o = new OSDMap;
       if (e > 1) {
-	bufferlist obl;
-        bool got = get_map_bl(e - 1, obl);
-	if (!got) {
-	  auto p = added_maps_bl.find(e - 1);
-	  ceph_assert(p != added_maps_bl.end());
-	  obl = p->second;
+	// build on the previous map if we still have it in memory instead of
+	// decoding it again.  the copy shares the previous epoch's crush map,
+	// which apply_incremental() only replaces if the incremental carries
+	// a new one.
+	OSDMapRef prev;
+	if (auto q = added_maps.find(e - 1); q != added_maps.end()) {
+	  prev = q->second;
+	} else {
+	  std::lock_guard l(service.map_cache_lock);
+	  prev = service.map_cache.lookup(e - 1);
+	}
+	if (prev) {
+	  o->deepish_copy_from(*prev);
+	} else {
+	  bufferlist obl;
+	  bool got = get_map_bl(e - 1, obl);
+	  if (!got) {
+	    auto p = added_maps_bl.find(e - 1);
+	    ceph_assert(p != added_maps_bl.end());
+	    obl = p->second;
+	  }
+	  o->decode(obl);
 	}
-	o->decode(obl);
       }
 
       OSDMap::Incremental inc;
@@ -9818,11 +9928,13 @@ void OSD::dequeue_op(
   op->set_dequeued_time(now);
 
   utime_t latency = now - m->get_recv_stamp();
-  dout(10) << "dequeue_op " << op << " prio " << m->get_priority()
-	   << " cost " << m->get_cost()
-	   << " latency " << latency
-	   << " " << *m
-	   << " pg " << *pg << dendl;
+  ldout_args(cct, 10,
+	     "osd.{} {} dequeue_op {} prio {} cost {} latency {} {} tid {}"
+	     " from {}.{} pg {}",
+	     whoami, get_osdmap_epoch(), op.get(), m->get_priority(),
+	     m->get_cost(), (double)latency, m->get_type_name(), m->get_tid(),
+	     m->get_source().type_str(), m->get_source().num(), pg->pg_id);
+  dout(20) << "dequeue_op " << op << " " << *m << " pg " << *pg << dendl;
 
   logger->tinc(l_osd_op_before_dequeue_op_lat, latency);
 
@@ -9839,7 +9951,8 @@ void OSD::dequeue_op(
   pg->do_request(op, handle);
 
   // finish
-  dout(10) << "dequeue_op " << op << " finish" << dendl;
+  ldout_args(cct, 10, "osd.{} {} dequeue_op {} finish",
+	     whoami, get_osdmap_epoch(), op.get());
   OID_EVENT_TRACE_WITH_MSG(m, "DEQUEUE_OP_END", false);
 }
 
@@ -9937,6 +10050,7 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_recovery_delay_start",
     "osd_client_message_size_cap",
     "osd_client_message_cap",
+    "osd_client_throttle_target_latency",
     "osd_heartbeat_min_size",
     "osd_heartbeat_interval",
     "osd_object_clean_region_max_num_intervals",
@@ -10048,19 +10162,10 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
     service.kick_recovery_queue();
   }
 
-  if (changed.count("osd_client_message_cap")) {
-    uint64_t newval = cct->_conf->osd_client_message_cap;
-    Messenger::Policy pol = client_messenger->get_policy(entity_name_t::TYPE_CLIENT);
-    if (pol.throttler_messages && newval > 0) {
-      pol.throttler_messages->reset_max(newval);
-    }
-  }
-  if (changed.count("osd_client_message_size_cap")) {
-    uint64_t newval = cct->_conf->osd_client_message_size_cap;
-    Messenger::Policy pol = client_messenger->get_policy(entity_name_t::TYPE_CLIENT);
-    if (pol.throttler_bytes && newval > 0) {
-      pol.throttler_bytes->reset_max(newval);
-    }
+  if (changed.count("osd_client_message_cap") ||
+      changed.count("osd_client_message_size_cap") ||
+      changed.count("osd_client_throttle_target_latency")) {
+    service.reset_client_throttles();
   }
   if (changed.count("osd_object_clean_region_max_num_intervals")) {
     ObjectCleanRegions::set_max_num_intervals(cct->_conf->osd_object_clean_region_max_num_intervals);
@@ -10635,6 +10740,19 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   auto& sdata = osd->shards[shard_index];
   ceph_assert(sdata);
 
+  // a thread serves one shard only: bind it on its first run, so that what
+  // the shard allocates from then on is on its node; load_pgs() placed the
+  // PGs which existed at boot
+  static thread_local bool numa_bound = false;
+  if (!numa_bound && sdata->numa_node >= 0) {
+    numa_bound = true;
+    int r = set_thread_numa_affinity(sdata->numa_node);
+    if (r < 0) {
+      derr << __func__ << " unable to bind to numa node " << sdata->numa_node
+	   << ": " << cpp_strerror(r) << dendl;
+    }
+  }
+
   // If all threads of shards do oncommits, there is a out-of-order
   // problem.  So we choose the thread which has the smallest
   // thread_index(thread_index < num_shards) of shard to do oncommit
@@ -10966,6 +11084,11 @@ void OSD::ShardedOpWQ::_enqueue(OpSchedulerItem&& item) {
   OSDShard* sdata = osd->shards[shard_index];
   assert (NULL != sdata);
 
+  if (sdata->numa_node >= 0) {
+    osd->logger->inc(get_current_numa_node() == sdata->numa_node ?
+		     l_osd_numa_local_enqueue : l_osd_numa_remote_enqueue);
+  }
+
   bool empty = true;
   {
     std::lock_guard l{sdata->shard_lock};
@@ -37,6 +37,7 @@
 
 #include "OpRequest.h"
 #include "Session.h"
+#include "ScrubScanner.h"
 
 #include "osd/scheduler/OpScheduler.h"
 
@@ -53,6 +54,7 @@
 #include "common/EventTrace.h"
 #include "osd/osd_perf_counters.h"
 #include "common/Finisher.h"
+#include "common/Throttle.h"
 
 #define CEPH_OSD_PROTOCOL    10 /* cluster internal */
 
@@ -528,6 +530,9 @@ public:
   ceph::mutex sleep_lock = ceph::make_mutex("OSDService::sleep_lock");
   SafeTimer sleep_timer;
 
+  // For scanning scrub chunks off the op threads
+  Scrub::ParallelScanner scrub_scanner;
+
   // -- tids --
   // for ops i issue
   std::atomic<unsigned int> last_tid{0};
@@ -758,6 +763,23 @@ public:
   void shutdown_reserver();
   void shutdown();
 
+  // -- client throttles --
+private:
+  /// adapt the client messenger's throttles to the latency of the ops
+  std::unique_ptr<AdaptiveThrottle> client_bytes_adaptive;
+  std::unique_ptr<AdaptiveThrottle> client_messages_adaptive;
+public:
+  void init_client_throttles();
+  void reset_client_throttles();
+  void sample_client_op_latency(ceph::timespan lat) {
+    if (client_bytes_adaptive) {
+      client_bytes_adaptive->sample(lat);
+    }
+    if (client_messages_adaptive) {
+      client_messages_adaptive->sample(lat);
+    }
+  }
+
   // -- stats --
   ceph::mutex stat_lock = ceph::make_mutex("OSDService::stat_lock");
   osd_stat_t osd_stat;
@@ -1009,6 +1031,9 @@ struct OSDShard {
 
   std::string shard_name;
 
+  /// the node the shard's threads are bound to, with osd_numa_spread
+  int numa_node = -1;
+
   std::string sdata_wait_lock_name;
   ceph::mutex sdata_wait_lock;
   ceph::condition_variable sdata_cond;
@@ -1138,6 +1163,7 @@ protected:
   int numa_node = -1;
   size_t numa_cpu_set_size = 0;
   cpu_set_t numa_cpu_set;
+  std::set<int> numa_spread_nodes;  ///< the shards are spread over
 
   bool store_is_rotational = true;
   bool journal_is_rotational = true;
@@ -2085,6 +2111,7 @@ public:
 
   int enable_disable_fuse(bool stop);
   int set_numa_affinity();
+  void set_numa_spread();
 
   void suicide(int exitcode);
   int shutdown();
@@ -1,6 +1,8 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <algorithm>
+
 #include "OSDMapMapping.h"
 #include "OSDMap.h"
 
@@ -8,14 +10,17 @@
 
 #include "common/debug.h"
 
+using std::set;
 using std::vector;
 
 MEMPOOL_DEFINE_OBJECT_FACTORY(OSDMapMapping, osdmapmapping,
 			      osdmap_mapping);
 
 // ensure that we have a PoolMappings for each pool and that
-// the dimensions (pg_num and size) match up.
-void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
+// the dimensions (pg_num and size) match up.  the ids of the pools
+// whose tables are (re)created are added to reset_pools.
+void OSDMapMapping::_init_mappings(const OSDMap& osdmap,
+				   set<int64_t> *reset_pools)
 {
   num_pgs = 0;
   auto q = pools.begin();
@@ -39,6 +44,9 @@ void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
     pools.emplace(p.first, PoolMapping(p.second.get_size(),
 				       p.second.get_pg_num(),
 				       p.second.is_erasure()));
+    if (reset_pools) {
+      reset_pools->insert(p.first);
+    }
   }
   pools.erase(q, pools.end());
   ceph_assert(pools.size() == osdmap.get_pools().size());
@@ -59,6 +67,251 @@ void OSDMapMapping::update(const OSDMap& osdmap, pg_t pgid)
   _update_range(osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
 }
 
+std::unique_ptr<OSDMapMapping::MappingJob> OSDMapMapping::start_update(
+  const OSDMap& map,
+  ParallelPGMapper& mapper,
+  unsigned pgs_per_item,
+  const set<int64_t>& pools,
+  const set<pg_t>& pgs)
+{
+  set<int64_t> reset_pools = pools;
+  std::unique_ptr<MappingJob> job(new MappingJob(&map, this, &reset_pools));
+  vector<pg_t> todo;
+  for (auto pool : reset_pools) {
+    auto pi = map.get_pg_pool(pool);
+    if (!pi) {
+      continue;
+    }
+    for (unsigned ps = 0; ps < pi->get_pg_num(); ++ps) {
+      todo.emplace_back(ps, pool);
+    }
+  }
+  for (auto pgid : pgs) {
+    if (reset_pools.count(pgid.pool())) {
+      continue;
+    }
+    auto pi = map.get_pg_pool(pgid.pool());
+    if (pi && pgid.ps() < pi->get_pg_num()) {
+      todo.push_back(pgid);
+    }
+  }
+  if (todo.empty()) {
+    // nothing to remap; we are done already
+    job->finish = ceph_clock_now();
+    job->complete();
+  } else {
+    mapper.queue(job.get(), pgs_per_item, todo);
+  }
+  return job;
+}
+
+namespace {
+
+bool same_crush_tunables(const CrushWrapper& a, const CrushWrapper& b)
+{
+  return a.get_choose_local_tries() == b.get_choose_local_tries() &&
+    a.get_choose_local_fallback_tries() == b.get_choose_local_fallback_tries() &&
+    a.get_choose_total_tries() == b.get_choose_total_tries() &&
+    a.get_chooseleaf_descend_once() == b.get_chooseleaf_descend_once() &&
+    a.get_chooseleaf_vary_r() == b.get_chooseleaf_vary_r() &&
+    a.get_chooseleaf_stable() == b.get_chooseleaf_stable() &&
+    a.get_straw_calc_version() == b.get_straw_calc_version() &&
+    a.get_allowed_bucket_algs() == b.get_allowed_bucket_algs();
+}
+
+// do the rule's steps, and the subtrees it takes from, map the same in
+// both crush maps?
+bool same_crush_rule(const CrushWrapper& a, const CrushWrapper& b, int rule)
+{
+  if (a.rule_exists(rule) != b.rule_exists(rule)) {
+    return false;
+  }
+  if (!a.rule_exists(rule)) {
+    return true;
+  }
+  int len = a.get_rule_len(rule);
+  if (len != b.get_rule_len(rule)) {
+    return false;
+  }
+  vector<int> todo;
+  for (int i = 0; i < len; ++i) {
+    if (a.get_rule_op(rule, i) != b.get_rule_op(rule, i) ||
+	a.get_rule_arg1(rule, i) != b.get_rule_arg1(rule, i) ||
+	a.get_rule_arg2(rule, i) != b.get_rule_arg2(rule, i)) {
+      return false;
+    }
+    if (a.get_rule_op(rule, i) == CRUSH_RULE_TAKE) {
+      todo.push_back(a.get_rule_arg1(rule, i));
+    }
+  }
+  set<int> seen;
+  while (!todo.empty()) {
+    int id = todo.back();
+    todo.pop_back();
+    if (id >= 0 || !seen.insert(id).second) {
+      continue;
+    }
+    if (a.bucket_exists(id) != b.bucket_exists(id)) {
+      return false;
+    }
+    if (!a.bucket_exists(id)) {
+      continue;
+    }
+    int size = a.get_bucket_size(id);
+    if (size != b.get_bucket_size(id) ||
+	a.get_bucket_type(id) != b.get_bucket_type(id) ||
+	a.get_bucket_alg(id) != b.get_bucket_alg(id) ||
+	a.get_bucket_hash(id) != b.get_bucket_hash(id)) {
+      return false;
+    }
+    for (int pos = 0; pos < size; ++pos) {
+      int item = a.get_bucket_item(id, pos);
+      if (item != b.get_bucket_item(id, pos) ||
+	  a.get_bucket_item_weight(id, pos) !=
+	  b.get_bucket_item_weight(id, pos)) {
+	return false;
+      }
+      todo.push_back(item);
+    }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+bool OSDMapMapping::get_affected_pgs(
+  const OSDMap& osdmap,
+  const CrushWrapper *prev_crush,
+  const OSDMap::Incremental& inc,
+  set<int64_t> *pools,
+  set<pg_t> *pgs)
+{
+  if (inc.fullmap.length() ||
+      inc.new_max_osd >= 0 ||
+      inc.change_stretch_mode) {
+    return false;
+  }
+
+  // changed pool parameters (pg_num, size, rule, ...)
+  for (auto& p : inc.new_pools) {
+    pools->insert(p.first);
+  }
+
+  // a new crush map only remaps the pools whose rule maps differently.
+  // apply_incremental() keeps the previous CrushWrapper if the blob is
+  // unchanged.
+  if (inc.crush.length() && osdmap.crush.get() != prev_crush) {
+    if (!prev_crush ||
+	!same_crush_tunables(*prev_crush, *osdmap.crush) ||
+	!prev_crush->choose_args.empty() ||
+	!osdmap.crush->choose_args.empty()) {
+      return false;
+    }
+    std::map<int, bool> rule_same;
+    for (auto& p : osdmap.get_pools()) {
+      int rule = p.second.get_crush_rule();
+      auto r = rule_same.find(rule);
+      if (r == rule_same.end()) {
+	r = rule_same.emplace(
+	  rule, same_crush_rule(*prev_crush, *osdmap.crush, rule)).first;
+      }
+      if (!r->second) {
+	pools->insert(p.first);
+      }
+    }
+  }
+
+  // explicit remappings that were added or removed
+  for (auto& p : inc.new_pg_temp) {
+    pgs->insert(p.first);
+  }
+  for (auto& p : inc.new_primary_temp) {
+    pgs->insert(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap) {
+    pgs->insert(p.first);
+  }
+  for (auto& p : inc.old_pg_upmap) {
+    pgs->insert(p);
+  }
+  for (auto& p : inc.new_pg_upmap_items) {
+    pgs->insert(p.first);
+  }
+  for (auto& p : inc.old_pg_upmap_items) {
+    pgs->insert(p);
+  }
+
+  // osds that went up/down/in/out or changed their primary affinity
+  set<int> osds;
+  for (auto& p : inc.new_state) {
+    osds.insert(p.first);
+  }
+  for (auto& p : inc.new_up_client) {
+    osds.insert(p.first);
+  }
+  for (auto& p : inc.new_weight) {
+    osds.insert(p.first);
+  }
+  for (auto& p : inc.new_primary_affinity) {
+    osds.insert(p.first);
+  }
+  if (osds.empty()) {
+    return true;
+  }
+
+  // an osd can only show up in a pg's mapping through its pool's crush
+  // rule, or through an explicit pg_temp, primary_temp or upmap entry.
+  std::map<int, bool> rule_affected;
+  for (auto& p : osdmap.get_pools()) {
+    int rule = p.second.get_crush_rule();
+    auto r = rule_affected.find(rule);
+    if (r == rule_affected.end()) {
+      std::map<int, float> wmap;
+      bool affected = true;
+      if (osdmap.crush->get_rule_weight_osd_map(rule, &wmap) >= 0) {
+	affected = std::any_of(
+	  wmap.begin(), wmap.end(),
+	  [&osds](auto& w) { return osds.count(w.first) > 0; });
+      }
+      r = rule_affected.emplace(rule, affected).first;
+    }
+    if (r->second) {
+      pools->insert(p.first);
+    }
+  }
+  auto touches = [&osds](auto& v) {
+    return std::any_of(v.begin(), v.end(),
+		       [&osds](int osd) { return osds.count(osd) > 0; });
+  };
+  for (auto& p : *osdmap.pg_temp) {
+    if (!pools->count(p.first.pool()) && touches(p.second)) {
+      pgs->insert(p.first);
+    }
+  }
+  for (auto& p : *osdmap.primary_temp) {
+    if (!pools->count(p.first.pool()) && osds.count(p.second)) {
+      pgs->insert(p.first);
+    }
+  }
+  for (auto& p : *osdmap.pg_upmap) {
+    if (!pools->count(p.first.pool()) && touches(p.second)) {
+      pgs->insert(p.first);
+    }
+  }
+  for (auto& p : *osdmap.pg_upmap_items) {
+    if (pools->count(p.first.pool())) {
+      continue;
+    }
+    for (auto& [from, to] : p.second) {
+      if (osds.count(from) || osds.count(to)) {
+	pgs->insert(p.first);
+	break;
+      }
+    }
+  }
+  return true;
+}
+
 void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
 {
   acting_rmap.resize(osdmap.get_max_osd());
@@ -90,6 +343,7 @@ void OSDMapMapping::_finish(const OSDMap& osdmap)
 {
   _build_rmap(osdmap);
   epoch = osdmap.get_epoch();
+  valid = true;
 }
 
 void OSDMapMapping::_dump()
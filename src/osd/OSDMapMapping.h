@@ -7,13 +7,13 @@
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include "osd/osd_types.h"
+#include "osd/OSDMap.h"
 #include "common/WorkQueue.h"
 #include "common/Cond.h"
 
-class OSDMap;
-
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
 public:
@@ -254,8 +254,10 @@ private:
   //unused: mempool::osdmap_mapping::vector<std::vector<pg_t>> up_rmap;  // osd -> pg
   epoch_t epoch = 0;
   uint64_t num_pgs = 0;
+  bool valid = false;  ///< tables fully reflect 'epoch' (no aborted update)
 
-  void _init_mappings(const OSDMap& osdmap);
+  void _init_mappings(const OSDMap& osdmap,
+		      std::set<int64_t> *reset_pools = nullptr);
   void _update_range(
     const OSDMap& map,
     int64_t pool,
@@ -263,8 +265,10 @@ private:
 
   void _build_rmap(const OSDMap& osdmap);
 
-  void _start(const OSDMap& osdmap) {
-    _init_mappings(osdmap);
+  void _start(const OSDMap& osdmap,
+	      std::set<int64_t> *reset_pools = nullptr) {
+    valid = false;
+    _init_mappings(osdmap, reset_pools);
   }
   void _finish(const OSDMap& osdmap);
 
@@ -274,11 +278,16 @@ private:
 
   struct MappingJob : public ParallelPGMapper::Job {
     OSDMapMapping *mapping;
-    MappingJob(const OSDMap *osdmap, OSDMapMapping *m)
+    MappingJob(const OSDMap *osdmap, OSDMapMapping *m,
+	       std::set<int64_t> *reset_pools = nullptr)
       : Job(osdmap), mapping(m) {
-      mapping->_start(*osdmap);
+      mapping->_start(*osdmap, reset_pools);
+    }
+    void process(const std::vector<pg_t>& pgs) override {
+      for (auto pgid : pgs) {
+	mapping->_update_range(*osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
+      }
     }
-    void process(const std::vector<pg_t>& pgs) override {}
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
@@ -338,10 +347,47 @@ public:
     return job;
   }
 
+  /**
+   * start an incremental update
+   *
+   * Only remap the given pools and pgs (as collected by get_affected_pgs()
+   * for the incrementals since get_epoch()); the rest of the tables are
+   * carried over as-is.  Pools whose dimensions changed are always remapped
+   * in full.
+   */
+  std::unique_ptr<MappingJob> start_update(
+    const OSDMap& map,
+    ParallelPGMapper& mapper,
+    unsigned pgs_per_item,
+    const std::set<int64_t>& pools,
+    const std::set<pg_t>& pgs);
+
+  /**
+   * collect the pools and pgs whose mapping may have changed by an incremental
+   *
+   * @param osdmap the map with the incremental applied
+   * @param prev_crush the crush map before the incremental, if known
+   * @param inc the incremental
+   * @param pools [out] pools that need a full remap
+   * @param pgs [out] individual pgs that need to be remapped
+   * @return false if the incremental requires remapping everything
+   */
+  static bool get_affected_pgs(
+    const OSDMap& osdmap,
+    const CrushWrapper *prev_crush,
+    const OSDMap::Incremental& inc,
+    std::set<int64_t> *pools,
+    std::set<pg_t> *pgs);
+
   epoch_t get_epoch() const {
     return epoch;
   }
 
+  /// false if the last update was aborted, i.e., the tables are inconsistent
+  bool is_valid() const {
+    return valid;
+  }
+
   uint64_t get_num_pgs() const {
     return num_pgs;
   }
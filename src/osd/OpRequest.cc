@@ -67,7 +67,7 @@ void OpRequest::_dump(Formatter *f) const
 
   {
     f->open_array_section("events");
-    std::lock_guard l(lock);
+    auto events = get_events();
 
     for (auto i = events.begin(); i != events.end(); ++i) {
       f->open_object_section("event");
@@ -116,11 +116,21 @@ int OpRequest::maybe_init_op_info(const OSDMap &osdmap) {
   return ret;
 }
 
-void OpRequest::mark_flag_point(uint8_t flag, const char *s) {
+const TrackedOp::event_id_t OpRequest::EVENT_QUEUED_FOR_PG =
+  TrackedOp::register_event("queued_for_pg");
+const TrackedOp::event_id_t OpRequest::EVENT_REACHED_PG =
+  TrackedOp::register_event("reached_pg");
+const TrackedOp::event_id_t OpRequest::EVENT_STARTED =
+  TrackedOp::register_event("started");
+const TrackedOp::event_id_t OpRequest::EVENT_COMMIT_SENT =
+  TrackedOp::register_event("commit_sent");
+
+void OpRequest::mark_flag_point(uint8_t flag, event_id_t ev) {
 #ifdef WITH_LTTNG
   uint8_t old_flags = hit_flag_points;
+  const char *s = get_event_name(ev);
 #endif
-  mark_event(s);
+  mark_event(ev);
   hit_flag_points |= flag;
   latest_flag_point = flag;
   tracepoint(oprequest, mark_flag_point, reqid.name._type,
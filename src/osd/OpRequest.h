@@ -91,6 +91,11 @@ public:
   epoch_t min_epoch = 0;      ///< min epoch needed to handle this msg
 
   bool hitset_inserted;
+
+  /// the memory of the containers which live no longer than we do, e.g.
+  /// the callbacks of the write we carry, see PrimaryLogPG::OpContext;
+  /// only used under the PG lock
+  mempool::osd_op::arena<1024> arena;
 #ifdef HAVE_JAEGER
   jspan osd_parent_span = nullptr;
   void set_osd_parent_span(jspan& span) {
@@ -130,22 +135,22 @@ public:
   }
 
   void mark_queued_for_pg() {
-    mark_flag_point(flag_queued_for_pg, "queued_for_pg");
+    mark_flag_point(flag_queued_for_pg, EVENT_QUEUED_FOR_PG);
   }
   void mark_reached_pg() {
-    mark_flag_point(flag_reached_pg, "reached_pg");
+    mark_flag_point(flag_reached_pg, EVENT_REACHED_PG);
   }
   void mark_delayed(const std::string& s) {
     mark_flag_point_string(flag_delayed, s);
   }
   void mark_started() {
-    mark_flag_point(flag_started, "started");
+    mark_flag_point(flag_started, EVENT_STARTED);
   }
   void mark_sub_op_sent(const std::string& s) {
     mark_flag_point_string(flag_sub_op_sent, s);
   }
   void mark_commit_sent() {
-    mark_flag_point(flag_commit_sent, "commit_sent");
+    mark_flag_point(flag_commit_sent, EVENT_COMMIT_SENT);
   }
 
   utime_t get_dequeued_time() const {
@@ -162,7 +167,12 @@ public:
   typedef boost::intrusive_ptr<OpRequest> Ref;
 
 private:
-  void mark_flag_point(uint8_t flag, const char *s);
+  static const event_id_t EVENT_QUEUED_FOR_PG;
+  static const event_id_t EVENT_REACHED_PG;
+  static const event_id_t EVENT_STARTED;
+  static const event_id_t EVENT_COMMIT_SENT;
+
+  void mark_flag_point(uint8_t flag, event_id_t ev);
   void mark_flag_point_string(uint8_t flag, const std::string& s);
 };
 
@@ -2474,10 +2474,12 @@ bool PG::can_discard_request(OpRequestRef& op)
 
 void PG::do_peering_event(PGPeeringEventRef evt, PeeringCtx &rctx)
 {
-  dout(10) << __func__ << ": " << evt->get_desc() << dendl;
+  ldout_args(cct, 10, PG_ARGS_PREFIX "do_peering_event: {}",
+	     PG_ARGS_PREFIX_ARGS(this), evt->get_desc());
   ceph_assert(have_same_or_newer_map(evt->get_epoch_sent()));
   if (old_peering_evt(evt)) {
-    dout(10) << "discard old " << evt->get_desc() << dendl;
+    ldout_args(cct, 10, PG_ARGS_PREFIX "discard old {}",
+	       PG_ARGS_PREFIX_ARGS(this), evt->get_desc());
   } else {
     recovery_state.handle_event(evt, &rctx);
   }
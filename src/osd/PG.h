@@ -162,6 +162,14 @@ class PGRecoveryStats {
   }
 };
 
+/// the prefix of a PG's lines logged with ldout_args(): its id and epoch,
+/// without the state which gen_prefix() renders, so that nothing is
+/// formatted when logging in binary form; the lines logged with dout()
+/// carry the state
+#define PG_ARGS_PREFIX "osd.{} pg_epoch: {} pg[{}] "
+#define PG_ARGS_PREFIX_ARGS(pg)						\
+  (pg)->pg_whoami.osd, (pg)->get_osdmap_epoch(), (pg)->info.pgid
+
 /** PG - Replica Placement Group
  *
  */
@@ -607,11 +607,23 @@ PGBackend *PGBackend::build_pg_backend(
   }
 }
 
+PGBackend::ScanContext PGBackend::get_scan_context() const
+{
+  ScanContext sctx;
+  sctx.cct = cct;
+  sctx.shard = get_parent()->whoami_shard().shard;
+  ostringstream ss;
+  get_parent()->gen_dbg_prefix(ss);
+  sctx.prefix = ss.str();
+  return sctx;
+}
+
 int PGBackend::be_scan_list(
+  const ScanContext &sctx,
   ScrubMap &map,
   ScrubMapBuilder &pos)
 {
-  dout(10) << __func__ << " " << pos << dendl;
+  ldpp_dout(&sctx, 10) << __func__ << " " << pos << dendl;
   ceph_assert(!pos.done());
   ceph_assert(pos.pos < pos.ls.size());
   hobject_t& poid = pos.ls[pos.pos];
@@ -620,7 +632,7 @@ int PGBackend::be_scan_list(
   int r = store->stat(
     ch,
     ghobject_t(
-      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+      poid, ghobject_t::NO_GEN, sctx.shard),
     &st,
     true);
   if (r == 0) {
@@ -630,23 +642,23 @@ int PGBackend::be_scan_list(
     store->getattrs(
       ch,
       ghobject_t(
-	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+	poid, ghobject_t::NO_GEN, sctx.shard),
       o.attrs);
 
     if (pos.deep) {
-      r = be_deep_scrub(poid, map, pos, o);
+      r = be_deep_scrub(sctx, poid, map, pos, o);
     }
-    dout(25) << __func__ << "  " << poid << dendl;
+    ldpp_dout(&sctx, 25) << __func__ << "  " << poid << dendl;
   } else if (r == -ENOENT) {
-    dout(25) << __func__ << "  " << poid << " got " << r
+    ldpp_dout(&sctx, 25) << __func__ << "  " << poid << " got " << r
 	     << ", skipping" << dendl;
   } else if (r == -EIO) {
-    dout(25) << __func__ << "  " << poid << " got " << r
+    ldpp_dout(&sctx, 25) << __func__ << "  " << poid << " got " << r
 	     << ", stat_error" << dendl;
     ScrubMap::object &o = map.objects[poid];
     o.stat_error = true;
   } else {
-    derr << __func__ << " got: " << cpp_strerror(r) << dendl;
+    ldpp_dout(&sctx, -1) << __func__ << " got: " << cpp_strerror(r) << dendl;
     ceph_abort();
   }
   if (r == -EINPROGRESS) {
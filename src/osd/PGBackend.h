@@ -581,7 +581,28 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
      Context *on_complete, bool fast_read = false) = 0;
 
    virtual bool auto_repair_supported() const = 0;
+   /// what be_scan_list() needs from the PG: captured under the PG lock, so
+   /// that the scan itself can run without it
+   struct ScanContext : public DoutPrefixProvider {
+     CephContext *cct = nullptr;
+     shard_id_t shard;
+     std::string prefix;  ///< the PG's log prefix
+     std::ostream& gen_prefix(std::ostream& out) const override {
+       return out << prefix;
+     }
+     CephContext *get_cct() const override { return cct; }
+     unsigned get_subsys() const override { return ceph_subsys_osd; }
+   };
+   ScanContext get_scan_context() const;
+   /// may be_scan_list(sctx, ...) be called without holding the PG lock?
+   virtual bool be_scan_list_is_reentrant() const { return false; }
+   int be_scan_list(
+     ScrubMap &map,
+     ScrubMapBuilder &pos) {
+     return be_scan_list(get_scan_context(), map, pos);
+   }
    int be_scan_list(
+     const ScanContext &sctx,
      ScrubMap &map,
      ScrubMapBuilder &pos);
    bool be_compare_scrub_objects(
@@ -618,6 +639,7 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
    virtual uint64_t be_get_ondisk_size(
      uint64_t logical_size) = 0;
    virtual int be_deep_scrub(
+     const ScanContext &sctx,
      const hobject_t &oid,
      ScrubMap &map,
      ScrubMapBuilder &pos,
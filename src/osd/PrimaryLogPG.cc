@@ -79,6 +79,7 @@
 #include <common/CDC.h>
 
 MEMPOOL_DEFINE_OBJECT_FACTORY(PrimaryLogPG, replicatedpg, osd);
+MEMPOOL_DEFINE_OBJECT_FACTORY(PrimaryLogPG::OpContext, pg_op_context, osd_op);
 
 using std::list;
 using std::ostream;
@@ -2071,11 +2072,17 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
     }
   }
 
-  dout(10) << "do_op " << *m
-	   << (op->may_write() ? " may_write" : "")
-	   << (op->may_read() ? " may_read" : "")
-	   << (op->may_cache() ? " may_cache" : "")
-	   << " -> " << (write_ordered ? "write-ordered" : "read-ordered")
+  ldout_args(cct, 10,
+	     PG_ARGS_PREFIX "do_op {}.{}:{} {} {} ops{}{}{} -> {} flags {}",
+	     PG_ARGS_PREFIX_ARGS(this),
+	     m->get_source().type_str(), m->get_source().num(), m->get_tid(),
+	     head.oid.name, m->ops.size(),
+	     op->may_write() ? " may_write" : "",
+	     op->may_read() ? " may_read" : "",
+	     op->may_cache() ? " may_cache" : "",
+	     write_ordered ? "write-ordered" : "read-ordered",
+	     m->get_flags());
+  dout(20) << "do_op " << *m
 	   << " flags " << ceph_osd_flag_string(m->get_flags())
 	   << dendl;
 
@@ -2753,6 +2760,20 @@ bool PrimaryLogPG::maybe_promote(ObjectContextRef obc,
   dout(20) << __func__ << " missing_oid " << missing_oid
 	   << "  in_hit_set " << in_hit_set << dendl;
 
+  if (recency && hit_set && hit_set->get_type() == HitSet::TYPE_COUNT_MIN) {
+    // the sketch carries the (decaying) hit counts over from the previous
+    // periods, so it alone tells us how hot the object is. Our own hit has
+    // been inserted already. The counts saturate, so a recency at or
+    // above the maximum count would never promote anything.
+    const hobject_t& oid = obc.get() ? obc->obs.oi.soid : missing_oid;
+    unsigned hits = hit_set->approx_hit_count(oid);
+    dout(20) << __func__ << " " << oid << " approx " << hits << " hits" << dendl;
+    if (hits <= std::min<unsigned>(recency, CountMinHitSet::MAX_COUNT - 1)) {
+      return false;	// not promoting
+    }
+    recency = 0;
+  }
+
   switch (recency) {
   case 0:
     break;
@@ -3934,7 +3955,8 @@ void PrimaryLogPG::promote_object(ObjectContextRef obc,
 void PrimaryLogPG::execute_ctx(OpContext *ctx)
 {
   FUNCTRACE(cct);
-  dout(10) << __func__ << " " << ctx << dendl;
+  ldout_args(cct, 10, PG_ARGS_PREFIX "execute_ctx {}",
+	     PG_ARGS_PREFIX_ARGS(this), ctx);
   ctx->reset_obs(ctx->obc);
   ctx->update_log_only = false; // reset in case finish_copyfrom() is re-running execute_ctx
   OpRequestRef op = ctx->op;
@@ -3971,15 +3993,20 @@ void PrimaryLogPG::execute_ctx(OpContext *ctx)
     ctx->at_version = get_next_version();
     ctx->mtime = m->get_mtime();
 
-    dout(10) << __func__ << " " << soid << " " << *ctx->ops
-	     << " ov " << obc->obs.oi.version << " av " << ctx->at_version
+    ldout_args(cct, 10,
+	       PG_ARGS_PREFIX "execute_ctx {} {} ops ov {}'{} av {}'{}",
+	       PG_ARGS_PREFIX_ARGS(this), soid.oid.name, ctx->ops->size(),
+	       obc->obs.oi.version.epoch, obc->obs.oi.version.version,
+	       ctx->at_version.epoch, ctx->at_version.version);
+    dout(20) << __func__ << " " << soid << " " << *ctx->ops
 	     << " snapc " << ctx->snapc
 	     << " snapset " << obc->ssc->snapset
 	     << dendl;
   } else {
-    dout(10) << __func__ << " " << soid << " " << *ctx->ops
-	     << " ov " << obc->obs.oi.version
-	     << dendl;
+    ldout_args(cct, 10, PG_ARGS_PREFIX "execute_ctx {} {} ops ov {}'{}",
+	       PG_ARGS_PREFIX_ARGS(this), soid.oid.name, ctx->ops->size(),
+	       obc->obs.oi.version.epoch, obc->obs.oi.version.version);
+    dout(20) << __func__ << " " << soid << " " << *ctx->ops << dendl;
   }
 
   if (!ctx->user_at_version)
@@ -4124,7 +4151,9 @@ void PrimaryLogPG::execute_ctx(OpContext *ctx)
 	MOSDOpReply *reply = ctx->reply;
 	ctx->reply = nullptr;
 	reply->add_flags(CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK);
-	dout(10) << " sending reply on " << *m << " " << reply << dendl;
+	ldout_args(cct, 10, PG_ARGS_PREFIX " sending reply on {}.{}:{} {}",
+		   PG_ARGS_PREFIX_ARGS(this), m->get_source().type_str(),
+		   m->get_source().num(), m->get_tid(), reply);
 	osd->send_message_osd_client(reply, m->get_connection());
 	ctx->sent_reply = true;
 	ctx->op->mark_commit_sent();
@@ -4187,6 +4216,9 @@ void PrimaryLogPG::log_op_stats(const OpRequest& op,
   osd->logger->inc(l_osd_op_inb, inb);
   osd->logger->tinc(l_osd_op_lat, latency);
   osd->logger->tinc(l_osd_op_process_lat, process_latency);
+  // from the admission by the client throttles
+  osd->sample_client_op_latency(
+    ceph::timespan((now - m->get_throttle_stamp()).to_nsec()));
 
   if (op.may_read() && op.may_write()) {
     osd->logger->inc(l_osd_op_rw);
@@ -8452,12 +8484,12 @@ void PrimaryLogPG::truncate_update_size_and_usage(
   }
 }
 
+template<typename Container>
 void PrimaryLogPG::complete_disconnect_watches(
   ObjectContextRef obc,
-  const list<watch_disconnect_t> &to_disconnect)
+  const Container &to_disconnect)
 {
-  for (list<watch_disconnect_t>::const_iterator i =
-	 to_disconnect.begin();
+  for (auto i = to_disconnect.begin();
        i != to_disconnect.end();
        ++i) {
     pair<uint64_t, entity_name_t> watcher(i->cookie, i->name);
@@ -8488,7 +8520,7 @@ void PrimaryLogPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
   if (!session)
     return;
 
-  for (list<pair<watch_info_t,bool> >::iterator i = ctx->watch_connects.begin();
+  for (auto i = ctx->watch_connects.begin();
        i != ctx->watch_connects.end();
        ++i) {
     pair<uint64_t, entity_name_t> watcher(i->first.cookie, entity);
@@ -8513,7 +8545,7 @@ void PrimaryLogPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
     watch->connect(conn, i->second);
   }
 
-  for (list<notify_info_t>::iterator p = ctx->notifies.begin();
+  for (auto p = ctx->notifies.begin();
        p != ctx->notifies.end();
        ++p) {
     dout(10) << "do_osd_op_effects, notify " << *p << dendl;
@@ -8538,7 +8570,7 @@ void PrimaryLogPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
     notif->init();
   }
 
-  for (list<OpContext::NotifyAck>::iterator p = ctx->notify_acks.begin();
+  for (auto p = ctx->notify_acks.begin();
        p != ctx->notify_acks.end();
        ++p) {
     if (p->watch_cookie)
@@ -10920,12 +10952,17 @@ void PrimaryLogPG::eval_repop(RepGather *repop)
     auto eval_span = jaeger_tracing::child_span(__func__, repop->op->osd_parent_span);
   }
  #endif
-  dout(10) << "eval_repop " << *repop
-    << (repop->op && repop->op->get_req<MOSDOp>() ? "" : " (no op)") << dendl;
+  ldout_args(cct, 10,
+	     PG_ARGS_PREFIX "eval_repop repgather({} {}'{} rep_tid={}"
+	     " committed?={} r={}){}",
+	     PG_ARGS_PREFIX_ARGS(this), repop, repop->v.epoch, repop->v.version,
+	     repop->rep_tid, repop->all_committed, repop->r,
+	     repop->op && repop->op->get_req<MOSDOp>() ? "" : " (no op)");
 
   // ondisk?
   if (repop->all_committed) {
-    dout(10) << " commit: " << *repop << dendl;
+    ldout_args(cct, 10, PG_ARGS_PREFIX " commit: repgather({})",
+	       PG_ARGS_PREFIX_ARGS(this), repop);
     for (auto p = repop->on_committed.begin();
 	 p != repop->on_committed.end();
 	 repop->on_committed.erase(p++)) {
@@ -10948,7 +10985,8 @@ void PrimaryLogPG::eval_repop(RepGather *repop)
 
     publish_stats_to_osd();
 
-    dout(10) << " removing " << *repop << dendl;
+    ldout_args(cct, 10, PG_ARGS_PREFIX " removing repgather({})",
+	       PG_ARGS_PREFIX_ARGS(this), repop);
     ceph_assert(!repop_queue.empty());
     dout(20) << "   q front is " << *repop_queue.front() << dendl;
     if (repop_queue.front() == repop) {
@@ -14059,6 +14097,33 @@ void PrimaryLogPG::hit_set_create()
 
     dout(10) << __func__ << " target_size " << p->target_size
 	     << " fpp " << p->get_fpp() << dendl;
+  } else if (pool.info.hit_set_params.get_type() == HitSet::TYPE_COUNT_MIN) {
+    CountMinHitSet::Params *p =
+      static_cast<CountMinHitSet::Params*>(params.impl.get());
+
+    // keep counting in (a decayed copy of) the previous set, so the access
+    // frequency survives across periods without consulting the archives
+    if (hit_set && hit_set->get_type() == HitSet::TYPE_COUNT_MIN) {
+      CountMinHitSet *prev = static_cast<CountMinHitSet*>(hit_set->impl.get());
+      if (prev->same_layout(*p)) {
+	dout(20) << __func__ << " carrying over the decayed counts" << dendl;
+	hit_set.reset(new HitSet(prev->decayed()));
+	hit_set_start_stamp = now;
+	return;
+      }
+    }
+
+    if (p->target_size == 0)
+      p->target_size = cct->_conf->osd_hit_set_max_size;
+    if (p->target_size <
+	static_cast<uint64_t>(cct->_conf->osd_hit_set_min_size))
+      p->target_size = cct->_conf->osd_hit_set_min_size;
+    if (p->target_size
+	> static_cast<uint64_t>(cct->_conf->osd_hit_set_max_size))
+      p->target_size = cct->_conf->osd_hit_set_max_size;
+
+    dout(10) << __func__ << " target_size " << p->target_size
+	     << " depth " << p->depth << dendl;
   }
   hit_set.reset(new HitSet(params));
   hit_set_start_stamp = now;
@@ -14972,6 +15037,11 @@ void PrimaryLogPG::agent_estimate_temp(const hobject_t& oid, int *temp)
   ceph_assert(hit_set);
   ceph_assert(temp);
   *temp = 0;
+  if (hit_set->get_type() == HitSet::TYPE_COUNT_MIN) {
+    // the current sketch already covers the previous periods
+    *temp = hit_set->approx_hit_count(oid) * 1000000;
+    return;
+  }
   if (hit_set->contains(oid))
     *temp = 1000000;
   unsigned i = 0;
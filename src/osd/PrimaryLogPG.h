@@ -587,9 +587,10 @@ public:
     watch_disconnect_t(uint64_t c, entity_name_t n, bool sd)
       : cookie(c), name(n), send_disconnect(sd) {}
   };
+  template<typename Container>
   void complete_disconnect_watches(
     ObjectContextRef obc,
-    const std::list<watch_disconnect_t> &to_disconnect);
+    const Container &to_disconnect);
 
   struct OpFinisher {
     virtual ~OpFinisher() {
@@ -602,6 +603,11 @@ public:
    * Capture all object state associated with an in-progress read or write.
    */
   struct OpContext {
+    MEMPOOL_CLASS_HELPERS();
+
+    /// the containers which die with the op take their memory from its
+    /// arena, see arena_alloc(); it goes with the last of us and the
+    /// RepGather holding op
     OpRequestRef op;
     osd_reqid_t reqid;
     std::vector<OSDOp> *ops;
@@ -624,9 +630,9 @@ public:
     ObjectCleanRegions clean_regions;
 
     // side effects
-    std::list<std::pair<watch_info_t,bool> > watch_connects; ///< new watch + will_ping flag
-    std::list<watch_disconnect_t> watch_disconnects; ///< old watch + send_discon
-    std::list<notify_info_t> notifies;
+    mempool::arena_list<std::pair<watch_info_t,bool> > watch_connects; ///< new watch + will_ping flag
+    mempool::arena_list<watch_disconnect_t> watch_disconnects; ///< old watch + send_discon
+    mempool::arena_list<notify_info_t> notifies;
     struct NotifyAck {
       std::optional<uint64_t> watch_cookie;
       uint64_t notify_id;
@@ -637,7 +643,7 @@ public:
 	reply_bl = std::move(rbl);
       }
     };
-    std::list<NotifyAck> notify_acks;
+    mempool::arena_list<NotifyAck> notify_acks;
 
     uint64_t bytes_written, bytes_read;
 
@@ -675,10 +681,10 @@ public:
 
     hobject_t new_temp_oid, discard_temp_oid;  ///< temp objects we should start/stop tracking
 
-    std::list<std::function<void()>> on_applied;
-    std::list<std::function<void()>> on_committed;
-    std::list<std::function<void()>> on_finish;
-    std::list<std::function<void()>> on_success;
+    mempool::arena_list<std::function<void()>> on_applied;
+    mempool::arena_list<std::function<void()>> on_committed;
+    mempool::arena_list<std::function<void()>> on_finish;
+    mempool::arena_list<std::function<void()>> on_success;
     template <typename F>
     void register_on_finish(F &&f) {
       on_finish.emplace_back(std::forward<F>(f));
@@ -712,7 +718,7 @@ public:
     RWState::State lock_type;
     ObcLockManager lock_manager;
 
-    std::map<int, std::unique_ptr<OpFinisher>> op_finishers;
+    mempool::arena_map<int, std::unique_ptr<OpFinisher>> op_finishers;
 
     OpContext(const OpContext& other);
     const OpContext& operator=(const OpContext& other);
@@ -726,15 +732,24 @@ public:
       new_obs(obs->oi, obs->exists),
       modify(false), user_modify(false), undirty(false), cache_operation(false),
       ignore_cache(false), ignore_log_op_stats(false), update_log_only(false),
+      watch_connects(arena_alloc()),
+      watch_disconnects(arena_alloc()),
+      notifies(arena_alloc()),
+      notify_acks(arena_alloc()),
       bytes_written(0), bytes_read(0), user_at_version(0),
       current_osd_subop_num(0),
       obc(obc),
       reply(NULL), pg(_pg),
       num_read(0),
       num_write(0),
+      on_applied(arena_alloc()),
+      on_committed(arena_alloc()),
+      on_finish(arena_alloc()),
+      on_success(arena_alloc()),
       sent_reply(false),
       inflightreads(0),
-      lock_type(RWState::RWNONE) {
+      lock_type(RWState::RWNONE),
+      op_finishers(arena_alloc()) {
       if (obc->ssc) {
 	new_snapset = obc->ssc->snapset;
 	snapset = &obc->ssc->snapset;
@@ -745,13 +760,22 @@ public:
       op(_op), reqid(_reqid), ops(_ops), obs(NULL), snapset(0),
       modify(false), user_modify(false), undirty(false), cache_operation(false),
       ignore_cache(false), ignore_log_op_stats(false), update_log_only(false),
+      watch_connects(arena_alloc()),
+      watch_disconnects(arena_alloc()),
+      notifies(arena_alloc()),
+      notify_acks(arena_alloc()),
       bytes_written(0), bytes_read(0), user_at_version(0),
       current_osd_subop_num(0),
       reply(NULL), pg(_pg),
       num_read(0),
       num_write(0),
+      on_applied(arena_alloc()),
+      on_committed(arena_alloc()),
+      on_finish(arena_alloc()),
+      on_success(arena_alloc()),
       inflightreads(0),
-      lock_type(RWState::RWNONE) {}
+      lock_type(RWState::RWNONE),
+      op_finishers(arena_alloc()) {}
     void reset_obs(ObjectContextRef obc) {
       new_obs = ObjectState(obc->obs.oi, obc->obs.exists);
       if (obc->ssc) {
@@ -771,6 +795,10 @@ public:
 	delete i->second.second;
       }
     }
+    /// the internal ops, without an OpRequest, use the heap
+    mempool::arena_allocator<char> arena_alloc() {
+      return mempool::arena_allocator<char>(op ? &op->arena : nullptr);
+    }
     uint64_t get_features() {
       if (op && op->get_req()) {
         return op->get_req()->get_connection()->get_features();
@@ -805,9 +833,10 @@ public:
 
     ObcLockManager lock_manager;
 
-    std::list<std::function<void()>> on_committed;
-    std::list<std::function<void()>> on_success;
-    std::list<std::function<void()>> on_finish;
+    /// from the arena of op, if they came from an OpContext
+    mempool::arena_list<std::function<void()>> on_committed;
+    mempool::arena_list<std::function<void()>> on_success;
+    mempool::arena_list<std::function<void()>> on_finish;
 
     RepGather(
       OpContext *c, ceph_tid_t rt,
@@ -629,12 +629,13 @@ void ReplicatedBackend::do_repop_reply(OpRequestRef op)
 }
 
 int ReplicatedBackend::be_deep_scrub(
+  const ScanContext &sctx,
   const hobject_t &poid,
   ScrubMap &map,
   ScrubMapBuilder &pos,
   ScrubMap::object &o)
 {
-  dout(10) << __func__ << " " << poid << " pos " << pos << dendl;
+  ldpp_dout(&sctx, 10) << __func__ << " " << poid << " pos " << pos << dendl;
   int r;
   uint32_t fadvise_flags = CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL |
                            CEPH_OSD_OP_FLAG_FADVISE_DONTNEED |
@@ -657,12 +658,12 @@ int ReplicatedBackend::be_deep_scrub(
     r = store->read(
       ch,
       ghobject_t(
-	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+	poid, ghobject_t::NO_GEN, sctx.shard),
       pos.data_pos,
       cct->_conf->osd_deep_scrub_stride, bl,
       fadvise_flags);
     if (r < 0) {
-      dout(20) << __func__ << "  " << poid << " got "
+      ldpp_dout(&sctx, 20) << __func__ << "  " << poid << " got "
 	       << r << " on read, read_error" << dendl;
       o.read_error = true;
       return 0;
@@ -672,7 +673,7 @@ int ReplicatedBackend::be_deep_scrub(
     }
     pos.data_pos += r;
     if (r == cct->_conf->osd_deep_scrub_stride) {
-      dout(20) << __func__ << "  " << poid << " more data, digest so far 0x"
+      ldpp_dout(&sctx, 20) << __func__ << "  " << poid << " more data, digest so far 0x"
 	       << std::hex << pos.data_hash.digest() << std::dec << dendl;
       return -EINPROGRESS;
     }
@@ -680,7 +681,7 @@ int ReplicatedBackend::be_deep_scrub(
     pos.data_pos = -1;
     o.digest = pos.data_hash.digest();
     o.digest_present = true;
-    dout(20) << __func__ << "  " << poid << " done with data, digest 0x"
+    ldpp_dout(&sctx, 20) << __func__ << "  " << poid << " done with data, digest 0x"
 	     << std::hex << o.digest << std::dec << dendl;
   }
 
@@ -692,17 +693,17 @@ int ReplicatedBackend::be_deep_scrub(
     r = store->omap_get_header(
       ch,
       ghobject_t(
-	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+	poid, ghobject_t::NO_GEN, sctx.shard),
       &hdrbl, true);
     if (r == -EIO) {
-      dout(20) << __func__ << "  " << poid << " got "
+      ldpp_dout(&sctx, 20) << __func__ << "  " << poid << " got "
 	       << r << " on omap header read, read_error" << dendl;
       o.read_error = true;
       return 0;
     }
     if (r == 0 && hdrbl.length()) {
       bool encoded = false;
-      dout(25) << "CRC header " << cleanbin(hdrbl, encoded, true) << dendl;
+      ldpp_dout(&sctx, 25) << "CRC header " << cleanbin(hdrbl, encoded, true) << dendl;
       pos.omap_hash << hdrbl;
     }
   }
@@ -711,7 +712,7 @@ int ReplicatedBackend::be_deep_scrub(
   ObjectMap::ObjectMapIterator iter = store->get_omap_iterator(
     ch,
     ghobject_t(
-      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard));
+      poid, ghobject_t::NO_GEN, sctx.shard));
   ceph_assert(iter);
   if (pos.omap_pos.length()) {
     iter->lower_bound(pos.omap_pos);
@@ -736,7 +737,7 @@ int ReplicatedBackend::be_deep_scrub(
       return -EINPROGRESS;
     }
     if (iter->status() < 0) {
-      dout(25) << __func__ << "  " << poid
+      ldpp_dout(&sctx, 25) << __func__ << "  " << poid
 	       << " on omap scan, db status error" << dendl;
       o.read_error = true;
       return 0;
@@ -747,7 +748,7 @@ int ReplicatedBackend::be_deep_scrub(
 	osd_deep_scrub_large_omap_object_key_threshold ||
       pos.omap_bytes > cct->_conf->
 	osd_deep_scrub_large_omap_object_value_sum_threshold) {
-    dout(25) << __func__ << " " << poid
+    ldpp_dout(&sctx, 25) << __func__ << " " << poid
 	     << " large omap object detected. Object has " << pos.omap_keys
 	     << " keys and size " << pos.omap_bytes << " bytes" << dendl;
     o.large_omap_object_found = true;
@@ -758,12 +759,12 @@ int ReplicatedBackend::be_deep_scrub(
 
   o.omap_digest = pos.omap_hash.digest();
   o.omap_digest_present = true;
-  dout(20) << __func__ << " done with " << poid << " omap_digest "
+  ldpp_dout(&sctx, 20) << __func__ << " done with " << poid << " omap_digest "
 	   << std::hex << o.omap_digest << std::dec << dendl;
 
   // Sum up omap usage
   if (pos.omap_keys > 0 || pos.omap_bytes > 0) {
-    dout(25) << __func__ << " adding " << pos.omap_keys << " keys and "
+    ldpp_dout(&sctx, 25) << __func__ << " adding " << pos.omap_keys << " keys and "
              << pos.omap_bytes << " bytes to pg_stats sums" << dendl;
     map.has_omap_keys = true;
     o.object_omap_bytes = pos.omap_bytes;
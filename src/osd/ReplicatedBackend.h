@@ -424,9 +424,13 @@ private:
 
   void repop_commit(RepModifyRef rm);
   bool auto_repair_supported() const override { return store->has_builtin_csum(); }
+  /// the scan only touches the object store, and what the ScanContext
+  /// captured from the PG
+  bool be_scan_list_is_reentrant() const override { return true; }
 
 
   int be_deep_scrub(
+    const ScanContext &sctx,
     const hobject_t &poid,
     ScrubMap &map,
     ScrubMapBuilder &pos,
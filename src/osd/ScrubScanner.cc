@@ -0,0 +1,129 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "ScrubScanner.h"
+
+#include "PGBackend.h"
+
+#define dout_context (m_cct)
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix *_dout << "scrub-scan "
+
+using std::vector;
+
+namespace Scrub {
+
+void ScanJob::collect(ScrubMap& map)
+{
+  ceph_assert(is_done());
+  for (auto& m : maps) {
+    for (auto& [hoid, obj] : m.objects) {
+      map.objects[hoid] = std::move(obj);
+    }
+    map.has_large_omap_object_errors |= m.has_large_omap_object_errors;
+    map.has_omap_keys |= m.has_omap_keys;
+  }
+  maps.clear();
+}
+
+ParallelScanner::ParallelScanner(CephContext* cct)
+    : m_cct{cct}
+    , m_num_threads{
+	static_cast<int>(cct->_conf.get_val<uint64_t>("osd_scrub_scan_threads"))}
+    , m_tp{cct, "OSD::scrub_scan_tp", "tp_scrub_scan", m_num_threads}
+    , m_wq{"OSD::scrub_scan_wq",
+	   ceph::make_timespan(cct->_conf->osd_op_thread_timeout),
+	   &m_tp}
+    , m_budget{cct, "osd_scrub_scan_bytes",
+	       static_cast<int64_t>(
+		 cct->_conf.get_val<Option::size_t>("osd_scrub_scan_max_bytes"))}
+{}
+
+void ParallelScanner::start()
+{
+  if (is_active()) {
+    m_tp.start();
+  }
+}
+
+void ParallelScanner::stop()
+{
+  if (is_active()) {
+    {
+      std::lock_guard l{m_jobs_lock};
+      for (auto job : m_jobs) {
+	job->canceled = true;
+      }
+    }
+    // the canceled jobs do not queue more strides
+    m_wq.drain();
+    m_tp.stop();
+  }
+}
+
+ScanJobRef ParallelScanner::submit(spg_t pgid,
+				   PGRef pg,
+				   ScanJob::scan_fn_t scan,
+				   vector<hobject_t> objects,
+				   bool deep,
+				   Context* on_finish)
+{
+  ceph_assert(is_active());
+  ceph_assert(!objects.empty());
+  auto job = std::make_shared<ScanJob>(pgid, std::move(pg), std::move(scan),
+				       std::move(objects), deep, on_finish);
+  dout(15) << __func__ << " " << pgid << " " << job->objects.size()
+	   << " objects, deep: " << deep << dendl;
+
+  {
+    std::lock_guard l{m_jobs_lock};
+    m_jobs.insert(job.get());
+  }
+  for (size_t i = 0; i < job->objects.size(); ++i) {
+    queue_stride(job, i);
+  }
+  return job;
+}
+
+void ParallelScanner::queue_stride(ScanJobRef job, size_t idx)
+{
+  m_wq.queue(new LambdaContext([this, job, idx](int) {
+    scan_stride(job, idx);
+  }));
+}
+
+void ParallelScanner::scan_stride(ScanJobRef job, size_t idx)
+{
+  const int64_t stride = m_cct->_conf->osd_deep_scrub_stride;
+  auto& pos = job->positions[idx];
+
+  // be_scan_list() returns -EINPROGRESS after each data stride / omap batch
+  if (!job->canceled) {
+    m_budget.get(stride);
+    job->scan(job->maps[idx], pos);
+    m_budget.put(stride);
+  }
+
+  if (!pos.done() && !job->canceled) {
+    queue_stride(std::move(job), idx);
+    return;
+  }
+  object_done(*job);
+}
+
+void ParallelScanner::object_done(ScanJob& job)
+{
+  if (--job.remaining == 0) {
+    dout(15) << __func__ << " " << job.pgid << " chunk done"
+	     << (job.canceled ? " (canceled)" : "") << dendl;
+    {
+      std::lock_guard l{m_jobs_lock};
+      m_jobs.erase(&job);
+    }
+    job.on_finish->complete(0);
+    job.on_finish = nullptr;
+  }
+}
+
+}  // namespace Scrub
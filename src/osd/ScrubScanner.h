@@ -0,0 +1,124 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "PG.h"
+#include "common/Throttle.h"
+#include "common/WorkQueue.h"
+#include "include/Context.h"
+#include "osd_types.h"
+
+namespace Scrub {
+
+/**
+ * The objects of a single scrub chunk, handed over to the ParallelScanner.
+ *
+ * Each object is scanned into its own ScrubMap slot, so that the workers never
+ * share any state but the 'remaining' counter. The owner (the PG's scrubber)
+ * only touches 'maps' after the job is done, and under the PG lock.
+ */
+struct ScanJob {
+  /// scans (a stride of) pos.ls[pos.pos] into the map, as be_scan_list();
+  /// called without the PG lock
+  using scan_fn_t = std::function<int(ScrubMap&, ScrubMapBuilder&)>;
+
+  ScanJob(spg_t pgid,
+	  PGRef pg,
+	  scan_fn_t scan,
+	  std::vector<hobject_t> objects,
+	  bool deep,
+	  Context* on_finish)
+      : pgid{pgid}
+      , pg{std::move(pg)}
+      , scan{std::move(scan)}
+      , objects{std::move(objects)}
+      , deep{deep}
+      , maps(this->objects.size())
+      , positions(this->objects.size())
+      , remaining{this->objects.size()}
+      , on_finish{on_finish}
+  {
+    for (size_t i = 0; i < this->objects.size(); ++i) {
+      positions[i].deep = deep;
+      positions[i].ls.push_back(this->objects[i]);
+    }
+  }
+
+  const spg_t pgid;
+  const PGRef pg;  ///< keeps the PG (and thus its backend) around while we scan
+  const scan_fn_t scan;
+  const std::vector<hobject_t> objects;
+  const bool deep;
+  std::vector<ScrubMap> maps;  ///< one per object, in 'objects' order
+  std::vector<ScrubMapBuilder> positions;  ///< ditto
+
+  std::atomic<size_t> remaining;
+  std::atomic<bool> canceled{false};
+  Context* on_finish;  ///< completed (w/o the PG lock) when all objects are done
+
+  bool is_done() const { return remaining == 0; }
+
+  /// merge the per-object results into the chunk's map
+  void collect(ScrubMap& map);
+};
+using ScanJobRef = std::shared_ptr<ScanJob>;
+
+/**
+ * ParallelScanner
+ *
+ * Offloads the stat/getattrs and the deep-scrub data & omap digests of the
+ * objects in a scrub chunk to a dedicated thread pool, instead of hashing the
+ * objects one at a time on the op thread. The PG lock is only held to dispatch
+ * the chunk and to merge the results.
+ *
+ * A work item scans a single stride of an object, and queues the next one:
+ * large objects do not hold a thread past its heartbeat timeout.
+ *
+ * Memory use is bounded by 'osd_scrub_scan_max_bytes': a worker must reserve
+ * one deep-scrub stride before each backend read.
+ */
+class ParallelScanner {
+ public:
+  explicit ParallelScanner(CephContext* cct);
+
+  void start();
+  /// cancel the outstanding jobs, and wait for their workers to let go
+  void stop();
+
+  /// is parallel scanning configured (osd_scrub_scan_threads > 0)?
+  bool is_active() const { return m_num_threads > 0; }
+
+  /**
+   * queue the objects for scanning. 'on_finish' is completed once all the
+   * objects were scanned (or the job was canceled).
+   */
+  ScanJobRef submit(spg_t pgid,
+		    PGRef pg,
+		    ScanJob::scan_fn_t scan,
+		    std::vector<hobject_t> objects,
+		    bool deep,
+		    Context* on_finish);
+
+ private:
+  void queue_stride(ScanJobRef job, size_t idx);
+  void scan_stride(ScanJobRef job, size_t idx);
+  void object_done(ScanJob& job);
+
+  CephContext* m_cct;
+  const int m_num_threads;
+  ThreadPool m_tp;
+  ContextWQ m_wq;
+  Throttle m_budget;  ///< bytes of object data being read concurrently
+
+  ceph::mutex m_jobs_lock = ceph::make_mutex("ParallelScanner::m_jobs_lock");
+  std::set<ScanJob*> m_jobs;  ///< not done yet
+};
+
+}  // namespace Scrub
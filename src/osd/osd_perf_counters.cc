@@ -117,6 +117,16 @@ PerfCounters *build_osd_logger(CephContext *cct) {
     l_osd_op_rw_prepare_lat, "op_rw_prepare_latency",
     "Latency of read-modify-write operations (excluding queue time and wait for finished)");
 
+  // bumped by every op shard thread for every client op
+  for (int idx : {l_osd_op, l_osd_op_inb, l_osd_op_outb,
+		  l_osd_op_lat, l_osd_op_process_lat, l_osd_op_prepare_lat,
+		  l_osd_op_r, l_osd_op_r_outb, l_osd_op_r_lat,
+		  l_osd_op_r_process_lat, l_osd_op_r_prepare_lat,
+		  l_osd_op_w, l_osd_op_w_inb, l_osd_op_w_lat,
+		  l_osd_op_w_process_lat, l_osd_op_w_prepare_lat}) {
+    osd_plb.set_sharded(idx);
+  }
+
   // Now we move on to some more obscure stats, revert to assuming things
   // are low priority unless otherwise specified.
   osd_plb.set_prio_default(PerfCountersBuilder::PRIO_DEBUGONLY);
@@ -278,6 +288,13 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_u64_counter(
     l_osd_pg_biginfo, "osd_pg_biginfo", "PG updated its biginfo attr");
 
+  osd_plb.add_u64_counter(
+    l_osd_numa_local_enqueue, "numa_local_enqueue",
+    "Ops queued from the numa node of their shard");
+  osd_plb.add_u64_counter(
+    l_osd_numa_remote_enqueue, "numa_remote_enqueue",
+    "Ops queued from another numa node than their shard's");
+
   return osd_plb.create_perf_counters();
 }
  
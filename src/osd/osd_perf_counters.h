@@ -118,6 +118,9 @@ enum {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_numa_local_enqueue,
+  l_osd_numa_remote_enqueue,
+
   l_osd_last,
 };
 
@@ -2688,6 +2688,19 @@ struct pool_stat_t {
 };
 WRITE_CLASS_ENCODER_FEATURES(pool_stat_t)
 
+inline bool operator==(const pool_stat_t& l, const pool_stat_t& r) {
+  return l.stats == r.stats &&
+    l.store_stats == r.store_stats &&
+    l.log_size == r.log_size &&
+    l.ondisk_log_size == r.ondisk_log_size &&
+    l.up == r.up &&
+    l.acting == r.acting &&
+    l.num_store_stats == r.num_store_stats;
+}
+inline bool operator!=(const pool_stat_t& l, const pool_stat_t& r) {
+  return !(l == r);
+}
+
 
 // -----------------------------------------
 
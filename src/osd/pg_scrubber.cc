@@ -915,7 +915,9 @@ int PgScrubber::build_primary_map_chunk()
   auto ret = build_scrub_map_chunk(m_primary_scrubmap, m_primary_scrubmap_pos, m_start,
 				   m_end, m_is_deep);
 
-  if (ret == -EINPROGRESS)
+  // if the chunk is being scanned by the ParallelScanner, we will be requeued
+  // when it is done
+  if (ret == -EINPROGRESS && !m_scan_job)
     m_osds->queue_for_scrub_resched(m_pg, Scrub::scrub_prio_t::low_priority);
 
   return ret;
@@ -942,7 +944,7 @@ int PgScrubber::build_replica_map_chunk()
 
   // previous version used low priority here. Now switched to using the priority
   // of the original message
-  if (ret == -EINPROGRESS)
+  if (ret == -EINPROGRESS && !m_scan_job)
     requeue_replica(m_replica_request_priority);
 
   return ret;
@@ -979,6 +981,15 @@ int PgScrubber::build_scrub_map_chunk(
   }
 
   // scan objects
+  if (!pos.done() && m_osds->scrub_scanner.is_active() &&
+      m_pg->get_pgbackend()->be_scan_list_is_reentrant()) {
+    int r = scan_chunk_in_parallel(map, pos);
+    if (r == -EINPROGRESS) {
+      dout(20) << __func__ << " in progress (parallel scan)" << dendl;
+      return r;
+    }
+  }
+
   while (!pos.done()) {
     int r = m_pg->get_pgbackend()->be_scan_list(map, pos);
     dout(10) << __func__ << " be r " << r << dendl;
@@ -997,6 +1008,79 @@ int PgScrubber::build_scrub_map_chunk(
   return 0;
 }
 
+int PgScrubber::scan_chunk_in_parallel(ScrubMap& map, ScrubMapBuilder& pos)
+{
+  vector<hobject_t> to_scan{pos.ls.begin() + pos.pos, pos.ls.end()};
+
+  if (m_scan_job && m_scan_job->objects != to_scan) {
+    // a leftover of a chunk we are no longer working on
+    dout(10) << __func__ << " discarding a stale scan" << dendl;
+    discard_parallel_scan();
+  }
+
+  if (!m_scan_job) {
+    m_scan_for_replica = (&pos == &replica_scrubmap_pos);
+    // the scrubber may be gone by the time the scan is done: look it up again
+    // from the PG
+    auto on_done = new LambdaContext([osds = m_osds, pgid = m_pg_id,
+				      seq = ++m_scan_seq]([[maybe_unused]] int r) {
+      PGRef pg = osds->osd->lookup_lock_pg(pgid);
+      if (!pg) {
+	return;
+      }
+      if (pg->m_scrubber) {
+	pg->m_scrubber->on_parallel_scan_done(seq);
+      }
+      pg->unlock();
+    });
+
+    dout(15) << __func__ << " dispatching " << to_scan.size() << " objects" << dendl;
+    // the workers do not take the PG lock: capture what the scan needs of
+    // the PG now
+    auto backend = m_pg->get_pgbackend();
+    m_scan_job = m_osds->scrub_scanner.submit(
+      m_pg_id, m_pg,
+      [backend, sctx = backend->get_scan_context()](ScrubMap& map,
+						     ScrubMapBuilder& pos) {
+	return backend->be_scan_list(sctx, map, pos);
+      },
+      std::move(to_scan), pos.deep, on_done);
+    return -EINPROGRESS;
+  }
+
+  if (!m_scan_job->is_done()) {
+    return -EINPROGRESS;
+  }
+
+  m_scan_job->collect(map);
+  m_scan_job.reset();
+  pos.pos = pos.ls.size();
+  return 0;
+}
+
+void PgScrubber::on_parallel_scan_done(uint64_t seq)
+{
+  if (!m_scan_job || seq != m_scan_seq) {
+    dout(15) << __func__ << " stale scan #" << seq << dendl;
+    return;
+  }
+
+  dout(15) << __func__ << " scan #" << seq << " done" << dendl;
+  if (m_scan_for_replica) {
+    requeue_replica(m_replica_request_priority);
+  } else {
+    m_osds->queue_for_scrub_resched(m_pg, Scrub::scrub_prio_t::low_priority);
+  }
+}
+
+void PgScrubber::discard_parallel_scan()
+{
+  if (m_scan_job) {
+    m_scan_job->canceled = true;
+    m_scan_job.reset();
+  }
+}
+
 /*
  * Process:
  * Building a map of objects suitable for snapshot validation.
@@ -1089,6 +1173,7 @@ void PgScrubber::replica_scrub_op(OpRequestRef op)
 
   replica_scrubmap = ScrubMap{};
   replica_scrubmap_pos = ScrubMapBuilder{};
+  discard_parallel_scan();
 
   m_replica_min_epoch = msg->min_epoch;
   m_start = msg->start;
@@ -1849,6 +1934,7 @@ void PgScrubber::reset_internal_state()
   m_primary_scrubmap_pos.reset();
   replica_scrubmap = ScrubMap{};
   replica_scrubmap_pos.reset();
+  discard_parallel_scan();
   m_cleaned_meta_map = ScrubMap{};
   m_needs_sleep = true;
   m_sleep_started_at = utime_t{};
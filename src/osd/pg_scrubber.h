@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "PG.h"
+#include "ScrubScanner.h"
 #include "ScrubStore.h"
 #include "scrub_machine_lstnr.h"
 #include "scrubber_common.h"
@@ -233,6 +234,7 @@ class PgScrubber : public ScrubPgIF, public ScrubMachineListener {
   void handle_scrub_reserve_reject(OpRequestRef op, pg_shard_t from) final;
   void handle_scrub_reserve_release(OpRequestRef op) final;
   void discard_replica_reservations() final;
+  void on_parallel_scan_done(uint64_t seq) final;
   void clear_scrub_reservations() final;  // PG::clear... fwds to here
   void unreserve_replicas() final;
 
@@ -520,6 +522,16 @@ class PgScrubber : public ScrubPgIF, public ScrubMachineListener {
 			    hobject_t end,
 			    bool deep);
 
+  /**
+   * hand the (remaining) objects of the chunk to the OSD's ParallelScanner,
+   * or - if it is done with them - merge the results into 'map'.
+   * @returns -EINPROGRESS while the scan is in flight. The completion of the
+   *  scan requeues us.
+   */
+  int scan_chunk_in_parallel(ScrubMap& map, ScrubMapBuilder& pos);
+
+  void discard_parallel_scan();
+
   std::unique_ptr<Scrub::ScrubMachine> m_fsm;
   const spg_t m_pg_id;	///< a local copy of m_pg->pg_id
   OSDService* const m_osds;
@@ -589,6 +601,11 @@ class PgScrubber : public ScrubPgIF, public ScrubMachineListener {
   ScrubMap m_primary_scrubmap;
   ScrubMapBuilder m_primary_scrubmap_pos;
 
+  /// the chunk being scanned off the op threads (see scan_chunk_in_parallel())
+  Scrub::ScanJobRef m_scan_job;
+  uint64_t m_scan_seq{0};
+  bool m_scan_for_replica{false};
+
   std::map<pg_shard_t, ScrubMap> m_received_maps;
 
   /// Cleaned std::map pending snap metadata scrub
@@ -237,6 +237,14 @@ struct ScrubPgIF {
    */
   virtual void discard_replica_reservations() = 0;
 
+  /**
+   * the OSD's ParallelScanner is done with scan #seq of our chunk. Requeues
+   * the scrub if that is still the scan we are waiting for.
+   *
+   * Called with the PG lock held.
+   */
+  virtual void on_parallel_scan_done(uint64_t seq) = 0;
+
   /**
    * clear both local and OSD-managed resource reservation flags
    */
@@ -69,6 +69,8 @@ class BaseMgrModule(object):
     def _ceph_get_perf_schema(self, svc_type: str, svc_name: str) -> Dict[str, Any]: ...
     def _ceph_get_counter(self, svc_type: str, svc_name: str, path: str) -> Dict[str, List[Tuple[float, int]]]: ...
     def _ceph_get_latest_counter(self, svc_type, svc_name, path): ...
+    def _ceph_get_latest_counters(self, svc_type: str, prio_limit: int) -> Dict[str, Dict[str, Any]]: ...
+    def _ceph_get_counter_series(self, svc_type: str, svc_name: str, path: str) -> Dict[str, bytes]: ...
     def _ceph_get_metadata(self, svc_type, svc_id): ...
     def _ceph_get_daemon_status(self, svc_type, svc_id): ...
     def _ceph_send_command(self,
@@ -1018,7 +1018,7 @@ class MgrModule(ceph_module.BaseMgrModule, MgrModuleLoggingMixin):
                 osd_map, osd_map_tree, osd_map_crush, config, mon_map, fs_map,
                 osd_metadata, pg_summary, io_rate, pg_dump, df, osd_stats,
                 health, mon_status, devices, device <devid>, pg_stats,
-                pool_stats, pg_ready, osd_ping_times.
+                pg_stats_columns, pool_stats, pg_ready, osd_ping_times.
 
         Note:
             All these structures have their own JSON representations: experiment
@@ -1026,6 +1026,34 @@ class MgrModule(ceph_module.BaseMgrModule, MgrModuleLoggingMixin):
         """
         return self._ceph_get(data_name)
 
+    PG_STATS_COLUMNS = {
+        'state': 'Q',
+        'reported_epoch': 'I',
+        'reported_seq': 'Q',
+        'num_bytes': 'q',
+        'num_objects': 'q',
+        'acting_primary': 'i',
+    }
+
+    def get_pg_stats_columns(self) -> Dict[int, Dict[str, Any]]:
+        """
+        Fetch the most used fields of every PG's stats, without building a
+        dict per PG like ``get('pg_stats')`` does.
+
+        :return: a dict of pool id to a dict with the pool's ``pg_num`` and
+            one typed memoryview per field (state, reported_epoch,
+            reported_seq, num_bytes, num_objects, acting_primary), indexed by
+            the PG's seed, i.e. the part of the pgid after the '.'.
+            PGs which did not report yet have a reported_epoch of 0.
+        """
+        result: Dict[int, Dict[str, Any]] = {}
+        for pool, columns in self._ceph_get('pg_stats_columns').items():
+            pool_columns: Dict[str, Any] = {'pg_num': columns['pg_num']}
+            for name, typecode in self.PG_STATS_COLUMNS.items():
+                pool_columns[name] = memoryview(columns[name]).cast(typecode)
+            result[pool] = pool_columns
+        return result
+
     def _stattype_to_str(self, stattype: int) -> str:
 
         typeonly = stattype & self.PERFCOUNTER_TYPE_MASK
@@ -1194,6 +1222,43 @@ class MgrModule(ceph_module.BaseMgrModule, MgrModuleLoggingMixin):
         """
         return self._ceph_get_latest_counter(svc_type, svc_name, path)
 
+    def get_latest_counters(self,
+                            svc_type: str = '',
+                            prio_limit: int = 0) -> Dict[str, Dict[str, Any]]:
+        """
+        Fetch the newest value of every performance counter of every daemon
+        of a kind in a single call, as typed arrays.
+
+        :param str svc_type: the daemon type, or '' for all daemons
+        :param int prio_limit: skip counters with a lower priority
+        :return: a dict of daemon name (e.g. "osd.3") to a dict of ``paths``,
+            a tuple of counter paths, and the parallel memoryviews ``type``
+            (the counter's type), ``value`` and ``count``, the latter only
+            set for long running averages.
+        """
+        result = self._ceph_get_latest_counters(svc_type, prio_limit)
+        for counters in result.values():
+            counters['type'] = memoryview(counters['type']).cast('B')
+            counters['value'] = memoryview(counters['value']).cast('Q')
+            counters['count'] = memoryview(counters['count']).cast('Q')
+        return result
+
+    def get_counter_series(self,
+                           svc_type: str,
+                           svc_name: str,
+                           path: str) -> Dict[str, memoryview]:
+        """
+        Like ``get_counter``, but as the parallel memoryviews ``t`` (the
+        timestamps), ``v`` (the values, or the sums of long running
+        averages) and ``c`` (the counts of long running averages, or empty).
+        """
+        series = self._ceph_get_counter_series(svc_type, svc_name, path)
+        return {
+            't': memoryview(series['t']).cast('d'),
+            'v': memoryview(series['v']).cast('Q'),
+            'c': memoryview(series['c']).cast('Q'),
+        }
+
     def list_servers(self) -> List[ServerInfoT]:
         """
         Like ``get_server``, but gives information about all servers (i.e. all
@@ -1569,53 +1634,38 @@ class MgrModule(ceph_module.BaseMgrModule, MgrModuleLoggingMixin):
 
         result = defaultdict(dict)  # type: Dict[str, dict]
 
+        wanted = set()
         for server in self.list_servers():
             for service in cast(List[ServiceInfoT], server['services']):
-                if service['type'] not in services:
+                if service['type'] in services:
+                    wanted.add("{0}.{1}".format(service['type'], service['id']))
+
+        # fetch the schemas and values of each kind of daemon at once,
+        # instead of calling into the mgr for every single counter
+        for svc_type in services:
+            schemas = self.get_perf_schema(svc_type, '')
+            latest = self.get_latest_counters(svc_type, prio_limit)
+            for svc_full_name, counters in latest.items():
+                if svc_full_name not in wanted:
                     continue
-
-                schemas = self.get_perf_schema(service['type'], service['id'])
-                if not schemas:
-                    self.log.warning("No perf counter schema for {0}.{1}".format(
-                        service['type'], service['id']
-                    ))
+                schema = schemas.get(svc_full_name)
+                if not schema:
+                    self.log.warning("No perf counter schema for {0}".format(
+                        svc_full_name))
                     continue
 
-                # Value is returned in a potentially-multi-service format,
-                # get just the service we're asking about
-                svc_full_name = "{0}.{1}".format(
-                    service['type'], service['id'])
-                schema = schemas[svc_full_name]
-
-                # Populate latest values
-                for counter_path, counter_schema in schema.items():
-                    # self.log.debug("{0}: {1}".format(
-                    #     counter_path, json.dumps(counter_schema)
-                    # ))
-                    priority = counter_schema['priority']
-                    assert isinstance(priority, int)
-                    if priority < prio_limit:
+                for counter_path, tp, value, count in zip(counters['paths'],
+                                                          counters['type'],
+                                                          counters['value'],
+                                                          counters['count']):
+                    counter_schema = schema.get(counter_path)
+                    if counter_schema is None:
                         continue
-
-                    tp = counter_schema['type']
-                    assert isinstance(tp, int)
                     counter_info = dict(counter_schema)
+                    counter_info['value'] = value
                     # Also populate count for the long running avgs
                     if tp & self.PERFCOUNTER_LONGRUNAVG:
-                        v, c = self.get_latest_avg(
-                            service['type'],
-                            service['id'],
-                            counter_path
-                        )
-                        counter_info['value'], counter_info['count'] = v, c
-                        result[svc_full_name][counter_path] = counter_info
-                    else:
-                        counter_info['value'] = self.get_latest(
-                            service['type'],
-                            service['id'],
-                            counter_path
-                        )
-
+                        counter_info['count'] = count
                     result[svc_full_name][counter_path] = counter_info
 
         self.log.debug("returning {0} counter".format(len(result)))
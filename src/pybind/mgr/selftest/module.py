@@ -4,6 +4,7 @@ import threading
 import random
 import json
 import errno
+import time
 
 
 class Module(MgrModule):
@@ -101,6 +102,12 @@ class Module(MgrModule):
                 "desc": "Create an audit log record.",
                 "perm": "rw"
             },
+            {
+                "cmd": "mgr self-test perf-counters-bench "
+                       "name=iterations,type=CephInt,req=false",
+                "desc": "Time fetching all perf counters per counter vs in bulk",
+                "perm": "r"
+            },
             ]
 
     def __init__(self, *args, **kwargs):
@@ -162,6 +169,10 @@ class Module(MgrModule):
                              priority_map[command['priority']],
                              command['message'])
             return 0, '', 'Successfully called'
+        elif command['prefix'] == 'mgr self-test perf-counters-bench':
+            return 0, json.dumps(
+                self._perf_counters_bench(command.get('iterations', 3)),
+                indent=2), ''
         else:
             return (-errno.EINVAL, '',
                     "Command not found '{0}'".format(command['prefix']))
@@ -239,6 +250,7 @@ class Module(MgrModule):
                 "pg_ready",
                 "df",
                 "pg_stats",
+                "pg_stats_columns",
                 "pool_stats",
                 "osd_stats",
                 "osd_ping_times",
@@ -366,9 +378,62 @@ class Module(MgrModule):
     def _self_test_perf_counters(self):
         self.get_perf_schema("osd", "0")
         self.get_counter("osd", "0", "osd.op")
+        series = self.get_counter_series("osd", "0", "osd.op")
+        assert len(series['t']) == len(series['v'])
+        for counters in self.get_latest_counters("osd").values():
+            assert len(counters['paths']) == len(counters['value'])
+        self.get_all_perf_counters()
         #get_counter
         #get_all_perf_coutners
 
+    def _get_all_perf_counters_per_counter(self, prio_limit):
+        # what get_all_perf_counters() used to do: one call per counter
+        result = {}
+        for server in self.list_servers():
+            for service in server['services']:
+                svc_type, svc_id = service['type'], service['id']
+                name = "{0}.{1}".format(svc_type, svc_id)
+                schema = self.get_perf_schema(svc_type, svc_id).get(name, {})
+                counters = result.setdefault(name, {})
+                for path, counter_schema in schema.items():
+                    if counter_schema['priority'] < prio_limit:
+                        continue
+                    counter_info = dict(counter_schema)
+                    if counter_schema['type'] & self.PERFCOUNTER_LONGRUNAVG:
+                        v, c = self.get_latest_avg(svc_type, svc_id, path)
+                        counter_info['value'], counter_info['count'] = v, c
+                    else:
+                        counter_info['value'] = self.get_latest(
+                            svc_type, svc_id, path)
+                    counters[path] = counter_info
+        return result
+
+    def _perf_counters_bench(self, iterations):
+        def best_of(fn):
+            best = None
+            for _ in range(iterations):
+                start = time.monotonic()
+                r = fn()
+                elapsed = time.monotonic() - start
+                best = elapsed if best is None else min(best, elapsed)
+            return best, r
+
+        per_counter, old = best_of(
+            lambda: self._get_all_perf_counters_per_counter(self.PRIO_USEFUL))
+        bulk, new = best_of(
+            lambda: self.get_all_perf_counters(self.PRIO_USEFUL))
+        arrays, latest = best_of(
+            lambda: self.get_latest_counters('', self.PRIO_USEFUL))
+        return {
+            'daemons': len(latest),
+            'counters': sum(len(c['paths']) for c in latest.values()),
+            'per_counter_sec': per_counter,
+            'bulk_sec': bulk,
+            'arrays_sec': arrays,
+            'per_counter_daemons': len([d for d in old.values() if d]),
+            'bulk_daemons': len(new),
+        }
+
     def _self_test_misc(self):
         self.set_uri("http://this.is.a.test.com")
         self.set_health_checks({})
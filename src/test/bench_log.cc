@@ -10,12 +10,15 @@
 #include "global/global_init.h"
 
 #define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_
 
 struct T : public Thread {
   int num;
+  int level;
+  bool args;
   set<int> myset;
   map<int,string> mymap;
-  explicit T(int n) : num(n) {
+  T(int n, int l, bool a) : num(n), level(l), args(a) {
     myset.insert(123);
     myset.insert(456);
     mymap[1] = "foo";
@@ -23,17 +26,29 @@ struct T : public Thread {
   }
 
   void *entry() override {
-    while (num-- > 0)
-      generic_dout(0) << "this is a typical log line.  set "
-		      << myset << " and map " << mymap << dendl;
+    if (args) {
+      while (num-- > 0)
+	ldout_args(g_ceph_context, ceph::dout::need_dynamic(level),
+		   "this is a typical log line.  num {} level {} name {}",
+		   num, level, mymap[1]);
+    } else {
+      while (num-- > 0)
+	generic_dout(ceph::dout::need_dynamic(level)) << "this is a typical log line.  num "
+			<< num << " level " << level << " name " << mymap[1] << dendl;
+    }
     return 0;
   }
 };
 
 void usage(const char *name) {
-  cout << name << " <threads> <lines>\n"
+  cout << name << " <threads> <lines> [level]\n"
        << "\t threads: the number of threads for this test.\n"
-       << "\t lines: the number of log entries per thread.\n";
+       << "\t lines: the number of log entries per thread.\n"
+       << "\t level: the debug level of the entries (default 0); with the\n"
+       << "\t        default debug_none of 0/5, 1-5 are only kept in memory\n"
+       << "\t        and 6 and up are not even gathered.\n"
+       << "\t --log-binary writes the log in binary form.\n"
+       << "\t --args logs the lines as a format and its arguments.\n";
 }
 
 int main(int argc, const char **argv)
@@ -45,21 +60,37 @@ int main(int argc, const char **argv)
 
   int threads = atoi(argv[1]);
   int num = atoi(argv[2]);
+  int level = 0;
+  if (argc > 3 && argv[3][0] != '-') {
+    level = atoi(argv[3]);
+  }
+  bool use_args = false;
+  for (int i = 3; i < argc; i++) {
+    if (std::string_view(argv[i]) == "--args") {
+      use_args = true;
+    }
+  }
 
-  cout << threads << " threads, " << num << " lines per thread" << std::endl;
+  cout << threads << " threads, " << num << " lines per thread, level "
+       << level << std::endl;
 
   vector<const char*> args;
   argv_to_vec(argc, argv, args);
+  args.erase(std::remove_if(args.begin(), args.end(), [](const char* a) {
+	return std::string_view(a) == "--args";
+      }), args.end());
 
   auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_OSD,
 			 CODE_ENVIRONMENT_UTILITY,
 			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  cout << (g_conf().get_val<bool>("log_binary") ? "binary" : "text")
+       << " log" << (use_args ? ", format and arguments" : "") << std::endl;
 
   utime_t start = ceph_clock_now();
 
   list<T*> ls;
   for (int i=0; i<threads; i++) {
-    T *t = new T(num);
+    T *t = new T(num, level, use_args);
     t->create("t");
     ls.push_back(t);
   }
@@ -80,6 +111,7 @@ int main(int argc, const char **argv)
   utime_t end = ceph_clock_now();
   utime_t dur = end - start;
 
-  cout << dur << std::endl;
+  cout << dur << " (" << (dur.to_nsec() / std::max(threads * num, 1))
+       << " ns per line)" << std::endl;
   return 0;
 }
@@ -36,4 +36,7 @@
      --test-crush [--range-first <first> --range-last <last>] map pgs to acting osds
      --adjust-crush-weight <osdid:weight>[,<osdid:weight>,<...>] change <osdid> CRUSH <weight> (but do not persist)
      --save                  write modified osdmap with upmap or crush-adjust changes
+     --bench-apply-inc <epochs> apply <epochs> synthetic incrementals (pg_temp churn,
+                             osd flaps, crush weight changes) and time the map and
+                             pg mapping updates (does not persist)
   [1]
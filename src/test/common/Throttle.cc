@@ -373,6 +373,60 @@ TEST(BackoffThrottle, oversaturated)
   ASSERT_GT(results.second.count(), 0.0005);
 }
 
+TEST(AdaptiveThrottle, aimd)
+{
+  using namespace std::chrono_literals;
+  g_ceph_context->_conf.set_val("throttle_adaptive_interval", "0.01");
+  g_ceph_context->_conf.set_val("throttle_adaptive_min_ratio", "0.1");
+  Throttle throttle(g_ceph_context, "adaptive_throttle_test");
+  AdaptiveThrottle adaptive(g_ceph_context, "adaptive_throttle_test",
+			    &throttle);
+  // one interval worth of requests, all of them taking lat
+  auto run_interval = [&](ceph::timespan lat) {
+    adaptive.sample(lat);
+    std::this_thread::sleep_for(20ms);
+    adaptive.sample(lat);
+  };
+
+  // no target, a plain Throttle
+  adaptive.configure(1000, ceph::timespan::zero());
+  ASSERT_EQ(1000, throttle.get_max());
+  run_interval(50ms);
+  ASSERT_EQ(1000, throttle.get_max());
+
+  adaptive.configure(1000, 10ms);
+  ASSERT_EQ(1000, adaptive.get_budget());
+  run_interval(50ms);
+  ASSERT_EQ(750, adaptive.get_budget());
+  ASSERT_EQ(750, throttle.get_max());
+  // cut down to the floor, and no further
+  for (int i = 0; i < 10; ++i) {
+    run_interval(50ms);
+  }
+  ASSERT_EQ(100, throttle.get_max());
+  // back up, a step at a time
+  run_interval(1ms);
+  ASSERT_EQ(100 + 1000 / AdaptiveThrottle::INCREASE_DIVISOR,
+	    throttle.get_max());
+  for (int i = 0; i < 40; ++i) {
+    run_interval(1ms);
+  }
+  ASSERT_EQ(1000, throttle.get_max());
+
+  // a single fast request in the interval is enough: it is the queueing
+  // which is cut
+  adaptive.sample(50ms);
+  adaptive.sample(1ms);
+  std::this_thread::sleep_for(20ms);
+  adaptive.sample(50ms);
+  ASSERT_EQ(1000, throttle.get_max());
+
+  adaptive.configure(1000, ceph::timespan::zero());
+  ASSERT_EQ(1000, throttle.get_max());
+  g_ceph_context->_conf.rm_val("throttle_adaptive_interval");
+  g_ceph_context->_conf.rm_val("throttle_adaptive_min_ratio");
+}
+
 /*
  * Local Variables:
  * compile-command: "cd ../.. ;
@@ -0,0 +1,108 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <iostream>
+#include <vector>
+
+#include "include/types.h"
+#include "include/buffer.h"
+#include "include/stringify.h"
+#include "common/Clock.h"
+#include "common/CDC.h"
+#include "common/FastCDC.h"
+#include "gtest/gtest.h"
+
+// Chunking throughput, compared between the CDC implementations, the
+// number of lanes FastCDC hashes side by side, and re-chunking the same
+// data at several target sizes with and without a boundary index.
+
+static constexpr int DATA_SIZE = 64 * 1024 * 1024;
+static constexpr int ROUNDS = 4;
+
+static void report(const std::string& what, utime_t elapsed, size_t bytes)
+{
+  std::cout << what << " = "
+	    << (double)bytes / (1024*1024) / (double)elapsed << " MB/sec"
+	    << std::endl;
+}
+
+class CDCBench : public ::testing::Test,
+		 public ::testing::WithParamInterface<int> {
+public:
+  bufferlist bl;
+
+  void SetUp() override {
+    generate_buffer(DATA_SIZE, &bl);
+  }
+};
+
+TEST_P(CDCBench, calc_chunks)
+{
+  int bits = GetParam();
+  for (auto type : {"fixed", "fastcdc"}) {
+    auto cdc = CDC::create(type, bits);
+    std::vector<std::pair<uint64_t, uint64_t>> chunks;
+    utime_t start = ceph_clock_now();
+    for (int i = 0; i < ROUNDS; ++i) {
+      chunks.clear();
+      cdc->calc_chunks(bl, &chunks);
+    }
+    report(std::string(type) + " " + stringify(bits) + " bits",
+	   ceph_clock_now() - start, (size_t)ROUNDS * bl.length());
+    ASSERT_FALSE(chunks.empty());
+  }
+}
+
+TEST_P(CDCBench, lanes)
+{
+  FastCDC cdc(GetParam());
+  std::vector<std::pair<uint64_t, uint64_t>> expected;
+  for (unsigned lanes : {1, 4}) {
+    std::vector<std::pair<uint64_t, uint64_t>> chunks;
+    utime_t start = ceph_clock_now();
+    for (int i = 0; i < ROUNDS; ++i) {
+      cdc_boundary_index_t index;
+      cdc.build_index(bl, &index, lanes);
+      chunks.clear();
+      cdc.calc_chunks(bl, &chunks, &index);
+    }
+    report("fastcdc " + stringify(lanes) + " lanes",
+	   ceph_clock_now() - start, (size_t)ROUNDS * bl.length());
+    if (expected.empty()) {
+      expected = chunks;
+    }
+    ASSERT_EQ(expected, chunks);
+  }
+}
+
+TEST_P(CDCBench, rechunk)
+{
+  // as ceph-dedup-tool's estimate does, from the smallest target up
+  std::vector<std::unique_ptr<CDC>> cdcs;
+  for (int bits = GetParam(); bits <= GetParam() + 4; ++bits) {
+    cdcs.push_back(CDC::create("fastcdc", bits));
+  }
+  std::vector<std::vector<std::pair<uint64_t, uint64_t>>> plain, indexed;
+  utime_t start = ceph_clock_now();
+  for (auto& cdc : cdcs) {
+    plain.emplace_back();
+    cdc->calc_chunks(bl, &plain.back());
+  }
+  report("rechunk w/o index", ceph_clock_now() - start,
+	 cdcs.size() * bl.length());
+
+  start = ceph_clock_now();
+  cdc_boundary_index_t index;
+  for (auto& cdc : cdcs) {
+    indexed.emplace_back();
+    cdc->calc_chunks(bl, &indexed.back(), &index);
+  }
+  report("rechunk with index", ceph_clock_now() - start,
+	 cdcs.size() * bl.length());
+  ASSERT_EQ(plain, indexed);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  CDC,
+  CDCBench,
+  ::testing::Values(12, 16, 20));
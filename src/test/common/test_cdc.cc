@@ -107,6 +107,31 @@ TEST_P(CDCTest, specific_result)
   ASSERT_EQ(chunks, expected[GetParam()]);
 }
 
+TEST_P(CDCTest, index)
+{
+  // an index built at a smaller target serves the larger ones, and an
+  // index of other data is rebuilt
+  bufferlist bl, other;
+  generate_buffer(4*1024*1024, &bl);
+  generate_buffer(3*1024*1024, &other, 1);
+  for (int bits = 16; bits <= 20; ++bits) {
+    auto c = CDC::create(GetParam(), bits);
+    cdc_boundary_index_t index;
+    vector<pair<uint64_t,uint64_t>> chunks, expected;
+    c->calc_chunks(other, &chunks, &index);
+    chunks.clear();
+    c->calc_chunks(bl, &chunks, &index);
+    c->calc_chunks(bl, &expected);
+    ASSERT_EQ(expected, chunks);
+
+    index = cdc_boundary_index_t();
+    CDC::create(GetParam(), 14)->calc_chunks(bl, &chunks, &index);
+    chunks.clear();
+    c->calc_chunks(bl, &chunks, &index);
+    ASSERT_EQ(expected, chunks);
+  }
+}
+
 
 void do_size_histogram(CDC& cdc, bufferlist& bl,
 		       map<int,int> *h)
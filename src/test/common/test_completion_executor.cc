@@ -0,0 +1,200 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "common/ceph_context.h"
+#include "common/CompletionExecutor.h"
+#include "include/compat.h"
+#include "include/msgr.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+class CompletionExecutorTest : public ::testing::Test {
+protected:
+  CephContext *cct = nullptr;
+
+  void SetUp() override {
+    cct = (new CephContext(CEPH_ENTITY_TYPE_CLIENT))->get();
+  }
+  void TearDown() override {
+    cct->put();
+  }
+};
+
+template<typename T>
+Context *lambda(T&& f)
+{
+  return make_lambda_context([f = std::forward<T>(f)](int) { f(); });
+}
+
+} // anonymous namespace
+
+TEST_F(CompletionExecutorTest, strand_fifo)
+{
+  CompletionExecutor ex(cct, "test_ce", 4);
+  CompletionExecutor::Strand strand(&ex, "test");
+  std::vector<int> done;
+  std::vector<int> expected;
+  // queued before the start, some of them queue more while the strand
+  // runs, which requeues it on the executor
+  for (int i = 0; i < 100; i++) {
+    strand.queue(lambda([&strand, &done, i] {
+      done.push_back(i);
+      if (i % 10 == 0) {
+	strand.queue(lambda([&done, i] { done.push_back(1000 + i); }));
+      }
+    }));
+    expected.push_back(i);
+  }
+  for (int i = 0; i < 100; i += 10) {
+    expected.push_back(1000 + i);
+  }
+  ex.start();
+  strand.wait_for_empty();
+  EXPECT_EQ(expected, done);
+
+  // and queued while the workers are running
+  done.clear();
+  expected.clear();
+  for (int i = 0; i < 1000; i++) {
+    strand.queue(lambda([&done, i] { done.push_back(i); }));
+    expected.push_back(i);
+  }
+  strand.wait_for_empty();
+  EXPECT_EQ(expected, done);
+  ex.stop();
+}
+
+TEST_F(CompletionExecutorTest, steal)
+{
+  CompletionExecutor ex(cct, "test_ce", 2);
+  ex.start();
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::promise<std::thread::id> blocked_on;
+  std::promise<std::thread::id> stolen_by;
+  // keep the worker of shard 0 busy, and queue more behind it
+  ex.queue(lambda([&blocked_on, released] {
+    blocked_on.set_value(std::this_thread::get_id());
+    released.wait();
+  }), 0, 0);
+  auto blocked = blocked_on.get_future().get();
+  ex.queue(lambda([&stolen_by] {
+    stolen_by.set_value(std::this_thread::get_id());
+  }), 0, 0);
+  auto stolen = stolen_by.get_future();
+  ASSERT_EQ(std::future_status::ready, stolen.wait_for(10s));
+  EXPECT_NE(blocked, stolen.get());
+  release.set_value();
+  ex.wait_for_empty();
+  ex.stop();
+}
+
+TEST_F(CompletionExecutorTest, wait_for_empty)
+{
+  CompletionExecutor ex(cct, "test_ce", 4);
+  CompletionExecutor::Strand strand(&ex, "test");
+  ex.start();
+  std::atomic<int> count = {0};
+  for (int i = 0; i < 100; i++) {
+    ex.queue(lambda([&count] {
+      std::this_thread::sleep_for(1ms);
+      ++count;
+    }));
+  }
+  ex.wait_for_empty();
+  EXPECT_EQ(100, count);
+
+  // the contexts of a strand are accounted as well
+  for (int i = 0; i < 10; i++) {
+    strand.queue(lambda([&count] {
+      std::this_thread::sleep_for(1ms);
+      ++count;
+    }));
+  }
+  ex.wait_for_empty();
+  EXPECT_EQ(110, count);
+  ex.stop();
+}
+
+TEST_F(CompletionExecutorTest, stop_drains_and_restarts)
+{
+  CompletionExecutor ex(cct, "test_ce", 2);
+  CompletionExecutor::Strand strand(&ex, "test");
+  // stopping before the start leaves everything queued
+  std::atomic<int> count = {0};
+  ex.queue(lambda([&count] { ++count; }));
+  ex.stop();
+  EXPECT_EQ(0, count);
+
+  ex.start();
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::promise<void> blocking;
+  ex.queue(lambda([&blocking, released] {
+    blocking.set_value();
+    released.wait();
+  }), 0, 0);
+  blocking.get_future().wait();
+  for (int i = 0; i < 10; i++) {
+    ex.queue(lambda([&count] { ++count; }), 0, 0);
+    strand.queue(lambda([&count] { ++count; }));
+  }
+  std::thread stopper([&ex] { ex.stop(); });
+  release.set_value();
+  stopper.join();
+  // nothing is left behind by stop()
+  EXPECT_EQ(21, count);
+
+  // queued while stopped, completed once started again
+  for (int i = 0; i < 5; i++) {
+    ex.queue(lambda([&count] { ++count; }));
+    strand.queue(lambda([&count] { ++count; }));
+  }
+  std::this_thread::sleep_for(10ms);
+  EXPECT_EQ(21, count);
+  ex.start();
+  ex.wait_for_empty();
+  strand.wait_for_empty();
+  EXPECT_EQ(31, count);
+  ex.stop();
+}
+
+TEST_F(CompletionExecutorTest, thread_names)
+{
+  CompletionExecutor ex(cct, "test_ce", 2);
+  ex.start();
+  std::mutex lock;
+  std::set<std::string> names;
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::atomic<int> started = {0};
+  // each worker is held up by one of them, so both get to run one
+  for (int i = 0; i < 2; i++) {
+    ex.queue(lambda([&lock, &names, &started, released] {
+      char buf[16];
+      EXPECT_EQ(0, ceph_pthread_getname(pthread_self(), buf, sizeof(buf)));
+      {
+	std::lock_guard l(lock);
+	names.insert(buf);
+      }
+      ++started;
+      released.wait();
+    }), 0, i);
+  }
+  while (started < 2) {
+    std::this_thread::sleep_for(1ms);
+  }
+  release.set_value();
+  ex.wait_for_empty();
+  ex.stop();
+  EXPECT_EQ((std::set<std::string>{"test_ce0", "test_ce1"}), names);
+}
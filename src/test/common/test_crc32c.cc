@@ -13,6 +13,8 @@
 
 #include "common/sctp_crc32.h"
 #include "common/crc32c_intel_baseline.h"
+#include "common/crc32c_intel_interleave.h"
+#include "arch/intel.h"
 #include "common/crc32c_aarch64.h"
 
 TEST(Crc32c, Small) {
@@ -44,6 +46,43 @@ TEST(Crc32c, Big) {
   free(a);
 }
 
+TEST(Crc32c, Combine) {
+  int len = 100000;
+  unsigned char *a = (unsigned char *)malloc(len);
+  for (int i = 0; i < len; i++)
+    a[i] = rand();
+  for (int split : {0, 1, 15, 17, 4096, 33333, len}) {
+    uint32_t crc_a = ceph_crc32c(-1, a, split);
+    uint32_t crc_b = ceph_crc32c(0, a + split, len - split);
+    ASSERT_EQ(ceph_crc32c(-1, a, len),
+	      ceph_crc32c_combine(crc_a, crc_b, len - split));
+  }
+  free(a);
+}
+
+#if defined(__x86_64__)
+TEST(Crc32c, Interleave) {
+  if (!ceph_arch_intel_sse42 || !ceph_crc32c_intel_interleave_exists()) {
+    GTEST_SKIP() << "no sse 4.2";
+  }
+  int len = 100000;
+  unsigned char *a = (unsigned char *)malloc(len + 8);
+  for (int i = 0; i < len + 8; i++)
+    a[i] = rand();
+  // across the lengths of the streams, and unaligned
+  for (unsigned l : {0, 7, 255, 767, 768, 769, 4096, 24575, 24576, 24577,
+		     100000}) {
+    for (unsigned off = 0; off < 8; off++) {
+      ASSERT_EQ(ceph_crc32c_sctp(-1, a + off, l),
+		ceph_crc32c_intel_interleave(-1, a + off, l));
+    }
+    ASSERT_EQ(ceph_crc32c_sctp(1234, nullptr, l),
+	      ceph_crc32c_intel_interleave(1234, nullptr, l));
+  }
+  free(a);
+}
+#endif
+
 TEST(Crc32c, Performance) {
   int len = 1000 * 1024 * 1024;
   char *a = (char *)malloc(len);
@@ -84,6 +123,16 @@ TEST(Crc32c, Performance) {
     std::cout << "intel baseline = " << rate << " MB/sec" << std::endl;
     ASSERT_EQ(261108528u, val);
   }
+#if defined(__x86_64__)
+  if (ceph_arch_intel_sse42 && ceph_crc32c_intel_interleave_exists()) {
+    utime_t start = ceph_clock_now();
+    unsigned val = ceph_crc32c_intel_interleave(0, (unsigned char *)a, len);
+    utime_t end = ceph_clock_now();
+    float rate = (float)len / (float)(1024*1024) / (float)(end - start);
+    std::cout << "intel interleave = " << rate << " MB/sec" << std::endl;
+    ASSERT_EQ(261108528u, val);
+  }
+#endif
 #if defined(__arm__) || defined(__aarch64__)
   if (ceph_arch_aarch64_crc32) // Skip if CRC32C instructions are not defined.
   {
@@ -1,6 +1,8 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <thread>
+
 #include "gtest/gtest.h"
 #include "common/numa.h"
 
@@ -70,3 +72,39 @@ TEST(cpu_set, round_trip_list)
   }
 }
 
+
+TEST(numa, thread_affinity)
+{
+  std::set<int> nodes;
+  if (get_numa_nodes(&nodes) < 0) {
+    GTEST_SKIP() << "no numa information";
+  }
+  ASSERT_FALSE(nodes.empty());
+  ASSERT_EQ(-1, get_thread_numa_node());
+  int node = *nodes.begin();
+  ASSERT_EQ(0, set_thread_numa_affinity(node));
+  ASSERT_EQ(node, get_thread_numa_node());
+  ASSERT_EQ(node, get_current_numa_node());
+  size_t size;
+  cpu_set_t cpu_set;
+  ASSERT_EQ(0, get_numa_node_cpu_set(node, &size, &cpu_set));
+  for (int cpu : cpu_set_to_set(size, &cpu_set)) {
+    ASSERT_EQ(node, get_cpu_numa_node(cpu));
+  }
+}
+
+TEST(numa, current_node)
+{
+  std::set<int> nodes;
+  if (get_numa_nodes(&nodes) < 0) {
+    GTEST_SKIP() << "no numa information";
+  }
+  // looked up from the cpu the thread runs on, in a thread which is not bound
+  std::thread t([&nodes] {
+    ASSERT_EQ(-1, get_thread_numa_node());
+    int node = get_current_numa_node();
+    ASSERT_EQ(1u, nodes.count(node));
+  });
+  t.join();
+  ASSERT_EQ(-ENOENT, get_cpu_numa_node(-1));
+}
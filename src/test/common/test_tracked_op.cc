@@ -0,0 +1,207 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <sstream>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "common/ceph_context.h"
+#include "common/config_proxy.h"
+#include "common/Formatter.h"
+#include "common/TrackedOp.h"
+#include "include/msgr.h"
+
+namespace {
+
+std::atomic<int> num_alive = {0};
+
+class TestOp : public TrackedOp {
+  const int id;
+public:
+  TestOp(OpTracker *tracker, int id)
+    : TrackedOp(tracker, ceph_clock_now()), id(id) {
+    ++num_alive;
+  }
+  ~TestOp() override {
+    --num_alive;
+  }
+  void _dump_op_descriptor_unlocked(std::ostream& stream) const override {
+    stream << "test_op(" << id << ")";
+  }
+  std::vector<std::string> event_names() const {
+    std::vector<std::string> names;
+    for (auto& e : get_events()) {
+      names.push_back(e.str);
+    }
+    return names;
+  }
+};
+
+class OpTrackerLockless : public ::testing::Test {
+protected:
+  CephContext *cct = nullptr;
+  std::unique_ptr<OpTracker> tracker;
+
+  void SetUp() override {
+    num_alive = 0;
+    cct = (new CephContext(CEPH_ENTITY_TYPE_CLIENT))->get();
+    cct->_conf.set_val("op_tracker_lockless", "true");
+    tracker.reset(new OpTracker(cct, true, 1));
+    ASSERT_TRUE(tracker->is_lockless());
+  }
+  void TearDown() override {
+    tracker->on_shutdown();
+    tracker.reset();
+    cct->put();
+  }
+  TrackedOpRef start_op(int id) {
+    TrackedOpRef op(new TestOp(tracker.get(), id));
+    op->tracking_start();
+    return op;
+  }
+  void complete_ops(int from, int to) {
+    for (int i = from; i < to; i++) {
+      start_op(i);
+    }
+  }
+  std::string dump_history() {
+    JSONFormatter f;
+    tracker->dump_historic_ops(&f);
+    std::ostringstream ss;
+    f.flush(ss);
+    return ss.str();
+  }
+};
+
+size_t count(const std::string& s, const std::string& what)
+{
+  size_t n = 0;
+  for (auto pos = s.find(what); pos != s.npos; pos = s.find(what, pos + 1)) {
+    n++;
+  }
+  return n;
+}
+
+} // anonymous namespace
+
+TEST(TrackedOp, register_event)
+{
+  auto a = TrackedOp::register_event("test_event_a");
+  auto b = TrackedOp::register_event("test_event_b");
+  EXPECT_NE(TrackedOp::EVENT_NONE, a);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(a, TrackedOp::register_event("test_event_a"));
+  EXPECT_STREQ("test_event_a", TrackedOp::get_event_name(a));
+  EXPECT_STREQ("test_event_b", TrackedOp::get_event_name(b));
+  // the well known events are registered up front
+  EXPECT_EQ(TrackedOp::EVENT_DONE, TrackedOp::register_event("done"));
+  EXPECT_STREQ("initiated",
+	       TrackedOp::get_event_name(TrackedOp::EVENT_INITIATED));
+}
+
+TEST_F(OpTrackerLockless, events_in_marked_order)
+{
+  auto ev = TrackedOp::register_event("test_event");
+  auto op = start_op(0);
+  auto test_op = static_cast<TestOp*>(op.get());
+  utime_t now = ceph_clock_now();
+  auto ago = [now](int secs) {
+    return utime_t(now.sec() - secs, now.nsec());
+  };
+  // the stamps go backwards, the order of marking wins
+  op->mark_event(TrackedOp::EVENT_DISPATCHED, now);
+  op->mark_event("by_name", ago(2));
+  op->mark_event(ev, ago(1));
+  EXPECT_EQ((std::vector<std::string>{
+	"initiated", "dispatched", "by_name", "test_event"}),
+    test_op->event_names());
+  EXPECT_EQ("test_event", op->state_string());
+
+  // the ones which do not fit in the preallocated slots go to the list
+  std::vector<std::string> expected = test_op->event_names();
+  for (int i = expected.size(); i < OPTRACKER_PREALLOC_EVENTS + 2; i++) {
+    op->mark_event(ev, ago(i));
+    expected.push_back("test_event");
+  }
+  op->mark_event("last", ago(100));
+  expected.push_back("last");
+  EXPECT_EQ(expected, test_op->event_names());
+  EXPECT_EQ("last", op->state_string());
+  op->mark_event(TrackedOp::EVENT_DONE, ago(200));
+  EXPECT_EQ("done", op->state_string());
+}
+
+TEST_F(OpTrackerLockless, history_ring)
+{
+  tracker->set_history_size_and_duration(4, 600);
+  complete_ops(0, 10);
+  // the ring keeps the latest ones, and releases the ones it overwrites
+  EXPECT_EQ(4, num_alive);
+  auto dump = dump_history();
+  EXPECT_EQ(4u, count(dump, "\"description\""));
+  for (int i = 6; i < 10; i++) {
+    EXPECT_EQ(1u, count(dump, "test_op(" + std::to_string(i) + ")"));
+  }
+  // collecting takes references, and puts the ops back
+  EXPECT_EQ(4, num_alive);
+  EXPECT_EQ(4u, count(dump_history(), "\"description\""));
+}
+
+TEST_F(OpTrackerLockless, reset_rings)
+{
+  tracker->set_history_size_and_duration(4, 600);
+  complete_ops(0, 4);
+  EXPECT_EQ(4, num_alive);
+  // resizing drains the old rings
+  tracker->set_history_size_and_duration(2, 600);
+  EXPECT_EQ(0, num_alive);
+  EXPECT_EQ(0u, count(dump_history(), "\"description\""));
+  complete_ops(4, 7);
+  EXPECT_EQ(2, num_alive);
+  auto dump = dump_history();
+  EXPECT_EQ(2u, count(dump, "\"description\""));
+  EXPECT_EQ(1u, count(dump, "test_op(6)"));
+  // the same size does not reset them
+  tracker->set_history_size_and_duration(2, 600);
+  EXPECT_EQ(2, num_alive);
+}
+
+TEST_F(OpTrackerLockless, reset_rings_while_inserting)
+{
+  tracker->set_history_size_and_duration(4, 600);
+  std::atomic<bool> stop = {false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([this, &stop, t] {
+      for (int i = 0; !stop; i++) {
+	start_op(t * 1000000 + i);
+      }
+    });
+  }
+  // the retired rings are freed while the inserts keep going
+  for (int i = 0; i < 200; i++) {
+    tracker->set_history_size_and_duration(2 + i % 2, 600);
+    dump_history();
+  }
+  stop = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  tracker->set_history_size_and_duration(4, 600);
+  EXPECT_EQ(0, num_alive);
+  complete_ops(0, 10);
+  EXPECT_EQ(4, num_alive);
+}
+
+TEST_F(OpTrackerLockless, drain_on_shutdown)
+{
+  tracker->set_history_size_and_duration(4, 600);
+  tracker->set_history_slow_op_size_and_threshold(4, 0);
+  complete_ops(0, 3);
+  EXPECT_EQ(3, num_alive);
+  tracker->on_shutdown();
+  EXPECT_EQ(0, num_alive);
+  // nothing is kept after the shutdown
+  complete_ops(3, 5);
+  EXPECT_EQ(0, num_alive);
+}
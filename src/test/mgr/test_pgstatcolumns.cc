@@ -0,0 +1,92 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "mgr/PGStatColumns.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+  pg_stat_t make_stat(epoch_t epoch, version_t seq, int64_t objects) {
+    pg_stat_t s;
+    s.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+    s.reported_epoch = epoch;
+    s.reported_seq = seq;
+    s.acting_primary = 1;
+    s.stats.sum.num_objects = objects;
+    s.stats.sum.num_bytes = objects * 4096;
+    return s;
+  }
+}
+
+TEST(PGStatColumns, ingest)
+{
+  PGStatColumns columns;
+  columns.set_pools({{1, 4}, {2, 8}});
+
+  PGStatColumns::pg_stat_map_t stats;
+  stats[pg_t(0, 1)] = make_stat(10, 5, 1);
+  stats[pg_t(3, 1)] = make_stat(10, 5, 2);
+  stats[pg_t(4, 1)] = make_stat(10, 5, 3);   // beyond pg_num
+  stats[pg_t(7, 2)] = make_stat(10, 5, 4);
+  stats[pg_t(0, 3)] = make_stat(10, 5, 5);   // no such pool
+  std::vector<PGStatColumns::pg_stat_map_t::iterator> accepted;
+  columns.ingest(stats, &accepted);
+  ASSERT_EQ(3u, accepted.size());
+  ASSERT_EQ(pg_t(0, 1), accepted[0]->first);
+  ASSERT_EQ(pg_t(3, 1), accepted[1]->first);
+  ASSERT_EQ(pg_t(7, 2), accepted[2]->first);
+
+  // an older report from another OSD is screened out
+  stats.clear();
+  accepted.clear();
+  stats[pg_t(0, 1)] = make_stat(10, 4, 10);
+  stats[pg_t(3, 1)] = make_stat(11, 1, 20);
+  columns.ingest(stats, &accepted);
+  ASSERT_EQ(1u, accepted.size());
+  ASSERT_EQ(pg_t(3, 1), accepted[0]->first);
+
+  auto snap = columns.snapshot();
+  ASSERT_EQ(2u, snap.size());
+  auto& pool = snap[1];
+  ASSERT_EQ(4u, pool.size());
+  ASSERT_EQ(1, pool.num_objects[0]);
+  ASSERT_EQ(20, pool.num_objects[3]);
+  ASSERT_EQ(20 * 4096, pool.num_bytes[3]);
+  ASSERT_EQ(11u, pool.reported_epoch[3]);
+  ASSERT_EQ(0u, pool.reported_epoch[1]);
+  ASSERT_EQ(-1, pool.acting_primary[1]);
+  ASSERT_EQ(8u, snap[2].size());
+  ASSERT_EQ(4, snap[2].num_objects[7]);
+}
+
+TEST(PGStatColumns, apply)
+{
+  PGStatColumns columns;
+  columns.set_pools({{1, 4}});
+
+  PGStatColumns::pg_stat_map_t stats;
+  stats[pg_t(0, 1)] = make_stat(10, 5, 1);
+  stats[pg_t(1, 1)] = make_stat(10, 5, 1);
+  std::vector<PGStatColumns::pg_stat_map_t::iterator> accepted;
+  columns.ingest(stats, &accepted);
+
+  PGMap::Incremental inc;
+  // marked stale by the mgr, same reported version
+  auto stale = make_stat(10, 5, 1);
+  stale.state |= PG_STATE_STALE;
+  inc.pg_stat_updates[pg_t(0, 1)] = stale;
+  // older than what we screened already
+  inc.pg_stat_updates[pg_t(1, 1)] = make_stat(9, 1, 100);
+  inc.pg_remove.insert(pg_t(2, 1));
+  columns.apply(inc);
+
+  auto snap = columns.snapshot();
+  ASSERT_TRUE(snap[1].state[0] & PG_STATE_STALE);
+  ASSERT_EQ(1, snap[1].num_objects[1]);
+
+  // pg_num shrinks, pool goes away
+  columns.set_pools({{1, 2}});
+  ASSERT_EQ(2u, columns.snapshot()[1].size());
+  columns.set_pools({});
+  ASSERT_TRUE(columns.snapshot().empty());
+}
@@ -164,3 +164,114 @@ TEST(pgmap, dump_object_stat_sum_2)
   ASSERT_EQ(percentify(0), tbl.get(0, col++));
   ASSERT_EQ(stringify(byte_u_t(avail/pool.size)), tbl.get(0, col++));
 }
+
+namespace {
+  PGMap::Incremental next_inc(const PGMap& pg_map) {
+    PGMap::Incremental inc;
+    inc.version = pg_map.version + 1;
+    inc.stamp = ceph_clock_now();
+    return inc;
+  }
+
+  pg_stat_t make_pg_stat(int primary, uint64_t objects,
+			 snapid_t purged_from, snapid_t purged_len) {
+    pg_stat_t s;
+    s.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+    s.up = s.acting = {primary, primary + 1};
+    s.up_primary = s.acting_primary = primary;
+    s.stats.sum.num_objects = objects;
+    s.purged_snaps.insert(purged_from, purged_len);
+    return s;
+  }
+}
+
+TEST(pgmap, purged_snaps)
+{
+  PGMap pg_map;
+  auto inc = next_inc(pg_map);
+  for (unsigned ps = 0; ps < 4; ps++) {
+    inc.pg_stat_updates[pg_t(ps, 1)] = make_pg_stat(0, 1, 1, 10);
+    inc.pg_stat_updates[pg_t(ps, 2)] = make_pg_stat(0, 1, 1, 20);
+  }
+  pg_map.apply_incremental(nullptr, inc);
+  pg_map.calc_purged_snaps();
+  ASSERT_EQ(2u, pg_map.purged_snaps.size());
+  ASSERT_EQ(10u, pg_map.purged_snaps[1].size());
+  ASSERT_EQ(20u, pg_map.purged_snaps[2].size());
+
+  // one pg lagging behind shrinks the intersection of its pool only
+  inc = next_inc(pg_map);
+  inc.pg_stat_updates[pg_t(2, 2)] = make_pg_stat(0, 1, 1, 5);
+  pg_map.apply_incremental(nullptr, inc);
+  pg_map.calc_purged_snaps();
+  ASSERT_EQ(10u, pg_map.purged_snaps[1].size());
+  ASSERT_EQ(5u, pg_map.purged_snaps[2].size());
+
+  // an unknown pg hides its pool's purged snaps
+  inc = next_inc(pg_map);
+  inc.pg_stat_updates[pg_t(0, 1)] = pg_stat_t();
+  pg_map.apply_incremental(nullptr, inc);
+  pg_map.calc_purged_snaps();
+  ASSERT_EQ(0u, pg_map.purged_snaps.count(1));
+  ASSERT_EQ(5u, pg_map.purged_snaps[2].size());
+
+  // and a full recalculation agrees with the incremental one
+  PGMap full = pg_map;
+  full.calc_stats();
+  full.calc_purged_snaps();
+  ASSERT_EQ(full.purged_snaps, pg_map.purged_snaps);
+}
+
+TEST(pgmap, digest_delta)
+{
+  PGMap pg_map;
+  auto inc = next_inc(pg_map);
+  for (unsigned ps = 0; ps < 8; ps++) {
+    inc.pg_stat_updates[pg_t(ps, 1)] = make_pg_stat(ps % 4, 10, 1, 10);
+    inc.pg_stat_updates[pg_t(ps, 2)] = make_pg_stat(ps % 4, 20, 1, 20);
+  }
+  for (int osd = 0; osd < 5; osd++) {
+    osd_stat_t s;
+    s.seq = 100 + osd;
+    inc.update_stat(osd, std::move(s));
+  }
+  pg_map.apply_incremental(nullptr, inc);
+  pg_map.calc_purged_snaps();
+  PGMapDigest base = pg_map;
+
+  // some pgs of pool 2 change, pool 1 goes away, one osd reports
+  inc = next_inc(pg_map);
+  inc.pg_stat_updates[pg_t(3, 2)] = make_pg_stat(1, 25, 1, 20);
+  inc.pg_stat_updates[pg_t(4, 2)] = make_pg_stat(2, 30, 1, 15);
+  for (unsigned ps = 0; ps < 8; ps++) {
+    inc.pg_remove.insert(pg_t(ps, 1));
+  }
+  osd_stat_t s;
+  s.seq = 200;
+  inc.update_stat(3, std::move(s));
+  pg_map.apply_incremental(nullptr, inc);
+  pg_map.calc_purged_snaps();
+
+  bufferlist full, delta;
+  pg_map.PGMapDigest::encode(full, CEPH_FEATURES_ALL);
+  pg_map.encode_delta(base, delta, CEPH_FEATURES_ALL);
+  ASSERT_LT(delta.length(), full.length());
+
+  PGMapDigest applied = base;
+  auto p = delta.cbegin();
+  applied.apply_delta(p);
+  ASSERT_TRUE(p.end());
+  ASSERT_EQ(pg_map.num_pg, applied.num_pg);
+  ASSERT_EQ(pg_map.pg_sum, applied.pg_sum);
+  ASSERT_EQ(pg_map.osd_sum, applied.osd_sum);
+  ASSERT_EQ(pg_map.pg_pool_sum, applied.pg_pool_sum);
+  ASSERT_EQ(0u, applied.pg_pool_sum.count(1));
+  ASSERT_EQ(pg_map.num_pg_by_pool, applied.num_pg_by_pool);
+  ASSERT_EQ(pg_map.num_pg_by_state, applied.num_pg_by_state);
+  ASSERT_EQ(pg_map.num_pg_by_osd, applied.num_pg_by_osd);
+  ASSERT_EQ(pg_map.osd_last_seq, applied.osd_last_seq);
+  ASSERT_EQ(pg_map.purged_snaps, applied.purged_snaps);
+  ASSERT_EQ(pg_map.per_pool_sum_delta, applied.per_pool_sum_delta);
+  ASSERT_EQ(pg_map.per_pool_sum_deltas_stamps,
+	    applied.per_pool_sum_deltas_stamps);
+}
@@ -760,6 +760,177 @@ TEST(BlueFS, test_replay_growth) {
   fs.umount();
 }
 
+TEST(BlueFS, test_parallel_fsync) {
+  uint64_t size = 1048576 * 128;
+  TempBdev bdev{size};
+  BlueFS fs(g_ceph_context);
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, bdev.path, false, 1048576));
+  uuid_d fsid;
+  ASSERT_EQ(0, fs.mkfs(fsid, { BlueFS::BDEV_DB, false, false }));
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.mkdir("dir"));
+
+  const unsigned num_threads = 8;
+  const unsigned num_appends = 500;
+  const size_t append_len = 1000;
+  std::vector<std::thread> writers;
+  for (unsigned t = 0; t < num_threads; t++) {
+    writers.emplace_back([&fs, t] {
+      BlueFS::FileWriter *h;
+      ASSERT_EQ(0, fs.open_for_write("dir", "file." + stringify(t), &h, false));
+      std::string data(append_len, 'a' + t);
+      for (unsigned i = 0; i < num_appends; i++) {
+	fs.append_try_flush(h, data.c_str(), data.length());
+	ASSERT_EQ(0, fs.fsync(h));
+      }
+      fs.close_writer(h);
+    });
+  }
+  join_all(writers);
+  // how many fsyncs find their update already synced by another thread's
+  // log flush depends on the timing, but no more than all of them can
+  auto logger = fs.get_perf_counters();
+  ASSERT_GT(logger->get(l_bluefs_log_sync_requests), 0u);
+  ASSERT_LE(logger->get(l_bluefs_log_sync_grouped),
+	    logger->get(l_bluefs_log_sync_requests));
+  fs.umount(true);
+
+  // every fsync'ed append made it to the log
+  ASSERT_EQ(0, fs.mount());
+  for (unsigned t = 0; t < num_threads; t++) {
+    BlueFS::FileReader *h;
+    ASSERT_EQ(0, fs.open_for_read("dir", "file." + stringify(t), &h));
+    bufferlist bl;
+    ASSERT_EQ((int64_t)(num_appends * append_len),
+	      fs.read(h, 0, num_appends * append_len, &bl, NULL));
+    ASSERT_EQ(std::string(num_appends * append_len, 'a' + t), bl.to_str());
+    delete h;
+  }
+  fs.umount();
+}
+
+TEST(BlueFS, test_buffer_cache) {
+  uint64_t size = 1048576 * 128;
+  TempBdev bdev{size};
+  BlueFS fs(g_ceph_context);
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, bdev.path, false, 1048576));
+  uuid_d fsid;
+  ASSERT_EQ(0, fs.mkfs(fsid, { BlueFS::BDEV_DB, false, false }));
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.mkdir("dir"));
+
+  const uint64_t file_size = 1048576 + 1000;
+  std::unique_ptr<char[]> buf = gen_buffer(file_size);
+  {
+    BlueFS::FileWriter *h;
+    ASSERT_EQ(0, fs.open_for_write("dir", "file", &h, false));
+    h->append(buf.get(), file_size);
+    fs.fsync(h);
+    fs.close_writer(h);
+  }
+  auto cache = fs.get_buffer_cache();
+  const uint64_t bs = cache->get_block_size();
+  cache->set_max(64 * bs);
+  auto logger = fs.get_perf_counters();
+
+  BlueFS::FileReader *h;
+  ASSERT_EQ(0, fs.open_for_read("dir", "file", &h, true));
+  {
+    // a miss, then a hit, both spanning two blocks
+    char out[2000];
+    uint64_t off = bs - 1000;
+    ASSERT_EQ(2000, fs.read_random(h, off, sizeof(out), out));
+    ASSERT_EQ(0, memcmp(buf.get() + off, out, sizeof(out)));
+    ASSERT_EQ(2u, logger->get(l_bluefs_read_cache_miss_count));
+    ASSERT_EQ(0u, logger->get(l_bluefs_read_cache_hit_count));
+    memset(out, 0, sizeof(out));
+    ASSERT_EQ(2000, fs.read_random(h, off, sizeof(out), out));
+    ASSERT_EQ(0, memcmp(buf.get() + off, out, sizeof(out)));
+    ASSERT_EQ(2u, logger->get(l_bluefs_read_cache_hit_count));
+    ASSERT_EQ(2 * bs, cache->get_bytes());
+  }
+  {
+    // overlapping reads within a block are served by the same cached block
+    char out[100];
+    ASSERT_EQ(100, fs.read_random(h, 10, sizeof(out), out));
+    ASSERT_EQ(0, memcmp(buf.get() + 10, out, sizeof(out)));
+    ASSERT_EQ(3u, logger->get(l_bluefs_read_cache_hit_count));
+    ASSERT_EQ(100, fs.read_random(h, 20, sizeof(out), out));
+    ASSERT_EQ(0, memcmp(buf.get() + 20, out, sizeof(out)));
+    ASSERT_EQ(4u, logger->get(l_bluefs_read_cache_hit_count));
+    ASSERT_EQ(2u, logger->get(l_bluefs_read_cache_miss_count));
+  }
+  {
+    // the tail block is trimmed to the eof
+    char out[4096];
+    ASSERT_EQ(1000, fs.read_random(h, file_size - 1000, sizeof(out), out));
+    ASSERT_EQ(0, memcmp(buf.get() + file_size - 1000, out, 1000));
+  }
+  // no read ahead for RANDOM readers
+  ASSERT_EQ(0u, logger->get(l_bluefs_read_ahead_bytes));
+
+  // sequential reads grow the read ahead window up to max_prefetch
+  h->buf.max_prefetch = 8 * bs;
+  for (uint64_t off = 4 * bs; off < 12 * bs; off += 4096) {
+    char out[4096];
+    ASSERT_EQ(4096, fs.read_random(h, off, sizeof(out), out));
+    ASSERT_EQ(0, memcmp(buf.get() + off, out, sizeof(out)));
+  }
+  ASSERT_GT(logger->get(l_bluefs_read_ahead_bytes), 0u);
+  ASSERT_LE(logger->get(l_bluefs_read_cache_miss_count), 4u);
+  ASSERT_LE(cache->get_bytes(), 64 * bs);
+
+  // shrinking evicts, removing the file drops what is left
+  cache->set_max(4 * bs);
+  ASSERT_LE(cache->get_bytes(), 4 * bs);
+  delete h;
+  ASSERT_EQ(0, fs.unlink("dir", "file"));
+  ASSERT_EQ(0u, cache->get_bytes());
+  cache->set_max(0);
+  fs.umount();
+}
+
+TEST(BlueFS, test_buffer_cache_full) {
+  BlueFSBufferCache cache(g_ceph_context);
+  const uint64_t bs = cache.get_block_size();
+  // 4 blocks per shard; every NUM_SHARDS'th block of a file is in the same
+  // shard
+  cache.set_max(BlueFSBufferCache::NUM_SHARDS * 4 * bs);
+  auto block = [&](unsigned i) {
+    return i * BlueFSBufferCache::NUM_SHARDS * bs;
+  };
+  for (unsigned i = 0; i < 4; i++) {
+    cache.insert(1, block(i), bufferptr(bs), false);
+  }
+  ASSERT_EQ(4 * bs, cache.get_bytes());
+
+  // read ahead into a full cache is not the first to go
+  cache.insert(1, block(4), bufferptr(bs), true);
+  ASSERT_TRUE(cache.contains(1, block(4)));
+  ASSERT_FALSE(cache.contains(1, block(0)));
+  ASSERT_EQ(4 * bs, cache.get_bytes());
+
+  // but once it has its share, it replaces older read ahead, not hot blocks
+  cache.insert(1, block(5), bufferptr(bs), true);
+  ASSERT_TRUE(cache.contains(1, block(5)));
+  ASSERT_FALSE(cache.contains(1, block(4)));
+  for (unsigned i = 1; i < 4; i++) {
+    ASSERT_TRUE(cache.contains(1, block(i)));
+  }
+
+  // a hit promotes it
+  bufferptr bp;
+  ASSERT_TRUE(cache.lookup(1, block(5), &bp));
+  cache.insert(1, block(6), bufferptr(bs), true);
+  ASSERT_TRUE(cache.contains(1, block(5)));
+  ASSERT_TRUE(cache.contains(1, block(6)));
+  ASSERT_FALSE(cache.contains(1, block(1)));
+  ASSERT_EQ(4 * bs, cache.get_bytes());
+
+  cache.discard(1);
+  ASSERT_EQ(0u, cache.get_bytes());
+}
+
 int main(int argc, char **argv) {
   vector<const char*> args;
   argv_to_vec(argc, (const char **)argv, args);
@@ -16,8 +16,10 @@
 #include <string.h>
 #include <iostream>
 #include <time.h>
+#include <thread>
 #include <sys/mount.h>
 #include "kv/KeyValueDB.h"
+#include "kv/MemDBSkipList.h"
 #include "kv/RocksDBStore.h"
 #include "include/Context.h"
 #include "common/ceph_argparse.h"
@@ -50,8 +52,15 @@ public:
 
   void init() {
     cout << "Creating " << string(GetParam()) << "\n";
-    db.reset(KeyValueDB::create(g_ceph_context, string(GetParam()),
+    string type = GetParam();
+    if (type == "memdb-skiplist") {
+      // the index is picked when the MemDB is created
+      g_ceph_context->_conf.set_val("memdb_index", "skiplist");
+      type = "memdb";
+    }
+    db.reset(KeyValueDB::create(g_ceph_context, type,
 				"kv_test_temp_dir"));
+    g_ceph_context->_conf.set_val("memdb_index", "map");
   }
   void fini() {
     db.reset(NULL);
@@ -349,6 +358,136 @@ TEST_P(KVTest, ShardingRMRange) {
 }
 
 
+TEST_P(KVTest, RocksDBTombstoneCompact) {
+  if(string(GetParam()) != "rocksdb")
+    return;
+  fini();
+  g_ceph_context->_conf.set_val_or_die("rocksdb_delete_range_mode", "always");
+  g_ceph_context->_conf.set_val_or_die("rocksdb_tombstone_compact_threshold", "150");
+  init();
+  std::string cfs("O(3)=");
+  ASSERT_EQ(0, db->create_and_open(cout, cfs));
+  for (auto prefix : {"O", "M"}) {
+    KeyValueDB::Transaction t = db->get_transaction();
+    for (size_t i = 0; i < 100; i++) {
+      bufferlist value;
+      value.append(stringify(i));
+      t->set(prefix, stringify(1000 + i), value);
+    }
+    db->submit_transaction_sync(t);
+  }
+  {
+    // a range tombstone per removal, never mind how many keys
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->rm_range_keys("O", "1010", "1090");
+    t->rmkeys_by_prefix("M");
+    db->submit_transaction_sync(t);
+  }
+  auto logger = db->get_perf_counters();
+  ASSERT_EQ(2u, logger->get(l_rocksdb_range_tombstones));
+  ASSERT_EQ(0u, logger->get(l_rocksdb_point_tombstones));
+  ASSERT_EQ(0u, logger->get(l_rocksdb_tombstone_compact));
+  for (size_t i = 0; i < 100; i++) {
+    bufferlist value;
+    ASSERT_EQ(i >= 10 && i < 90 ? -ENOENT : 0,
+	      db->get("O", stringify(1000 + i), &value));
+    ASSERT_EQ(-ENOENT, db->get("M", stringify(1000 + i), &value));
+  }
+  fini();
+
+  g_ceph_context->_conf.set_val_or_die("rocksdb_delete_range_mode", "threshold");
+  init();
+  ASSERT_EQ(0, db->open(cout, cfs));
+  {
+    // 10 + 10 keys left in O, and only 20 tombstones
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->rm_range_keys("O", "1000", "1100");
+    db->submit_transaction_sync(t);
+  }
+  logger = db->get_perf_counters();
+  ASSERT_EQ(20u, logger->get(l_rocksdb_point_tombstones));
+  ASSERT_EQ(0u, logger->get(l_rocksdb_tombstone_compact));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    for (size_t i = 0; i < 200; i++) {
+      bufferlist value;
+      value.append(stringify(i));
+      t->set("O", stringify(2000 + i), value);
+    }
+    db->submit_transaction_sync(t);
+  }
+  {
+    // now we have more than enough for a compaction
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->rm_range_keys("O", "2000", "2200");
+    db->submit_transaction_sync(t);
+  }
+  ASSERT_EQ(220u, logger->get(l_rocksdb_point_tombstones));
+  ASSERT_EQ(1u, logger->get(l_rocksdb_tombstone_compact));
+  fini();
+
+  g_ceph_context->_conf.rm_val("rocksdb_delete_range_mode");
+  g_ceph_context->_conf.rm_val("rocksdb_tombstone_compact_threshold");
+}
+
+TEST(RocksDBCache, split_capacity) {
+  using rocksdb_cache::BinnedLRUCache;
+  // by weight
+  auto sizes = BinnedLRUCache::split_capacity(
+    1000, {1, 3}, {{0, 1}, {0, 1}});
+  ASSERT_NEAR(250, sizes[0], 1);
+  ASSERT_NEAR(750, sizes[1], 1);
+  // the busy one is capped, the rest goes to the idle one
+  sizes = BinnedLRUCache::split_capacity(
+    1000, {1, 1000}, {{0, 1}, {0, 0.5}});
+  ASSERT_NEAR(500, sizes[0], 1);
+  ASSERT_NEAR(500, sizes[1], 1);
+  // the idle one keeps its minimum
+  sizes = BinnedLRUCache::split_capacity(
+    1000, {1000, 1, 1}, {{0, 1}, {0.2, 0.5}, {0, 0.5}});
+  ASSERT_GE(sizes[1], 199u);
+  ASSERT_LE(sizes[2], 10u);
+  ASSERT_NEAR(1000, sizes[0] + sizes[1] + sizes[2], 3);
+  // too much reserved
+  sizes = BinnedLRUCache::split_capacity(
+    1000, {1, 1}, {{0.8, 1}, {0.8, 1}});
+  ASSERT_NEAR(500, sizes[0], 1);
+  ASSERT_NEAR(500, sizes[1], 1);
+}
+
+TEST_P(KVTest, RocksDBCachePartitions) {
+  if(string(GetParam()) != "rocksdb")
+    return;
+  fini();
+  g_ceph_context->_conf.set_val_or_die("rocksdb_cache_partitions", "O=0.1:0.5");
+  init();
+  std::string cfs("O(3)= P");
+  ASSERT_EQ(0, db->create_and_open(cout, cfs));
+  // the partition is balanced with the whole cache, not on its own
+  ASSERT_NE(nullptr, db->get_priority_cache());
+  ASSERT_EQ(nullptr, db->get_priority_cache("O"));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    for (size_t i = 0; i < 100; i++) {
+      bufferlist value;
+      value.append(stringify(i));
+      t->set("O", stringify(i), value);
+      t->set("P", stringify(i), value);
+    }
+    db->submit_transaction_sync(t);
+  }
+  db->compact();
+  for (size_t i = 0; i < 100; i++) {
+    bufferlist value;
+    ASSERT_EQ(0, db->get("O", stringify(i), &value));
+  }
+  auto cache = db->get_priority_cache();
+  cache->commit_cache_size(64 << 20);
+  ASSERT_EQ(64 << 20, cache->get_committed_size());
+  fini();
+  g_ceph_context->_conf.rm_val("rocksdb_cache_partitions");
+}
+
 TEST_P(KVTest, RocksDBColumnFamilyTest) {
   if(string(GetParam()) != "rocksdb")
     return;
@@ -666,6 +805,93 @@ TEST_P(KVTest, RocksDB_parse_sharding_def) {
 
 
 
+TEST(MemDBSkipList, basic) {
+  MemDBSkipList sl;
+  auto val = [](const string& s) {
+    return bufferptr(s.c_str(), s.length());
+  };
+  for (auto k : {"b", "d", "a", "c"}) {
+    ASSERT_FALSE(sl.set(k, val(k)));
+  }
+  bufferptr old;
+  ASSERT_TRUE(sl.set("c", val("C"), &old));
+  ASSERT_EQ("c", string(old.c_str(), old.length()));
+  ASSERT_EQ(4u, sl.size());
+
+  MemDBSkipList::ReadGuard g(sl);
+  ASSERT_EQ("a", sl.first()->key);
+  ASSERT_EQ("d", sl.last()->key);
+  ASSERT_EQ("C", string(sl.find("c")->get_value().c_str(), 1));
+  ASSERT_EQ(nullptr, sl.find("e"));
+  ASSERT_EQ("b", sl.lower_bound("b")->key);
+  ASSERT_EQ("c", sl.upper_bound("b")->key);
+  ASSERT_EQ("a", sl.find_less_than("b")->key);
+  ASSERT_EQ(nullptr, sl.find_less_than("a"));
+  ASSERT_EQ(nullptr, sl.upper_bound("d"));
+
+  uint64_t generation = sl.get_generation();
+  ASSERT_TRUE(sl.erase("b", &old));
+  ASSERT_EQ("b", string(old.c_str(), old.length()));
+  ASSERT_FALSE(sl.erase("b"));
+  ASSERT_NE(generation, sl.get_generation());
+  ASSERT_EQ("c", sl.lower_bound("b")->key);
+  ASSERT_EQ(3u, sl.size());
+}
+
+TEST(MemDBSkipList, concurrent_readers) {
+  MemDBSkipList sl;
+  const unsigned num_keys = 10000;
+  auto key = [](unsigned i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%08u", i);
+    return string(buf);
+  };
+  for (unsigned i = 0; i < num_keys; i += 2) {
+    sl.set(key(i), bufferptr(key(i).c_str(), 8));
+  }
+  // the even keys stay, the odd ones come and go, and the values of the
+  // even ones get replaced; readers must always see the even keys, in order
+  std::atomic<bool> stop = false;
+  std::vector<std::thread> readers;
+  for (unsigned t = 0; t < 4; t++) {
+    readers.emplace_back([&] {
+      while (!stop) {
+	MemDBSkipList::ReadGuard g(sl);
+	string prev;
+	unsigned even = 0;
+	for (auto n = sl.first(); n; n = n->get_next(0)) {
+	  ASSERT_LT(prev, n->key);
+	  ASSERT_EQ(n->key, string(n->get_value().c_str(), 8));
+	  if (atoi(n->key.c_str()) % 2 == 0) {
+	    ++even;
+	  }
+	  prev = n->key;
+	}
+	ASSERT_EQ(num_keys / 2, even);
+      }
+    });
+  }
+  for (unsigned round = 0; round < 20; round++) {
+    for (unsigned i = 0; i < num_keys; i++) {
+      if (i % 2) {
+	if (round % 2) {
+	  sl.erase(key(i));
+	} else {
+	  sl.set(key(i), bufferptr(key(i).c_str(), 8));
+	}
+      } else if (i % 7 == 0) {
+	sl.set(key(i), bufferptr(key(i).c_str(), 8));
+      }
+    }
+  }
+  stop = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  sl.reclaim();
+  ASSERT_EQ(num_keys / 2, sl.size());
+}
+
 class RocksDBShardingTest : public ::testing::TestWithParam<const char*> {
 public:
   boost::scoped_ptr<KeyValueDB> db;
@@ -1272,11 +1498,205 @@ TEST_F(RocksDBResharding, change_reshard) {
   }
 }
 
+TEST_F(RocksDBResharding, online_basic) {
+  ASSERT_EQ(0, db->create_and_open(cout, "Ad(2) Evade(2)"));
+  generate_data();
+  data_to_db();
+  RocksDBStore::resharding_ctrl ctrl;
+  ctrl.keys_per_batch = 50;
+  ASSERT_EQ(0, db->reshard_online("Ad(3) Evade(5)", &ctrl));
+  ASSERT_EQ(-EBUSY, db->reshard_online("Ad(3) Evade(4)", &ctrl));
+  while (db->is_resharding_online()) {
+    check_db();
+    usleep(1000);
+  }
+  check_db();
+  std::string sharding;
+  ASSERT_TRUE(db->get_sharding(sharding));
+  ASSERT_EQ("Ad(3) Evade(5)", sharding);
+  db->close();
+  ASSERT_EQ(db->open(cout), 0);
+  check_db();
+  db->close();
+}
+
+TEST_F(RocksDBResharding, online_resume) {
+  ASSERT_EQ(0, db->create_and_open(cout, "Ad(1) Evade(2)"));
+  generate_data();
+  data_to_db();
+  RocksDBStore::resharding_ctrl ctrl;
+  ctrl.keys_per_batch = 10;
+  ctrl.unittest_stop_online_after_first_batch = true;
+  ASSERT_EQ(0, db->reshard_online("Ad(2) Evade(3)", &ctrl));
+  // the keys are in both shardings now
+  check_db();
+  {
+    // update and remove keys on both sides of the move
+    KeyValueDB::Transaction t = db->get_transaction();
+    size_t i = 0;
+    for (auto d = data.begin(); d != data.end(); i++) {
+      string prefix;
+      string key;
+      RocksDBStore::split_key(d->first, &prefix, &key);
+      if (i % 3 == 0) {
+	d->second += "updated";
+	bufferlist v;
+	v.append(d->second);
+	t->set(prefix, key, v);
+	++d;
+      } else if (i % 3 == 1) {
+	t->rmkey(prefix, key);
+	d = data.erase(d);
+      } else {
+	++d;
+      }
+    }
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+  }
+  check_db();
+  db->close();
+  // the reshard picks up where it stopped
+  ASSERT_EQ(db->open(cout), 0);
+  ASSERT_TRUE(db->is_resharding_online());
+  check_db();
+  while (db->is_resharding_online()) {
+    usleep(1000);
+  }
+  check_db();
+  db->close();
+  ASSERT_EQ(db->open(cout), 0);
+  ASSERT_FALSE(db->is_resharding_online());
+  std::string sharding;
+  ASSERT_TRUE(db->get_sharding(sharding));
+  ASSERT_EQ("Ad(2) Evade(3)", sharding);
+  check_db();
+  db->close();
+}
+
+TEST_F(RocksDBResharding, online_merge) {
+  shared_ptr<KeyValueDB::MergeOperator> mop(new AppendMOP);
+  ASSERT_EQ(0, db->set_merge_operator("Evade", mop));
+  ASSERT_EQ(0, db->create_and_open(cout, "Ad(1) Evade(2)"));
+  generate_data();
+  data_to_db();
+  RocksDBStore::resharding_ctrl ctrl;
+  ctrl.keys_per_batch = 10;
+  ctrl.unittest_stop_online_after_first_batch = true;
+  ASSERT_EQ(0, db->reshard_online("Ad(1) Evade(3)", &ctrl));
+  std::vector<string> keys;
+  for (auto& d : data) {
+    string prefix;
+    string key;
+    RocksDBStore::split_key(d.first, &prefix, &key);
+    if (prefix == "Evade") {
+      keys.push_back(key);
+    }
+  }
+  ASSERT_LE(2u, keys.size());
+  {
+    // most keys are still in their old shard, a merge moves them along
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist v;
+    v.append("+");
+    for (auto& key : keys) {
+      t->merge("Evade", key, v);
+      data[RocksDBStore::combine_strings("Evade", key)] += "+";
+    }
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+  }
+  check_db();
+  {
+    // a key the transaction removed or set is not moved along
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist x, y, v;
+    x.append("x");
+    y.append("y");
+    v.append("v");
+    t->rmkey("Evade", keys[0]);
+    t->merge("Evade", keys[0], x);
+    data[RocksDBStore::combine_strings("Evade", keys[0])] = "?x";
+    t->set("Evade", keys[1], v);
+    t->merge("Evade", keys[1], y);
+    data[RocksDBStore::combine_strings("Evade", keys[1])] = "vy";
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+  }
+  check_db();
+  bufferlist bl;
+  ASSERT_EQ(0, db->get("Evade", keys[0], &bl));
+  ASSERT_EQ("?x", bl.to_str());
+  db->close();
+  ASSERT_EQ(db->open(cout), 0);
+  while (db->is_resharding_online()) {
+    usleep(1000);
+  }
+  check_db();
+  db->close();
+}
+
+TEST_F(RocksDBResharding, online_rm_range) {
+  ASSERT_EQ(0, db->create_and_open(cout, "Ad(2) Evade(2)"));
+  generate_data();
+  data_to_db();
+  RocksDBStore::resharding_ctrl ctrl;
+  ctrl.keys_per_batch = 10;
+  ctrl.unittest_stop_online_after_first_batch = true;
+  ASSERT_EQ(0, db->reshard_online("Ad(2) Evade(4)", &ctrl));
+  std::vector<string> keys;
+  for (auto& d : data) {
+    string prefix;
+    string key;
+    RocksDBStore::split_key(d.first, &prefix, &key);
+    if (prefix == "Evade") {
+      keys.push_back(key);
+    }
+  }
+  ASSERT_LE(4u, keys.size());
+  // a range with moved and unmoved keys, in all the old and new shards
+  const string start = keys[keys.size() / 4];
+  const string end = keys[keys.size() * 3 / 4];
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->rm_range_keys("Evade", start, end);
+    // written after the removal, in the same transaction
+    bufferlist v;
+    v.append("again");
+    t->set("Evade", start, v);
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+  }
+  data.erase(data.lower_bound(RocksDBStore::combine_strings("Evade", start)),
+	     data.lower_bound(RocksDBStore::combine_strings("Evade", end)));
+  data[RocksDBStore::combine_strings("Evade", start)] = "again";
+  check_db();
+  bufferlist bl;
+  ASSERT_EQ(-ENOENT, db->get("Evade", keys[keys.size() / 2], &bl));
+  db->close();
+  ASSERT_EQ(db->open(cout), 0);
+  while (db->is_resharding_online()) {
+    usleep(1000);
+  }
+  check_db();
+  std::string sharding;
+  ASSERT_TRUE(db->get_sharding(sharding));
+  ASSERT_EQ("Ad(2) Evade(4)", sharding);
+  db->close();
+}
+
+TEST_F(RocksDBResharding, online_refuses_default) {
+  ASSERT_EQ(0, db->create_and_open(cout, "Ad(2)"));
+  generate_data();
+  data_to_db();
+  ASSERT_EQ(-EOPNOTSUPP, db->reshard_online("Ad(2) Evade(2)"));
+  ASSERT_EQ(-EOPNOTSUPP, db->reshard_online(""));
+  ASSERT_FALSE(db->is_resharding_online());
+  check_db();
+  db->close();
+}
+
 
 INSTANTIATE_TEST_SUITE_P(
   KeyValueDB,
   KVTest,
-  ::testing::Values("leveldb", "rocksdb", "memdb"));
+  ::testing::Values("leveldb", "rocksdb", "memdb", "memdb-skiplist"));
 
 INSTANTIATE_TEST_SUITE_P(
   KeyValueDB,
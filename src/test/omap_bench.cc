@@ -45,6 +45,14 @@ int OmapBench::setup(int argc, const char** argv) {
 	key_size = atoi(args[i+1]);
       } else if (strcmp(args[i], "--valsize") == 0) {
 	value_size = atoi(args[i+1]);
+      } else if (strcmp(args[i], "--lists") == 0) {
+	lists = atoi(args[i+1]);
+      } else if (strcmp(args[i], "--test") == 0) {
+	if (strcmp("write", args[i+1]) == 0) {
+	  test = &OmapBench::test_write_objects_in_parallel;
+	} else if (strcmp("list-after-clear", args[i+1]) == 0) {
+	  test = &OmapBench::test_list_after_omap_clear;
+	}
       } else if (strcmp(args[i], "--inc") == 0) {
 	increment = atoi(args[i+1]);
       } else if (strcmp(args[i], "--omaptype") == 0) {
@@ -75,6 +83,12 @@ int OmapBench::setup(int argc, const char** argv) {
       cout << ")\n"
       	   << "	--valsize       number of characters per value "
       	   << "(default "<<value_size;
+      cout << ")\n"
+	   << "	--test          write: write omaps in parallel (default)\n"
+	   << "                        list-after-clear: write and clear an omap,\n"
+	   << "                        then time listing it\n"
+	   << "	--lists         listings per object for list-after-clear "
+	   << "(default " << lists;
       cout << ")\n"
       	   << "	--inc           specify the increment to use in the displayed "
       	   << "histogram (default "<<increment;
@@ -166,20 +180,28 @@ void AioWriter::set_aioc(librados::callback_t complete) {
 void OmapBench::aio_is_complete(rados_completion_t c, void *arg) {
   AioWriter *aiow = reinterpret_cast<AioWriter *>(arg);
   aiow->stop_time();
-  ceph::mutex * data_lock = &aiow->ob->data_lock;
   ceph::mutex * thread_is_free_lock = &aiow->ob->thread_is_free_lock;
   ceph::condition_variable* thread_is_free = &aiow->ob->thread_is_free;
   int &busythreads_count = aiow->ob->busythreads_count;
-  o_bench_data &data = aiow->ob->data;
-  int INCREMENT = aiow->ob->increment;
   int err = aiow->get_aioc()->get_return_value();
   if (err < 0) {
     cout << "error writing AioCompletion";
     return;
   }
   double time = aiow->get_time();
+  OmapBench *ob = aiow->ob;
   delete aiow;
-  data_lock->lock();
+  ob->record_latency(time);
+
+  thread_is_free_lock->lock();
+  busythreads_count--;
+  thread_is_free->notify_all();
+  thread_is_free_lock->unlock();
+}
+
+void OmapBench::record_latency(double time) {
+  int INCREMENT = increment;
+  std::lock_guard l{data_lock};
   data.avg_latency = (data.avg_latency * data.completed_ops + time)
       / (data.completed_ops + 1);
   data.completed_ops++;
@@ -195,12 +217,6 @@ void OmapBench::aio_is_complete(rados_completion_t c, void *arg) {
     data.mode.first = time/INCREMENT;
     data.mode.second = data.freq_map[time/INCREMENT];
   }
-  data_lock->unlock();
-
-  thread_is_free_lock->lock();
-  busythreads_count--;
-  thread_is_free->notify_all();
-  thread_is_free_lock->unlock();
 }
 
 string OmapBench::random_string(int len) {
@@ -398,6 +414,48 @@ int OmapBench::test_write_objects_in_parallel(omap_generator_t omap_gen) {
   return 0;
 }
 
+int OmapBench::test_list_after_omap_clear(omap_generator_t omap_gen) {
+  for (int i = 0; i < objects; i++) {
+    Writer writer(this);
+    int err = omap_gen(entries_per_omap, key_size, value_size,
+	&writer.get_omap());
+    if (err < 0) {
+      return err;
+    }
+    librados::ObjectWriteOperation fill;
+    fill.create(false);
+    fill.omap_set(writer.get_omap());
+    err = io_ctx.operate(writer.get_oid(), &fill);
+    if (err < 0) {
+      cout << "writing omap failed with code " << err << std::endl;
+      return err;
+    }
+    librados::ObjectWriteOperation clear;
+    clear.omap_clear();
+    err = io_ctx.operate(writer.get_oid(), &clear);
+    if (err < 0) {
+      cout << "clearing omap failed with code " << err << std::endl;
+      return err;
+    }
+    for (int j = 0; j < lists; j++) {
+      librados::ObjectReadOperation list;
+      set<string> keys;
+      int rval = 0;
+      list.omap_get_keys2("", LONG_MAX, &keys, nullptr, &rval);
+      writer.start_time();
+      err = io_ctx.operate(writer.get_oid(), &list, nullptr);
+      writer.stop_time();
+      if (err < 0 || rval < 0) {
+	cout << "listing omap failed with code " << (err < 0 ? err : rval)
+	     << std::endl;
+	return err < 0 ? err : rval;
+      }
+      record_latency(writer.get_time());
+    }
+  }
+  return 0;
+}
+
 /**
  * runs the specified test with the specified parameters and generates
  * a histogram of latencies
@@ -102,6 +102,7 @@ protected:
   int entries_per_omap;
   int key_size;
   int value_size;
+  int lists;
   double increment;
 
   friend class Writer;
@@ -117,7 +118,7 @@ public:
       rados_id("admin"),
       prefix(rados_id+".obj."),
       threads(3), objects(100), entries_per_omap(10), key_size(10),
-      value_size(100), increment(10)
+      value_size(100), lists(10), increment(10)
   {}
   /**
    * Parses command line args, initializes rados and ioctx
@@ -198,6 +199,21 @@ public:
    */
   int test_write_objects_in_parallel(omap_generator_t omap_gen);
 
+  /*
+   * Writes an omap generated by omap_gen to each of OBJECTS objects, clears
+   * it, and then lists the (now empty) omap LISTS times. Until the deleted
+   * keys are compacted away each listing has to skip their tombstones, so
+   * the histogram shows how slow iterating over a removed omap is.
+   *
+   * @param omap_gen the method used to generate the omaps.
+   */
+  int test_list_after_omap_clear(omap_generator_t omap_gen);
+
+  /**
+   * Adds the latency of a completed op to data.
+   */
+  void record_latency(double time);
+
 };
 
 
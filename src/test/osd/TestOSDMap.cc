@@ -1943,3 +1943,192 @@ TEST_F(OSDMapTest, BUG_48884)
     }
   }
 }
+
+TEST_F(OSDMapTest, IncrementalMapping) {
+  set_up_map();
+  ThreadPool tp(g_ceph_context, "IncrementalMapping", "tp_inc_mapping", 2);
+  tp.start();
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  mapping.update(osdmap);
+  ASSERT_TRUE(mapping.is_valid());
+
+  // apply the incremental, and check that only remapping the affected
+  // pools and pgs matches a full remap
+  auto check = [&](const OSDMap::Incremental& inc,
+		   set<int64_t> *affected_pools = nullptr) {
+    auto prev_crush = osdmap.crush;
+    osdmap.apply_incremental(inc);
+    set<int64_t> pools;
+    set<pg_t> pgs;
+    ASSERT_TRUE(OSDMapMapping::get_affected_pgs(osdmap, prev_crush.get(), inc,
+						&pools, &pgs));
+    if (affected_pools) {
+      *affected_pools = pools;
+    }
+    auto job = mapping.start_update(osdmap, mapper, 16, pools, pgs);
+    job->wait();
+    ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+    OSDMapMapping full;
+    full.update(osdmap);
+    for (auto& p : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+	pg_t pgid(ps, p.first);
+	vector<int> up, acting, fup, facting;
+	int up_primary, acting_primary, fup_primary, facting_primary;
+	mapping.get(pgid, &up, &up_primary, &acting, &acting_primary);
+	full.get(pgid, &fup, &fup_primary, &facting, &facting_primary);
+	ASSERT_EQ(fup, up);
+	ASSERT_EQ(fup_primary, up_primary);
+	ASSERT_EQ(facting, acting);
+	ASSERT_EQ(facting_primary, acting_primary);
+      }
+    }
+  };
+
+  // pg_temp only touches the one pg
+  {
+    pg_t pgid(3, my_rep_pool);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>({0, 1, 2});
+    set<int64_t> pools;
+    set<pg_t> pgs;
+    OSDMap next;
+    next.deepish_copy_from(osdmap);
+    next.apply_incremental(inc);
+    ASSERT_TRUE(OSDMapMapping::get_affected_pgs(next, osdmap.crush.get(), inc,
+						&pools, &pgs));
+    ASSERT_TRUE(pools.empty());
+    ASSERT_EQ(set<pg_t>{pgid}, pgs);
+    check(inc);
+  }
+  // osd down and out
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[1] = CEPH_OSD_UP;
+    inc.new_weight[1] = CEPH_OSD_OUT;
+    check(inc);
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[2] = CEPH_OSD_OUT;
+    check(inc);
+  }
+  // pg_num change resizes the pool's table
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    pg_pool_t pool = *osdmap.get_pg_pool(my_rep_pool);
+    pool.set_pg_num(128);
+    pool.set_pgp_num(128);
+    inc.new_pools[my_rep_pool] = pool;
+    check(inc);
+  }
+  // nothing mapping related
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_up_thru[0] = osdmap.get_epoch();
+    set<int64_t> pools;
+    set<pg_t> pgs;
+    ASSERT_TRUE(OSDMapMapping::get_affected_pgs(osdmap, osdmap.crush.get(),
+						inc, &pools, &pgs));
+    ASSERT_TRUE(pools.empty() && pgs.empty());
+    check(inc);
+  }
+  // resending the same crush map keeps the decoded one
+  {
+    bufferlist crush_bl;
+    osdmap.crush->encode(crush_bl, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.crush = crush_bl;
+    check(inc);
+    auto crush = osdmap.crush;
+    OSDMap::Incremental again(osdmap.get_epoch() + 1);
+    again.crush = crush_bl;
+    set<int64_t> pools;
+    check(again, &pools);
+    ASSERT_EQ(crush, osdmap.crush);
+    ASSERT_TRUE(pools.empty());
+  }
+  // a rule no pool uses does not remap anything
+  {
+    CrushWrapper newcrush;
+    get_crush(osdmap, newcrush);
+    ASSERT_LE(0, newcrush.add_simple_rule("unused", "default", "host", "",
+					  "firstn", pg_pool_t::TYPE_REPLICATED,
+					  &cerr));
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    newcrush.encode(inc.crush, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    set<int64_t> pools;
+    check(inc, &pools);
+    ASSERT_TRUE(pools.empty());
+  }
+  // a crush weight change remaps the pools whose rule reaches the osd
+  {
+    CrushWrapper newcrush;
+    get_crush(osdmap, newcrush);
+    newcrush.adjust_item_weightf(g_ceph_context, 0, 0.5);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    newcrush.encode(inc.crush, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    set<int64_t> pools;
+    check(inc, &pools);
+    ASSERT_EQ((set<int64_t>{my_ec_pool, my_rep_pool}), pools);
+  }
+  // new tunables require a full remap
+  {
+    CrushWrapper newcrush;
+    get_crush(osdmap, newcrush);
+    newcrush.set_choose_total_tries(newcrush.get_choose_total_tries() + 1);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    newcrush.encode(inc.crush, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    OSDMap next;
+    next.deepish_copy_from(osdmap);
+    next.apply_incremental(inc);
+    set<int64_t> pools;
+    set<pg_t> pgs;
+    ASSERT_FALSE(OSDMapMapping::get_affected_pgs(next, osdmap.crush.get(), inc,
+						 &pools, &pgs));
+  }
+  tp.stop();
+}
+
+TEST_F(OSDMapTest, Dedup) {
+  set_up_map();
+  OSDMap prev;
+  prev.deepish_copy_from(osdmap);
+
+  pg_t pgid(0, my_rep_pool);
+  vector<int> up;
+  osdmap.pg_to_up_acting_osds(pgid, &up, nullptr, nullptr, nullptr);
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  inc.new_pg_upmap_items[pgid] =
+    mempool::osdmap::vector<pair<int32_t,int32_t>>({{up[0], osdmap.get_max_osd() - 1}});
+  osdmap.apply_incremental(inc);
+  vector<int> upmapped;
+  osdmap.pg_to_up_acting_osds(pgid, &upmapped, nullptr, nullptr, nullptr);
+
+  OSDMap next;
+  next.deepish_copy_from(osdmap);
+  OSDMap::Incremental inc2(next.get_epoch() + 1);
+  inc2.new_up_thru[0] = next.get_epoch();
+  next.apply_incremental(inc2);
+  ASSERT_EQ(osdmap.crush, next.crush);
+
+  // dedup against a map w/o the upmap must not lose it
+  OSDMap::dedup(&prev, &next);
+  ASSERT_TRUE(next.have_pg_upmaps(pgid));
+  ASSERT_FALSE(prev.have_pg_upmaps(pgid));
+  vector<int> v;
+  next.pg_to_up_acting_osds(pgid, &v, nullptr, nullptr, nullptr);
+  ASSERT_EQ(upmapped, v);
+
+  // the structures shared w/ the previous epoch are not modified by
+  // applying an incremental to a copy of the new one
+  OSDMap::dedup(&osdmap, &next);
+  OSDMap after;
+  after.deepish_copy_from(next);
+  OSDMap::Incremental inc3(after.get_epoch() + 1);
+  inc3.old_pg_upmap_items.insert(pgid);
+  after.apply_incremental(inc3);
+  ASSERT_FALSE(after.have_pg_upmaps(pgid));
+  ASSERT_TRUE(next.have_pg_upmaps(pgid));
+  ASSERT_TRUE(osdmap.have_pg_upmaps(pgid));
+}
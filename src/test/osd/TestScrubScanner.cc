@@ -0,0 +1,145 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include "common/Cond.h"
+#include "global/global_context.h"
+#include "osd/ScrubScanner.h"
+
+using Scrub::ParallelScanner;
+using Scrub::ScanJob;
+
+namespace {
+
+constexpr int STRIDES = 3;  ///< per object, for the scans below to finish
+
+std::vector<hobject_t> make_objects(int n)
+{
+  std::vector<hobject_t> objects;
+  for (int i = 0; i < n; ++i) {
+    objects.emplace_back(object_t("obj" + std::to_string(i)), "", CEPH_NOSNAP,
+			 i, 1, "");
+  }
+  return objects;
+}
+
+/// scan an object in STRIDES strides, counting them in 'strides'
+ScanJob::scan_fn_t counting_scan(std::atomic<int>& strides)
+{
+  return [&strides](ScrubMap& map, ScrubMapBuilder& pos) {
+    ++strides;
+    if (++pos.data_pos < STRIDES) {
+      return -EINPROGRESS;
+    }
+    map.objects[pos.ls[pos.pos]] = ScrubMap::object{};
+    pos.next_object();
+    return 0;
+  };
+}
+
+/// never done with an object
+ScanJob::scan_fn_t endless_scan(std::atomic<int>& strides)
+{
+  return [&strides](ScrubMap&, ScrubMapBuilder&) {
+    ++strides;
+    return -EINPROGRESS;
+  };
+}
+
+void wait_for_strides(std::atomic<int>& strides, int n)
+{
+  while (strides < n) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+class TestScrubScanner : public ::testing::Test {
+ public:
+  std::unique_ptr<ParallelScanner> scanner;
+
+  void SetUp() override {
+    g_ceph_context->_conf.set_val_or_die("osd_scrub_scan_threads", "2");
+    scanner = std::make_unique<ParallelScanner>(g_ceph_context);
+    ASSERT_TRUE(scanner->is_active());
+    scanner->start();
+  }
+  void TearDown() override {
+    scanner->stop();
+    g_ceph_context->_conf.set_val_or_die("osd_scrub_scan_threads", "0");
+  }
+};
+
+}  // namespace
+
+TEST_F(TestScrubScanner, chunk_done)
+{
+  std::atomic<int> strides{0};
+  C_SaferCond done;
+  auto job = scanner->submit(spg_t{pg_t{0, 1}}, nullptr, counting_scan(strides),
+			     make_objects(4), true, &done);
+  ASSERT_EQ(0, done.wait());
+  ASSERT_TRUE(job->is_done());
+  ASSERT_FALSE(job->canceled);
+  // one work item per stride
+  ASSERT_EQ(4 * STRIDES, strides);
+
+  ScrubMap map;
+  job->collect(map);
+  ASSERT_EQ(4u, map.objects.size());
+  for (auto& hoid : job->objects) {
+    ASSERT_EQ(1u, map.objects.count(hoid));
+  }
+}
+
+TEST_F(TestScrubScanner, cancel_on_stop)
+{
+  std::atomic<int> strides{0};
+  C_SaferCond done;
+  auto job = scanner->submit(spg_t{pg_t{0, 1}}, nullptr, endless_scan(strides),
+			     make_objects(3), true, &done);
+  wait_for_strides(strides, 10);
+
+  // stopping cancels the outstanding jobs, instead of waiting for them
+  scanner->stop();
+  ASSERT_EQ(0, done.wait());
+  ASSERT_TRUE(job->is_done());
+  ASSERT_TRUE(job->canceled);
+  int after_stop = strides;
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_EQ(after_stop, strides);
+
+  // and the scanner can start over
+  scanner->start();
+  std::atomic<int> more{0};
+  C_SaferCond done2;
+  auto job2 = scanner->submit(spg_t{pg_t{0, 1}}, nullptr, counting_scan(more),
+			      make_objects(2), false, &done2);
+  ASSERT_EQ(0, done2.wait());
+  ASSERT_FALSE(job2->canceled);
+  ASSERT_EQ(2 * STRIDES, more);
+}
+
+TEST_F(TestScrubScanner, interval_change)
+{
+  // as PgScrubber::discard_parallel_scan() does on a new interval: the job
+  // is canceled by its owner while in flight, and a new chunk is scanned
+  std::atomic<int> strides{0};
+  C_SaferCond done;
+  auto job = scanner->submit(spg_t{pg_t{0, 1}}, nullptr, endless_scan(strides),
+			     make_objects(3), true, &done);
+  wait_for_strides(strides, 10);
+  job->canceled = true;
+  ASSERT_EQ(0, done.wait());
+  ASSERT_TRUE(job->is_done());
+
+  std::atomic<int> fresh{0};
+  C_SaferCond done2;
+  auto job2 = scanner->submit(spg_t{pg_t{0, 1}}, nullptr, counting_scan(fresh),
+			      make_objects(3), true, &done2);
+  ASSERT_EQ(0, done2.wait());
+  ScrubMap map;
+  job2->collect(map);
+  ASSERT_EQ(3u, map.objects.size());
+  ASSERT_EQ(3 * STRIDES, fresh);
+}
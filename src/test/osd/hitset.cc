@@ -195,3 +195,94 @@ TEST_F(ExplicitObjectHitSetTest, RejectsNoMatch) {
   }
   EXPECT_EQ(matches, 0);
 }
+
+class CountMinHitSetTest : public testing::Test, public HitSetTestStrap {
+public:
+
+  CountMinHitSetTest() : HitSetTestStrap(new HitSet(new CountMinHitSet)) {}
+
+  void rebuild(uint64_t target, uint32_t depth, uint64_t seed) {
+    HitSet::Params param(new CountMinHitSet::Params(target, depth, seed));
+    HitSet new_set(param);
+    *hitset = new_set;
+  }
+
+  CountMinHitSet *get_hitset() { return static_cast<CountMinHitSet*>(hitset->impl.get()); }
+};
+
+TEST_F(CountMinHitSetTest, Params) {
+  CountMinHitSet::Params params(100, 3, 5);
+  bufferlist bl;
+  params.encode(bl);
+  CountMinHitSet::Params p2;
+  auto iter = bl.cbegin();
+  p2.decode(iter);
+  EXPECT_EQ((unsigned)100, p2.target_size);
+  EXPECT_EQ((unsigned)3, p2.depth);
+  EXPECT_EQ((unsigned)5, p2.seed);
+}
+
+TEST_F(CountMinHitSetTest, Construct) {
+  rebuild(100, 4, 1);
+  ASSERT_EQ(hitset->impl->get_type(), HitSet::TYPE_COUNT_MIN);
+  ASSERT_EQ(hitset->get_type(), HitSet::TYPE_COUNT_MIN);
+}
+
+TEST_F(CountMinHitSetTest, InsertsMatch) {
+  rebuild(100, 4, 1);
+  fill(50);
+  verify_fill(50);
+  EXPECT_GE(hitset->approx_unique_insert_count(), 45u);
+  EXPECT_LE(hitset->approx_unique_insert_count(), 50u);
+  EXPECT_FALSE(hitset->is_full());
+}
+
+TEST_F(CountMinHitSetTest, Counts) {
+  rebuild(1000, 4, 1);
+  hobject_t hot(object_t("hot"), "", 0, 1, 0, "");
+  hobject_t cold(object_t("cold"), "", 0, 2, 0, "");
+  for (int i = 0; i < 5; ++i) {
+    hitset->insert(hot);
+  }
+  hitset->insert(cold);
+  EXPECT_EQ(5u, hitset->approx_hit_count(hot));
+  EXPECT_EQ(1u, hitset->approx_hit_count(cold));
+
+  // counters saturate
+  for (int i = 0; i < 100; ++i) {
+    hitset->insert(hot);
+  }
+  EXPECT_EQ(15u, hitset->approx_hit_count(hot));
+}
+
+TEST_F(CountMinHitSetTest, Decay) {
+  rebuild(1000, 4, 1);
+  hobject_t hot(object_t("hot"), "", 0, 1, 0, "");
+  hobject_t cold(object_t("cold"), "", 0, 2, 0, "");
+  for (int i = 0; i < 8; ++i) {
+    hitset->insert(hot);
+  }
+  hitset->insert(cold);
+
+  HitSet next(get_hitset()->decayed());
+  EXPECT_EQ(0u, next.insert_count());
+  EXPECT_EQ(4u, next.approx_hit_count(hot));
+  EXPECT_FALSE(next.contains(cold));
+  EXPECT_TRUE(static_cast<CountMinHitSet*>(next.impl.get())->same_layout(
+    CountMinHitSet::Params(1000, 4, 1)));
+  EXPECT_FALSE(static_cast<CountMinHitSet*>(next.impl.get())->same_layout(
+    CountMinHitSet::Params(100000, 4, 1)));
+}
+
+TEST_F(CountMinHitSetTest, Encode) {
+  rebuild(100, 4, 1);
+  fill(20);
+  bufferlist bl;
+  encode(*hitset, bl);
+  HitSet decoded;
+  auto p = bl.cbegin();
+  decode(decoded, p);
+  ASSERT_EQ(decoded.get_type(), HitSet::TYPE_COUNT_MIN);
+  EXPECT_EQ(20u, decoded.insert_count());
+  HitSetTestStrap(&decoded).verify_fill(20);
+}
@@ -252,4 +252,54 @@ TEST(PerfCounters, read_avg) {
   std::thread t2(counters_readavg_test, fake_pf);
   t2.join();
   t1.join();
-}
\ No newline at end of file
+}
+enum {
+  TEST_PERFCOUNTERS4_ELEMENT_FIRST = 800,
+  TEST_PERFCOUNTERS4_ELEMENT_OPS,
+  TEST_PERFCOUNTERS4_ELEMENT_LAT,
+  TEST_PERFCOUNTERS4_ELEMENT_LAST,
+};
+
+TEST(PerfCounters, sharded) {
+  PerfCountersBuilder bld(g_ceph_context, "test_perfcounter_4",
+	  TEST_PERFCOUNTERS4_ELEMENT_FIRST, TEST_PERFCOUNTERS4_ELEMENT_LAST);
+  bld.add_u64_counter(TEST_PERFCOUNTERS4_ELEMENT_OPS, "ops");
+  bld.add_time_avg(TEST_PERFCOUNTERS4_ELEMENT_LAT, "lat");
+  bld.set_sharded(TEST_PERFCOUNTERS4_ELEMENT_OPS);
+  bld.set_sharded(TEST_PERFCOUNTERS4_ELEMENT_LAT);
+  std::shared_ptr<PerfCounters> fake_pf(bld.create_perf_counters());
+
+  constexpr int threads = 8;
+  constexpr int count = 10000;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&] {
+      for (int i = 0; i < count; ++i) {
+	fake_pf->inc(TEST_PERFCOUNTERS4_ELEMENT_OPS);
+	fake_pf->tinc(TEST_PERFCOUNTERS4_ELEMENT_LAT, utime_t(0, 2));
+	// the slots are read one by one, each of them consistent
+	auto a = fake_pf->get_tavg_ns(TEST_PERFCOUNTERS4_ELEMENT_LAT);
+	ASSERT_EQ(a.first * 2, a.second);
+      }
+    });
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+  ASSERT_EQ(uint64_t(threads * count),
+	    fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_OPS));
+  auto a = fake_pf->get_tavg_ns(TEST_PERFCOUNTERS4_ELEMENT_LAT);
+  ASSERT_EQ(uint64_t(threads * count), a.first);
+  ASSERT_EQ(uint64_t(threads * count * 2), a.second);
+
+  fake_pf->dec(TEST_PERFCOUNTERS4_ELEMENT_OPS, 10);
+  ASSERT_EQ(uint64_t(threads * count - 10),
+	    fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_OPS));
+  fake_pf->set(TEST_PERFCOUNTERS4_ELEMENT_OPS, 5);
+  ASSERT_EQ(5u, fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_OPS));
+  fake_pf->reset();
+  ASSERT_EQ(0u, fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_OPS));
+  a = fake_pf->get_tavg_ns(TEST_PERFCOUNTERS4_ELEMENT_LAT);
+  ASSERT_EQ(0u, a.first);
+  ASSERT_EQ(0u, a.second);
+}
@@ -47,8 +47,11 @@
 #include "include/spinlock.h"
 #include "common/ceph_argparse.h"
 #include "common/Cycles.h"
+#include "common/CompletionExecutor.h"
 #include "common/Cond.h"
+#include "common/Finisher.h"
 #include "common/ceph_mutex.h"
+#include "common/perf_counters.h"
 #include "common/Thread.h"
 #include "common/Timer.h"
 #include "msg/async/Event.h"
@@ -57,6 +60,7 @@
 #include "test/perf_helper.h"
 
 #include <atomic>
+#include <thread>
 
 using namespace ceph;
 
@@ -358,6 +362,104 @@ double cond_ping_pong()
   return CondPingPong().run();
 }
 
+// A chain of Contexts, each of them queueing the next one: measures the
+// hop from one completion to the next.
+struct CompletionChain {
+  ceph::mutex lock = ceph::make_mutex("CompletionChain::lock");
+  ceph::condition_variable cond;
+  bool done = false;
+  int left;
+  std::function<void(Context*)> queue;
+
+  class C_Hop : public Context {
+    CompletionChain *chain;
+   public:
+    explicit C_Hop(CompletionChain *chain) : chain(chain) {}
+    void finish(int r) override {
+      if (--chain->left > 0) {
+	chain->queue(new C_Hop(chain));
+      } else {
+	std::lock_guard l{chain->lock};
+	chain->done = true;
+	chain->cond.notify_all();
+      }
+    }
+  };
+
+  CompletionChain(int count, std::function<void(Context*)> queue)
+    : left(count), queue(std::move(queue)) {}
+
+  double run() {
+    int count = left;
+    uint64_t start = Cycles::rdtsc();
+    queue(new C_Hop(this));
+    std::unique_lock l{lock};
+    cond.wait(l, [this] { return done; });
+    uint64_t stop = Cycles::rdtsc();
+    return Cycles::to_seconds(stop - start)/count;
+  }
+};
+
+// Measure the cost of a Context completion queueing the next one on the
+// same Finisher.
+double finisher_hop()
+{
+  Finisher finisher(g_ceph_context);
+  finisher.start();
+  double r = CompletionChain(1000000, [&](Context *c) {
+    finisher.queue(c);
+  }).run();
+  finisher.stop();
+  return r;
+}
+
+// Measure the cost of a Context completion queueing the next one on a
+// shared CompletionExecutor, without affinity: it stays on the worker.
+double executor_hop()
+{
+  CompletionExecutor ex(g_ceph_context, "perf_executor", 4);
+  ex.start();
+  double r = CompletionChain(1000000, [&](Context *c) {
+    ex.queue(c);
+  }).run();
+  ex.stop();
+  return r;
+}
+
+// Measure the cost of a Context completion queueing the next one on a
+// shared CompletionExecutor, on another shard each time.
+double executor_cross_hop()
+{
+  CompletionExecutor ex(g_ceph_context, "perf_executor", 4);
+  ex.start();
+  int next = 0;
+  double r = CompletionChain(100000, [&](Context *c) {
+    ex.queue(c, 0, next++);
+  }).run();
+  ex.stop();
+  return r;
+}
+
+// Measure the round trip from a thread to a Finisher and back.
+double finisher_round_trip()
+{
+  int count = 100000;
+  Finisher finisher(g_ceph_context);
+  finisher.start();
+  ceph::mutex lock = ceph::make_mutex("finisher_round_trip::lock");
+  ceph::condition_variable cond;
+  uint64_t start = Cycles::rdtsc();
+  for (int i = 0; i < count; i++) {
+    bool done = false;
+    finisher.queue(new C_SafeCond(lock, cond, &done));
+    std::unique_lock l{lock};
+    cond.wait(l, [&] { return done; });
+  }
+  uint64_t stop = Cycles::rdtsc();
+  finisher.stop();
+  return Cycles::to_seconds(stop - start)/count;
+}
+
 // Measure the cost of a 32-bit divide. Divides don't take a constant
 // number of cycles. Values were chosen here semi-randomly to depict a
 // fairly expensive scenario. Someone with fancy ALU knowledge could
@@ -914,6 +1016,57 @@ double perf_ceph_clock_now()
   return Cycles::to_seconds(stop - start)/count;
 }
 
+enum {
+  l_perf_local_first = 1000,
+  l_perf_local_counter,
+  l_perf_local_lat,
+  l_perf_local_last,
+};
+
+// Measure the cost of bumping a counter and an average when so many
+// threads, each on its own CPU, are doing the same
+template <bool sharded, int threads>
+double perf_counter_inc()
+{
+  PerfCountersBuilder b(g_ceph_context, "perf_local",
+			l_perf_local_first, l_perf_local_last);
+  b.add_u64_counter(l_perf_local_counter, "counter");
+  b.add_time_avg(l_perf_local_lat, "lat");
+  if (sharded) {
+    b.set_sharded(l_perf_local_counter);
+    b.set_sharded(l_perf_local_lat);
+  }
+  std::unique_ptr<PerfCounters> logger(b.create_perf_counters());
+
+  int count = 1000000;
+  std::atomic<int> ready = { 0 };
+  std::atomic<bool> go = { false };
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      bind_thread_to_cpu(t % std::thread::hardware_concurrency());
+      ready++;
+      while (!go) ;
+      for (int i = 0; i < count; i++) {
+	logger->inc(l_perf_local_counter);
+	logger->tinc(l_perf_local_lat, ceph::timespan(i));
+      }
+    });
+  }
+  while (ready < threads) ;
+  uint64_t start = Cycles::rdtsc();
+  go = true;
+  for (auto& w : workers) {
+    w.join();
+  }
+  uint64_t stop = Cycles::rdtsc();
+  // the counters have to be left unharmed
+  if (logger->get(l_perf_local_counter) != uint64_t(count) * threads) {
+    return -1;
+  }
+  return Cycles::to_seconds(stop - start)/count;
+}
+
 // The following struct and table define each performance test in terms of
 // a string name and a function that implements the test.
 struct TestInfo {
@@ -952,6 +1105,14 @@ TestInfo tests[] = {
     "iterate over buffer with 5 ptrs"},
   {"cond_ping_pong", cond_ping_pong,
     "condition variable round-trip"},
+  {"finisher_hop", finisher_hop,
+    "Complete a Context queueing the next one, on a Finisher"},
+  {"executor_hop", executor_hop,
+    "Complete a Context queueing the next one, on a CompletionExecutor"},
+  {"executor_cross_hop", executor_cross_hop,
+    "Complete a Context queueing the next one, on another shard"},
+  {"finisher_round_trip", finisher_round_trip,
+    "Queue a Context on a Finisher and wait for it"},
   {"div32", div32,
     "32-bit integer division instruction"},
   {"div64", div64,
@@ -1004,6 +1165,22 @@ TestInfo tests[] = {
     "Push and pop a std::vector"},
   {"ceph_clock_now", perf_ceph_clock_now,
    "ceph_clock_now function"},
+  {"perf_counter_inc1", perf_counter_inc<false, 1>,
+    "PerfCounters inc+tinc, 1 thread"},
+  {"perf_counter_inc4", perf_counter_inc<false, 4>,
+    "PerfCounters inc+tinc, 4 threads"},
+  {"perf_counter_inc16", perf_counter_inc<false, 16>,
+    "PerfCounters inc+tinc, 16 threads"},
+  {"perf_counter_inc64", perf_counter_inc<false, 64>,
+    "PerfCounters inc+tinc, 64 threads"},
+  {"perf_counter_sharded_inc1", perf_counter_inc<true, 1>,
+    "sharded PerfCounters inc+tinc, 1 thread"},
+  {"perf_counter_sharded_inc4", perf_counter_inc<true, 4>,
+    "sharded PerfCounters inc+tinc, 4 threads"},
+  {"perf_counter_sharded_inc16", perf_counter_inc<true, 16>,
+    "sharded PerfCounters inc+tinc, 16 threads"},
+  {"perf_counter_sharded_inc64", perf_counter_inc<true, 64>,
+    "sharded PerfCounters inc+tinc, 64 threads"},
 };
 
 /**
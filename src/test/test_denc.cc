@@ -267,6 +267,116 @@ TEST(denc, vector)
   }
 }
 
+struct le_pod_t {
+  ceph_le32 a;
+  ceph_le32 b;
+  bool operator==(const le_pod_t& o) const {
+    return a == o.a && b == o.b;
+  }
+  DENC(le_pod_t, v, p) {
+    denc(v.a, p);
+    denc(v.b, p);
+  }
+};
+WRITE_CLASS_DENC_BOUNDED(le_pod_t)
+
+TEST(denc, le_layout)
+{
+  static_assert(_denc::is_le_layout_v<uint64_t>);
+  static_assert(_denc::is_le_layout_v<ceph_le32>);
+  static_assert(!_denc::is_le_layout_v<bool>);
+  static_assert(!_denc::is_le_layout_v<std::string>);
+  // the DENC'ed structs may have a header, or padding
+  static_assert(!_denc::is_le_layout_v<le_pod_t>);
+  static_assert(_denc::le_element<std::pair<const uint32_t, uint64_t>>::value);
+  static_assert(_denc::is_memcpy_container_v<std::vector<uint32_t>, uint32_t>);
+  static_assert(!_denc::is_memcpy_container_v<std::list<uint32_t>, uint32_t>);
+
+  // the bulk paths encode as the element by element ones do
+  std::vector<uint32_t> v(1000);
+  std::iota(v.begin(), v.end(), 1);
+  std::vector<le_pod_t> pods;
+  for (auto i : v) {
+    pods.push_back(le_pod_t{init_le32(i), init_le32(~i)});
+  }
+  bufferlist bl, pods_bl;
+  encode(v, bl);
+  encode(pods, pods_bl);
+  ASSERT_EQ(bl.length(), 4 + v.size() * 4);
+  ASSERT_EQ(pods_bl.length(), 4 + v.size() * 8);
+  {
+    auto p = pods_bl.cbegin();
+    std::vector<uint64_t> w;
+    decode(w, p);
+    for (size_t i = 0; i < v.size(); ++i) {
+      ASSERT_EQ(w[i], (uint64_t)v[i] | ((uint64_t)~v[i] << 32));
+    }
+  }
+  test_denc(v);
+  test_denc(boost::container::small_vector<uint64_t, 4>(v.begin(), v.end()));
+  test_denc(std::list<uint32_t>(v.begin(), v.end()));
+  std::map<uint32_t, uint64_t> m;
+  for (auto i : v) {
+    m[i] = i * 3;
+  }
+  test_denc(m);
+  test_denc(std::vector<uint8_t>{1, 2, 3});
+  test_denc(std::vector<uint32_t>());
+
+  // a truncated encoding throws rather than reading past the end
+  bufferlist short_bl;
+  short_bl.substr_of(bl, 0, bl.length() - 1);
+  {
+    std::vector<uint32_t> w;
+    auto p = short_bl.cbegin();
+    ASSERT_THROW(decode(w, p), ceph::buffer::end_of_buffer);
+  }
+  {
+    bufferlist huge;
+    encode((uint32_t)0xffffffff, huge);
+    std::vector<uint64_t> w;
+    auto p = huge.cbegin();
+    ASSERT_THROW(decode(w, p), ceph::buffer::end_of_buffer);
+  }
+}
+
+TEST(denc, vector_view)
+{
+  std::vector<uint64_t> v(100);
+  std::iota(v.begin(), v.end(), 1000);
+  bufferlist bl;
+  encode(v, bl);
+  const char* base = bl.c_str();
+
+  denc_vector_view<uint64_t> view;
+  auto p = bl.cbegin();
+  decode(view, p);
+  ASSERT_EQ(v.size(), view.size());
+  // the view points into the buffer
+  ASSERT_EQ(base + sizeof(uint32_t), view.get_ptr().c_str());
+  for (size_t i = 0; i < v.size(); ++i) {
+    ASSERT_EQ(v[i], view[i]);
+  }
+  ASSERT_TRUE(std::equal(view.begin(), view.end(), v.begin()));
+  ASSERT_EQ(v, view.to_vector());
+  ASSERT_THROW(view.at(v.size()), std::out_of_range);
+
+  // it encodes as the vector does
+  bufferlist bl2;
+  encode(view, bl2);
+  ASSERT_TRUE(bl.contents_equal(bl2));
+  ASSERT_EQ(v, denc_vector_view<uint64_t>(v).to_vector());
+
+  denc_vector_view<uint32_t> empty;
+  ASSERT_TRUE(empty.empty());
+  ASSERT_TRUE(empty.begin() == empty.end());
+
+  bufferlist short_bl;
+  short_bl.substr_of(bl, 0, bl.length() - 1);
+  p = short_bl.cbegin();
+  ASSERT_THROW(decode(view, p), ceph::buffer::end_of_buffer);
+}
+
 template<typename T>
 using default_list = std::list<T>;
 
@@ -402,6 +402,63 @@ TEST(mempool, btree_map_test)
   ASSERT_EQ(0, mempool::osd::allocated_bytes());
 }
 
+TEST(mempool, arena)
+{
+  // unittest_2 is otherwise unused here
+  size_t items = mempool::unittest_2::allocated_items();
+  size_t bytes = mempool::unittest_2::allocated_bytes();
+  {
+    mempool::unittest_2::arena<256> arena(1024);
+    ASSERT_EQ(items + 1, mempool::unittest_2::allocated_items());
+    ASSERT_EQ(bytes + 256, mempool::unittest_2::allocated_bytes());
+
+    mempool::arena_allocator<char> alloc(&arena);
+    mempool::arena_list<uint64_t> l(alloc);
+    mempool::arena_map<int, std::string> m(alloc);
+    mempool::arena_vector<uint32_t> v(alloc);
+    for (int i = 0; i < 1000; ++i) {
+      l.push_back(i);
+      m[i] = std::to_string(i);
+      v.push_back(i);
+    }
+    // the first chunks came from the inline buffer, the rest from the heap
+    ASSERT_LT(256u, arena.allocated_bytes());
+    ASSERT_EQ(bytes + arena.allocated_bytes(),
+	      mempool::unittest_2::allocated_bytes());
+    int i = 0;
+    for (auto j : l) {
+      ASSERT_EQ(i++, (int)j);
+    }
+    ASSERT_EQ("999", m[999]);
+    ASSERT_EQ(999u, v.back());
+
+    // larger than a chunk, and overaligned
+    auto p = arena.allocate(4096, 256);
+    ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(p) % 256);
+    memset(p, 0, 4096);
+
+    // the last allocation can be taken back
+    auto q = arena.allocate(16, 8);
+    arena.deallocate(q, 16);
+    ASSERT_EQ(q, arena.allocate(16, 8));
+  }
+  ASSERT_EQ(items, mempool::unittest_2::allocated_items());
+  ASSERT_EQ(bytes, mempool::unittest_2::allocated_bytes());
+
+  // without an arena, the memory comes from the heap
+  mempool::arena_list<uint64_t> l;
+  mempool::arena_map<int, std::string> m{mempool::arena_allocator<char>()};
+  for (int i = 0; i < 100; ++i) {
+    l.push_back(i);
+    m[i] = std::to_string(i);
+  }
+  // and a list moved away takes its allocator along
+  mempool::arena_list<uint64_t> l2(std::move(l));
+  ASSERT_EQ(100u, l2.size());
+  ASSERT_EQ(items, mempool::unittest_2::allocated_items());
+  ASSERT_EQ(bytes, mempool::unittest_2::allocated_bytes());
+}
+
 TEST(mempool, check_shard_select)
 {
   const size_t samples = 100;
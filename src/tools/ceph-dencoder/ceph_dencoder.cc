@@ -18,6 +18,7 @@
 #include "include/types.h"
 #include "common/Formatter.h"
 #include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
 #include "common/errno.h"
 #include "denc_registry.h"
 
@@ -51,6 +52,9 @@ void usage(ostream &out)
   out << "  count_tests         print number of generated test objects (to stdout)\n";
   out << "  select_test <n>     select generated test object as in-memory object\n";
   out << "  is_deterministic    exit w/ success if type encodes deterministically\n";
+  out << "\n";
+  out << "  bench <n>           time <n> encodes of the in-memory object, and <n> decodes\n";
+  out << "                      of the encoded data (of the encoded object if there is none)\n";
 }
   
 int main(int argc, const char **argv)
@@ -215,6 +219,35 @@ int main(int argc, const char **argv)
       }
       int n = atoi(*i);
       err = den->select_generated(n);
+    } else if (*i == string("bench")) {
+      if (!den) {
+	cerr << "must first select type with 'type <name>'" << std::endl;
+	exit(1);
+      }
+      ++i;
+      if (i == args.end()) {
+	cerr << "expecting iteration count" << std::endl;
+	exit(1);
+      }
+      int n = std::max(atoi(*i), 1);
+      auto start = ceph::mono_clock::now();
+      bufferlist bl;
+      for (int j = 0; j < n; ++j) {
+	bl.clear();
+	den->encode(bl, features | CEPH_FEATURE_RESERVED);
+      }
+      auto encode_ns = std::chrono::nanoseconds(ceph::mono_clock::now() - start).count();
+      if (encbl.length() == 0) {
+	encbl = bl;
+      }
+      start = ceph::mono_clock::now();
+      for (int j = 0; j < n && err.empty(); ++j) {
+	err = den->decode(encbl, skip);
+      }
+      auto decode_ns = std::chrono::nanoseconds(ceph::mono_clock::now() - start).count();
+      cout << "encode: " << encode_ns / n << " ns, " << bl.length() << " bytes\n"
+	   << "decode: " << decode_ns / n << " ns, " << encbl.length() << " bytes"
+	   << std::endl;
     } else if (*i == string("is_deterministic")) {
       if (!den) {
 	cerr << "must first select type with 'type <name>'" << std::endl;
@@ -366,10 +366,12 @@ void EstimateDedupRatio::estimate_dedup_ratio()
       examined_objects++;
       examined_bytes += bl.length();
 
-      // do the chunking
+      // do the chunking; the estimates go from the smallest chunk size up,
+      // so the candidate cut points found for the first one serve them all
+      cdc_boundary_index_t index;
       for (auto& i : dedup_estimates) {
 	vector<pair<uint64_t, uint64_t>> chunks;
-	i.second.cdc->calc_chunks(bl, &chunks);
+	i.second.cdc->calc_chunks(bl, &chunks, &index);
 	for (auto& p : chunks) {
 	  bufferlist chunk;
 	  chunk.substr_of(bl, p.first, p.second);
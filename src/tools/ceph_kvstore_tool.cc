@@ -28,7 +28,7 @@
 
 void usage(const char *pname)
 {
-  std::cout << "Usage: " << pname << " <leveldb|rocksdb|bluestore-kv> <store path> command [args...]\n"
+  std::cout << "Usage: " << pname << " <leveldb|rocksdb|memdb|bluestore-kv> <store path> command [args...]\n"
     << "\n"
     << "Commands:\n"
     << "  list [prefix]\n"
@@ -49,6 +49,7 @@ void usage(const char *pname)
     << "  destructive-repair  (use only as last resort! may corrupt healthy data)\n"
     << "  stats\n"
     << "  histogram [prefix]\n"
+    << "  bench [threads] [keys] [seconds]\n"
     << std::endl;
 }
 
@@ -91,6 +92,7 @@ int main(int argc, const char *argv[])
 
   if (type != "leveldb" &&
       type != "rocksdb" &&
+      type != "memdb" &&
       type != "bluestore-kv")  {
 
     std::cerr << "Unrecognized type: " << args[0] << std::endl;
@@ -100,7 +102,8 @@ int main(int argc, const char *argv[])
 
   bool to_repair = (cmd == "destructive-repair");
   bool need_stats = (cmd == "stats");
-  StoreTool st(type, path, to_repair, need_stats);
+  bool create_if_missing = (cmd == "bench");
+  StoreTool st(type, path, to_repair, need_stats, create_if_missing);
 
   if (cmd == "destructive-repair") {
     int ret = st.destructive_repair();
@@ -353,6 +356,27 @@ int main(int argc, const char *argv[])
     if (argc > 4)
       prefix = url_unescape(argv[4]);
     st.build_size_histogram(prefix);
+  } else if (cmd == "bench") {
+    unsigned threads = 8;
+    uint64_t keys = 100000;
+    double seconds = 5;
+    string err;
+    if (argc > 4) {
+      threads = strict_strtol(argv[4], 10, &err);
+    }
+    if (err.empty() && argc > 5) {
+      keys = strict_strtoll(argv[5], 10, &err);
+    }
+    if (err.empty() && argc > 6) {
+      seconds = strict_strtod(argv[6], &err);
+    }
+    if (!err.empty()) {
+      std::cerr << "invalid argument: " << err << std::endl;
+      return 1;
+    }
+    if (st.bench(threads, keys, seconds) < 0) {
+      return 1;
+    }
   } else {
     std::cerr << "Unrecognized command: " << cmd << std::endl;
     return 1;
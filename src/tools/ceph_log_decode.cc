@@ -0,0 +1,53 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * ceph-log-decode -- render a binary log (log_binary = true) as text
+ *
+ * USAGE
+ *
+ *     ceph-log-decode [<file>]
+ *
+ * reads <file>, or stdin, and writes the same lines the text log would
+ * have had to stdout.
+ *
+ * EXIT STATUS
+ *
+ *     0 : ok
+ *     1 : usage problem
+ *     2 : problem opening the input file
+ *     3 : not a binary log
+ */
+
+#include <fstream>
+#include <iostream>
+
+#include "log/BinaryLog.h"
+
+int main(int argc, const char **argv)
+{
+  if (argc > 2 ||
+      (argc == 2 && (std::string_view(argv[1]) == "-h" ||
+		     std::string_view(argv[1]) == "--help"))) {
+    std::cerr << "usage: " << argv[0] << " [<file>]" << std::endl;
+    return 1;
+  }
+
+  std::ifstream file;
+  if (argc == 2) {
+    file.open(argv[1], std::ios::binary);
+    if (!file) {
+      std::cerr << "unable to open " << argv[1] << std::endl;
+      return 2;
+    }
+  }
+  std::istream& in = argc == 2 ? file : std::cin;
+  std::ios::sync_with_stdio(false);
+
+  if (ceph::logging::decode_binary_log(in, std::cout) < 0) {
+    std::cerr << (argc == 2 ? argv[1] : "stdin")
+	      << ": not a binary ceph log" << std::endl;
+    return 3;
+  }
+  return 0;
+}
@@ -3,7 +3,11 @@
 
 #include "kvstore_tool.h"
 
+#include <atomic>
 #include <iostream>
+#include <random>
+#include <thread>
+#include <unistd.h>
 
 #include "common/errno.h"
 #include "common/url_escape.h"
@@ -15,7 +19,8 @@
 StoreTool::StoreTool(const string& type,
 		     const string& path,
 		     bool to_repair,
-		     bool need_stats)
+		     bool need_stats,
+		     bool create_if_missing)
   : store_path(path)
 {
 
@@ -34,8 +39,19 @@ StoreTool::StoreTool(const string& type,
 #endif
   } else {
     auto db_ptr = KeyValueDB::create(g_ceph_context, type, path);
+    if (!db_ptr) {
+      cerr << "failed to create type " << type
+	   << " (memdb is an experimental feature)" << std::endl;
+      exit(1);
+    }
     if (!to_repair) {
-      if (int r = db_ptr->open(std::cerr); r < 0) {
+      int r;
+      if (create_if_missing && ::access(path.c_str(), F_OK) != 0) {
+	r = db_ptr->create_and_open(std::cerr);
+      } else {
+	r = db_ptr->open(std::cerr);
+      }
+      if (r < 0) {
         cerr << "failed to open type " << type << " path " << path << ": "
              << cpp_strerror(r) << std::endl;
         exit(1);
@@ -376,3 +392,91 @@ int StoreTool::destructive_repair()
 {
   return db->repair(std::cout);
 }
+
+int StoreTool::bench(unsigned num_threads, uint64_t num_keys, double seconds)
+{
+  if (num_threads == 0 || num_keys == 0 || seconds <= 0) {
+    std::cerr << "threads, keys and seconds must be > 0" << std::endl;
+    return -EINVAL;
+  }
+  const string prefix = "_bench";
+  const unsigned value_size = 128;
+  const unsigned scan_len = 16;
+  auto make_key = [](uint64_t i) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%016" PRIx64, i);
+    return string(buf);
+  };
+  bufferlist value;
+  value.append_zero(value_size);
+
+  auto start = mono_clock::now();
+  for (uint64_t i = 0; i < num_keys; ) {
+    KeyValueDB::Transaction tx = db->get_transaction();
+    for (unsigned n = 0; n < 128 && i < num_keys; ++n, ++i) {
+      tx->set(prefix, make_key(i), value);
+    }
+    db->submit_transaction(tx);
+  }
+  std::cout << "loaded " << num_keys << " keys in "
+	    << std::chrono::duration<double>(mono_clock::now() - start).count()
+	    << "s" << std::endl;
+
+  // each phase runs the op in all the threads for the given time
+  auto run = [&](const char* name,
+		 std::function<void(std::minstd_rand&)> op) {
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> total = 0;
+    std::vector<std::thread> threads;
+    auto start = mono_clock::now();
+    for (unsigned t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&, t] {
+	std::minstd_rand rng(t + 1);
+	uint64_t ops = 0;
+	while (!stop) {
+	  op(rng);
+	  ++ops;
+	}
+	total += ops;
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& t : threads) {
+      t.join();
+    }
+    double elapsed =
+      std::chrono::duration<double>(mono_clock::now() - start).count();
+    std::cout << name << ": " << num_threads << " threads, " << total
+	      << " ops, " << (uint64_t)(total / elapsed) << " ops/s"
+	      << std::endl;
+  };
+  run("get", [&](std::minstd_rand& rng) {
+    bufferlist bl;
+    db->get(prefix, make_key(rng() % num_keys), &bl);
+  });
+  run("scan", [&](std::minstd_rand& rng) {
+    auto it = db->get_iterator(prefix);
+    it->lower_bound(make_key(rng() % num_keys));
+    for (unsigned n = 0; n < scan_len && it->valid(); ++n) {
+      it->value();
+      it->next();
+    }
+  });
+  run("get+set (10% sets)", [&](std::minstd_rand& rng) {
+    uint64_t i = rng() % num_keys;
+    if (rng() % 10 == 0) {
+      KeyValueDB::Transaction tx = db->get_transaction();
+      tx->set(prefix, make_key(i), value);
+      db->submit_transaction(tx);
+    } else {
+      bufferlist bl;
+      db->get(prefix, make_key(i), &bl);
+    }
+  });
+
+  KeyValueDB::Transaction tx = db->get_transaction();
+  tx->rmkeys_by_prefix(prefix);
+  db->submit_transaction_sync(tx);
+  return 0;
+}
@@ -44,7 +44,8 @@ public:
   StoreTool(const std::string& type,
 	    const std::string& path,
 	    bool need_open_db = true,
-	    bool need_stats = false);
+	    bool need_stats = false,
+	    bool create_if_missing = false);
   int load_bluestore(const std::string& path, bool need_open_db);
   uint32_t traverse(const std::string& prefix,
                     const bool do_crc,
@@ -78,4 +79,5 @@ public:
 
   int print_stats() const;
   int build_size_histogram(const string& prefix) const;
+  int bench(unsigned num_threads, uint64_t num_keys, double seconds);
 };
@@ -25,6 +25,7 @@
 
 #include "global/global_init.h"
 #include "osd/OSDMap.h"
+#include "osd/OSDMapMapping.h"
 
 
 void usage()
@@ -66,6 +67,9 @@ void usage()
   cout << "   --test-crush [--range-first <first> --range-last <last>] map pgs to acting osds" << std::endl;
   cout << "   --adjust-crush-weight <osdid:weight>[,<osdid:weight>,<...>] change <osdid> CRUSH <weight> (but do not persist)" << std::endl;
   cout << "   --save                  write modified osdmap with upmap or crush-adjust changes" << std::endl;
+  cout << "   --bench-apply-inc <epochs> apply <epochs> synthetic incrementals (pg_temp churn," << std::endl;
+  cout << "                           osd flaps, crush weight changes) and time the map and" << std::endl;
+  cout << "                           pg mapping updates (does not persist)" << std::endl;
   exit(1);
 }
 
@@ -100,6 +104,162 @@ void print_inc_upmaps(const OSDMap::Incremental& pending_inc, int fd)
   }
 }
 
+// synthesize an incremental on top of 'cur': mostly pg_temp churn, with an
+// osd flap every 10 epochs and a crush weight change every 100 epochs.
+static void bench_make_incremental(const OSDMap& cur, int n,
+				   std::set<pg_t> *temps,
+				   OSDMap::Incremental *inc)
+{
+  inc->fsid = cur.get_fsid();
+  inc->epoch = cur.get_epoch() + 1;
+  int max_osd = cur.get_max_osd();
+  auto& pools = cur.get_pools();
+  auto p = pools.begin();
+  std::advance(p, rand() % pools.size());
+  pg_t pgid(rand() % p->second.get_pg_num(), p->first);
+  if (temps->erase(pgid)) {
+    inc->new_pg_temp[pgid].clear();
+  } else {
+    temps->insert(pgid);
+    auto& temp = inc->new_pg_temp[pgid];
+    for (unsigned i = 0; i < p->second.get_size(); ++i) {
+      temp.push_back(rand() % max_osd);
+    }
+  }
+  if (n % 10 == 9) {
+    int osd = rand() % max_osd;
+    if (cur.is_up(osd)) {
+      inc->new_state[osd] = CEPH_OSD_UP;
+    } else if (cur.exists(osd)) {
+      inc->new_up_client[osd] = cur.get_addrs(osd);
+      inc->new_up_cluster[osd] = cur.get_cluster_addrs(osd);
+      inc->new_hb_back_up[osd] = cur.get_hb_back_addrs(osd);
+      inc->new_hb_front_up[osd] = cur.get_hb_front_addrs(osd);
+    }
+  }
+  if (n % 100 == 99) {
+    int osd = rand() % max_osd;
+    if (cur.crush->item_exists(osd)) {
+      CrushWrapper crush;
+      bufferlist cbl;
+      cur.crush->encode(cbl, CEPH_FEATURES_SUPPORTED_DEFAULT);
+      auto q = cbl.cbegin();
+      crush.decode(q);
+      float w = crush.get_item_weightf(osd);
+      crush.adjust_item_weightf(g_ceph_context, osd, w > 0.5 ? w / 2 : w * 2);
+      crush.encode(inc->crush, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    }
+  }
+}
+
+// compare applying incrementals by decoding the previous full map (the old
+// OSD::handle_osd_map() behavior) vs. building on the in-memory previous
+// map, and full vs. incremental OSDMapMapping updates.
+static int bench_apply_incremental(const OSDMap& osdmap, int epochs)
+{
+  if (osdmap.get_pools().empty() || osdmap.get_max_osd() == 0) {
+    cerr << "need at least one pool and one osd to benchmark" << std::endl;
+    return -EINVAL;
+  }
+  ThreadPool tp(g_ceph_context, "osdmaptool::bench", "tp_bench", 1);
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  tp.start();
+
+  auto cur = std::make_shared<OSDMap>();
+  cur->deepish_copy_from(osdmap);
+  OSDMapMapping full_mapping, inc_mapping;
+  full_mapping.update(*cur);
+  inc_mapping.update(*cur);
+
+  std::set<pg_t> temps;
+  double decode_apply = 0, copy_apply = 0, full_map = 0, inc_map = 0;
+  uint64_t remapped = 0;
+  int crush_changes = 0, full_remaps = 0;
+  for (int n = 0; n < epochs; ++n) {
+    OSDMap::Incremental inc;
+    bench_make_incremental(*cur, n, &temps, &inc);
+    if (inc.crush.length()) {
+      ++crush_changes;
+    }
+
+    bufferlist prev_bl;
+    cur->encode(prev_bl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
+    utime_t start = ceph_clock_now();
+    {
+      OSDMap decoded;
+      decoded.decode(prev_bl);
+      decoded.apply_incremental(inc);
+    }
+    decode_apply += ceph_clock_now() - start;
+
+    start = ceph_clock_now();
+    auto next = std::make_shared<OSDMap>();
+    next->deepish_copy_from(*cur);
+    int r = next->apply_incremental(inc);
+    copy_apply += ceph_clock_now() - start;
+    if (r < 0) {
+      cerr << "apply_incremental e" << inc.epoch << " failed: "
+	   << cpp_strerror(r) << std::endl;
+      tp.stop();
+      return r;
+    }
+    auto prev_crush = cur->crush;
+    cur = next;
+
+    start = ceph_clock_now();
+    full_mapping.update(*cur);
+    full_map += ceph_clock_now() - start;
+
+    std::set<int64_t> pools;
+    std::set<pg_t> pgs;
+    start = ceph_clock_now();
+    if (OSDMapMapping::get_affected_pgs(*cur, prev_crush.get(), inc,
+					&pools, &pgs)) {
+      auto job = inc_mapping.start_update(*cur, mapper, 64, pools, pgs);
+      job->wait();
+      for (auto pool : pools) {
+	remapped += cur->get_pg_pool(pool)->get_pg_num();
+      }
+      remapped += pgs.size();
+    } else {
+      inc_mapping.update(*cur);
+      remapped += full_mapping.get_num_pgs();
+      ++full_remaps;
+    }
+    inc_map += ceph_clock_now() - start;
+  }
+  tp.stop();
+
+  // the incrementally maintained mapping must match the full one
+  for (auto& p : cur->get_pools()) {
+    for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+      pg_t pgid(ps, p.first);
+      vector<int> up, acting, fup, facting;
+      int upp, actingp, fupp, factingp;
+      inc_mapping.get(pgid, &up, &upp, &acting, &actingp);
+      full_mapping.get(pgid, &fup, &fupp, &facting, &factingp);
+      if (up != fup || upp != fupp || acting != facting || actingp != factingp) {
+	cerr << pgid << " incremental mapping up " << up << " acting " << acting
+	     << " != full mapping up " << fup << " acting " << facting
+	     << std::endl;
+	return -EIO;
+      }
+    }
+  }
+
+  cout << "applied " << epochs << " incrementals (" << crush_changes
+       << " with crush changes) to a map with " << full_mapping.get_num_pgs()
+       << " pgs" << std::endl;
+  cout << " apply_incremental: decode+apply " << decode_apply / epochs * 1000000
+       << " us/epoch, copy+apply " << copy_apply / epochs * 1000000
+       << " us/epoch" << std::endl;
+  cout << " pg mapping: full " << full_map / epochs * 1000000
+       << " us/epoch, incremental " << inc_map / epochs * 1000000
+       << " us/epoch (" << remapped / epochs << " pgs/epoch, "
+       << full_remaps << " full remaps)" << std::endl;
+  return 0;
+}
+
 int main(int argc, const char **argv)
 {
   vector<const char*> args;
@@ -158,6 +318,7 @@ int main(int argc, const char **argv)
   int64_t pg_num = -1;
   bool test_map_pgs_dump_all = false;
   bool save = false;
+  int bench_apply_inc = 0;
 
   std::string val;
   std::ostringstream err;
@@ -261,6 +422,11 @@ int main(int argc, const char **argv)
       adjust_crush_weight = val;
     } else if (ceph_argparse_flag(args, i, "--save", (char*)NULL)) {
       save = true;
+    } else if (ceph_argparse_witharg(args, i, &bench_apply_inc, err, "--bench-apply-inc", (char*)NULL)) {
+      if (!err.str().empty()) {
+        cerr << err.str() << std::endl;
+        exit(EXIT_FAILURE);
+      }
     } else {
       ++i;
     }
@@ -784,11 +950,19 @@ skip_upmap:
     }
   }
 
+  if (bench_apply_inc > 0) {
+    int r = bench_apply_incremental(osdmap, bench_apply_inc);
+    if (r < 0) {
+      exit(1);
+    }
+  }
+
   if (!print && !health && !tree && !modified &&
       export_crush.empty() && import_crush.empty() && 
       test_map_pg.empty() && test_map_object.empty() &&
       !test_map_pgs && !test_map_pgs_dump && !test_map_pgs_dump_all &&
-      adjust_crush_weight.empty() && !upmap && !upmap_cleanup) {
+      adjust_crush_weight.empty() && !upmap && !upmap_cleanup &&
+      bench_apply_inc <= 0) {
     cerr << me << ": no action specified?" << std::endl;
     usage();
   }